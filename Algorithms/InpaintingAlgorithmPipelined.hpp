@@ -0,0 +1,301 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef InpaintingAlgorithmPipelined_hpp
+#define InpaintingAlgorithmPipelined_hpp
+
+// Concepts
+#include "Concepts/InpaintingVisitorConcept.hpp"
+
+// Boost
+#include <boost/graph/properties.hpp>
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Custom
+#include <BoostHelpers/BoostHelpers.h>
+#include <ITKHelpers/ITKHelpers.h>
+
+/** This is InpaintingAlgorithm with the search for the next target overlapped with the FinishVertex() of the
+  * current target (which updates the mask, the priorities and the boundary queue).
+  *
+  * After the current target is painted, the most likely next target is guessed: the first of the next boundary
+  * nodes (IndirectPriorityQueue::peek) whose patch does not overlap the current target patch, so that the fill
+  * does not change it. While FinishVertex() runs, a dedicated thread searches for its best source patch. (A task of
+  * the TaskPool could wait in the queue behind the tasks of FinishVertex(), or be run inline by the wait for it,
+  * and then the search would not overlap FinishVertex() at all.)
+  * The candidates (all of the vertices of the graph) are searched in chunks of 'chunkSize', and the chunks that
+  * contain vertices of the current target patch are skipped, because FinishVertex() can change their descriptors.
+  *
+  * When the queue's actual next target is the guessed one, the skipped chunks are searched and the best of the
+  * chunk results is used. Otherwise the speculative search is cancelled (it stops at the end of the chunk it is
+  * searching) and the actual target is searched as in InpaintingAlgorithm.
+  *
+  * The best of the chunk results is the best of all of the candidates, so the result is the same as the result of
+  * InpaintingAlgorithm if the bestPatchFinder breaks ties in favor of the first element of the range (see
+  * LinearSearchBestProperty::SetDeterministic()). The visitor's FinishVertex() must not change the descriptors of
+  * vertices outside of the target patch (InpaintingVisitor does not), and the bestPatchFinder must be safe to
+  * use while FinishVertex() runs.
+  */
+template <typename TVertexListGraph, typename TInpaintingVisitor,
+          typename TPriorityQueue, typename TBestPatchFinder,
+          typename TPatchInpainter>
+inline void
+InpaintingAlgorithmPipelined(std::shared_ptr<TVertexListGraph> graph,
+                             std::shared_ptr<TInpaintingVisitor> visitor,
+                             std::shared_ptr<TPriorityQueue> boundaryNodeQueue,
+                             std::shared_ptr<TBestPatchFinder> bestPatchFinder,
+                             std::shared_ptr<TPatchInpainter> patchInpainter,
+                             const unsigned int patchHalfWidth,
+                             const unsigned int chunkSize = 4096)
+{
+  BOOST_CONCEPT_ASSERT((InpaintingVisitorConcept<TInpaintingVisitor, TVertexListGraph>));
+
+  typedef typename boost::graph_traits<TVertexListGraph>::vertex_descriptor VertexDescriptorType;
+  typedef typename boost::graph_traits<TVertexListGraph>::vertex_iterator VertexIteratorType;
+
+  if(chunkSize == 0)
+  {
+    throw std::runtime_error("InpaintingAlgorithmPipelined: chunkSize must be at least 1!");
+  }
+
+  // Create a list of the source patches to search (all of them)
+  VertexIteratorType graphBeginIterator;
+  VertexIteratorType graphEndIterator;
+  tie(graphBeginIterator, graphEndIterator) = vertices(*graph);
+
+  const long numberOfVertices = graphEndIterator - graphBeginIterator;
+  const long numberOfChunks = (numberOfVertices + chunkSize - 1) / chunkSize;
+
+  // The search of one chunk. A chunk without source patches is marked as having no result.
+  auto searchChunk = [&](const long chunkId, const VertexDescriptorType& query,
+                         std::vector<VertexDescriptorType>& chunkResults, std::vector<char>& chunkHasResult)
+  {
+    VertexIteratorType chunkBegin = graphBeginIterator + chunkId * chunkSize;
+    VertexIteratorType chunkEnd = graphBeginIterator + std::min(numberOfVertices, (chunkId + 1) * chunkSize);
+    VertexDescriptorType result = (*bestPatchFinder)(chunkBegin, chunkEnd, query);
+    chunkResults[chunkId] = result;
+    chunkHasResult[chunkId] = (std::find(chunkBegin, chunkEnd, result) != chunkEnd);
+  };
+
+  // The search for the guessed next target
+  struct SpeculativeSearch
+  {
+    VertexDescriptorType Target;
+    std::vector<VertexDescriptorType> ChunkResults;
+    std::vector<char> ChunkHasResult;
+
+    /** The chunks that the speculative search skipped because FinishVertex() could change them. */
+    std::vector<char> ChunkSkipped;
+
+    std::atomic<bool> Cancelled;
+  };
+  std::unique_ptr<SpeculativeSearch> speculativeSearch;
+  std::thread speculativeThread;
+
+  // An exception of the speculative search, which is rethrown on this thread
+  std::exception_ptr speculativeException;
+
+  unsigned int iteration = 0;
+  unsigned int numberOfSpeculativeSearches = 0;
+  unsigned int numberOfUsedSpeculativeSearches = 0;
+
+  if(boundaryNodeQueue->empty())
+  {
+    visitor->InpaintingComplete();
+    return;
+  }
+
+  VertexDescriptorType targetNode = boundaryNodeQueue->top(); // This also pops the node
+
+  while(true)
+  {
+    // Notify the visitor that we have a hole target center.
+    visitor->DiscoverVertex(targetNode);
+
+    // Find the source node that matches best to the target node
+    VertexDescriptorType sourceNode;
+    if(speculativeSearch && speculativeSearch->Target == targetNode)
+    {
+      for(long chunkId = 0; chunkId < numberOfChunks; ++chunkId)
+      {
+        if(speculativeSearch->ChunkSkipped[chunkId])
+        {
+          searchChunk(chunkId, targetNode, speculativeSearch->ChunkResults, speculativeSearch->ChunkHasResult);
+        }
+      }
+
+      std::vector<VertexDescriptorType> chunkWinners;
+      for(long chunkId = 0; chunkId < numberOfChunks; ++chunkId)
+      {
+        if(speculativeSearch->ChunkHasResult[chunkId])
+        {
+          chunkWinners.push_back(speculativeSearch->ChunkResults[chunkId]);
+        }
+      }
+
+      if(chunkWinners.empty())
+      {
+        sourceNode = (*bestPatchFinder)(graphBeginIterator, graphEndIterator, targetNode);
+      }
+      else
+      {
+        // Some finders read *last (e.g. as the result when nothing is found), so keep a valid element there
+        chunkWinners.push_back(chunkWinners.back());
+        sourceNode = (*bestPatchFinder)(chunkWinners.begin(), chunkWinners.end() - 1, targetNode);
+      }
+
+      numberOfUsedSpeculativeSearches++;
+    }
+    else
+    {
+      sourceNode = (*bestPatchFinder)(graphBeginIterator, graphEndIterator, targetNode);
+    }
+    speculativeSearch.reset();
+
+    visitor->PotentialMatchMade(targetNode, sourceNode);
+
+    // Inpaint the target patch from the source patch.
+    itk::Index<2> targetIndex = ITKHelpers::CreateIndex(targetNode);
+    itk::Index<2> sourceIndex = ITKHelpers::CreateIndex(sourceNode);
+
+    patchInpainter->PaintPatch(targetIndex, sourceIndex);
+
+    // Guess the next target: the first of the next nodes whose patch the fill does not change
+    itk::ImageRegion<2> targetRegion = ITKHelpers::GetRegionInRadiusAroundPixel(targetIndex, patchHalfWidth);
+    std::vector<VertexDescriptorType> nextNodes = boundaryNodeQueue->peek(8);
+    for(size_t nextNodeId = 0; nextNodeId < nextNodes.size(); ++nextNodeId)
+    {
+      itk::ImageRegion<2> nextRegion =
+          ITKHelpers::GetRegionInRadiusAroundPixel(ITKHelpers::CreateIndex(nextNodes[nextNodeId]), patchHalfWidth);
+      // Crop() returns false (and leaves the region unchanged) if the regions do not overlap.
+      if(nextNodes[nextNodeId] == targetNode || nextRegion.Crop(targetRegion))
+      {
+        continue;
+      }
+
+      speculativeSearch.reset(new SpeculativeSearch);
+      speculativeSearch->Target = nextNodes[nextNodeId];
+      speculativeSearch->ChunkResults.resize(numberOfChunks);
+      speculativeSearch->ChunkHasResult.resize(numberOfChunks, 0);
+      speculativeSearch->ChunkSkipped.resize(numberOfChunks, 0);
+      speculativeSearch->Cancelled = false;
+      break;
+    }
+
+    if(speculativeSearch)
+    {
+      // The guessed target's patch is not changed by the fill, so its descriptor can be prepared now
+      visitor->DiscoverVertex(speculativeSearch->Target);
+      numberOfSpeculativeSearches++;
+
+      SpeculativeSearch* search = speculativeSearch.get();
+      speculativeThread = std::thread([&, search, targetRegion]()
+      {
+        try
+        {
+          for(long chunkId = 0; chunkId < numberOfChunks && !search->Cancelled; ++chunkId)
+          {
+            VertexIteratorType chunkBegin = graphBeginIterator + chunkId * chunkSize;
+            VertexIteratorType chunkEnd = graphBeginIterator +
+                                          std::min(numberOfVertices, (chunkId + 1) * chunkSize);
+            for(VertexIteratorType vertexIterator = chunkBegin; vertexIterator != chunkEnd; ++vertexIterator)
+            {
+              if(targetRegion.IsInside(ITKHelpers::CreateIndex(*vertexIterator)))
+              {
+                search->ChunkSkipped[chunkId] = 1;
+                break;
+              }
+            }
+
+            if(!search->ChunkSkipped[chunkId])
+            {
+              searchChunk(chunkId, search->Target, search->ChunkResults, search->ChunkHasResult);
+            }
+          }
+        }
+        catch(...)
+        {
+          speculativeException = std::current_exception();
+        }
+      });
+    }
+
+    // This updates the mask, the priorities and the queue while the speculative search runs
+    try
+    {
+      visitor->FinishVertex(targetNode, sourceNode);
+    }
+    catch(...)
+    {
+      if(speculativeThread.joinable())
+      {
+        speculativeSearch->Cancelled = true;
+        speculativeThread.join();
+      }
+      throw;
+    }
+
+    iteration++;
+
+    bool done = boundaryNodeQueue->empty();
+    if(!done)
+    {
+      targetNode = boundaryNodeQueue->top(); // This also pops the node
+    }
+
+    if(speculativeSearch)
+    {
+      if(done || speculativeSearch->Target != targetNode)
+      {
+        speculativeSearch->Cancelled = true;
+      }
+
+      // The speculative search must be finished before the next DiscoverVertex() changes its query descriptor
+      speculativeThread.join();
+      if(speculativeException)
+      {
+        std::rethrow_exception(speculativeException);
+      }
+
+      if(speculativeSearch->Cancelled)
+      {
+        speculativeSearch.reset();
+      }
+    }
+
+    if(done)
+    {
+      break;
+    }
+  } // end main iteration loop
+
+  std::cout << "Inpainting complete after " << iteration << " iterations. "
+            << numberOfUsedSpeculativeSearches << " of " << numberOfSpeculativeSearches
+            << " speculative searches were used." << std::endl;
+  visitor->InpaintingComplete();
+}
+
+#endif
@@ -0,0 +1,245 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef InpaintingAlgorithmSpeculativeParallel_hpp
+#define InpaintingAlgorithmSpeculativeParallel_hpp
+
+// Concepts
+#include "Concepts/InpaintingVisitorConcept.hpp"
+
+// Boost
+#include <boost/graph/properties.hpp>
+
+// STL
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+// Custom
+#include <BoostHelpers/BoostHelpers.h>
+#include <ITKHelpers/ITKHelpers.h>
+#include "Utilities/TaskPool.h"
+
+/** Determine if the regions of 'radius' around 'a' and around 'b' overlap. */
+inline bool SpeculativeRegionsOverlap(const itk::Index<2>& a, const itk::Index<2>& b, const unsigned int radius)
+{
+  itk::ImageRegion<2> regionA = ITKHelpers::GetRegionInRadiusAroundPixel(a, radius);
+  itk::ImageRegion<2> regionB = ITKHelpers::GetRegionInRadiusAroundPixel(b, radius);
+
+  // Crop() returns false (and leaves the region unchanged) if the regions do not overlap.
+  return regionA.Crop(regionB);
+}
+
+/** This is InpaintingAlgorithmWithSourcePatchBank with the searches of several targets run concurrently.
+  * When the result for the target at the top of the queue is not known yet, up to 'batchSize' - 1 of the
+  * next boundary nodes (IndirectPriorityQueue::peek) are chosen whose patch regions dilated by
+  * 'patchHalfWidth' do not overlap the target's or each other's, and all of their searches are run in
+  * parallel (as tasks of the TaskPool, so the bestPatchFinder must be safe to call concurrently and must not
+  * depend on the previous searches). Because the dilated regions are disjoint, filling one of them neither
+  * changes the other target patches nor the priorities of the other targets.
+  *
+  * LinearSearchBestProperty (the finder of the drivers, e.g. ClassicalImageInpainting) and
+  * LinearSearchBestPropertyNoCheck meet this requirement: a search only reads the property map and the
+  * image, and does not write to the finder.
+  * Finders that keep state between searches do not (PatchMatchNearestNeighbor's NN field,
+  * LinearSearchBestFFTSSD's tile cache, and VPTreeSearchBest::operator(), which can rebuild the tree).
+  *
+  * In strict mode the targets are still taken from the queue one at a time in exactly the serial order,
+  * and a speculative result is only used when its target comes to the top of the queue. A speculative
+  * result is thrown away (and that search re-run when the target comes to the top) if a fill since
+  * the search overlapped its target patch, or if new source patches were added to the bank since the
+  * search. So the output is the same as the output of InpaintingAlgorithmWithSourcePatchBank.
+  *
+  * In relaxed mode every speculative target of a batch that is still on the boundary is filled right
+  * after the batch's first target, without waiting for it to come to the top of the queue, and the source
+  * patches added by the earlier fills of the batch are not searched. This gives the most parallelism,
+  * but the fill order (and so the result) can differ from the serial algorithm.
+  */
+template <typename TVertexListGraph, typename TInpaintingVisitor,
+          typename TPriorityQueue, typename TSourcePatchBank, typename TBestPatchFinder,
+          typename TPatchInpainter>
+inline void
+InpaintingAlgorithmSpeculativeParallel(std::shared_ptr<TVertexListGraph> graph,
+                                       std::shared_ptr<TInpaintingVisitor> visitor,
+                                       std::shared_ptr<TPriorityQueue> boundaryNodeQueue,
+                                       std::shared_ptr<TSourcePatchBank> sourcePatchBank,
+                                       std::shared_ptr<TBestPatchFinder> bestPatchFinder,
+                                       std::shared_ptr<TPatchInpainter> patchInpainter,
+                                       const unsigned int patchHalfWidth,
+                                       const unsigned int batchSize,
+                                       const bool strict = true)
+{
+  BOOST_CONCEPT_ASSERT((InpaintingVisitorConcept<TInpaintingVisitor, TVertexListGraph>));
+
+  typedef typename boost::graph_traits<TVertexListGraph>::vertex_descriptor VertexDescriptorType;
+
+  if(batchSize == 0)
+  {
+    throw std::runtime_error("InpaintingAlgorithmSpeculativeParallel: batchSize must be at least 1!");
+  }
+
+  // A search result that was computed before its target came to the top of the queue.
+  struct SpeculativeMatch
+  {
+    VertexDescriptorType SourceNode;
+
+    /** The number of source patches in the bank when the search was run. */
+    size_t NumberOfSourcePatches;
+  };
+  typedef std::map<VertexDescriptorType, SpeculativeMatch> SpeculativeMatchMapType;
+  SpeculativeMatchMapType speculativeMatches;
+
+  // Targets further apart than this are not affected by each other's fills
+  const unsigned int dilatedRadius = 2 * patchHalfWidth;
+
+  // How many of the next boundary nodes to look at to find the targets of a batch
+  const unsigned int lookAhead = 4 * batchSize;
+
+  unsigned int iteration = 0;
+  unsigned int numberOfSpeculativeSearches = 0;
+  unsigned int numberOfUsedSpeculativeSearches = 0;
+
+  // Fill 'targetNode' from 'sourceNode' and throw away the speculative results that the fill invalidated.
+  auto commit = [&](const VertexDescriptorType& targetNode, const VertexDescriptorType& sourceNode)
+  {
+    visitor->PotentialMatchMade(targetNode, sourceNode);
+
+    // Inpaint the target patch from the source patch.
+    itk::Index<2> targetIndex = ITKHelpers::CreateIndex(targetNode);
+    itk::Index<2> sourceIndex = ITKHelpers::CreateIndex(sourceNode);
+
+    patchInpainter->PaintPatch(targetIndex, sourceIndex);
+
+    // This may add new source patches to the bank (if the visitor allows new patches)
+    visitor->FinishVertex(targetNode, sourceNode);
+
+    speculativeMatches.erase(targetNode);
+    for(typename SpeculativeMatchMapType::iterator matchIterator = speculativeMatches.begin();
+        matchIterator != speculativeMatches.end(); )
+    {
+      if(SpeculativeRegionsOverlap(ITKHelpers::CreateIndex(matchIterator->first), targetIndex, patchHalfWidth))
+      {
+        speculativeMatches.erase(matchIterator++);
+      }
+      else
+      {
+        ++matchIterator;
+      }
+    }
+
+    iteration++;
+  };
+
+  while(!boundaryNodeQueue->empty())
+  {
+    VertexDescriptorType targetNode = boundaryNodeQueue->top(); // This also pops the node
+
+    // Notify the visitor that we have a hole target center.
+    visitor->DiscoverVertex(targetNode);
+
+    typename SpeculativeMatchMapType::const_iterator speculativeMatch = speculativeMatches.find(targetNode);
+    if(speculativeMatch != speculativeMatches.end() &&
+       speculativeMatch->second.NumberOfSourcePatches == sourcePatchBank->size())
+    {
+      // Copy the source node, the match is erased by the commit
+      VertexDescriptorType sourceNode = speculativeMatch->second.SourceNode;
+      numberOfUsedSpeculativeSearches++;
+      commit(targetNode, sourceNode);
+      continue;
+    }
+
+    // Choose the targets to search along with this one
+    std::vector<VertexDescriptorType> batch(1, targetNode);
+    std::vector<VertexDescriptorType> nextNodes = boundaryNodeQueue->peek(lookAhead);
+    for(size_t nextNodeId = 0; nextNodeId < nextNodes.size() && batch.size() < batchSize; ++nextNodeId)
+    {
+      // Do not search again for the targets that already have a usable result
+      speculativeMatch = speculativeMatches.find(nextNodes[nextNodeId]);
+      if(speculativeMatch != speculativeMatches.end() &&
+         speculativeMatch->second.NumberOfSourcePatches == sourcePatchBank->size())
+      {
+        continue;
+      }
+
+      bool overlaps = false;
+      for(size_t batchId = 0; batchId < batch.size(); ++batchId)
+      {
+        if(nextNodes[nextNodeId] == batch[batchId] ||
+           SpeculativeRegionsOverlap(ITKHelpers::CreateIndex(nextNodes[nextNodeId]),
+                                     ITKHelpers::CreateIndex(batch[batchId]), dilatedRadius))
+        {
+          overlaps = true;
+          break;
+        }
+      }
+
+      if(!overlaps)
+      {
+        visitor->DiscoverVertex(nextNodes[nextNodeId]);
+        batch.push_back(nextNodes[nextNodeId]);
+      }
+    }
+
+    // Find the source node that matches best to each target node. A bestPatchFinder that parallelizes its
+    // own search runs it on the same threads (see TaskPool).
+    std::vector<VertexDescriptorType> sourceNodes(batch.size());
+    TaskPool::GetGlobalInstance().ParallelFor(0, static_cast<long>(batch.size()), [&](const long batchId)
+    {
+      sourceNodes[batchId] = (*bestPatchFinder)(sourcePatchBank->begin(), sourcePatchBank->end(), batch[batchId]);
+    });
+
+    numberOfSpeculativeSearches += batch.size() - 1;
+
+    if(strict)
+    {
+      // Keep the other results until their targets come to the top of the queue
+      for(size_t batchId = 1; batchId < batch.size(); ++batchId)
+      {
+        SpeculativeMatch match = {sourceNodes[batchId], sourcePatchBank->size()};
+        speculativeMatches[batch[batchId]] = match;
+      }
+
+      commit(targetNode, sourceNodes[0]);
+    }
+    else
+    {
+      commit(targetNode, sourceNodes[0]);
+
+      for(size_t batchId = 1; batchId < batch.size(); ++batchId)
+      {
+        // The target can only have left the boundary through a fill outside of this batch
+        if(!get(*(boundaryNodeQueue->GetBoundaryStatusMap()), batch[batchId]))
+        {
+          continue;
+        }
+
+        boundaryNodeQueue->mark_as_invalid(batch[batchId]);
+        numberOfUsedSpeculativeSearches++;
+        commit(batch[batchId], sourceNodes[batchId]);
+      }
+    }
+  } // end main iteration loop
+
+  std::cout << "Inpainting complete after " << iteration << " iterations. "
+            << numberOfUsedSpeculativeSearches << " of " << numberOfSpeculativeSearches
+            << " speculative searches were used." << std::endl;
+  visitor->InpaintingComplete();
+}
+
+#endif
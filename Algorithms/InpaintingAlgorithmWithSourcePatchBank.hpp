@@ -0,0 +1,89 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef InpaintingAlgorithmWithSourcePatchBank_hpp
+#define InpaintingAlgorithmWithSourcePatchBank_hpp
+
+// Concepts
+#include "Concepts/InpaintingVisitorConcept.hpp"
+
+// Boost
+#include <boost/graph/properties.hpp>
+
+// STL
+#include <stdexcept>
+#include <memory>
+
+// Custom
+#include <BoostHelpers/BoostHelpers.h>
+
+/** This is the same as InpaintingAlgorithm, but instead of passing every vertex of the graph to the
+  * bestPatchFinder at each iteration, only the nodes in 'sourcePatchBank' are searched. The bank is
+  * built once from the mask before the algorithm is started. If the visitor allows new source patches,
+  * the same bank should be given to the visitor (InpaintingVisitor::SetSourcePatchBank) so that it is
+  * kept up to date as patches are filled.
+  */
+template <typename TVertexListGraph, typename TInpaintingVisitor,
+          typename TPriorityQueue, typename TSourcePatchBank, typename TBestPatchFinder,
+          typename TPatchInpainter>
+inline void
+InpaintingAlgorithmWithSourcePatchBank(std::shared_ptr<TVertexListGraph> graph,
+                                       std::shared_ptr<TInpaintingVisitor> visitor,
+                                       std::shared_ptr<TPriorityQueue> boundaryNodeQueue,
+                                       std::shared_ptr<TSourcePatchBank> sourcePatchBank,
+                                       std::shared_ptr<TBestPatchFinder> bestPatchFinder,
+                                       std::shared_ptr<TPatchInpainter> patchInpainter)
+{
+  BOOST_CONCEPT_ASSERT((InpaintingVisitorConcept<TInpaintingVisitor, TVertexListGraph>));
+
+  typedef typename boost::graph_traits<TVertexListGraph>::vertex_descriptor VertexDescriptorType;
+
+  std::cout << "At the beginning of the algorithm there are " << sourcePatchBank->size()
+            << " source patches." << std::endl;
+
+  unsigned int iteration = 0;
+
+  while(!boundaryNodeQueue->empty())
+  {
+    VertexDescriptorType targetNode = boundaryNodeQueue->top(); // This also pops the node
+
+    // Notify the visitor that we have a hole target center.
+    visitor->DiscoverVertex(targetNode);
+
+    // Find the source node that matches best to the target node
+    VertexDescriptorType sourceNode = (*bestPatchFinder)(sourcePatchBank->begin(), sourcePatchBank->end(), targetNode);
+    visitor->PotentialMatchMade(targetNode, sourceNode);
+
+    // Inpaint the target patch from the source patch.
+    itk::Index<2> targetIndex = ITKHelpers::CreateIndex(targetNode);
+    itk::Index<2> sourceIndex = ITKHelpers::CreateIndex(sourceNode);
+
+    patchInpainter->PaintPatch(targetIndex, sourceIndex);
+
+    // This may add new source patches to the bank (if the visitor allows new patches)
+    visitor->FinishVertex(targetNode, sourceNode);
+
+    iteration++;
+  } // end main iteration loop
+
+  std::cout << "Inpainting complete after " << iteration
+            << " iterations." << std::endl;
+  visitor->InpaintingComplete();
+}
+
+#endif
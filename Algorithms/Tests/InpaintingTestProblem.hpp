@@ -0,0 +1,279 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef InpaintingTestProblem_HPP
+#define InpaintingTestProblem_HPP
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+// Submodules
+#include <Helpers/Helpers.h>
+#include <Mask/Mask.h>
+#include <Mask/MaskOperations.h>
+#include <ITKHelpers/ITKHelpers.h>
+
+// Custom
+#include "Utilities/IndirectPriorityQueue.h"
+#include "Utilities/SourcePatchBank.hpp"
+
+// Pixel descriptors
+#include "PixelDescriptors/ImagePatchPixelDescriptor.h"
+
+// Descriptor visitors
+#include "Visitors/DescriptorVisitors/ImagePatchDescriptorVisitor.hpp"
+
+// Inpainting visitors
+#include "Visitors/InpaintingVisitors/InpaintingVisitor.hpp"
+#include "Visitors/AcceptanceVisitors/DefaultAcceptanceVisitor.hpp"
+
+// Nearest neighbors
+#include "NearestNeighbor/LinearSearchBest/Property.hpp"
+
+// Initializers
+#include "Initializers/InitializeFromMaskImage.hpp"
+#include "Initializers/InitializePriority.hpp"
+
+// Inpainters
+#include "Inpainters/CompositePatchInpainter.hpp"
+#include "Inpainters/PatchInpainter.hpp"
+
+// Difference functions
+#include "DifferenceFunctions/Patch/ImagePatchDifference.hpp"
+#include "DifferenceFunctions/Pixel/SumSquaredPixelDifference.hpp"
+
+// Priority
+#include "Priority/PriorityCriminisi.h"
+
+// Boost
+#include <boost/graph/grid_graph.hpp>
+#include <boost/property_map/property_map.hpp>
+
+// STL
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/** The (target, source) pixels of every fill, in the order of the fills. */
+typedef std::vector<std::pair<itk::Index<2>, itk::Index<2> > > FillLogType;
+
+/** Record every fill of the wrapped inpainter. */
+template <typename TPatchInpainter>
+struct LoggingPatchInpainter
+{
+  std::shared_ptr<TPatchInpainter> PatchInpainter;
+
+  FillLogType FillLog;
+
+  LoggingPatchInpainter(std::shared_ptr<TPatchInpainter> patchInpainter) : PatchInpainter(patchInpainter) {}
+
+  void PaintPatch(const itk::Index<2>& targetPatchCenter, const itk::Index<2>& sourcePatchCenter)
+  {
+    this->FillLog.push_back(std::make_pair(targetPatchCenter, sourcePatchCenter));
+    this->PatchInpainter->PaintPatch(targetPatchCenter, sourcePatchCenter);
+  }
+};
+
+/** Everything the inpainting algorithms need to inpaint a textured test image as ClassicalImageInpainting
+  * does, with a deterministic LinearSearchBestProperty, so that the algorithms that should give the same
+  * result as InpaintingAlgorithm (or InpaintingAlgorithmWithSourcePatchBank) can be run on a fresh copy each
+  * and compared with SameResult(). */
+struct InpaintingTestProblem
+{
+  typedef itk::Image<itk::CovariantVector<unsigned char, 3>, 2> ImageType;
+
+  typedef boost::grid_graph<2> VertexListGraphType;
+  typedef boost::graph_traits<VertexListGraphType>::vertex_descriptor VertexDescriptorType;
+
+  typedef IndirectPriorityQueue<VertexListGraphType> BoundaryNodeQueueType;
+
+  typedef ImagePatchPixelDescriptor<ImageType> ImagePatchPixelDescriptorType;
+  typedef boost::vector_property_map<ImagePatchPixelDescriptorType,
+      BoundaryNodeQueueType::IndexMapType> ImagePatchDescriptorMapType;
+
+  typedef PriorityCriminisi<ImageType> PriorityType;
+
+  typedef ImagePatchDescriptorVisitor<VertexListGraphType, ImageType, ImagePatchDescriptorMapType>
+      ImagePatchDescriptorVisitorType;
+
+  typedef DefaultAcceptanceVisitor<VertexListGraphType> AcceptanceVisitorType;
+
+  typedef InpaintingVisitor<VertexListGraphType, BoundaryNodeQueueType,
+                            ImagePatchDescriptorVisitorType, AcceptanceVisitorType, PriorityType>
+                            InpaintingVisitorType;
+
+  typedef InpaintingVisitorType::SourcePatchBankType SourcePatchBankType;
+
+  typedef ImagePatchDifference<ImagePatchPixelDescriptorType,
+      SumSquaredPixelDifference<ImageType::PixelType> > PatchDifferenceType;
+  typedef LinearSearchBestProperty<ImagePatchDescriptorMapType, PatchDifferenceType> BestSearchType;
+
+  typedef LoggingPatchInpainter<CompositePatchInpainter> InpainterType;
+
+  ImageType::Pointer Image;
+  Mask::Pointer MaskImage;
+
+  std::shared_ptr<VertexListGraphType> Graph;
+  std::shared_ptr<BoundaryNodeQueueType> BoundaryNodeQueue;
+  std::shared_ptr<ImagePatchDescriptorMapType> ImagePatchDescriptorMap;
+  std::shared_ptr<InpaintingVisitorType> Visitor;
+  std::shared_ptr<SourcePatchBankType> SourcePatchBank;
+  std::shared_ptr<BestSearchType> BestSearch;
+  std::shared_ptr<InpainterType> Inpainter;
+
+  /** A 'size' x 'size' image with a square hole of 'holeSize' in the middle. If 'allowNewPatches' is true, the
+    * filled patches are added to the source patch bank. */
+  InpaintingTestProblem(const unsigned int size, const unsigned int holeSize, const unsigned int patchHalfWidth,
+                        const bool allowNewPatches)
+  {
+    itk::Index<2> corner = {{0, 0}};
+    itk::Size<2> imageSize = {{size, size}};
+    itk::ImageRegion<2> region(corner, imageSize);
+
+    this->Image = ImageType::New();
+    this->Image->SetRegions(region);
+    this->Image->Allocate();
+
+    // A texture with few exactly equal patches, so most searches have a single best patch
+    itk::ImageRegionIteratorWithIndex<ImageType> imageIterator(this->Image, region);
+    while(!imageIterator.IsAtEnd())
+    {
+      itk::Index<2> index = imageIterator.GetIndex();
+      ImageType::PixelType pixel;
+      pixel[0] = (index[0] * index[0] + 3 * index[1]) % 256;
+      pixel[1] = (7 * index[0] + index[1] * index[1]) % 256;
+      pixel[2] = (index[0] * index[1]) % 256;
+      imageIterator.Set(pixel);
+      ++imageIterator;
+    }
+
+    this->MaskImage = Mask::New();
+    this->MaskImage->SetRegions(region);
+    this->MaskImage->Allocate();
+    ITKHelpers::SetImageToConstant(this->MaskImage.GetPointer(), this->MaskImage->GetValidValue());
+
+    itk::Index<2> holeCorner = {{static_cast<itk::IndexValueType>((size - holeSize) / 2),
+                                 static_cast<itk::IndexValueType>((size - holeSize) / 2)}};
+    itk::Size<2> holeRegionSize = {{holeSize, holeSize}};
+    ITKHelpers::SetRegionToConstant(this->MaskImage.GetPointer(), itk::ImageRegion<2>(holeCorner, holeRegionSize),
+                                    this->MaskImage->GetHoleValue());
+
+    ImageType::Pointer blurredImage = ImageType::New();
+    MaskOperations::MaskedBlur(this->Image.GetPointer(), this->MaskImage.GetPointer(), 2.0f,
+                               blurredImage.GetPointer());
+
+    boost::array<std::size_t, 2> graphSideLengths = { { size, size } };
+    this->Graph.reset(new VertexListGraphType(graphSideLengths));
+
+    this->BoundaryNodeQueue.reset(new BoundaryNodeQueueType(*this->Graph));
+
+    this->ImagePatchDescriptorMap.reset(new ImagePatchDescriptorMapType(num_vertices(*this->Graph),
+                                                                        *(this->BoundaryNodeQueue->GetIndexMap())));
+
+    typedef PatchInpainter<ImageType> ImageInpainterType;
+    std::shared_ptr<ImageInpainterType> imagePatchInpainter(new
+        ImageInpainterType(patchHalfWidth, this->Image, this->MaskImage));
+    std::shared_ptr<ImageInpainterType> blurredImagePatchInpainter(new
+        ImageInpainterType(patchHalfWidth, blurredImage, this->MaskImage));
+
+    std::shared_ptr<CompositePatchInpainter> compositeInpainter(new CompositePatchInpainter);
+    compositeInpainter->AddInpainter(imagePatchInpainter);
+    compositeInpainter->AddInpainter(blurredImagePatchInpainter);
+    this->Inpainter.reset(new InpainterType(compositeInpainter));
+
+    std::shared_ptr<PriorityType> priorityFunction(new PriorityType(blurredImage, this->MaskImage, patchHalfWidth));
+
+    std::shared_ptr<ImagePatchDescriptorVisitorType> imagePatchDescriptorVisitor(new
+        ImagePatchDescriptorVisitorType(this->Image.GetPointer(), this->MaskImage, this->ImagePatchDescriptorMap,
+                                        patchHalfWidth));
+
+    std::shared_ptr<AcceptanceVisitorType> acceptanceVisitor(new AcceptanceVisitorType);
+
+    this->Visitor.reset(new InpaintingVisitorType(this->MaskImage, this->BoundaryNodeQueue,
+                                                  imagePatchDescriptorVisitor, acceptanceVisitor,
+                                                  priorityFunction, patchHalfWidth, "InpaintingVisitor"));
+
+    this->SourcePatchBank.reset(new SourcePatchBankType(this->MaskImage, patchHalfWidth));
+    this->Visitor->SetAllowNewPatches(allowNewPatches);
+    this->Visitor->SetSourcePatchBank(this->SourcePatchBank);
+
+    InitializePriority(this->MaskImage.GetPointer(), this->BoundaryNodeQueue.get(), priorityFunction.get());
+    InitializeFromMaskImage<InpaintingVisitorType, VertexDescriptorType>(this->MaskImage, this->Visitor.get());
+
+    this->BestSearch.reset(new BestSearchType(*this->ImagePatchDescriptorMap));
+    this->BestSearch->SetDeterministic(true);
+  }
+};
+
+/** Check that 'actual' filled the same targets from the same sources in the same order as 'expected', and that
+  * the inpainted images are the same. The first difference is written to std::cerr. */
+inline bool SameResult(const InpaintingTestProblem& expected, const InpaintingTestProblem& actual,
+                       const std::string& name)
+{
+  const FillLogType& expectedFillLog = expected.Inpainter->FillLog;
+  const FillLogType& actualFillLog = actual.Inpainter->FillLog;
+
+  if(expectedFillLog.empty())
+  {
+    std::cerr << name << ": Nothing was filled!" << std::endl;
+    return false;
+  }
+
+  for(size_t fillId = 0; fillId < expectedFillLog.size() && fillId < actualFillLog.size(); ++fillId)
+  {
+    if(expectedFillLog[fillId] != actualFillLog[fillId])
+    {
+      std::cerr << name << ": First difference at fill " << fillId << ": target "
+                << expectedFillLog[fillId].first << " was filled from " << expectedFillLog[fillId].second
+                << ", but target " << actualFillLog[fillId].first << " was filled from "
+                << actualFillLog[fillId].second << std::endl;
+      return false;
+    }
+  }
+
+  if(expectedFillLog.size() != actualFillLog.size())
+  {
+    std::cerr << name << ": " << actualFillLog.size() << " fills instead of " << expectedFillLog.size()
+              << "!" << std::endl;
+    return false;
+  }
+
+  itk::ImageRegionConstIterator<InpaintingTestProblem::ImageType> expectedIterator(
+        expected.Image, expected.Image->GetLargestPossibleRegion());
+  itk::ImageRegionConstIterator<InpaintingTestProblem::ImageType> actualIterator(
+        actual.Image, actual.Image->GetLargestPossibleRegion());
+  while(!expectedIterator.IsAtEnd())
+  {
+    if(expectedIterator.Get() != actualIterator.Get())
+    {
+      std::cerr << name << ": The inpainted images are different at " << expectedIterator.GetIndex()
+                << "!" << std::endl;
+      return false;
+    }
+    ++expectedIterator;
+    ++actualIterator;
+  }
+
+  return true;
+}
+
+#endif
@@ -0,0 +1,56 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// Custom
+#include "Utilities/TaskPool.h"
+#include "InpaintingTestProblem.hpp"
+
+// Inpainting
+#include "Algorithms/InpaintingAlgorithm.hpp"
+#include "Algorithms/InpaintingAlgorithmPipelined.hpp"
+
+// STL
+#include <cstdlib>
+#include <iostream>
+
+/** InpaintingAlgorithmPipelined must fill the same targets from the same source patches in the same order as
+  * InpaintingAlgorithm when the finder breaks ties in favor of the first element of the range. The chunks are
+  * small, so that the chunks the speculative search skips and the merging of the chunk results are tested. */
+int main()
+{
+  TaskPool::SetGlobalConfiguration(4);
+
+  const unsigned int imageSize = 60;
+  const unsigned int holeSize = 24;
+  const unsigned int patchHalfWidth = 3;
+  const unsigned int chunkSize = 97;
+
+  InpaintingTestProblem serial(imageSize, holeSize, patchHalfWidth, false);
+  InpaintingAlgorithm(serial.Graph, serial.Visitor, serial.BoundaryNodeQueue, serial.BestSearch, serial.Inpainter);
+
+  InpaintingTestProblem pipelined(imageSize, holeSize, patchHalfWidth, false);
+  InpaintingAlgorithmPipelined(pipelined.Graph, pipelined.Visitor, pipelined.BoundaryNodeQueue,
+                               pipelined.BestSearch, pipelined.Inpainter, patchHalfWidth, chunkSize);
+
+  if(!SameResult(serial, pipelined, "Pipelined"))
+  {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,61 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// Custom
+#include "Utilities/TaskPool.h"
+#include "InpaintingTestProblem.hpp"
+
+// Inpainting
+#include "Algorithms/InpaintingAlgorithmSpeculativeParallel.hpp"
+#include "Algorithms/InpaintingAlgorithmWithSourcePatchBank.hpp"
+
+// STL
+#include <cstdlib>
+#include <iostream>
+
+/** Strict mode must fill the same targets from the same source patches in the same order as
+  * InpaintingAlgorithmWithSourcePatchBank, whether or not the filled patches become new source patches
+  * (which throws away the speculative results computed before they were added). */
+int main()
+{
+  TaskPool::SetGlobalConfiguration(4);
+
+  const unsigned int imageSize = 60;
+  const unsigned int holeSize = 24;
+  const unsigned int patchHalfWidth = 3;
+  const unsigned int batchSize = 4;
+
+  for(unsigned int allowNewPatches = 0; allowNewPatches < 2; ++allowNewPatches)
+  {
+    InpaintingTestProblem serial(imageSize, holeSize, patchHalfWidth, allowNewPatches);
+    InpaintingAlgorithmWithSourcePatchBank(serial.Graph, serial.Visitor, serial.BoundaryNodeQueue,
+                                           serial.SourcePatchBank, serial.BestSearch, serial.Inpainter);
+
+    InpaintingTestProblem speculative(imageSize, holeSize, patchHalfWidth, allowNewPatches);
+    InpaintingAlgorithmSpeculativeParallel(speculative.Graph, speculative.Visitor, speculative.BoundaryNodeQueue,
+                                           speculative.SourcePatchBank, speculative.BestSearch,
+                                           speculative.Inpainter, patchHalfWidth, batchSize, true);
+
+    if(!SameResult(serial, speculative, allowNewPatches ? "Strict mode with new patches" : "Strict mode"))
+    {
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
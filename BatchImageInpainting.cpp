@@ -0,0 +1,77 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// ITK
+#include "itkImage.h"
+#include "itkCovariantVector.h"
+
+// STL
+#include <algorithm>
+#include <sstream>
+
+#include "Drivers/BatchImageInpainting.hpp"
+
+// Run with: jobs.txt timing.txt [maximumNumberOfConcurrentJobs]
+// Each line of jobs.txt is: image.png image.mask patchHalfWidth output.png [numberOfPyramidLevels]
+// The number of threads is set with the PATCHBASEDINPAINTING_NUMBER_OF_THREADS environment variable.
+int main(int argc, char *argv[])
+{
+  // Verify arguments
+  if(argc != 3 && argc != 4)
+  {
+    std::cerr << "Required arguments: jobs.txt timing.txt [maximumNumberOfConcurrentJobs]" << std::endl;
+    std::cerr << "Input arguments: ";
+    for(int i = 1; i < argc; ++i)
+    {
+      std::cerr << argv[i] << " ";
+    }
+    return EXIT_FAILURE;
+  }
+
+  // Parse arguments
+  std::string manifestFileName = argv[1];
+  std::string timingFileName = argv[2];
+
+  unsigned int maximumNumberOfConcurrentJobs = 0;
+  if(argc == 4)
+  {
+    std::stringstream ssMaximumNumberOfConcurrentJobs;
+    ssMaximumNumberOfConcurrentJobs << argv[3];
+    ssMaximumNumberOfConcurrentJobs >> maximumNumberOfConcurrentJobs;
+  }
+
+  typedef itk::Image<itk::CovariantVector<int, 3>, 2> OriginalImageType;
+
+  std::vector<BatchInpaintingJob> jobs = ReadBatchManifest(manifestFileName);
+  std::cout << "Read " << jobs.size() << " jobs." << std::endl;
+
+  std::vector<BatchInpaintingResult> results = BatchImageInpainting<OriginalImageType>(jobs, timingFileName,
+                                                                                     maximumNumberOfConcurrentJobs);
+
+  for(size_t jobId = 0; jobId < results.size(); ++jobId)
+  {
+    if(!results[jobId].Succeeded)
+    {
+      std::cerr << jobs[jobId].ImageFileName << " failed: " << results[jobId].Error << std::endl;
+    }
+  }
+
+  return std::all_of(results.begin(), results.end(),
+                     [](const BatchInpaintingResult& result) { return result.Succeeded; }) ?
+         EXIT_SUCCESS : EXIT_FAILURE;
+}
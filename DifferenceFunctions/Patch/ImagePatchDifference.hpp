@@ -20,10 +20,14 @@
 #define ImagePatchDifference_hpp
 
 // STL
+#include <limits>
 #include <stdexcept>
+#include <type_traits>
 
 #include "PixelDescriptors/ImagePatchPixelDescriptor.h"
 
+#include "SpanDifferenceTraits.hpp"
+
 /** Compute the average difference between corresponding pixels in valid regions of the two patches.
   * This is an average and not a sum because we want to be able to compare "match quality" values between
   * different pairs of patches, in which the source region will not be the same size.
@@ -31,6 +35,10 @@
   * In this class, we do not assume that the provided sourcePatch is actually a SOURCE_NODE.
   * If it IS known that the sourcePatch will definitely be a SOURCE_NODE, we can use
   * ImagePatchDifferenceNoCheck instead.
+  *
+  * If there is a SpanDifferenceTraits specialization for the image type and PixelDifferenceFunctorType
+  * (SSD and SAD of float VectorImages and unsigned char CovariantVector images), the sum is computed
+  * from the image buffer with the vectorized SpanDifferenceKernels using the row bitmasks of the target patch.
   */
 template <typename ImagePatchType, typename PixelDifferenceFunctorType>
 struct ImagePatchDifference
@@ -70,6 +78,11 @@ struct ImagePatchDifference
 
     assert(validOffsets->size() > 0);
 
+    if(this->ComputeSpanDifference(sourcePatch, targetPatch, std::numeric_limits<float>::infinity(), totalDifference))
+    {
+      return totalDifference / static_cast<float>(validOffsets->size());
+    }
+
     for(OffsetVectorType::const_iterator offsetIterator = validOffsets->begin();
         offsetIterator < validOffsets->end(); ++offsetIterator)
     {
@@ -95,6 +108,18 @@ struct ImagePatchDifference
     * been extracted from the image, and the targetPatch has its ValidOffsetsAddresses already computed.*/
   float operator()(const ImagePatchType& sourcePatch, const ImagePatchType& targetPatch,
                    const std::vector<typename ImagePatchType::ImageType::PixelType>& targetPixels) const
+  {
+    return (*this)(sourcePatch, targetPatch, targetPixels, std::numeric_limits<float>::infinity());
+  }
+
+  /** This version of the function stops accumulating as soon as the difference is known to be larger
+    * than 'threshold' (usually the best difference found so far by a search). In that case
+    * std::numeric_limits<float>::max() is returned, otherwise the difference is returned exactly as by the
+    * 3 argument version. A patch whose difference equals 'threshold' is never stopped, so searches can
+    * still break ties.*/
+  float operator()(const ImagePatchType& sourcePatch, const ImagePatchType& targetPatch,
+                   const std::vector<typename ImagePatchType::ImageType::PixelType>& targetPixels,
+                   const float threshold) const
   {
     assert(targetPixels.size() == targetPatch.GetValidOffsetsAddress()->size());
 
@@ -112,6 +137,19 @@ struct ImagePatchDifference
 
     assert(validOffsets->size() > 0);
 
+    // The threshold is on the average difference, so compare the running sum against the scaled threshold
+    const float totalThreshold = SpanDifferenceKernels::GetTotalThreshold(threshold, validOffsets->size());
+
+    // The target pixels are read from the image buffer instead of from 'targetPixels' in this case
+    if(this->ComputeSpanDifference(sourcePatch, targetPatch, totalThreshold, totalDifference))
+    {
+      if(totalDifference == std::numeric_limits<float>::max())
+      {
+        return totalDifference;
+      }
+      return totalDifference / static_cast<float>(validOffsets->size());
+    }
+
     for(OffsetVectorType::const_iterator offsetIterator = validOffsets->begin();
         offsetIterator < validOffsets->end(); ++offsetIterator)
     {
@@ -129,6 +167,12 @@ struct ImagePatchDifference
       float difference = this->PixelDifferenceFunctor(sourcePixel,
                                                       targetPixel);
       totalDifference += difference;
+
+      // The pixel differences are non-negative, so this patch can no longer beat the threshold
+      if(totalDifference > totalThreshold)
+      {
+        return std::numeric_limits<float>::max();
+      }
     }
 
     totalDifference = totalDifference / static_cast<float>(validOffsets->size());
@@ -136,6 +180,49 @@ struct ImagePatchDifference
     return totalDifference;
   }
 
+private:
+  typedef SpanDifferenceTraits<typename ImagePatchType::ImageType, PixelDifferenceFunctorType> SpanTraitsType;
+
+  /** Compute the sum of the pixel differences with the span kernels. Returns false if this is not possible,
+    * in which case the caller must compute the sum one pixel at a time. */
+  bool ComputeSpanDifference(const ImagePatchType& sourcePatch, const ImagePatchType& targetPatch,
+                             const float totalThreshold, float& totalDifference) const
+  {
+    return this->ComputeSpanDifference(sourcePatch, targetPatch, totalThreshold, totalDifference,
+                                       std::integral_constant<bool, SpanTraitsType::Supported>());
+  }
+
+  bool ComputeSpanDifference(const ImagePatchType&, const ImagePatchType&, const float, float&,
+                             std::false_type) const
+  {
+    return false;
+  }
+
+  bool ComputeSpanDifference(const ImagePatchType& sourcePatch, const ImagePatchType& targetPatch,
+                             const float totalThreshold, float& totalDifference, std::true_type) const
+  {
+    const std::vector<uint64_t>* rowMasks = targetPatch.GetValidRowMasksAddress();
+    if(rowMasks->empty())
+    {
+      return false;
+    }
+
+    // Both patches are in the same image, so a row of either patch is 'rowStride' components after the previous one
+    typename ImagePatchType::ImageType* image = targetPatch.GetImage();
+    const unsigned int numberOfComponents = SpanTraitsType::GetNumberOfComponents(image);
+    const size_t rowStride = image->GetBufferedRegion().GetSize()[0] * numberOfComponents;
+
+    const typename SpanTraitsType::ComponentType* buffer = SpanTraitsType::GetBufferPointer(image);
+    const typename SpanTraitsType::ComponentType* source =
+        buffer + image->ComputeOffset(sourcePatch.GetCorner()) * numberOfComponents;
+    const typename SpanTraitsType::ComponentType* target =
+        buffer + image->ComputeOffset(targetPatch.GetCorner()) * numberOfComponents;
+
+    totalDifference = SpanDifferenceKernels::MaskedPatchDifference(source, target, rowStride, numberOfComponents,
+                                                                   *rowMasks, totalThreshold,
+                                                                   typename SpanTraitsType::SpanFunctionType());
+    return true;
+  }
 };
 
 #endif
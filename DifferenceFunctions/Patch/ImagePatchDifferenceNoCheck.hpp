@@ -20,8 +20,10 @@
 #define ImagePatchDifferenceNoCheck_hpp
 
 // STL
+#include <limits>
 #include <stdexcept>
 
+#include "SpanDifferenceKernels.hpp"
 #include "PixelDescriptors/ImagePatchPixelDescriptor.h"
 
 /** Compute the average difference between corresponding pixels in valid regions of the two patches.
@@ -31,11 +33,11 @@
  *  In this class, the 3 argument version of operator() assumes all input patches should be compared.
  */
 template <typename ImagePatchType, typename PixelDifferenceFunctorType>
-struct ImagePatchDifference
+struct ImagePatchDifferenceNoCheck
 {
   PixelDifferenceFunctorType PixelDifferenceFunctor;
 
-  ImagePatchDifference(PixelDifferenceFunctorType pixelDifferenceFunctor = PixelDifferenceFunctorType()) :
+  ImagePatchDifferenceNoCheck(PixelDifferenceFunctorType pixelDifferenceFunctor = PixelDifferenceFunctorType()) :
     PixelDifferenceFunctor(pixelDifferenceFunctor)
   {
     pixelDifferenceFunctor.PrintName();
@@ -90,6 +92,17 @@ struct ImagePatchDifference
     * been extracted from the image, and the targetPatch has its ValidOffsetsAddresses already computed.*/
   float operator()(const ImagePatchType& sourcePatch, const ImagePatchType& targetPatch,
                    const std::vector<typename ImagePatchType::ImageType::PixelType>& targetPixels) const
+  {
+    return (*this)(sourcePatch, targetPatch, targetPixels, std::numeric_limits<float>::infinity());
+  }
+
+  /** This version of the function stops accumulating as soon as the difference is known to be larger
+    * than 'threshold' (usually the best difference found so far by a search). In that case
+    * std::numeric_limits<float>::max() is returned, otherwise the difference is returned exactly as by the
+    * 3 argument version.*/
+  float operator()(const ImagePatchType& sourcePatch, const ImagePatchType& targetPatch,
+                   const std::vector<typename ImagePatchType::ImageType::PixelType>& targetPixels,
+                   const float threshold) const
   {
     assert(targetPixels.size() == targetPatch.GetValidOffsetsAddress()->size());
 
@@ -102,6 +115,9 @@ struct ImagePatchDifference
 
     assert(validOffsets->size() > 0);
 
+    // The threshold is on the average difference, so compare the running sum against the scaled threshold
+    const float totalThreshold = SpanDifferenceKernels::GetTotalThreshold(threshold, validOffsets->size());
+
     for(OffsetVectorType::const_iterator offsetIterator = validOffsets->begin();
         offsetIterator < validOffsets->end(); ++offsetIterator)
     {
@@ -118,8 +134,13 @@ struct ImagePatchDifference
 
       float difference = this->PixelDifferenceFunctor(sourcePixel,
                                                       targetPixel);
-
       totalDifference += difference;
+
+      // The pixel differences are non-negative, so this patch can no longer beat the threshold
+      if(totalDifference > totalThreshold)
+      {
+        return std::numeric_limits<float>::max();
+      }
     }
 
     totalDifference = totalDifference / static_cast<float>(validOffsets->size());
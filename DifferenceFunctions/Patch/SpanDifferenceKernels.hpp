@@ -0,0 +1,407 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef SpanDifferenceKernels_hpp
+#define SpanDifferenceKernels_hpp
+
+// Custom
+#include "Utilities/RowMasks.hpp"
+
+// STL
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+// The instruction set is chosen at compile time (e.g. with -msse4.1, -mavx2 or -march=native, see the
+// PatchBasedInpainting_UseNativeInstructions CMake option). Without any of these the scalar versions are used.
+#if defined(__SSE4_1__) || defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+/** These functions compute the SSD and the SAD between two contiguous runs ("spans") of pixel components,
+  * and the masked difference between two patches by splitting each patch row into the spans of valid pixels.
+  * The valid pixels of each row are given as a bitmask (see RowMasks), so patches can be at most 64 pixels
+  * wide.
+  */
+namespace SpanDifferenceKernels
+{
+
+/** Get the name of the instruction set the kernels were compiled for. */
+inline const char* GetInstructionSetName()
+{
+#if defined(__AVX512F__)
+  return "AVX-512";
+#elif defined(__AVX2__)
+  return "AVX2";
+#elif defined(__SSE4_1__)
+  return "SSE4.1";
+#else
+  return "Scalar";
+#endif
+}
+
+#if defined(__AVX512F__)
+/** Get the lower and the upper 256 bits of 'value'. The masked extracts are used instead of
+  * _mm512_castsi512_si256 and _mm512_extracti64x4_epi64 (which the _mm512_reduce_add_* functions also use),
+  * because GCC implements those with an undefined source register and warns that it may be used uninitialized. */
+inline __m256i GetLowerHalf(const __m512i value)
+{
+  return _mm512_maskz_extracti64x4_epi64(0xFF, value, 0);
+}
+
+inline __m256i GetUpperHalf(const __m512i value)
+{
+  return _mm512_maskz_extracti64x4_epi64(0xFF, value, 1);
+}
+
+/** Sum the 16 floats of 'value'. */
+inline float ReduceAdd(const __m512 value)
+{
+  const __m512i bits = _mm512_castps_si512(value);
+  __m256 halfSum = _mm256_add_ps(_mm256_castsi256_ps(GetLowerHalf(bits)), _mm256_castsi256_ps(GetUpperHalf(bits)));
+  __m128 quarterSum = _mm_add_ps(_mm256_castps256_ps128(halfSum), _mm256_extractf128_ps(halfSum, 1));
+  quarterSum = _mm_hadd_ps(quarterSum, quarterSum);
+  quarterSum = _mm_hadd_ps(quarterSum, quarterSum);
+  return _mm_cvtss_f32(quarterSum);
+}
+
+/** Sum the 16 32 bit integers of 'value'. */
+inline int32_t ReduceAddEpi32(const __m512i value)
+{
+  __m256i halfSum = _mm256_add_epi32(GetLowerHalf(value), GetUpperHalf(value));
+  __m128i quarterSum = _mm_add_epi32(_mm256_castsi256_si128(halfSum), _mm256_extracti128_si256(halfSum, 1));
+  quarterSum = _mm_hadd_epi32(quarterSum, quarterSum);
+  quarterSum = _mm_hadd_epi32(quarterSum, quarterSum);
+  return _mm_cvtsi128_si32(quarterSum);
+}
+
+/** Sum the 8 64 bit integers of 'value'. */
+inline int64_t ReduceAddEpi64(const __m512i value)
+{
+  __m256i halfSum = _mm256_add_epi64(GetLowerHalf(value), GetUpperHalf(value));
+  __m128i quarterSum = _mm_add_epi64(_mm256_castsi256_si128(halfSum), _mm256_extracti128_si256(halfSum, 1));
+  return _mm_cvtsi128_si64(quarterSum) + _mm_extract_epi64(quarterSum, 1);
+}
+#endif
+
+/** Sum of squared differences of 'numberOfValues' floats. */
+inline float SumSquaredDifferences(const float* a, const float* b, const size_t numberOfValues)
+{
+  size_t i = 0;
+  float sum = 0.0f;
+
+#if defined(__AVX512F__)
+  __m512 accumulator = _mm512_setzero_ps();
+  for(; i + 16 <= numberOfValues; i += 16)
+  {
+    __m512 difference = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+    accumulator = _mm512_fmadd_ps(difference, difference, accumulator);
+  }
+  // Use a masked load for the remainder instead of a scalar loop
+  if(i < numberOfValues)
+  {
+    __mmask16 tailMask = static_cast<__mmask16>((1u << (numberOfValues - i)) - 1);
+    __m512 difference = _mm512_sub_ps(_mm512_maskz_loadu_ps(tailMask, a + i), _mm512_maskz_loadu_ps(tailMask, b + i));
+    accumulator = _mm512_fmadd_ps(difference, difference, accumulator);
+    i = numberOfValues;
+  }
+  sum = ReduceAdd(accumulator);
+#elif defined(__AVX2__)
+  __m256 accumulator = _mm256_setzero_ps();
+  for(; i + 8 <= numberOfValues; i += 8)
+  {
+    __m256 difference = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+#if defined(__FMA__)
+    accumulator = _mm256_fmadd_ps(difference, difference, accumulator);
+#else
+    accumulator = _mm256_add_ps(accumulator, _mm256_mul_ps(difference, difference));
+#endif
+  }
+  __m128 halfSum = _mm_add_ps(_mm256_castps256_ps128(accumulator), _mm256_extractf128_ps(accumulator, 1));
+  halfSum = _mm_hadd_ps(halfSum, halfSum);
+  halfSum = _mm_hadd_ps(halfSum, halfSum);
+  sum = _mm_cvtss_f32(halfSum);
+#elif defined(__SSE4_1__)
+  __m128 accumulator = _mm_setzero_ps();
+  for(; i + 4 <= numberOfValues; i += 4)
+  {
+    __m128 difference = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+    accumulator = _mm_add_ps(accumulator, _mm_mul_ps(difference, difference));
+  }
+  accumulator = _mm_hadd_ps(accumulator, accumulator);
+  accumulator = _mm_hadd_ps(accumulator, accumulator);
+  sum = _mm_cvtss_f32(accumulator);
+#endif
+
+  for(; i < numberOfValues; ++i)
+  {
+    float difference = a[i] - b[i];
+    sum += difference * difference;
+  }
+
+  return sum;
+}
+
+/** Sum of absolute differences of 'numberOfValues' floats. */
+inline float SumAbsoluteDifferences(const float* a, const float* b, const size_t numberOfValues)
+{
+  size_t i = 0;
+  float sum = 0.0f;
+
+#if defined(__AVX512F__)
+  __m512 accumulator = _mm512_setzero_ps();
+  for(; i + 16 <= numberOfValues; i += 16)
+  {
+    __m512 difference = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+    accumulator = _mm512_add_ps(accumulator, _mm512_abs_ps(difference));
+  }
+  if(i < numberOfValues)
+  {
+    __mmask16 tailMask = static_cast<__mmask16>((1u << (numberOfValues - i)) - 1);
+    __m512 difference = _mm512_sub_ps(_mm512_maskz_loadu_ps(tailMask, a + i), _mm512_maskz_loadu_ps(tailMask, b + i));
+    accumulator = _mm512_add_ps(accumulator, _mm512_abs_ps(difference));
+    i = numberOfValues;
+  }
+  sum = ReduceAdd(accumulator);
+#elif defined(__AVX2__)
+  // Clear the sign bit to get the absolute value
+  const __m256 signMask = _mm256_set1_ps(-0.0f);
+  __m256 accumulator = _mm256_setzero_ps();
+  for(; i + 8 <= numberOfValues; i += 8)
+  {
+    __m256 difference = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+    accumulator = _mm256_add_ps(accumulator, _mm256_andnot_ps(signMask, difference));
+  }
+  __m128 halfSum = _mm_add_ps(_mm256_castps256_ps128(accumulator), _mm256_extractf128_ps(accumulator, 1));
+  halfSum = _mm_hadd_ps(halfSum, halfSum);
+  halfSum = _mm_hadd_ps(halfSum, halfSum);
+  sum = _mm_cvtss_f32(halfSum);
+#elif defined(__SSE4_1__)
+  const __m128 signMask = _mm_set1_ps(-0.0f);
+  __m128 accumulator = _mm_setzero_ps();
+  for(; i + 4 <= numberOfValues; i += 4)
+  {
+    __m128 difference = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+    accumulator = _mm_add_ps(accumulator, _mm_andnot_ps(signMask, difference));
+  }
+  accumulator = _mm_hadd_ps(accumulator, accumulator);
+  accumulator = _mm_hadd_ps(accumulator, accumulator);
+  sum = _mm_cvtss_f32(accumulator);
+#endif
+
+  for(; i < numberOfValues; ++i)
+  {
+    sum += std::fabs(a[i] - b[i]);
+  }
+
+  return sum;
+}
+
+/** Sum of squared differences of 'numberOfValues' unsigned chars. The products are accumulated in 32 bit
+  * integers, which cannot overflow for spans of up to 64 pixels with up to 64 components each. */
+inline float SumSquaredDifferences(const unsigned char* a, const unsigned char* b, const size_t numberOfValues)
+{
+  size_t i = 0;
+  int32_t sum = 0;
+
+#if defined(__AVX512BW__)
+  __m512i accumulator = _mm512_setzero_si512();
+  for(; i + 32 <= numberOfValues; i += 32)
+  {
+    __m512i difference = _mm512_sub_epi16(
+          _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i))),
+          _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i))));
+    accumulator = _mm512_add_epi32(accumulator, _mm512_madd_epi16(difference, difference));
+  }
+  // The spans are short (a patch row), so use a masked load for the remainder instead of a scalar loop
+  if(i < numberOfValues)
+  {
+    __mmask64 tailMask = (static_cast<__mmask64>(1) << (numberOfValues - i)) - 1;
+    __m512i difference = _mm512_sub_epi16(
+          _mm512_cvtepu8_epi16(GetLowerHalf(_mm512_maskz_loadu_epi8(tailMask, a + i))),
+          _mm512_cvtepu8_epi16(GetLowerHalf(_mm512_maskz_loadu_epi8(tailMask, b + i))));
+    accumulator = _mm512_add_epi32(accumulator, _mm512_madd_epi16(difference, difference));
+    i = numberOfValues;
+  }
+  sum = ReduceAddEpi32(accumulator);
+#elif defined(__AVX2__)
+  __m256i accumulator = _mm256_setzero_si256();
+  for(; i + 16 <= numberOfValues; i += 16)
+  {
+    __m256i difference = _mm256_sub_epi16(
+          _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i))),
+          _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i))));
+    accumulator = _mm256_add_epi32(accumulator, _mm256_madd_epi16(difference, difference));
+  }
+  __m128i halfSum = _mm_add_epi32(_mm256_castsi256_si128(accumulator), _mm256_extracti128_si256(accumulator, 1));
+  halfSum = _mm_hadd_epi32(halfSum, halfSum);
+  halfSum = _mm_hadd_epi32(halfSum, halfSum);
+  sum = _mm_cvtsi128_si32(halfSum);
+#elif defined(__SSE4_1__)
+  __m128i accumulator = _mm_setzero_si128();
+  for(; i + 8 <= numberOfValues; i += 8)
+  {
+    __m128i difference = _mm_sub_epi16(
+          _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(a + i))),
+          _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(b + i))));
+    accumulator = _mm_add_epi32(accumulator, _mm_madd_epi16(difference, difference));
+  }
+  accumulator = _mm_hadd_epi32(accumulator, accumulator);
+  accumulator = _mm_hadd_epi32(accumulator, accumulator);
+  sum = _mm_cvtsi128_si32(accumulator);
+#endif
+
+  for(; i < numberOfValues; ++i)
+  {
+    int32_t difference = static_cast<int32_t>(a[i]) - static_cast<int32_t>(b[i]);
+    sum += difference * difference;
+  }
+
+  return static_cast<float>(sum);
+}
+
+/** Sum of absolute differences of 'numberOfValues' unsigned chars (using the PSADBW instruction). */
+inline float SumAbsoluteDifferences(const unsigned char* a, const unsigned char* b, const size_t numberOfValues)
+{
+  size_t i = 0;
+  int64_t sum = 0;
+
+#if defined(__AVX512BW__)
+  __m512i accumulator = _mm512_setzero_si512();
+  for(; i + 64 <= numberOfValues; i += 64)
+  {
+    accumulator = _mm512_add_epi64(accumulator, _mm512_sad_epu8(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i)));
+  }
+  if(i < numberOfValues)
+  {
+    __mmask64 tailMask = (static_cast<__mmask64>(1) << (numberOfValues - i)) - 1;
+    accumulator = _mm512_add_epi64(accumulator, _mm512_sad_epu8(_mm512_maskz_loadu_epi8(tailMask, a + i),
+                                                                _mm512_maskz_loadu_epi8(tailMask, b + i)));
+    i = numberOfValues;
+  }
+  sum = ReduceAddEpi64(accumulator);
+#elif defined(__AVX2__)
+  __m256i accumulator = _mm256_setzero_si256();
+  for(; i + 32 <= numberOfValues; i += 32)
+  {
+    accumulator = _mm256_add_epi64(accumulator,
+                                   _mm256_sad_epu8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                                   _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i))));
+  }
+  __m128i halfSum = _mm_add_epi64(_mm256_castsi256_si128(accumulator), _mm256_extracti128_si256(accumulator, 1));
+  sum = _mm_cvtsi128_si64(halfSum) + _mm_extract_epi64(halfSum, 1);
+#elif defined(__SSE4_1__)
+  __m128i accumulator = _mm_setzero_si128();
+  for(; i + 16 <= numberOfValues; i += 16)
+  {
+    accumulator = _mm_add_epi64(accumulator,
+                                _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                                             _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i))));
+  }
+  sum = _mm_cvtsi128_si64(accumulator) + _mm_extract_epi64(accumulator, 1);
+#endif
+
+  for(; i < numberOfValues; ++i)
+  {
+    sum += std::abs(static_cast<int>(a[i]) - static_cast<int>(b[i]));
+  }
+
+  return static_cast<float>(sum);
+}
+
+/** The two span functions, so the masked patch difference can be written once for both metrics. */
+struct SquaredDifferenceSpan
+{
+  template <typename T>
+  float operator()(const T* a, const T* b, const size_t numberOfValues) const
+  {
+    return SumSquaredDifferences(a, b, numberOfValues);
+  }
+};
+
+struct AbsoluteDifferenceSpan
+{
+  template <typename T>
+  float operator()(const T* a, const T* b, const size_t numberOfValues) const
+  {
+    return SumAbsoluteDifferences(a, b, numberOfValues);
+  }
+};
+
+/** Get the cutoff for the sum of the differences of 'numberOfPixels' pixels when their average must not
+  * exceed 'threshold'. The scaled threshold is rounded, so a patch whose average difference is exactly
+  * 'threshold' could be stopped by an ulp. The cutoff is moved up by one ulp and a small relative margin so
+  * that only patches that are strictly worse are stopped, and ties are decided on the averages by the caller. */
+inline float GetTotalThreshold(const float threshold, const size_t numberOfPixels)
+{
+  const float totalThreshold = threshold * static_cast<float>(numberOfPixels);
+  return std::nextafter(totalThreshold, std::numeric_limits<float>::infinity()) * (1.0f + 1e-5f);
+}
+
+/** Compute the difference between the valid pixels of two patches stored in the same buffer. 'source' and
+  * 'target' point to the first component of the top left pixel of each patch, 'rowStride' is the number
+  * of components between the starts of consecutive rows of the buffer, and 'rowMasks' contains the valid
+  * pixel bitmask of each patch row. Each run of consecutive valid pixels is contiguous in memory, so it is
+  * handed to 'spanFunction' in one call.
+  *
+  * As in ImagePatchDifference, the sum is checked against 'totalThreshold' (after each row) and
+  * std::numeric_limits<float>::max() is returned as soon as it is exceeded. */
+template <typename T, typename TSpanFunction>
+float MaskedPatchDifference(const T* source, const T* target, const size_t rowStride,
+                            const unsigned int numberOfComponents, const std::vector<uint64_t>& rowMasks,
+                            const float totalThreshold, const TSpanFunction spanFunction)
+{
+  float totalDifference = 0.0f;
+
+  for(size_t row = 0; row < rowMasks.size(); ++row)
+  {
+    uint64_t remainingMask = rowMasks[row];
+    while(remainingMask != 0)
+    {
+      // Find the next run of set bits
+      const unsigned int spanStart = RowMasks::CountTrailingZeros(remainingMask);
+      const uint64_t shiftedMask = remainingMask >> spanStart;
+      const unsigned int spanLength = (~shiftedMask == 0) ? 64 - spanStart : RowMasks::CountTrailingZeros(~shiftedMask);
+
+      totalDifference += spanFunction(source + spanStart * numberOfComponents,
+                                      target + spanStart * numberOfComponents,
+                                      spanLength * numberOfComponents);
+
+      const unsigned int spanEnd = spanStart + spanLength;
+      remainingMask = (spanEnd >= 64) ? 0 : (remainingMask & (~static_cast<uint64_t>(0) << spanEnd));
+    }
+
+    // The span differences are non-negative, so this patch can no longer beat the threshold
+    if(totalDifference > totalThreshold)
+    {
+      return std::numeric_limits<float>::max();
+    }
+
+    source += rowStride;
+    target += rowStride;
+  }
+
+  return totalDifference;
+}
+
+} // end namespace SpanDifferenceKernels
+
+#endif
@@ -0,0 +1,98 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef SpanDifferenceTraits_hpp
+#define SpanDifferenceTraits_hpp
+
+// ITK
+#include "itkCovariantVector.h"
+#include "itkImage.h"
+#include "itkVectorImage.h"
+
+// Custom
+#include "SpanDifferenceKernels.hpp"
+#include "DifferenceFunctions/Pixel/SumAbsolutePixelDifference.hpp"
+#include "DifferenceFunctions/Pixel/SumSquaredPixelDifference.hpp"
+
+/** This class tells ImagePatchDifference whether the sum of a pixel difference functor over a patch can be
+  * computed with the SpanDifferenceKernels, and if so how to get at the components of the image buffer.
+  * It is specialized for the (image, pixel difference) combinations that have a kernel.
+  */
+template <typename TImage, typename TPixelDifference>
+struct SpanDifferenceTraits
+{
+  static const bool Supported = false;
+};
+
+/** Images with a variable number of float components per pixel. */
+template <>
+struct SpanDifferenceTraits<itk::VectorImage<float, 2>, SumSquaredPixelDifference<itk::VariableLengthVector<float> > >
+{
+  static const bool Supported = true;
+  typedef float ComponentType;
+  typedef SpanDifferenceKernels::SquaredDifferenceSpan SpanFunctionType;
+
+  static const ComponentType* GetBufferPointer(const itk::VectorImage<float, 2>* const image)
+  {
+    return image->GetBufferPointer();
+  }
+
+  static unsigned int GetNumberOfComponents(const itk::VectorImage<float, 2>* const image)
+  {
+    return image->GetNumberOfComponentsPerPixel();
+  }
+};
+
+template <>
+struct SpanDifferenceTraits<itk::VectorImage<float, 2>, SumAbsolutePixelDifference<itk::VariableLengthVector<float> > > :
+    public SpanDifferenceTraits<itk::VectorImage<float, 2>, SumSquaredPixelDifference<itk::VariableLengthVector<float> > >
+{
+  typedef SpanDifferenceKernels::AbsoluteDifferenceSpan SpanFunctionType;
+};
+
+/** Images of N unsigned char components per pixel (e.g. RGB). The components of a CovariantVector are stored
+  * contiguously, so the buffer can be read as an array of unsigned chars. */
+template <unsigned int N>
+struct SpanDifferenceTraits<itk::Image<itk::CovariantVector<unsigned char, N>, 2>,
+                            SumSquaredPixelDifference<itk::CovariantVector<unsigned char, N> > >
+{
+  static const bool Supported = (sizeof(itk::CovariantVector<unsigned char, N>) == N);
+  typedef unsigned char ComponentType;
+  typedef SpanDifferenceKernels::SquaredDifferenceSpan SpanFunctionType;
+
+  static const ComponentType* GetBufferPointer(const itk::Image<itk::CovariantVector<unsigned char, N>, 2>* const image)
+  {
+    return reinterpret_cast<const ComponentType*>(image->GetBufferPointer());
+  }
+
+  static unsigned int GetNumberOfComponents(const itk::Image<itk::CovariantVector<unsigned char, N>, 2>* const)
+  {
+    return N;
+  }
+};
+
+template <unsigned int N>
+struct SpanDifferenceTraits<itk::Image<itk::CovariantVector<unsigned char, N>, 2>,
+                            SumAbsolutePixelDifference<itk::CovariantVector<unsigned char, N> > > :
+    public SpanDifferenceTraits<itk::Image<itk::CovariantVector<unsigned char, N>, 2>,
+                                SumSquaredPixelDifference<itk::CovariantVector<unsigned char, N> > >
+{
+  typedef SpanDifferenceKernels::AbsoluteDifferenceSpan SpanFunctionType;
+};
+
+#endif
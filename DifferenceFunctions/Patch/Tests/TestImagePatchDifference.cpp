@@ -27,16 +27,23 @@
 
 // ITK
 #include "itkImage.h"
+#include "itkImageRegionIterator.h"
 #include "itkRandomImageSource.h"
 
 static void Scalar();
 static void Vector();
+static bool MaskedVector();
 
 int main(int, char*[])
 {
   Scalar();
   Vector();
 
+  if(!MaskedVector())
+  {
+    return EXIT_FAILURE;
+  }
+
   return EXIT_SUCCESS;
 }
 
@@ -135,3 +142,79 @@ void Vector()
   std::cout << "GMHDifference: " << difference << std::endl;
 
 }
+
+/** Check the (span kernel) result for a partially valid target patch against the sum of the pixel differences. */
+bool MaskedVector()
+{
+  typedef itk::Image<itk::CovariantVector<unsigned char, 3>, 2 >  ImageType;
+  ImageType::Pointer image = ImageType::New();
+  itk::Index<2> corner = {{0,0}};
+  itk::Size<2> imageSize = {{100,100}};
+  itk::ImageRegion<2> fullRegion(corner, imageSize);
+  image->SetRegions(fullRegion);
+  image->Allocate();
+
+  itk::ImageRegionIterator<ImageType> imageIterator(image, fullRegion);
+  while(!imageIterator.IsAtEnd())
+  {
+    ImageType::PixelType pixel;
+    for(unsigned int component = 0; component < 3; ++component)
+    {
+      pixel[component] = rand() % 256;
+    }
+    imageIterator.Set(pixel);
+    ++imageIterator;
+  }
+
+  itk::Size<2> patchSize = {{21,21}};
+  itk::Index<2> targetCorner = {{40, 30}};
+  itk::ImageRegion<2> targetRegion(targetCorner, patchSize);
+  itk::Index<2> sourceCorner = {{10, 60}};
+  itk::ImageRegion<2> sourceRegion(sourceCorner, patchSize);
+
+  Mask::Pointer mask = Mask::New();
+  mask->SetRegions(fullRegion);
+  mask->Allocate();
+  ITKHelpers::SetImageToConstant(mask.GetPointer(), mask->GetValidValue());
+
+  typedef SumSquaredPixelDifference<ImageType::PixelType> PixelDifferenceType;
+  typedef ImagePatchPixelDescriptor<ImageType> PatchType;
+
+  PatchType targetPatch(image, mask, targetRegion);
+  PatchType sourcePatch(image, mask, sourceRegion);
+  sourcePatch.SetStatus(PatchType::SOURCE_NODE);
+
+  // Make every third pixel of the target patch invalid
+  std::vector<itk::Offset<2> > validOffsets;
+  for(unsigned int offsetId = 0; offsetId < patchSize[0] * patchSize[1]; ++offsetId)
+  {
+    if(offsetId % 3 != 0)
+    {
+      itk::Offset<2> offset = {{offsetId % patchSize[0], offsetId / patchSize[0]}};
+      validOffsets.push_back(offset);
+    }
+  }
+  targetPatch.SetValidOffsets(validOffsets);
+
+  PixelDifferenceType pixelDifference;
+  float expectedDifference = 0.0f;
+  for(size_t offsetId = 0; offsetId < validOffsets.size(); ++offsetId)
+  {
+    expectedDifference += pixelDifference(image->GetPixel(sourceCorner + validOffsets[offsetId]),
+                                          image->GetPixel(targetCorner + validOffsets[offsetId]));
+  }
+  expectedDifference /= static_cast<float>(validOffsets.size());
+
+  ImagePatchDifference<PatchType, PixelDifferenceType> imagePatchDifference;
+  float difference = imagePatchDifference(sourcePatch, targetPatch);
+
+  std::cout << "Masked difference: " << difference << " expected: " << expectedDifference << std::endl;
+
+  if(fabs(difference - expectedDifference) > 1e-3f * expectedDifference)
+  {
+    std::cerr << "The masked difference is not correct!" << std::endl;
+    return false;
+  }
+
+  return true;
+}
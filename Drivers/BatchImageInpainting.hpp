@@ -0,0 +1,239 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef BatchImageInpainting_HPP
+#define BatchImageInpainting_HPP
+
+// ITK
+#include "itkImageFileReader.h"
+
+// Submodules
+#include <Helpers/Helpers.h>
+#include <ITKHelpers/ITKHelpers.h>
+#include <Mask/Mask.h>
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Custom
+#include "Drivers/ClassicalImageInpainting.hpp"
+#include "Drivers/PyramidImageInpainting.hpp"
+#include "Utilities/TaskPool.h"
+
+/** One image of a batch. */
+struct BatchInpaintingJob
+{
+  std::string ImageFileName;
+  std::string MaskFileName;
+  unsigned int PatchHalfWidth;
+  std::string OutputFileName;
+
+  /** 1 runs ClassicalImageInpainting, more runs PyramidImageInpainting with this many levels. */
+  unsigned int NumberOfLevels;
+};
+
+/** How one job of a batch went. */
+struct BatchInpaintingResult
+{
+  bool Succeeded;
+  std::string Error;
+
+  /** The wall clock time of the job, including reading and writing the files. */
+  double Seconds;
+};
+
+/** Read a batch manifest. Each line is a job:
+  *   image.png image.mask patchHalfWidth output.png [numberOfLevels]
+  * Empty lines and lines starting with '#' are skipped. */
+inline std::vector<BatchInpaintingJob> ReadBatchManifest(const std::string& manifestFileName)
+{
+  std::ifstream manifestStream(manifestFileName.c_str());
+  if(!manifestStream)
+  {
+    throw std::runtime_error("ReadBatchManifest: Could not open " + manifestFileName + "!");
+  }
+
+  std::vector<BatchInpaintingJob> jobs;
+  std::string line;
+  unsigned int lineNumber = 0;
+  while(std::getline(manifestStream, line))
+  {
+    lineNumber++;
+
+    std::stringstream lineStream(line);
+    std::string firstField;
+    if(!(lineStream >> firstField) || firstField[0] == '#')
+    {
+      continue;
+    }
+
+    BatchInpaintingJob job;
+    job.ImageFileName = firstField;
+    job.NumberOfLevels = 1;
+    if(!(lineStream >> job.MaskFileName >> job.PatchHalfWidth >> job.OutputFileName))
+    {
+      std::stringstream ss;
+      ss << "ReadBatchManifest: Line " << lineNumber << " of " << manifestFileName
+         << " is not 'image mask patchHalfWidth output [numberOfLevels]'!";
+      throw std::runtime_error(ss.str());
+    }
+
+    unsigned int numberOfLevels = 0;
+    if(lineStream >> numberOfLevels)
+    {
+      job.NumberOfLevels = std::max(numberOfLevels, 1u);
+    }
+
+    jobs.push_back(job);
+  }
+
+  return jobs;
+}
+
+/** Run one job: read the image and the mask, inpaint, and write the result. */
+template <typename TImage>
+void RunBatchInpaintingJob(const BatchInpaintingJob& job)
+{
+  typedef itk::ImageFileReader<TImage> ImageReaderType;
+  typename ImageReaderType::Pointer imageReader = ImageReaderType::New();
+  imageReader->SetFileName(job.ImageFileName);
+  imageReader->Update();
+
+  typename TImage::Pointer image = TImage::New();
+  ITKHelpers::DeepCopy(imageReader->GetOutput(), image.GetPointer());
+
+  Mask::Pointer mask = Mask::New();
+  mask->Read(job.MaskFileName);
+
+  if(job.NumberOfLevels > 1)
+  {
+    PyramidImageInpainting(image, mask.GetPointer(), job.PatchHalfWidth, job.NumberOfLevels);
+  }
+  else
+  {
+    ClassicalImageInpainting(image, mask.GetPointer(), job.PatchHalfWidth);
+  }
+
+  // As in ClassicalImageInpainting.cpp, png files are casted to unsigned char.
+  if(Helpers::GetFileExtension(job.OutputFileName) == "png")
+  {
+    ITKHelpers::WriteRGBImage(image.GetPointer(), job.OutputFileName);
+  }
+  else
+  {
+    ITKHelpers::WriteImage(image.GetPointer(), job.OutputFileName);
+  }
+}
+
+/** Run all of the jobs in one process. At most 'maximumNumberOfConcurrentJobs' jobs (the number of threads of the
+  * global TaskPool if 0) are in flight at once: each of that many tasks takes the next job from a shared counter
+  * when its current job is done, so the number of images in memory does not grow with the number of jobs. The
+  * searches and priority updates of the jobs share the threads of the pool (see TaskPool). A thread that waits
+  * for a parallel loop of its job never starts another job, so the time of a job only covers its own work.
+  * A job that throws is recorded as failed and does not stop the others. The per-job timing and a summary are
+  * written to 'timingFileName' as tab separated text. Returns the results in the order of 'jobs'. */
+template <typename TImage>
+std::vector<BatchInpaintingResult> BatchImageInpainting(const std::vector<BatchInpaintingJob>& jobs,
+                                                        const std::string& timingFileName,
+                                                        const unsigned int maximumNumberOfConcurrentJobs = 0)
+{
+  typedef std::chrono::steady_clock ClockType;
+
+  std::vector<BatchInpaintingResult> results(jobs.size());
+
+  ClockType::time_point batchStart = ClockType::now();
+
+  unsigned int numberOfConcurrentJobs = maximumNumberOfConcurrentJobs;
+  if(numberOfConcurrentJobs == 0)
+  {
+    numberOfConcurrentJobs = TaskPool::GetGlobalInstance().GetNumberOfThreads();
+  }
+  numberOfConcurrentJobs = static_cast<unsigned int>(std::min<size_t>(numberOfConcurrentJobs, jobs.size()));
+
+  std::atomic<size_t> nextJobId(0);
+
+  TaskGroup taskGroup;
+  for(unsigned int runnerId = 0; runnerId < numberOfConcurrentJobs; ++runnerId)
+  {
+    taskGroup.Run([&]()
+    {
+      for(size_t jobId = nextJobId++; jobId < jobs.size(); jobId = nextJobId++)
+      {
+        ClockType::time_point jobStart = ClockType::now();
+        results[jobId].Succeeded = true;
+        try
+        {
+          RunBatchInpaintingJob<TImage>(jobs[jobId]);
+        }
+        catch(const std::exception& e)
+        {
+          results[jobId].Succeeded = false;
+          results[jobId].Error = e.what();
+        }
+        results[jobId].Seconds = std::chrono::duration<double>(ClockType::now() - jobStart).count();
+      }
+    });
+  }
+
+  taskGroup.Wait();
+
+  double batchSeconds = std::chrono::duration<double>(ClockType::now() - batchStart).count();
+
+  std::ofstream timingStream(timingFileName.c_str());
+  if(!timingStream)
+  {
+    throw std::runtime_error("BatchImageInpainting: Could not open " + timingFileName + "!");
+  }
+
+  timingStream << "# image\toutput\tstatus\tseconds\terror" << std::endl;
+
+  unsigned int numberOfFailedJobs = 0;
+  double totalJobSeconds = 0;
+  for(size_t jobId = 0; jobId < jobs.size(); ++jobId)
+  {
+    timingStream << jobs[jobId].ImageFileName << "\t" << jobs[jobId].OutputFileName << "\t"
+                 << (results[jobId].Succeeded ? "ok" : "failed") << "\t" << results[jobId].Seconds << "\t"
+                 << results[jobId].Error << std::endl;
+
+    if(!results[jobId].Succeeded)
+    {
+      numberOfFailedJobs++;
+    }
+    totalJobSeconds += results[jobId].Seconds;
+  }
+
+  std::stringstream summary;
+  summary << "# " << jobs.size() << " jobs, " << numberOfFailedJobs << " failed, "
+          << TaskPool::GetGlobalInstance().GetNumberOfThreads() << " threads, at most " << numberOfConcurrentJobs
+          << " concurrent jobs. Wall time " << batchSeconds
+          << " s, sum of the job times " << totalJobSeconds << " s.";
+  timingStream << summary.str() << std::endl;
+  std::cout << "BatchImageInpainting: " << summary.str().substr(2) << std::endl;
+
+  return results;
+}
+
+#endif
@@ -24,6 +24,7 @@
 
 // STL
 #include <memory>
+#include <ostream>
 
 // Submodules
 #include <Helpers/Helpers.h>
@@ -72,9 +73,11 @@
 
 #include "SearchRegions/NeighborhoodSearch.hpp"
 
+/** If 'queueTraceStream' is given, the operations on the boundary node queue are written to it
+  * (see IndirectPriorityQueue::SetTraceStream). */
 template <typename TImage>
 void ClassicalImageInpainting(typename itk::SmartPointer<TImage> originalImage, Mask* const mask,
-                              const unsigned int patchHalfWidth)
+                              const unsigned int patchHalfWidth, std::ostream* const queueTraceStream = 0)
 {
   itk::ImageRegion<2> fullRegion = originalImage->GetLargestPossibleRegion();
 
@@ -99,6 +102,7 @@ void ClassicalImageInpainting(typename itk::SmartPointer<TImage> originalImage,
   // Queue
   typedef IndirectPriorityQueue<VertexListGraphType> BoundaryNodeQueueType;
   std::shared_ptr<BoundaryNodeQueueType> boundaryNodeQueue(new BoundaryNodeQueueType(*graph));
+  boundaryNodeQueue->SetTraceStream(queueTraceStream);
 
   // Create the descriptor map. This is where the data for each pixel is stored.
   typedef boost::vector_property_map<ImagePatchPixelDescriptorType,
@@ -148,7 +152,7 @@ void ClassicalImageInpainting(typename itk::SmartPointer<TImage> originalImage,
   inpaintingVisitor->SetAllowNewPatches(false);
 //  inpaintingVisitor.SetDebugImages(true); // Write PatchesCopied images that show the source and target patch at each iteration
 
-  InitializePriority(mask, boundaryNodeQueue.get(), priorityFunction.get());
+  InitializePriorityFromFillFront(inpaintingVisitor.get(), boundaryNodeQueue.get(), priorityFunction.get());
 
   // Initialize the boundary node queue from the user provided mask image.
   InitializeFromMaskImage<InpaintingVisitorType, VertexDescriptorType>(mask, inpaintingVisitor.get());
@@ -0,0 +1,249 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef ConnectedComponentImageInpainting_HPP
+#define ConnectedComponentImageInpainting_HPP
+
+// ITK
+#include "itkConnectedComponentImageFilter.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+#include <Mask/Mask.h>
+
+// STL
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+// Custom
+#include "Drivers/PyramidImageInpainting.hpp"
+#include "Utilities/TaskPool.h"
+
+/** Compute the regions that can be inpainted independently. Each connected component (8-connected) of the hole
+  * in 'mask' gets the bounding box of its pixels dilated by 'margin' (and cropped to the image). If the dilated
+  * box does not contain a fully valid source patch of radius 'patchHalfWidth', the margin of that component is
+  * doubled until it does. Components whose dilated boxes overlap are grouped together (the union of their boxes
+  * is used), so that no region contains hole pixels of another region. The regions are returned largest first.
+  * An exception is thrown if a component has no valid source patch even in the whole image. */
+inline std::vector<itk::ImageRegion<2> > GetIndependentHoleRegions(const Mask* const mask, const unsigned int margin,
+                                                                   const unsigned int patchHalfWidth)
+{
+  itk::ImageRegion<2> fullRegion = mask->GetLargestPossibleRegion();
+
+  // Label the hole components
+  typedef itk::Image<unsigned char, 2> HoleImageType;
+  HoleImageType::Pointer holeImage = HoleImageType::New();
+  holeImage->SetRegions(fullRegion);
+  holeImage->Allocate();
+
+  itk::ImageRegionConstIteratorWithIndex<Mask> maskIterator(mask, fullRegion);
+  while(!maskIterator.IsAtEnd())
+  {
+    holeImage->SetPixel(maskIterator.GetIndex(), mask->IsHole(maskIterator.GetIndex()) ? 1 : 0);
+    ++maskIterator;
+  }
+
+  typedef itk::Image<unsigned int, 2> LabelImageType;
+  typedef itk::ConnectedComponentImageFilter<HoleImageType, LabelImageType> ConnectedComponentFilterType;
+  ConnectedComponentFilterType::Pointer connectedComponentFilter = ConnectedComponentFilterType::New();
+  connectedComponentFilter->SetInput(holeImage);
+  connectedComponentFilter->FullyConnectedOn();
+  connectedComponentFilter->Update();
+
+  // Compute the bounding box of each component
+  std::map<unsigned int, std::pair<itk::Index<2>, itk::Index<2> > > boundingBoxes;
+  itk::ImageRegionConstIteratorWithIndex<LabelImageType> labelIterator(connectedComponentFilter->GetOutput(),
+                                                                       fullRegion);
+  while(!labelIterator.IsAtEnd())
+  {
+    unsigned int label = labelIterator.Get();
+    if(label != 0)
+    {
+      itk::Index<2> index = labelIterator.GetIndex();
+      if(boundingBoxes.find(label) == boundingBoxes.end())
+      {
+        boundingBoxes[label] = std::make_pair(index, index);
+      }
+      std::pair<itk::Index<2>, itk::Index<2> >& boundingBox = boundingBoxes[label];
+      for(unsigned int dimension = 0; dimension < 2; ++dimension)
+      {
+        boundingBox.first[dimension] = std::min(boundingBox.first[dimension], index[dimension]);
+        boundingBox.second[dimension] = std::max(boundingBox.second[dimension], index[dimension]);
+      }
+    }
+    ++labelIterator;
+  }
+
+  // Dilate the boxes until each of them contains a source patch. Merging boxes only makes them larger, so the
+  // merged regions contain a source patch too.
+  std::vector<itk::ImageRegion<2> > regions;
+  for(std::map<unsigned int, std::pair<itk::Index<2>, itk::Index<2> > >::const_iterator boxIterator =
+      boundingBoxes.begin(); boxIterator != boundingBoxes.end(); ++boxIterator)
+  {
+    itk::ImageRegion<2> region;
+    for(unsigned int componentMargin = std::max(margin, 1u); ; componentMargin *= 2)
+    {
+      const itk::Index<2>::IndexValueType signedMargin = static_cast<itk::Index<2>::IndexValueType>(componentMargin);
+      itk::Index<2> corner = {{boxIterator->second.first[0] - signedMargin,
+                               boxIterator->second.first[1] - signedMargin}};
+      itk::Size<2> size = {{boxIterator->second.second[0] - boxIterator->second.first[0] + 1 + 2 * componentMargin,
+                            boxIterator->second.second[1] - boxIterator->second.first[1] + 1 + 2 * componentMargin}};
+      region = itk::ImageRegion<2>(corner, size);
+      region.Crop(fullRegion);
+
+      if(ContainsValidSourcePatch(mask, region, patchHalfWidth))
+      {
+        break;
+      }
+
+      if(region == fullRegion)
+      {
+        throw std::runtime_error("GetIndependentHoleRegions: The mask does not contain a valid source patch!");
+      }
+    }
+    regions.push_back(region);
+  }
+
+  // Group the overlapping regions until no two regions overlap
+  bool merged = true;
+  while(merged)
+  {
+    merged = false;
+    for(size_t i = 0; i < regions.size() && !merged; ++i)
+    {
+      for(size_t j = i + 1; j < regions.size() && !merged; ++j)
+      {
+        itk::ImageRegion<2> intersection = regions[i];
+        if(intersection.Crop(regions[j]))
+        {
+          itk::Index<2> corner;
+          itk::Size<2> size;
+          for(unsigned int dimension = 0; dimension < 2; ++dimension)
+          {
+            corner[dimension] = std::min(regions[i].GetIndex()[dimension], regions[j].GetIndex()[dimension]);
+            itk::Index<2>::IndexValueType end =
+                std::max(regions[i].GetUpperIndex()[dimension], regions[j].GetUpperIndex()[dimension]);
+            size[dimension] = end - corner[dimension] + 1;
+          }
+          regions[i] = itk::ImageRegion<2>(corner, size);
+          regions.erase(regions.begin() + j);
+          merged = true;
+        }
+      }
+    }
+  }
+
+  struct LargerRegion
+  {
+    bool operator()(const itk::ImageRegion<2>& a, const itk::ImageRegion<2>& b) const
+    {
+      return a.GetNumberOfPixels() > b.GetNumberOfPixels();
+    }
+  };
+  std::sort(regions.begin(), regions.end(), LargerRegion());
+
+  return regions;
+}
+
+/** Inpaint each independent hole region (see GetIndependentHoleRegions) on its own. Each region is copied
+  * into its own image and mask, which get their own graph, queue, priority function and visitors, and are
+  * inpainted with PyramidLevelInpainting (the ClassicalImageInpainting machinery, searching the whole region).
+  * All of the regions are copied before any of them is inpainted, so the tasks never read 'originalImage' or
+  * 'mask'. Each region is a task of the TaskPool. The regions are submitted largest first, and the filled pixels
+  * are copied back into 'originalImage' (and marked valid in 'mask') as each region finishes.
+  *
+  * The source patches of a hole are looked for within 'searchRadius' of the hole's bounding box, or further if
+  * there is no fully valid source patch that close. */
+template <typename TImage>
+void ConnectedComponentImageInpainting(typename itk::SmartPointer<TImage> originalImage, Mask* const mask,
+                                       const unsigned int patchHalfWidth, const unsigned int searchRadius)
+{
+  std::vector<itk::ImageRegion<2> > regions = GetIndependentHoleRegions(mask, searchRadius + patchHalfWidth,
+                                                                        patchHalfWidth);
+
+  std::cout << "ConnectedComponentImageInpainting: " << regions.size() << " independent regions." << std::endl;
+
+  // Copy each region into an image and a mask whose index starts at zero
+  std::vector<typename TImage::Pointer> regionImages(regions.size());
+  std::vector<Mask::Pointer> regionMasks(regions.size());
+  std::vector<std::vector<itk::Index<2> > > regionHolePixels(regions.size());
+  for(size_t regionId = 0; regionId < regions.size(); ++regionId)
+  {
+    const itk::ImageRegion<2>& region = regions[regionId];
+
+    regionImages[regionId] = TImage::New();
+    ITKHelpers::ExtractRegion(originalImage.GetPointer(), region, regionImages[regionId].GetPointer());
+
+    Mask::Pointer regionMask = Mask::New();
+    regionMask->SetRegions(regionImages[regionId]->GetLargestPossibleRegion());
+    regionMask->Allocate();
+
+    const itk::Offset<2> regionOffset = region.GetIndex() -
+                                        regionImages[regionId]->GetLargestPossibleRegion().GetIndex();
+    itk::ImageRegionConstIteratorWithIndex<Mask> maskIterator(mask, region);
+    while(!maskIterator.IsAtEnd())
+    {
+      if(mask->IsHole(maskIterator.GetIndex()))
+      {
+        regionMask->SetPixel(maskIterator.GetIndex() - regionOffset, regionMask->GetHoleValue());
+        regionHolePixels[regionId].push_back(maskIterator.GetIndex() - regionOffset);
+      }
+      else
+      {
+        regionMask->SetPixel(maskIterator.GetIndex() - regionOffset, regionMask->GetValidValue());
+      }
+      ++maskIterator;
+    }
+    regionMasks[regionId] = regionMask;
+  }
+
+  std::mutex copyBackMutex;
+
+  // One task per region, so that the large regions do not share a task with other regions
+  TaskGroup taskGroup;
+  for(size_t regionId = 0; regionId < regions.size(); ++regionId)
+  {
+    taskGroup.Run([&, regionId]()
+    {
+      typename TImage::Pointer regionImage = regionImages[regionId];
+      const std::vector<itk::Index<2> >& holePixels = regionHolePixels[regionId];
+      const itk::Offset<2> regionOffset = regions[regionId].GetIndex() -
+                                          regionImage->GetLargestPossibleRegion().GetIndex();
+
+      PyramidLevelInpainting(regionImage, regionMasks[regionId].GetPointer(), patchHalfWidth, 0, 0);
+
+      // The regions do not contain each other's hole pixels, but they can share valid pixels, so
+      // only the filled pixels are written back.
+      std::lock_guard<std::mutex> lock(copyBackMutex);
+      for(size_t pixelId = 0; pixelId < holePixels.size(); ++pixelId)
+      {
+        originalImage->SetPixel(holePixels[pixelId] + regionOffset, regionImage->GetPixel(holePixels[pixelId]));
+        mask->SetPixel(holePixels[pixelId] + regionOffset, mask->GetValidValue());
+      }
+    });
+  }
+
+  taskGroup.Wait();
+}
+
+#endif
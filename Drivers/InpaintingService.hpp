@@ -0,0 +1,256 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef InpaintingService_HPP
+#define InpaintingService_HPP
+
+// ITK
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIterator.h"
+
+// STL
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// POSIX
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Custom
+#include "Drivers/InpaintingWorkspace.hpp"
+#include "Utilities/InpaintingServiceProtocol.hpp"
+
+/** A long running inpainting process. Requests (see InpaintingServiceProtocol) are read from a file descriptor
+  * (stdin, or the connections of a Unix socket), each image is inpainted as ClassicalImageInpainting does, and
+  * the inpainted pixels are written back, without touching the disk.
+  *
+  * The InpaintingWorkspace of the last 'maximumNumberOfWorkspaces' image sizes is kept, so a request of a size
+  * that was seen recently reuses its image, mask, graph, queue and descriptor map instead of allocating them.
+  * The message buffers are reused in the same way. The requests are handled one at a time; each of them uses
+  * all of the threads of the TaskPool.
+  *
+  * TImage must have 3 components per pixel. */
+template <typename TImage>
+class InpaintingService
+{
+public:
+  InpaintingService(const unsigned int maximumNumberOfWorkspaces = 4) :
+    MaximumNumberOfWorkspaces(std::max(maximumNumberOfWorkspaces, 1u)), NumberOfRequests(0),
+    NumberOfReusedWorkspaces(0)
+  {
+
+  }
+
+  /** Handle requests from 'inputFileDescriptor' until it is closed. The responses are written to
+    * 'outputFileDescriptor'. A request that cannot be inpainted gets an error response; an error of the
+    * stream itself is thrown. */
+  void Serve(const int inputFileDescriptor, const int outputFileDescriptor)
+  {
+    while(InpaintingServiceProtocol::ReadMessage(inputFileDescriptor, this->RequestMessage))
+    {
+      InpaintingServiceProtocol::Response response;
+      try
+      {
+        InpaintingServiceProtocol::DecodeRequest(this->RequestMessage, this->CurrentRequest);
+        this->HandleRequest(this->CurrentRequest, response.Pixels);
+        response.Succeeded = true;
+      }
+      catch(const std::exception& e)
+      {
+        response.Succeeded = false;
+        response.Error = e.what();
+      }
+
+      InpaintingServiceProtocol::WriteMessage(outputFileDescriptor,
+                                              InpaintingServiceProtocol::EncodeResponse(response));
+    }
+  }
+
+  /** Listen on a Unix socket at 'socketPath' and serve its connections one after the other. This does not return. */
+  void ServeUnixSocket(const std::string& socketPath)
+  {
+    sockaddr_un address;
+    if(socketPath.size() >= sizeof(address.sun_path))
+    {
+      throw std::runtime_error("InpaintingService: The socket path " + socketPath + " is too long!");
+    }
+
+    int listeningSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listeningSocket < 0)
+    {
+      throw std::runtime_error(std::string("InpaintingService: socket failed: ") + std::strerror(errno));
+    }
+
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    unlink(socketPath.c_str());
+    if(bind(listeningSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+       listen(listeningSocket, 16) < 0)
+    {
+      std::string error = std::strerror(errno);
+      close(listeningSocket);
+      throw std::runtime_error("InpaintingService: Could not listen on " + socketPath + ": " + error);
+    }
+
+    std::cerr << "InpaintingService: listening on " << socketPath << std::endl;
+
+    while(true)
+    {
+      int connection = accept(listeningSocket, 0, 0);
+      if(connection < 0)
+      {
+        if(errno == EINTR)
+        {
+          continue;
+        }
+        std::string error = std::strerror(errno);
+        close(listeningSocket);
+        throw std::runtime_error("InpaintingService: accept failed: " + error);
+      }
+
+      try
+      {
+        this->Serve(connection, connection);
+      }
+      catch(const std::exception& e)
+      {
+        // A broken connection does not stop the service
+        std::cerr << "InpaintingService: " << e.what() << std::endl;
+      }
+      close(connection);
+    }
+  }
+
+  /** Inpaint one request and put the RGB pixels of the result into 'pixels'. */
+  void HandleRequest(const InpaintingServiceProtocol::Request& request, std::vector<unsigned char>& pixels)
+  {
+    // Without a source patch the inpainting can not fill anything
+    if(!InpaintingServiceProtocol::HasValidSourcePatch(request))
+    {
+      throw std::runtime_error("InpaintingService: The mask does not leave a single fully valid source patch!");
+    }
+
+    this->NumberOfRequests++;
+
+    itk::Index<2> corner = {{0, 0}};
+    itk::Size<2> size = {{request.Width, request.Height}};
+    itk::ImageRegion<2> region(corner, size);
+
+    InpaintingWorkspace<TImage>* workspace = this->GetWorkspace(region);
+    TImage* image = workspace->GetImage();
+    Mask* mask = workspace->GetMask();
+
+    // Both the image and the protocol are row by row
+    itk::ImageRegionIterator<TImage> imageIterator(image, region);
+    itk::ImageRegionIterator<Mask> maskIterator(mask, region);
+    size_t pixelId = 0;
+    while(!imageIterator.IsAtEnd())
+    {
+      typename TImage::PixelType pixel = imageIterator.Get();
+      for(unsigned int component = 0; component < 3; ++component)
+      {
+        pixel[component] = request.Pixels[3 * pixelId + component];
+      }
+      imageIterator.Set(pixel);
+
+      maskIterator.Set(request.MaskPixels[pixelId] ? mask->GetHoleValue() : mask->GetValidValue());
+
+      ++imageIterator;
+      ++maskIterator;
+      ++pixelId;
+    }
+
+    workspace->Inpaint(request.PatchHalfWidth);
+
+    pixels.resize(3 * region.GetNumberOfPixels());
+    itk::ImageRegionConstIteratorWithIndex<TImage> resultIterator(image, region);
+    pixelId = 0;
+    while(!resultIterator.IsAtEnd())
+    {
+      for(unsigned int component = 0; component < 3; ++component)
+      {
+        float value = resultIterator.Get()[component];
+        pixels[3 * pixelId + component] = static_cast<unsigned char>(std::min(std::max(value, 0.0f), 255.0f));
+      }
+      ++resultIterator;
+      ++pixelId;
+    }
+  }
+
+  /** The number of requests that were handled, and how many of them reused a workspace. */
+  unsigned int GetNumberOfRequests() const
+  {
+    return this->NumberOfRequests;
+  }
+
+  unsigned int GetNumberOfReusedWorkspaces() const
+  {
+    return this->NumberOfReusedWorkspaces;
+  }
+
+private:
+  unsigned int MaximumNumberOfWorkspaces;
+
+  unsigned int NumberOfRequests;
+
+  unsigned int NumberOfReusedWorkspaces;
+
+  /** The workspaces, most recently used first. */
+  std::list<std::shared_ptr<InpaintingWorkspace<TImage> > > Workspaces;
+
+  std::vector<unsigned char> RequestMessage;
+
+  InpaintingServiceProtocol::Request CurrentRequest;
+
+  /** Get the workspace of an image of 'region', creating it (and dropping the least recently used one) if needed. */
+  InpaintingWorkspace<TImage>* GetWorkspace(const itk::ImageRegion<2>& region)
+  {
+    typedef typename std::list<std::shared_ptr<InpaintingWorkspace<TImage> > >::iterator WorkspaceIteratorType;
+    for(WorkspaceIteratorType workspaceIterator = this->Workspaces.begin();
+        workspaceIterator != this->Workspaces.end(); ++workspaceIterator)
+    {
+      if((*workspaceIterator)->GetRegion() == region)
+      {
+        this->Workspaces.splice(this->Workspaces.begin(), this->Workspaces, workspaceIterator);
+        this->NumberOfReusedWorkspaces++;
+        return this->Workspaces.front().get();
+      }
+    }
+
+    if(this->Workspaces.size() >= this->MaximumNumberOfWorkspaces)
+    {
+      this->Workspaces.pop_back();
+    }
+
+    this->Workspaces.push_front(std::shared_ptr<InpaintingWorkspace<TImage> >(
+                                  new InpaintingWorkspace<TImage>(region)));
+    return this->Workspaces.front().get();
+  }
+};
+
+#endif
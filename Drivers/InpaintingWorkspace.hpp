@@ -0,0 +1,224 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef InpaintingWorkspace_HPP
+#define InpaintingWorkspace_HPP
+
+// Custom
+#include "Utilities/IndirectPriorityQueue.h"
+
+// STL
+#include <memory>
+
+// Submodules
+#include <Helpers/Helpers.h>
+#include <Mask/Mask.h>
+
+// Pixel descriptors
+#include "PixelDescriptors/ImagePatchPixelDescriptor.h"
+
+// Descriptor visitors
+#include "Visitors/DescriptorVisitors/ImagePatchDescriptorVisitor.hpp"
+
+// Inpainting visitors
+#include "Visitors/InpaintingVisitors/InpaintingVisitor.hpp"
+#include "Visitors/AcceptanceVisitors/DefaultAcceptanceVisitor.hpp"
+
+// Nearest neighbors
+#include "NearestNeighbor/LinearSearchBest/Property.hpp"
+
+// Initializers
+#include "Initializers/InitializeFromMaskImage.hpp"
+#include "Initializers/InitializePriority.hpp"
+
+// Inpainters
+#include "Inpainters/CompositePatchInpainter.hpp"
+#include "Inpainters/PatchInpainter.hpp"
+
+// Difference functions
+#include "DifferenceFunctions/Patch/ImagePatchDifference.hpp"
+#include "DifferenceFunctions/Pixel/SumSquaredPixelDifference.hpp"
+
+// Inpainting
+#include "Algorithms/InpaintingAlgorithmWithLocalSearch.hpp"
+
+// Priority
+#include "Priority/PriorityCriminisi.h"
+
+// Search regions
+#include "SearchRegions/NeighborhoodSearch.hpp"
+
+// Boost
+#include <boost/graph/grid_graph.hpp>
+#include <boost/property_map/property_map.hpp>
+
+/** The buffers that ClassicalImageInpainting allocates for an image of a given size: the image, its blurred
+  * copy, the mask, the graph, the boundary node queue and the descriptor map. A long running process (see
+  * InpaintingService) keeps a workspace per image size and inpaints every image of that size in it, so these
+  * are allocated once instead of once per image. The descriptors are rebuilt for every image, but
+  * assigning them into the existing map reuses the storage of their offset lists.
+  *
+  * The priority function and the visitors depend on the image, so they are still created for every image
+  * (they are small, except for the per-pixel images of the priority function). */
+template <typename TImage>
+class InpaintingWorkspace
+{
+public:
+  typedef boost::grid_graph<2> VertexListGraphType;
+  typedef boost::graph_traits<VertexListGraphType>::vertex_descriptor VertexDescriptorType;
+
+  typedef IndirectPriorityQueue<VertexListGraphType> BoundaryNodeQueueType;
+
+  typedef ImagePatchPixelDescriptor<TImage> ImagePatchPixelDescriptorType;
+  typedef boost::vector_property_map<ImagePatchPixelDescriptorType,
+      typename BoundaryNodeQueueType::IndexMapType> ImagePatchDescriptorMapType;
+
+  InpaintingWorkspace(const itk::ImageRegion<2>& region) : Region(region), NumberOfUses(0)
+  {
+    this->Image = TImage::New();
+    this->Image->SetRegions(region);
+    this->Image->Allocate();
+
+    this->BlurredImage = TImage::New();
+
+    this->MaskImage = Mask::New();
+    this->MaskImage->SetRegions(region);
+    this->MaskImage->Allocate();
+
+    boost::array<std::size_t, 2> graphSideLengths = { { region.GetSize()[0], region.GetSize()[1] } };
+    this->Graph.reset(new VertexListGraphType(graphSideLengths));
+
+    this->BoundaryNodeQueue.reset(new BoundaryNodeQueueType(*this->Graph));
+
+    this->DescriptorMap.reset(new ImagePatchDescriptorMapType(num_vertices(*this->Graph),
+                                                               *(this->BoundaryNodeQueue->GetIndexMap())));
+  }
+
+  const itk::ImageRegion<2>& GetRegion() const
+  {
+    return this->Region;
+  }
+
+  /** The image to fill in before calling Inpaint(). It holds the result afterwards. */
+  TImage* GetImage()
+  {
+    return this->Image;
+  }
+
+  /** The mask to fill in before calling Inpaint(). */
+  Mask* GetMask()
+  {
+    return this->MaskImage;
+  }
+
+  /** The number of images that have been inpainted in this workspace. */
+  unsigned int GetNumberOfUses() const
+  {
+    return this->NumberOfUses;
+  }
+
+  /** Inpaint GetImage() where GetMask() is a hole, in the same way as ClassicalImageInpainting. */
+  void Inpaint(const unsigned int patchHalfWidth)
+  {
+    this->NumberOfUses++;
+
+    this->BoundaryNodeQueue->clear();
+
+    // Blur the image
+    float blurVariance = 2.0f;
+    MaskOperations::MaskedBlur(this->Image.GetPointer(), this->MaskImage.GetPointer(), blurVariance,
+                               this->BlurredImage.GetPointer());
+
+    // Create the patch inpainters for the image and the blurred image, and a composite inpainter.
+    typedef PatchInpainter<TImage> ImageInpainterType;
+    std::shared_ptr<ImageInpainterType> imagePatchInpainter(new
+        ImageInpainterType(patchHalfWidth, this->Image, this->MaskImage));
+
+    std::shared_ptr<ImageInpainterType> blurredImagePatchInpainter(new
+        ImageInpainterType(patchHalfWidth, this->BlurredImage, this->MaskImage));
+
+    std::shared_ptr<CompositePatchInpainter> inpainter(new CompositePatchInpainter);
+    inpainter->AddInpainter(imagePatchInpainter);
+    inpainter->AddInpainter(blurredImagePatchInpainter);
+
+    // Create the priority function
+    typedef PriorityCriminisi<TImage> PriorityType;
+    std::shared_ptr<PriorityType> priorityFunction(new PriorityType(this->BlurredImage, this->MaskImage,
+                                                                    patchHalfWidth));
+
+    // Create the descriptor visitor
+    typedef ImagePatchDescriptorVisitor<VertexListGraphType, TImage, ImagePatchDescriptorMapType>
+        ImagePatchDescriptorVisitorType;
+    std::shared_ptr<ImagePatchDescriptorVisitorType> imagePatchDescriptorVisitor(new
+        ImagePatchDescriptorVisitorType(this->Image.GetPointer(), this->MaskImage.GetPointer(),
+                                        this->DescriptorMap, patchHalfWidth));
+
+    typedef DefaultAcceptanceVisitor<VertexListGraphType> AcceptanceVisitorType;
+    std::shared_ptr<AcceptanceVisitorType> acceptanceVisitor(new AcceptanceVisitorType);
+
+    // Create the inpainting visitor
+    typedef InpaintingVisitor<VertexListGraphType, BoundaryNodeQueueType,
+                              ImagePatchDescriptorVisitorType, AcceptanceVisitorType, PriorityType>
+                              InpaintingVisitorType;
+    std::shared_ptr<InpaintingVisitorType> inpaintingVisitor(new InpaintingVisitorType(this->MaskImage,
+                                            this->BoundaryNodeQueue, imagePatchDescriptorVisitor,
+                                            acceptanceVisitor, priorityFunction, patchHalfWidth,
+                                            "InpaintingVisitor"));
+    inpaintingVisitor->SetAllowNewPatches(false);
+
+    InitializePriorityFromFillFront(inpaintingVisitor.get(), this->BoundaryNodeQueue.get(), priorityFunction.get());
+
+    // This overwrites the descriptors of the previous image
+    InitializeFromMaskImage<InpaintingVisitorType, VertexDescriptorType>(this->MaskImage.GetPointer(),
+                                                                         inpaintingVisitor.get());
+
+    // Create the best patch searcher
+    typedef ImagePatchDifference<ImagePatchPixelDescriptorType,
+        SumSquaredPixelDifference<typename TImage::PixelType> > PatchDifferenceType;
+
+    typedef LinearSearchBestProperty<ImagePatchDescriptorMapType,
+                                     PatchDifferenceType> BestSearchType;
+    std::shared_ptr<BestSearchType> linearSearchBest(new BestSearchType(*this->DescriptorMap));
+
+    // As in ClassicalImageInpainting, search up to 1/4 of the image each time
+    typedef NeighborhoodSearch<VertexDescriptorType, ImagePatchDescriptorMapType> NeighborhoodSearchType;
+    NeighborhoodSearchType neighborhoodSearch(this->Region, this->Region.GetSize()[0]/8, *this->DescriptorMap);
+
+    InpaintingAlgorithmWithLocalSearch(this->Graph, inpaintingVisitor, this->BoundaryNodeQueue,
+                                       linearSearchBest, inpainter, neighborhoodSearch);
+  }
+
+private:
+  itk::ImageRegion<2> Region;
+
+  unsigned int NumberOfUses;
+
+  typename TImage::Pointer Image;
+
+  typename TImage::Pointer BlurredImage;
+
+  Mask::Pointer MaskImage;
+
+  std::shared_ptr<VertexListGraphType> Graph;
+
+  std::shared_ptr<BoundaryNodeQueueType> BoundaryNodeQueue;
+
+  std::shared_ptr<ImagePatchDescriptorMapType> DescriptorMap;
+};
+
+#endif
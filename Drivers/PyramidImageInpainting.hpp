@@ -0,0 +1,343 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef PyramidImageInpainting_HPP
+#define PyramidImageInpainting_HPP
+
+// Custom
+#include "Utilities/IndirectPriorityQueue.h"
+#include "Utilities/PyramidHelpers.hpp"
+
+// STL
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+// ITK
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+// Submodules
+#include <Helpers/Helpers.h>
+#include <ITKHelpers/ITKHelpers.h>
+#include <Mask/Mask.h>
+
+// Pixel descriptors
+#include "PixelDescriptors/ImagePatchPixelDescriptor.h"
+
+// Descriptor visitors
+#include "Visitors/DescriptorVisitors/ImagePatchDescriptorVisitor.hpp"
+
+// Inpainting visitors
+#include "Visitors/InpaintingVisitors/InpaintingVisitor.hpp"
+#include "Visitors/AcceptanceVisitors/DefaultAcceptanceVisitor.hpp"
+
+// Nearest neighbors
+#include "NearestNeighbor/LinearSearchBest/Property.hpp"
+
+// Initializers
+#include "Initializers/InitializeFromMaskImage.hpp"
+#include "Initializers/InitializePriority.hpp"
+
+// Inpainters
+#include "Inpainters/CompositePatchInpainter.hpp"
+#include "Inpainters/PatchInpainter.hpp"
+
+// Difference functions
+#include "DifferenceFunctions/Patch/ImagePatchDifference.hpp"
+#include "DifferenceFunctions/Pixel/SumSquaredPixelDifference.hpp"
+
+// Inpainting
+#include "Algorithms/InpaintingAlgorithmWithLocalSearch.hpp"
+
+// Priority
+#include "Priority/PriorityCriminisi.h"
+
+// Search regions
+#include "SearchRegions/CoarseToFineSearch.hpp"
+#include "SearchRegions/FullImageSearch.hpp"
+
+// Boost
+#include <boost/graph/grid_graph.hpp>
+#include <boost/property_map/property_map.hpp>
+
+/** Determine if 'region' contains a patch of radius 'patchHalfWidth' whose pixels are all valid in 'mask'. */
+inline bool ContainsValidSourcePatch(const Mask* const mask, const itk::ImageRegion<2>& region,
+                                     const unsigned int patchHalfWidth)
+{
+  const unsigned int patchWidth = 2 * patchHalfWidth + 1;
+  if(region.GetSize()[0] < patchWidth || region.GetSize()[1] < patchWidth)
+  {
+    return false;
+  }
+
+  // The centers of the patches that are inside of the region
+  itk::ImageRegion<2> centerRegion = region;
+  centerRegion.ShrinkByRadius(patchHalfWidth);
+
+  itk::ImageRegionConstIteratorWithIndex<Mask> centerIterator(mask, centerRegion);
+  while(!centerIterator.IsAtEnd())
+  {
+    if(mask->IsValid(ITKHelpers::GetRegionInRadiusAroundPixel(centerIterator.GetIndex(), patchHalfWidth)))
+    {
+      return true;
+    }
+    ++centerIterator;
+  }
+
+  return false;
+}
+
+/** Search the whole image for each target patch, as the coarsest level of the pyramid does. This and
+  * CoarseToFineLevelSearch are the searches that PyramidLevelInpainting runs with InpaintLevelWithSearch. */
+struct FullImageLevelSearch
+{
+  template <typename TGraph, typename TInpaintingVisitor, typename TBoundaryNodeQueue, typename TDescriptorMap,
+            typename TBestSearch, typename TPatchDifference, typename TInpainter>
+  void operator()(std::shared_ptr<TGraph> graph, std::shared_ptr<TInpaintingVisitor> inpaintingVisitor,
+                  std::shared_ptr<TBoundaryNodeQueue> boundaryNodeQueue, std::shared_ptr<TDescriptorMap>,
+                  std::shared_ptr<TBestSearch> bestSearch, const TPatchDifference&,
+                  std::shared_ptr<TInpainter> inpainter, const itk::ImageRegion<2>& fullRegion)
+  {
+    typedef typename boost::graph_traits<TGraph>::vertex_descriptor VertexDescriptorType;
+    FullImageSearch<VertexDescriptorType> fullImageSearch(fullRegion);
+
+    InpaintingAlgorithmWithLocalSearch(graph, inpaintingVisitor, boundaryNodeQueue,
+                                       bestSearch, inpainter, fullImageSearch);
+  }
+};
+
+/** Search the windows of 'searchRadius' around the source locations the level above used (see
+  * CoarseToFineSearch). If the level above has no prediction for a target patch, search up to 1/4 of the
+  * image, as ClassicalImageInpainting does. */
+struct CoarseToFineLevelSearch
+{
+  itk::Image<itk::Index<2>, 2>* CoarseSourcePixelMap;
+
+  unsigned int PatchHalfWidth;
+
+  unsigned int SearchRadius;
+
+  CoarseToFineLevelSearch(itk::Image<itk::Index<2>, 2>* const coarseSourcePixelMap,
+                          const unsigned int patchHalfWidth, const unsigned int searchRadius) :
+    CoarseSourcePixelMap(coarseSourcePixelMap), PatchHalfWidth(patchHalfWidth), SearchRadius(searchRadius)
+  {
+
+  }
+
+  template <typename TGraph, typename TInpaintingVisitor, typename TBoundaryNodeQueue, typename TDescriptorMap,
+            typename TBestSearch, typename TPatchDifference, typename TInpainter>
+  void operator()(std::shared_ptr<TGraph> graph, std::shared_ptr<TInpaintingVisitor> inpaintingVisitor,
+                  std::shared_ptr<TBoundaryNodeQueue> boundaryNodeQueue,
+                  std::shared_ptr<TDescriptorMap> imagePatchDescriptorMap,
+                  std::shared_ptr<TBestSearch> bestSearch, const TPatchDifference&,
+                  std::shared_ptr<TInpainter> inpainter, const itk::ImageRegion<2>& fullRegion)
+  {
+    typedef typename boost::graph_traits<TGraph>::vertex_descriptor VertexDescriptorType;
+    typedef CoarseToFineSearch<VertexDescriptorType, TDescriptorMap> CoarseToFineSearchType;
+    CoarseToFineSearchType coarseToFineSearch(fullRegion, this->CoarseSourcePixelMap, this->PatchHalfWidth,
+                                              this->SearchRadius, fullRegion.GetSize()[0]/8,
+                                              *imagePatchDescriptorMap);
+
+    InpaintingAlgorithmWithLocalSearch(graph, inpaintingVisitor, boundaryNodeQueue,
+                                       bestSearch, inpainter, coarseToFineSearch);
+  }
+};
+
+/** Inpaint 'image' in the same way as ClassicalImageInpainting, except that the algorithm and the search
+  * regions are run by 'levelSearch'. The image and the blurred image, the priority function, the visitors and
+  * the linear best patch search are set up here, and 'levelSearch' is called with them as
+  *   levelSearch(graph, inpaintingVisitor, boundaryNodeQueue, imagePatchDescriptorMap, bestSearch,
+  *               patchDifference, inpainter, fullRegion)
+  * (see FullImageLevelSearch, CoarseToFineLevelSearch and VideoWarmStartLevelSearch). If 'targetRegion' is given,
+  * only the target patches centered in it are filled, so the hole pixels that are further than a patch from it
+  * are left as they are (see TiledImageInpainting).
+  * Returns the source pixel map of the image. An exception is thrown if the image has no fully valid source
+  * patch. */
+template <typename TImage, typename TLevelSearch>
+itk::Image<itk::Index<2>, 2>::Pointer
+InpaintLevelWithSearch(typename itk::SmartPointer<TImage> image, Mask* const mask,
+                       const unsigned int patchHalfWidth, TLevelSearch& levelSearch,
+                       const itk::ImageRegion<2>* const targetRegion = 0)
+{
+  itk::ImageRegion<2> fullRegion = image->GetLargestPossibleRegion();
+
+  // Without a source patch the search would return the end of its range
+  if(!ContainsValidSourcePatch(mask, fullRegion, patchHalfWidth))
+  {
+    throw std::runtime_error("InpaintLevelWithSearch: The image does not contain a valid source patch!");
+  }
+
+  // Blur the image
+  typedef TImage BlurredImageType; // Usually the blurred image is the same type as the original image.
+  typename BlurredImageType::Pointer blurredImage = BlurredImageType::New();
+  float blurVariance = 2.0f;
+  MaskOperations::MaskedBlur(image.GetPointer(), mask, blurVariance, blurredImage.GetPointer());
+
+  typedef ImagePatchPixelDescriptor<TImage> ImagePatchPixelDescriptorType;
+
+  // Create the graph
+  typedef boost::grid_graph<2> VertexListGraphType;
+  boost::array<std::size_t, 2> graphSideLengths = { { fullRegion.GetSize()[0],
+                                                      fullRegion.GetSize()[1] } };
+  std::shared_ptr<VertexListGraphType> graph(new VertexListGraphType(graphSideLengths));
+  typedef boost::graph_traits<VertexListGraphType>::vertex_descriptor VertexDescriptorType;
+
+  // Queue
+  typedef IndirectPriorityQueue<VertexListGraphType> BoundaryNodeQueueType;
+  std::shared_ptr<BoundaryNodeQueueType> boundaryNodeQueue(new BoundaryNodeQueueType(*graph));
+  if(targetRegion)
+  {
+    itk::ImageRegion<2> croppedTargetRegion = *targetRegion;
+    croppedTargetRegion.Crop(fullRegion);
+    boundaryNodeQueue->SetTargetRegion(
+          Helpers::ConvertFrom<VertexDescriptorType, itk::Index<2> >(croppedTargetRegion.GetIndex()),
+          Helpers::ConvertFrom<VertexDescriptorType, itk::Index<2> >(croppedTargetRegion.GetUpperIndex()));
+  }
+
+  // Create the descriptor map. This is where the data for each pixel is stored.
+  typedef boost::vector_property_map<ImagePatchPixelDescriptorType,
+      BoundaryNodeQueueType::IndexMapType> ImagePatchDescriptorMapType;
+  std::shared_ptr<ImagePatchDescriptorMapType> imagePatchDescriptorMap(new
+      ImagePatchDescriptorMapType(num_vertices(*graph), *(boundaryNodeQueue->GetIndexMap())));
+
+  // Create the patch inpainters for the image and the blurred image, and a composite inpainter.
+  typedef PatchInpainter<TImage> OriginalImageInpainterType;
+  std::shared_ptr<OriginalImageInpainterType> originalImagePatchInpainter(new
+      OriginalImageInpainterType(patchHalfWidth, image, mask));
+
+  typedef PatchInpainter<BlurredImageType> BlurredImageInpainterType;
+  std::shared_ptr<BlurredImageInpainterType> blurredImagePatchInpainter(new
+     BlurredImageInpainterType(patchHalfWidth, blurredImage, mask));
+
+  std::shared_ptr<CompositePatchInpainter> inpainter(new CompositePatchInpainter);
+  inpainter->AddInpainter(originalImagePatchInpainter);
+  inpainter->AddInpainter(blurredImagePatchInpainter);
+
+  // Create the priority function
+  typedef PriorityCriminisi<BlurredImageType> PriorityType;
+  std::shared_ptr<PriorityType> priorityFunction(new PriorityType(blurredImage, mask, patchHalfWidth));
+
+  // Create the descriptor visitor
+  typedef ImagePatchDescriptorVisitor<VertexListGraphType, TImage, ImagePatchDescriptorMapType>
+      ImagePatchDescriptorVisitorType;
+  std::shared_ptr<ImagePatchDescriptorVisitorType> imagePatchDescriptorVisitor(new
+      ImagePatchDescriptorVisitorType(image.GetPointer(), mask,
+                                      imagePatchDescriptorMap, patchHalfWidth));
+
+  typedef DefaultAcceptanceVisitor<VertexListGraphType> AcceptanceVisitorType;
+  std::shared_ptr<AcceptanceVisitorType> acceptanceVisitor(new AcceptanceVisitorType);
+
+  // Create the inpainting visitor. Its source pixel map records where every hole pixel was copied from.
+  typedef InpaintingVisitor<VertexListGraphType, BoundaryNodeQueueType,
+                            ImagePatchDescriptorVisitorType, AcceptanceVisitorType, PriorityType>
+                            InpaintingVisitorType;
+  std::shared_ptr<InpaintingVisitorType> inpaintingVisitor(new InpaintingVisitorType(mask, boundaryNodeQueue,
+                                          imagePatchDescriptorVisitor, acceptanceVisitor,
+                                          priorityFunction, patchHalfWidth, "InpaintingVisitor"));
+  inpaintingVisitor->SetAllowNewPatches(false);
+
+  InitializePriorityFromFillFront(inpaintingVisitor.get(), boundaryNodeQueue.get(), priorityFunction.get());
+
+  // Initialize the boundary node queue from the mask.
+  InitializeFromMaskImage<InpaintingVisitorType, VertexDescriptorType>(mask, inpaintingVisitor.get());
+
+  // Create the best patch searcher
+  typedef ImagePatchDifference<ImagePatchPixelDescriptorType,
+      SumSquaredPixelDifference<typename TImage::PixelType> > PatchDifferenceType;
+
+  typedef LinearSearchBestProperty<ImagePatchDescriptorMapType,
+                                   PatchDifferenceType> BestSearchType;
+  std::shared_ptr<BestSearchType> linearSearchBest(new BestSearchType(*imagePatchDescriptorMap));
+
+  // Perform the inpainting
+  levelSearch(graph, inpaintingVisitor, boundaryNodeQueue, imagePatchDescriptorMap, linearSearchBest,
+              PatchDifferenceType(), inpainter, fullRegion);
+
+  return inpaintingVisitor->GetSourcePixelMapImage();
+}
+
+/** Inpaint one level of the pyramid in the same way as ClassicalImageInpainting. If 'coarseSourcePixelMap' is
+  * null (the coarsest level) the whole image is searched for each target patch, otherwise only the windows
+  * around the source locations the level above used are searched (see CoarseToFineSearch).
+  * If 'targetRegion' is given, only the target patches centered in it are filled (see InpaintLevelWithSearch).
+  * Returns the source pixel map of this level, which guides the search of the next finer level. An exception is
+  * thrown if the image has no fully valid source patch. */
+template <typename TImage>
+itk::Image<itk::Index<2>, 2>::Pointer
+PyramidLevelInpainting(typename itk::SmartPointer<TImage> image, Mask* const mask,
+                       const unsigned int patchHalfWidth,
+                       itk::Image<itk::Index<2>, 2>* const coarseSourcePixelMap,
+                       const unsigned int searchRadius,
+                       const itk::ImageRegion<2>* const targetRegion = 0)
+{
+  if(!coarseSourcePixelMap)
+  {
+    FullImageLevelSearch fullImageLevelSearch;
+    return InpaintLevelWithSearch(image, mask, patchHalfWidth, fullImageLevelSearch, targetRegion);
+  }
+
+  CoarseToFineLevelSearch coarseToFineLevelSearch(coarseSourcePixelMap, patchHalfWidth, searchRadius);
+  return InpaintLevelWithSearch(image, mask, patchHalfWidth, coarseToFineLevelSearch, targetRegion);
+}
+
+/** Inpaint 'originalImage' coarse-to-fine. A pyramid of up to 'numberOfLevels' levels (including the original
+  * resolution) of the image and the mask is built with PyramidHelpers::DownsampleMasked. The coarsest level is
+  * inpainted with an exhaustive search, and each finer level only searches windows of 'searchRadius' around the
+  * upsampled source locations of the level above, so the cost of the full resolution search no longer grows with
+  * the image size. Levels that would be too small to contain source patches are not created. As in
+  * ClassicalImageInpainting, 'originalImage' and 'mask' are modified in place. */
+template <typename TImage>
+void PyramidImageInpainting(typename itk::SmartPointer<TImage> originalImage, Mask* const mask,
+                            const unsigned int patchHalfWidth, const unsigned int numberOfLevels,
+                            const unsigned int searchRadius = 2)
+{
+  std::vector<typename TImage::Pointer> images(1, originalImage);
+  std::vector<Mask::Pointer> masks(1, mask);
+
+  // Stop when the next level would be less than two patches wide in either direction
+  const unsigned int minimumLevelSize = 2 * (2 * patchHalfWidth + 1);
+  while(images.size() < numberOfLevels)
+  {
+    itk::ImageRegion<2> coarseRegion =
+        PyramidHelpers::GetDownsampledRegion(images.back()->GetLargestPossibleRegion());
+    if(coarseRegion.GetSize()[0] < minimumLevelSize || coarseRegion.GetSize()[1] < minimumLevelSize)
+    {
+      break;
+    }
+
+    typename TImage::Pointer coarseImage = TImage::New();
+    Mask::Pointer coarseMask = Mask::New();
+    PyramidHelpers::DownsampleMasked(images.back().GetPointer(), masks.back().GetPointer(),
+                                     coarseImage.GetPointer(), coarseMask.GetPointer());
+    images.push_back(coarseImage);
+    masks.push_back(coarseMask);
+  }
+
+  std::cout << "PyramidImageInpainting: using " << images.size() << " levels." << std::endl;
+
+  itk::Image<itk::Index<2>, 2>::Pointer coarseSourcePixelMap;
+  for(int level = static_cast<int>(images.size()) - 1; level >= 0; --level)
+  {
+    std::cout << "PyramidImageInpainting: inpainting level " << level << " ("
+              << images[level]->GetLargestPossibleRegion().GetSize() << ")" << std::endl;
+    coarseSourcePixelMap = PyramidLevelInpainting(images[level], masks[level].GetPointer(), patchHalfWidth,
+                                                  coarseSourcePixelMap.GetPointer(), searchRadius);
+  }
+}
+
+#endif
@@ -0,0 +1,340 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef SharedSourceBankInpainting_HPP
+#define SharedSourceBankInpainting_HPP
+
+// ITK
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+// Submodules
+#include <Helpers/Helpers.h>
+#include <ITKHelpers/ITKHelpers.h>
+#include <Mask/Mask.h>
+
+// STL
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+// Boost
+#include <boost/graph/grid_graph.hpp>
+#include <boost/property_map/property_map.hpp>
+
+// Custom
+#include "Utilities/IndirectPriorityQueue.h"
+#include "Utilities/SourcePatchBank.hpp"
+#include "Utilities/TaskPool.h"
+
+// Pixel descriptors
+#include "PixelDescriptors/ImagePatchPixelDescriptor.h"
+
+// Descriptor visitors
+#include "Visitors/DescriptorVisitors/ImagePatchDescriptorVisitor.hpp"
+
+// Inpainting visitors
+#include "Visitors/InpaintingVisitors/InpaintingVisitor.hpp"
+#include "Visitors/AcceptanceVisitors/DefaultAcceptanceVisitor.hpp"
+
+// Nearest neighbors
+#include "NearestNeighbor/VPTreeSearchBest.hpp"
+
+// Initializers
+#include "Initializers/InitializePriority.hpp"
+
+// Inpainters
+#include "Inpainters/CompositePatchInpainter.hpp"
+#include "Inpainters/PatchInpainter.hpp"
+
+// Priority
+#include "Priority/PriorityCriminisi.h"
+
+/** The source side of inpainting, computed once for a reference image so that many target images that share
+  * its background (e.g. the frames of a video from a fixed camera) can be inpainted against it: the blurred
+  * reference image, the list of valid source patches (SourcePatchBank), their descriptors, and a
+  * VPTreeSearchBest index over them.
+  * The descriptors of the other pixels of the reference are never created.
+  *
+  * Nothing is changed after the constructor, so any number of SharedSourceBankInpainting calls can use the
+  * bank concurrently. */
+template <typename TImage>
+class SharedSourceBank
+{
+public:
+  typedef boost::grid_graph<2> VertexListGraphType;
+  typedef boost::graph_traits<VertexListGraphType>::vertex_descriptor VertexDescriptorType;
+  typedef boost::property_map<VertexListGraphType, boost::vertex_index_t>::const_type IndexMapType;
+
+  typedef ImagePatchPixelDescriptor<TImage> ImagePatchPixelDescriptorType;
+  typedef boost::vector_property_map<ImagePatchPixelDescriptorType, IndexMapType> ImagePatchDescriptorMapType;
+
+  typedef VPTreeSearchBest<ImagePatchDescriptorMapType> SearchType;
+
+  /** The source patches are the patches of 'referenceImage' that are entirely valid in 'referenceMask'. */
+  SharedSourceBank(typename TImage::Pointer referenceImage, Mask* const referenceMask,
+                   const unsigned int patchHalfWidth) :
+    ReferenceImage(referenceImage), ReferenceMask(referenceMask), PatchHalfWidth(patchHalfWidth)
+  {
+    itk::ImageRegion<2> fullRegion = referenceImage->GetLargestPossibleRegion();
+
+    this->BlurredReferenceImage = TImage::New();
+    float blurVariance = 2.0f; // As in ClassicalImageInpainting
+    MaskOperations::MaskedBlur(referenceImage.GetPointer(), referenceMask, blurVariance,
+                               this->BlurredReferenceImage.GetPointer());
+
+    boost::array<std::size_t, 2> graphSideLengths = { { fullRegion.GetSize()[0], fullRegion.GetSize()[1] } };
+    this->Graph.reset(new VertexListGraphType(graphSideLengths));
+
+    this->DescriptorMap.reset(new ImagePatchDescriptorMapType(num_vertices(*this->Graph),
+                                                               get(boost::vertex_index, *this->Graph)));
+
+    this->Bank.reset(new SourcePatchBank<VertexDescriptorType>(referenceMask, patchHalfWidth));
+    if(this->Bank->size() == 0)
+    {
+      throw std::runtime_error("SharedSourceBank: The reference image has no valid source patches!");
+    }
+
+    // Only the source patches get descriptors
+    typedef ImagePatchDescriptorVisitor<VertexListGraphType, TImage, ImagePatchDescriptorMapType>
+        ImagePatchDescriptorVisitorType;
+    ImagePatchDescriptorVisitorType descriptorVisitor(referenceImage.GetPointer(), referenceMask,
+                                                      this->DescriptorMap, patchHalfWidth);
+    for(typename SourcePatchBank<VertexDescriptorType>::ConstIteratorType nodeIterator = this->Bank->begin();
+        nodeIterator != this->Bank->end(); ++nodeIterator)
+    {
+      descriptorVisitor.InitializeVertex(*nodeIterator);
+    }
+
+    this->Search.reset(new SearchType(*this->DescriptorMap));
+    this->Search->Build(this->Bank->begin(), this->Bank->end());
+
+    std::cout << "SharedSourceBank: " << this->Bank->size() << " source patches." << std::endl;
+  }
+
+  TImage* GetReferenceImage() const
+  {
+    return this->ReferenceImage;
+  }
+
+  TImage* GetBlurredReferenceImage() const
+  {
+    return this->BlurredReferenceImage;
+  }
+
+  unsigned int GetPatchHalfWidth() const
+  {
+    return this->PatchHalfWidth;
+  }
+
+  /** Get the center (in the reference image) of the source patch that best matches the valid pixels of
+    * 'targetPatch', which can be a patch of any image. The target patches on the fill front are partially valid,
+    * and the tree prunes them with the bounding boxes of its nodes (see VPTreeSearchBest), so this does not
+    * compare every source patch. A query runs on the calling thread; the concurrency comes from inpainting
+    * several images at once. */
+  itk::Index<2> FindBestSourcePatch(const ImagePatchPixelDescriptorType& targetPatch) const
+  {
+    return ITKHelpers::CreateIndex(this->Search->FindBest(targetPatch));
+  }
+
+private:
+  typename TImage::Pointer ReferenceImage;
+
+  typename TImage::Pointer BlurredReferenceImage;
+
+  Mask::Pointer ReferenceMask;
+
+  unsigned int PatchHalfWidth;
+
+  std::shared_ptr<VertexListGraphType> Graph;
+
+  std::shared_ptr<ImagePatchDescriptorMapType> DescriptorMap;
+
+  std::shared_ptr<SourcePatchBank<VertexDescriptorType> > Bank;
+
+  std::shared_ptr<SearchType> Search;
+};
+
+/** Inpaint 'image' where 'mask' is a hole from the source patches of 'sourceBank', in the same way as
+  * ClassicalImageInpainting (Criminisi priorities on the blurred image, and the image and its blurred copy
+  * painted together), except that every target patch is searched for in the whole reference image with
+  * the shared index and is filled from the reference image. The image must be the same size as the
+  * reference image (the visitor records the source pixel of every filled pixel in the coordinates of the image).
+  *
+  * Only the descriptors of the pixels within a patch of the hole are created (not of every pixel, as
+  * InitializeFromMaskImage does), since the pixels of the image are never used as source patches.
+  * The priority function still computes the isophotes of 'image' itself, because they depend on its mask. */
+template <typename TImage>
+void SharedSourceBankInpainting(const SharedSourceBank<TImage>& sourceBank,
+                                typename itk::SmartPointer<TImage> image, Mask* const mask)
+{
+  const unsigned int patchHalfWidth = sourceBank.GetPatchHalfWidth();
+  itk::ImageRegion<2> fullRegion = image->GetLargestPossibleRegion();
+
+  if(fullRegion != sourceBank.GetReferenceImage()->GetLargestPossibleRegion())
+  {
+    throw std::runtime_error("SharedSourceBankInpainting: The image is not the same size as the reference image!");
+  }
+
+  // Blur the image
+  typename TImage::Pointer blurredImage = TImage::New();
+  float blurVariance = 2.0f;
+  MaskOperations::MaskedBlur(image.GetPointer(), mask, blurVariance, blurredImage.GetPointer());
+
+  typedef ImagePatchPixelDescriptor<TImage> ImagePatchPixelDescriptorType;
+
+  // Create the graph
+  typedef boost::grid_graph<2> VertexListGraphType;
+  boost::array<std::size_t, 2> graphSideLengths = { { fullRegion.GetSize()[0],
+                                                      fullRegion.GetSize()[1] } };
+  std::shared_ptr<VertexListGraphType> graph(new VertexListGraphType(graphSideLengths));
+  typedef boost::graph_traits<VertexListGraphType>::vertex_descriptor VertexDescriptorType;
+
+  // Queue
+  typedef IndirectPriorityQueue<VertexListGraphType> BoundaryNodeQueueType;
+  std::shared_ptr<BoundaryNodeQueueType> boundaryNodeQueue(new BoundaryNodeQueueType(*graph));
+
+  // Create the descriptor map of the target patches.
+  typedef boost::vector_property_map<ImagePatchPixelDescriptorType,
+      BoundaryNodeQueueType::IndexMapType> ImagePatchDescriptorMapType;
+  std::shared_ptr<ImagePatchDescriptorMapType> imagePatchDescriptorMap(new
+      ImagePatchDescriptorMapType(num_vertices(*graph), *(boundaryNodeQueue->GetIndexMap())));
+
+  // Create the patch inpainters, which copy from the reference image and its blurred copy.
+  typedef PatchInpainter<TImage> ImageInpainterType;
+  std::shared_ptr<ImageInpainterType> imagePatchInpainter(new ImageInpainterType(patchHalfWidth, image, mask));
+  imagePatchInpainter->SetSourceImage(sourceBank.GetReferenceImage());
+
+  std::shared_ptr<ImageInpainterType> blurredImagePatchInpainter(new
+      ImageInpainterType(patchHalfWidth, blurredImage, mask));
+  blurredImagePatchInpainter->SetSourceImage(sourceBank.GetBlurredReferenceImage());
+
+  std::shared_ptr<CompositePatchInpainter> inpainter(new CompositePatchInpainter);
+  inpainter->AddInpainter(imagePatchInpainter);
+  inpainter->AddInpainter(blurredImagePatchInpainter);
+
+  // Create the priority function
+  typedef PriorityCriminisi<TImage> PriorityType;
+  std::shared_ptr<PriorityType> priorityFunction(new PriorityType(blurredImage, mask, patchHalfWidth));
+
+  // Create the descriptor visitor
+  typedef ImagePatchDescriptorVisitor<VertexListGraphType, TImage, ImagePatchDescriptorMapType>
+      ImagePatchDescriptorVisitorType;
+  std::shared_ptr<ImagePatchDescriptorVisitorType> imagePatchDescriptorVisitor(new
+      ImagePatchDescriptorVisitorType(image.GetPointer(), mask, imagePatchDescriptorMap, patchHalfWidth));
+
+  typedef DefaultAcceptanceVisitor<VertexListGraphType> AcceptanceVisitorType;
+  std::shared_ptr<AcceptanceVisitorType> acceptanceVisitor(new AcceptanceVisitorType);
+
+  // Create the inpainting visitor
+  typedef InpaintingVisitor<VertexListGraphType, BoundaryNodeQueueType,
+                            ImagePatchDescriptorVisitorType, AcceptanceVisitorType, PriorityType>
+                            InpaintingVisitorType;
+  std::shared_ptr<InpaintingVisitorType> inpaintingVisitor(new InpaintingVisitorType(mask, boundaryNodeQueue,
+                                          imagePatchDescriptorVisitor, acceptanceVisitor,
+                                          priorityFunction, patchHalfWidth, "InpaintingVisitor"));
+  inpaintingVisitor->SetAllowNewPatches(false);
+
+  InitializePriorityFromFillFront(inpaintingVisitor.get(), boundaryNodeQueue.get(), priorityFunction.get());
+
+  // Initialize the descriptors of the pixels within a patch of the hole
+  itk::Index<2> holeCorner = {{fullRegion.GetUpperIndex()[0], fullRegion.GetUpperIndex()[1]}};
+  itk::Index<2> holeUpperCorner = fullRegion.GetIndex();
+  itk::ImageRegionConstIteratorWithIndex<Mask> maskIterator(mask, fullRegion);
+  while(!maskIterator.IsAtEnd())
+  {
+    if(mask->IsHole(maskIterator.GetIndex()))
+    {
+      for(unsigned int dimension = 0; dimension < 2; ++dimension)
+      {
+        holeCorner[dimension] = std::min(holeCorner[dimension], maskIterator.GetIndex()[dimension]);
+        holeUpperCorner[dimension] = std::max(holeUpperCorner[dimension], maskIterator.GetIndex()[dimension]);
+      }
+    }
+    ++maskIterator;
+  }
+
+  if(holeCorner[0] > holeUpperCorner[0])
+  {
+    return; // There is no hole
+  }
+
+  itk::Size<2> holeSize = {{static_cast<itk::SizeValueType>(holeUpperCorner[0] - holeCorner[0] + 1),
+                            static_cast<itk::SizeValueType>(holeUpperCorner[1] - holeCorner[1] + 1)}};
+  itk::ImageRegion<2> targetRegion(holeCorner, holeSize);
+  targetRegion.PadByRadius(patchHalfWidth);
+  targetRegion.Crop(fullRegion);
+
+  itk::ImageRegionConstIteratorWithIndex<Mask> targetRegionIterator(mask, targetRegion);
+  while(!targetRegionIterator.IsAtEnd())
+  {
+    inpaintingVisitor->InitializeVertex(
+          Helpers::ConvertFrom<VertexDescriptorType, itk::Index<2> >(targetRegionIterator.GetIndex()));
+    ++targetRegionIterator;
+  }
+
+  // The loop of InpaintingAlgorithm. PotentialMatchMade() is not called, because it checks the source
+  // patch against the mask of this image, and the source patches are in the reference image.
+  unsigned int iteration = 0;
+  while(!boundaryNodeQueue->empty())
+  {
+    VertexDescriptorType targetNode = boundaryNodeQueue->top(); // This also pops the node
+
+    inpaintingVisitor->DiscoverVertex(targetNode);
+
+    itk::Index<2> targetIndex = ITKHelpers::CreateIndex(targetNode);
+    itk::Index<2> sourceIndex = sourceBank.FindBestSourcePatch(get(*imagePatchDescriptorMap, targetNode));
+
+    inpainter->PaintPatch(targetIndex, sourceIndex);
+
+    inpaintingVisitor->FinishVertex(targetNode,
+                                    Helpers::ConvertFrom<VertexDescriptorType, itk::Index<2> >(sourceIndex));
+
+    iteration++;
+  }
+
+  std::cout << "SharedSourceBankInpainting: complete after " << iteration << " iterations." << std::endl;
+  inpaintingVisitor->InpaintingComplete();
+}
+
+/** Inpaint each of 'images' (where the corresponding mask is a hole) against the same 'sourceBank'. Each image
+  * is a task of the TaskPool, so the images are inpainted concurrently. */
+template <typename TImage>
+void SharedSourceBankInpainting(const SharedSourceBank<TImage>& sourceBank,
+                                const std::vector<typename TImage::Pointer>& images,
+                                const std::vector<Mask::Pointer>& masks)
+{
+  if(images.size() != masks.size())
+  {
+    throw std::runtime_error("SharedSourceBankInpainting: There must be a mask for every image!");
+  }
+
+  TaskGroup taskGroup;
+  for(size_t imageId = 0; imageId < images.size(); ++imageId)
+  {
+    taskGroup.Run([&, imageId]()
+    {
+      SharedSourceBankInpainting(sourceBank, images[imageId], masks[imageId].GetPointer());
+    });
+  }
+
+  taskGroup.Wait();
+}
+
+#endif
@@ -0,0 +1,180 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// ITK
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+// STL
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Custom
+#include "Drivers/BatchImageInpainting.hpp"
+
+typedef itk::Image<itk::CovariantVector<int, 3>, 2> ImageType;
+
+/** The hole of the test image, which is written red so that an unfilled pixel is easy to find. */
+static itk::ImageRegion<2> GetHoleRegion()
+{
+  itk::Index<2> holeCorner = {{13, 13}};
+  itk::Size<2> holeSize = {{6, 6}};
+  return itk::ImageRegion<2>(holeCorner, holeSize);
+}
+
+/** Write a smooth image with a red hole and its mask (a .mask file is "holeValue validValue maskImage"). */
+static void WriteTestImageAndMask(const std::string& imageFileName, const std::string& maskFileName)
+{
+  itk::Index<2> corner = {{0, 0}};
+  itk::Size<2> size = {{32, 32}};
+  itk::ImageRegion<2> region(corner, size);
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(region);
+  image->Allocate();
+
+  typedef itk::Image<unsigned char, 2> MaskImageType;
+  MaskImageType::Pointer maskImage = MaskImageType::New();
+  maskImage->SetRegions(region);
+  maskImage->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> imageIterator(image, region);
+  while(!imageIterator.IsAtEnd())
+  {
+    itk::Index<2> index = imageIterator.GetIndex();
+    ImageType::PixelType pixel;
+    if(GetHoleRegion().IsInside(index))
+    {
+      pixel[0] = 255;
+      pixel[1] = 0;
+      pixel[2] = 0;
+      maskImage->SetPixel(index, 0);
+    }
+    else
+    {
+      pixel[0] = 4 * index[0];
+      pixel[1] = 4 * index[1];
+      pixel[2] = 100;
+      maskImage->SetPixel(index, 255);
+    }
+    imageIterator.Set(pixel);
+    ++imageIterator;
+  }
+
+  ITKHelpers::WriteRGBImage(image.GetPointer(), imageFileName);
+  ITKHelpers::WriteImage(maskImage.GetPointer(), "TestBatchMask.png");
+
+  std::ofstream maskStream(maskFileName.c_str());
+  maskStream << "0 255 TestBatchMask.png" << std::endl;
+}
+
+/** Whether the hole of the output image was filled (no red pixel is left in it). */
+static bool IsHoleFilled(const std::string& outputFileName)
+{
+  typedef itk::ImageFileReader<ImageType> ImageReaderType;
+  ImageReaderType::Pointer imageReader = ImageReaderType::New();
+  imageReader->SetFileName(outputFileName);
+  imageReader->Update();
+
+  itk::ImageRegionConstIterator<ImageType> imageIterator(imageReader->GetOutput(), GetHoleRegion());
+  while(!imageIterator.IsAtEnd())
+  {
+    if(imageIterator.Get()[0] == 255 && imageIterator.Get()[1] == 0 && imageIterator.Get()[2] == 0)
+    {
+      return false;
+    }
+    ++imageIterator;
+  }
+  return true;
+}
+
+int main(int argc, char*argv[])
+{
+  WriteTestImageAndMask("TestBatchImage.png", "TestBatch.mask");
+
+  // More jobs than concurrent jobs, a pyramid job, a comment and a job whose image does not exist
+  const unsigned int numberOfGoodJobs = 5;
+  {
+    std::ofstream manifestStream("TestBatchManifest.txt");
+    manifestStream << "# image mask patchHalfWidth output [numberOfLevels]" << std::endl;
+    for(unsigned int jobId = 0; jobId < numberOfGoodJobs; ++jobId)
+    {
+      manifestStream << "TestBatchImage.png TestBatch.mask 3 TestBatchOutput" << jobId << ".png"
+                     << (jobId == 0 ? " 2" : "") << std::endl;
+    }
+    manifestStream << std::endl;
+    manifestStream << "TestBatchMissing.png TestBatch.mask 3 TestBatchMissingOutput.png" << std::endl;
+  }
+
+  std::vector<BatchInpaintingJob> jobs = ReadBatchManifest("TestBatchManifest.txt");
+  if(jobs.size() != numberOfGoodJobs + 1 || jobs[0].NumberOfLevels != 2 || jobs[1].NumberOfLevels != 1)
+  {
+    std::cerr << "The manifest was not read correctly (" << jobs.size() << " jobs)!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::vector<BatchInpaintingResult> results = BatchImageInpainting<ImageType>(jobs, "TestBatchTiming.txt", 2);
+
+  bool correct = true;
+  for(unsigned int jobId = 0; jobId < numberOfGoodJobs; ++jobId)
+  {
+    if(!results[jobId].Succeeded)
+    {
+      std::cerr << "Job " << jobId << " failed: " << results[jobId].Error << std::endl;
+      correct = false;
+      continue;
+    }
+
+    if(!IsHoleFilled(jobs[jobId].OutputFileName))
+    {
+      std::cerr << "The hole of job " << jobId << " was not filled!" << std::endl;
+      correct = false;
+    }
+  }
+
+  if(results[numberOfGoodJobs].Succeeded)
+  {
+    std::cerr << "The job with a missing image did not fail!" << std::endl;
+    correct = false;
+  }
+
+  // A header, one line per job and the summary
+  std::ifstream timingStream("TestBatchTiming.txt");
+  std::string line;
+  unsigned int numberOfLines = 0;
+  while(std::getline(timingStream, line))
+  {
+    numberOfLines++;
+  }
+  if(numberOfLines != jobs.size() + 2)
+  {
+    std::cerr << "The timing file has " << numberOfLines << " lines instead of " << jobs.size() + 2 << std::endl;
+    correct = false;
+  }
+
+  return correct ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,169 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+#include <Mask/Mask.h>
+
+// STL
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+// Custom
+#include "Drivers/VideoInpainting.hpp"
+
+typedef itk::Image<itk::CovariantVector<int, 3>, 2> ImageType;
+
+typedef itk::Image<itk::Index<2>, 2> SourcePixelMapImageType;
+
+/** The hole of the test frame. */
+static itk::ImageRegion<2> GetHoleRegion()
+{
+  itk::Index<2> holeCorner = {{16, 16}};
+  itk::Size<2> holeSize = {{8, 8}};
+  return itk::ImageRegion<2>(holeCorner, holeSize);
+}
+
+/** Create a frame with a repeating texture and its mask. The same frame is created each time, so it is a static
+  * background for the warm start. */
+static void CreateFrame(ImageType* const image, Mask* const mask, const unsigned int width = 40)
+{
+  itk::Index<2> corner = {{0, 0}};
+  itk::Size<2> size = {{width, 40}};
+  itk::ImageRegion<2> region(corner, size);
+
+  image->SetRegions(region);
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> imageIterator(image, region);
+  while(!imageIterator.IsAtEnd())
+  {
+    itk::Index<2> index = imageIterator.GetIndex();
+    ImageType::PixelType pixel;
+    pixel[0] = 30 * (index[0] % 5);
+    pixel[1] = 40 * (index[1] % 4);
+    pixel[2] = 10 * ((index[0] + index[1]) % 7);
+    imageIterator.Set(pixel);
+    ++imageIterator;
+  }
+
+  mask->SetRegions(region);
+  mask->Allocate();
+  ITKHelpers::SetImageToConstant(mask, mask->GetValidValue());
+  ITKHelpers::SetRegionToConstant(mask, GetHoleRegion(), mask->GetHoleValue());
+}
+
+/** Whether the frame was completely filled and every hole pixel was copied from a pixel outside of the hole. */
+static bool IsFrameFilled(Mask* const mask, SourcePixelMapImageType* const sourcePixelMap)
+{
+  if(mask->CountHolePixels() != 0)
+  {
+    std::cerr << mask->CountHolePixels() << " hole pixels were not filled!" << std::endl;
+    return false;
+  }
+
+  itk::ImageRegionConstIteratorWithIndex<SourcePixelMapImageType> sourcePixelMapIterator(sourcePixelMap,
+                                                                                        GetHoleRegion());
+  while(!sourcePixelMapIterator.IsAtEnd())
+  {
+    if(!sourcePixelMap->GetLargestPossibleRegion().IsInside(sourcePixelMapIterator.Get()) ||
+       GetHoleRegion().IsInside(sourcePixelMapIterator.Get()))
+    {
+      std::cerr << "The source of " << sourcePixelMapIterator.GetIndex() << " is "
+                << sourcePixelMapIterator.Get() << ", which is not a valid pixel!" << std::endl;
+      return false;
+    }
+    ++sourcePixelMapIterator;
+  }
+  return true;
+}
+
+/** Inpaint a new copy of the frame, warm started from 'previousSourcePixelMap'. */
+static SourcePixelMapImageType::Pointer InpaintFrame(SourcePixelMapImageType* const previousSourcePixelMap,
+                                                     const float warmStartThreshold,
+                                                     unsigned int* const numberOfAcceptedCandidates, bool* const filled)
+{
+  ImageType::Pointer frame = ImageType::New();
+  Mask::Pointer mask = Mask::New();
+  CreateFrame(frame, mask);
+
+  const unsigned int patchHalfWidth = 3;
+  SourcePixelMapImageType::Pointer sourcePixelMap =
+      VideoFrameInpainting(frame, mask.GetPointer(), patchHalfWidth, previousSourcePixelMap, warmStartThreshold,
+                           numberOfAcceptedCandidates);
+  *filled = IsFrameFilled(mask, sourcePixelMap);
+  return sourcePixelMap;
+}
+
+int main(int argc, char*argv[])
+{
+  bool correct = true;
+
+  // The first frame has nothing to warm start from
+  bool filled = false;
+  unsigned int numberOfAcceptedCandidates = 0;
+  SourcePixelMapImageType::Pointer firstSourcePixelMap = InpaintFrame(0, std::numeric_limits<float>::max(),
+                                                                      &numberOfAcceptedCandidates, &filled);
+  if(!filled || numberOfAcceptedCandidates != 0)
+  {
+    std::cerr << "The first frame was not inpainted correctly (" << numberOfAcceptedCandidates
+              << " accepted candidates)!" << std::endl;
+    correct = false;
+  }
+
+  // Every candidate from the previous frame's shifts is good enough, so searches are skipped
+  InpaintFrame(firstSourcePixelMap, std::numeric_limits<float>::max(), &numberOfAcceptedCandidates, &filled);
+  if(!filled || numberOfAcceptedCandidates == 0)
+  {
+    std::cerr << "The warm started frame was not inpainted correctly (" << numberOfAcceptedCandidates
+              << " accepted candidates)!" << std::endl;
+    correct = false;
+  }
+
+  // With no acceptance threshold every target is searched
+  InpaintFrame(firstSourcePixelMap, -std::numeric_limits<float>::infinity(), &numberOfAcceptedCandidates, &filled);
+  if(!filled || numberOfAcceptedCandidates != 0)
+  {
+    std::cerr << "The frame without an acceptance threshold was not inpainted correctly ("
+              << numberOfAcceptedCandidates << " accepted candidates)!" << std::endl;
+    correct = false;
+  }
+
+  // A frame of another size can not be warm started
+  ImageType::Pointer smallFrame = ImageType::New();
+  Mask::Pointer smallMask = Mask::New();
+  CreateFrame(smallFrame, smallMask, 30);
+  try
+  {
+    VideoFrameInpainting(smallFrame, smallMask.GetPointer(), 3, firstSourcePixelMap.GetPointer(), 0.0f);
+    std::cerr << "A frame of a different size was inpainted!" << std::endl;
+    correct = false;
+  }
+  catch(const std::runtime_error&)
+  {
+  }
+
+  return correct ? EXIT_SUCCESS : EXIT_FAILURE;
+}
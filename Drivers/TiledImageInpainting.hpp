@@ -0,0 +1,266 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef TiledImageInpainting_HPP
+#define TiledImageInpainting_HPP
+
+// ITK
+#include "itkImageFileReader.h"
+#include "itkImageFileWriter.h"
+#include "itkImageIORegion.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkRegionOfInterestImageFilter.h"
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+#include <Mask/Mask.h>
+
+// STL
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+// Custom
+#include "Drivers/PyramidImageInpainting.hpp"
+
+/** Estimate how many bytes of memory inpainting an image of TImage takes per pixel. This counts the image and
+  * the blurred image, the patch descriptor, priority, handle and boundary status property maps, the graph vertex
+  * list of the search, the confidence sums of the priority function, and about 32 bytes of per-pixel images kept
+  * by the priority function and the visitors. */
+template <typename TImage>
+size_t GetInpaintingBytesPerPixel()
+{
+  typedef boost::grid_graph<2> VertexListGraphType;
+  typedef boost::graph_traits<VertexListGraphType>::vertex_descriptor VertexDescriptorType;
+
+  return 2 * sizeof(typename TImage::PixelType) + sizeof(ImagePatchPixelDescriptor<TImage>) +
+         sizeof(float) + sizeof(void*) + sizeof(bool) + sizeof(VertexDescriptorType) +
+         sizeof(itk::Index<2>) + sizeof(double) + 32;
+}
+
+/** Inpaint an image that is too large to inpaint in memory. The image is split into a grid of core tiles, and
+  * each tile is extended by a halo of 'searchRadius' + patchHalfWidth pixels, so that the source patches within
+  * 'searchRadius' of every target in the core are in the tile. The tile size is chosen so that inpainting a
+  * tile (see GetInpaintingBytesPerPixel) takes about 'memoryBudget' bytes.
+  *
+  * The input image is first copied to 'outputFileName' in streamed pieces. Then only the tiles whose core contains
+  * hole pixels are read back from the output file, inpainted with PyramidLevelInpainting (searching the whole
+  * tile), and the core of the tile is written back into the output file. Only the target patches centered within
+  * a patch of the core are filled, since the rest of the tile is thrown away; if that leaves hole pixels in the
+  * core (the core cannot be reached from the valid pixels near it), the whole tile is inpainted. The tiles are
+  * processed in raster order, and the filled core pixels are marked valid in 'mask', so a hole that crosses tiles
+  * is continued from the pixels the earlier tiles filled instead of being filled twice.
+  *
+  * If the tile does not contain a fully valid source patch, its halo is doubled until it does (so the tile can
+  * take more memory than 'memoryBudget'), and an exception is thrown if the whole image has none.
+  *
+  * Only 'mask' is kept in memory for the whole image (one byte per pixel). Reading and writing the pieces of a
+  * file requires a file format that ITK can stream, such as an uncompressed MetaImage (.mha or .mhd); with other
+  * formats ITK reads the whole file for every tile.
+  */
+template <typename TImage>
+void TiledImageInpainting(const std::string& imageFileName, Mask* const mask, const std::string& outputFileName,
+                          const unsigned int patchHalfWidth, const unsigned int searchRadius,
+                          const size_t memoryBudget)
+{
+  typedef itk::ImageFileReader<TImage> ImageReaderType;
+  typedef itk::ImageFileWriter<TImage> ImageWriterType;
+
+  itk::ImageRegion<2> fullRegion = mask->GetLargestPossibleRegion();
+
+  // Compute the size of the tiles
+  const unsigned int halo = searchRadius + patchHalfWidth;
+  const size_t tilePixels = memoryBudget / GetInpaintingBytesPerPixel<TImage>();
+  const long tileSideLength = static_cast<long>(std::sqrt(static_cast<double>(tilePixels)));
+  const long coreSideLength = tileSideLength - 2 * static_cast<long>(halo);
+  if(coreSideLength < static_cast<long>(2 * patchHalfWidth + 1))
+  {
+    std::stringstream ss;
+    ss << "TiledImageInpainting: A memory budget of " << memoryBudget << " bytes only allows tiles of "
+       << tileSideLength << " pixels, which is not enough for a halo of " << halo << " pixels!";
+    throw std::runtime_error(ss.str());
+  }
+
+  // Copy the input to the output file, one piece at a time.
+  {
+    typename ImageReaderType::Pointer imageReader = ImageReaderType::New();
+    imageReader->SetFileName(imageFileName);
+    imageReader->UpdateOutputInformation();
+
+    if(imageReader->GetOutput()->GetLargestPossibleRegion() != fullRegion)
+    {
+      throw std::runtime_error("TiledImageInpainting: The image and the mask are not the same size!");
+    }
+
+    const size_t numberOfPixels = fullRegion.GetNumberOfPixels();
+    const unsigned int numberOfStreamDivisions =
+        static_cast<unsigned int>(numberOfPixels / static_cast<size_t>(tileSideLength * tileSideLength)) + 1;
+
+    typename ImageWriterType::Pointer imageWriter = ImageWriterType::New();
+    imageWriter->SetFileName(outputFileName);
+    imageWriter->SetInput(imageReader->GetOutput());
+    imageWriter->SetNumberOfStreamDivisions(numberOfStreamDivisions);
+    imageWriter->Update();
+  }
+
+  unsigned int numberOfInpaintedTiles = 0;
+  unsigned int numberOfTiles = 0;
+
+  for(long coreY = fullRegion.GetIndex()[1];
+      coreY < fullRegion.GetIndex()[1] + static_cast<long>(fullRegion.GetSize()[1]); coreY += coreSideLength)
+  {
+    for(long coreX = fullRegion.GetIndex()[0];
+        coreX < fullRegion.GetIndex()[0] + static_cast<long>(fullRegion.GetSize()[0]); coreX += coreSideLength)
+    {
+      numberOfTiles++;
+
+      itk::Index<2> coreCorner = {{coreX, coreY}};
+      itk::Size<2> coreSize = {{static_cast<itk::SizeValueType>(coreSideLength),
+                                static_cast<itk::SizeValueType>(coreSideLength)}};
+      itk::ImageRegion<2> coreRegion(coreCorner, coreSize);
+      coreRegion.Crop(fullRegion);
+
+      // Skip the tiles that have nothing to fill
+      bool coreHasHolePixels = false;
+      itk::ImageRegionConstIteratorWithIndex<Mask> coreMaskIterator(mask, coreRegion);
+      while(!coreMaskIterator.IsAtEnd() && !coreHasHolePixels)
+      {
+        coreHasHolePixels = mask->IsHole(coreMaskIterator.GetIndex());
+        ++coreMaskIterator;
+      }
+
+      if(!coreHasHolePixels)
+      {
+        continue;
+      }
+
+      itk::ImageRegion<2> tileRegion = coreRegion;
+      for(unsigned int tileHalo = halo; ; tileHalo *= 2)
+      {
+        tileRegion = coreRegion;
+        tileRegion.PadByRadius(tileHalo);
+        tileRegion.Crop(fullRegion);
+
+        if(ContainsValidSourcePatch(mask, tileRegion, patchHalfWidth))
+        {
+          break;
+        }
+
+        if(tileRegion == fullRegion)
+        {
+          throw std::runtime_error("TiledImageInpainting: The mask does not contain a valid source patch!");
+        }
+      }
+
+      std::cout << "TiledImageInpainting: inpainting tile " << tileRegion.GetIndex() << " "
+                << tileRegion.GetSize() << std::endl;
+
+      // Read the tile (including the results of the earlier tiles) from the output file
+      typename ImageReaderType::Pointer tileReader = ImageReaderType::New();
+      tileReader->SetFileName(outputFileName);
+
+      typedef itk::RegionOfInterestImageFilter<TImage, TImage> RegionOfInterestImageFilterType;
+      typename RegionOfInterestImageFilterType::Pointer regionOfInterestFilter = RegionOfInterestImageFilterType::New();
+      regionOfInterestFilter->SetRegionOfInterest(tileRegion);
+      regionOfInterestFilter->SetInput(tileReader->GetOutput());
+      regionOfInterestFilter->Update();
+
+      typename TImage::Pointer tileImage = TImage::New();
+      ITKHelpers::DeepCopy(regionOfInterestFilter->GetOutput(), tileImage.GetPointer());
+
+      // The tile image starts at index zero
+      const itk::Offset<2> tileOffset = tileRegion.GetIndex() - tileImage->GetLargestPossibleRegion().GetIndex();
+
+      Mask::Pointer tileMask = Mask::New();
+      tileMask->SetRegions(tileImage->GetLargestPossibleRegion());
+      tileMask->Allocate();
+
+      itk::ImageRegionConstIteratorWithIndex<Mask> maskIterator(mask, tileRegion);
+      while(!maskIterator.IsAtEnd())
+      {
+        tileMask->SetPixel(maskIterator.GetIndex() - tileOffset,
+                           mask->IsHole(maskIterator.GetIndex()) ? tileMask->GetHoleValue() :
+                                                                   tileMask->GetValidValue());
+        ++maskIterator;
+      }
+
+      // Only the targets whose patches touch the core change the pixels that are kept
+      itk::ImageRegion<2> targetRegion = coreRegion;
+      targetRegion.PadByRadius(patchHalfWidth);
+      targetRegion.SetIndex(targetRegion.GetIndex() - tileOffset);
+      PyramidLevelInpainting(tileImage, tileMask.GetPointer(), patchHalfWidth, 0, 0, &targetRegion);
+
+      bool coreIsFilled = true;
+      itk::ImageRegionConstIteratorWithIndex<Mask> coreTileMaskIterator(mask, coreRegion);
+      while(!coreTileMaskIterator.IsAtEnd() && coreIsFilled)
+      {
+        coreIsFilled = !tileMask->IsHole(coreTileMaskIterator.GetIndex() - tileOffset);
+        ++coreTileMaskIterator;
+      }
+
+      if(!coreIsFilled)
+      {
+        std::cout << "TiledImageInpainting: the core was not reached, inpainting the whole tile." << std::endl;
+        PyramidLevelInpainting(tileImage, tileMask.GetPointer(), patchHalfWidth, 0, 0);
+      }
+
+      // Write the core of the tile back into the output file. The image only buffers the core,
+      // but its largest possible region is the whole image so that the writer knows where to put it.
+      typename TImage::Pointer coreImage = TImage::New();
+      coreImage->SetLargestPossibleRegion(fullRegion);
+      coreImage->SetBufferedRegion(coreRegion);
+      coreImage->SetRequestedRegion(coreRegion);
+      coreImage->SetNumberOfComponentsPerPixel(tileImage->GetNumberOfComponentsPerPixel());
+      coreImage->Allocate();
+
+      itk::ImageRegionConstIteratorWithIndex<TImage> coreIterator(coreImage, coreRegion);
+      while(!coreIterator.IsAtEnd())
+      {
+        itk::Index<2> index = coreIterator.GetIndex();
+        coreImage->SetPixel(index, tileImage->GetPixel(index - tileOffset));
+        if(mask->IsHole(index))
+        {
+          mask->SetPixel(index, mask->GetValidValue());
+        }
+        ++coreIterator;
+      }
+
+      itk::ImageIORegion ioRegion(2);
+      for(unsigned int dimension = 0; dimension < 2; ++dimension)
+      {
+        ioRegion.SetIndex(dimension, coreRegion.GetIndex()[dimension]);
+        ioRegion.SetSize(dimension, coreRegion.GetSize()[dimension]);
+      }
+
+      typename ImageWriterType::Pointer coreWriter = ImageWriterType::New();
+      coreWriter->SetFileName(outputFileName);
+      coreWriter->SetInput(coreImage);
+      coreWriter->SetIORegion(ioRegion);
+      coreWriter->Update();
+
+      numberOfInpaintedTiles++;
+    }
+  }
+
+  std::cout << "TiledImageInpainting: inpainted " << numberOfInpaintedTiles << " of " << numberOfTiles
+            << " tiles." << std::endl;
+}
+
+#endif
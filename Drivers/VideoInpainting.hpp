@@ -0,0 +1,144 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef VideoInpainting_HPP
+#define VideoInpainting_HPP
+
+// Custom
+#include "Drivers/PyramidImageInpainting.hpp"
+
+// STL
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+// Submodules
+#include <Mask/Mask.h>
+
+// Nearest neighbors
+#include "NearestNeighbor/CoherentSearchBest.hpp"
+
+// Inpainting
+#include "Algorithms/InpaintingAlgorithmWithLocalSearch.hpp"
+
+// Search regions
+#include "SearchRegions/NeighborhoodSearch.hpp"
+
+// Boost
+#include <boost/graph/grid_graph.hpp>
+
+/** The search of VideoFrameInpainting (see InpaintLevelWithSearch). As in ClassicalImageInpainting, up to 1/4 of
+  * the image is searched for each target patch. If there is a previous frame, the best patch search is wrapped
+  * in a CoherentSearchBest that reads the previous frame's source pixel map, and the number of targets that
+  * were filled from its shifts without a search is recorded. */
+struct VideoWarmStartLevelSearch
+{
+  itk::Image<itk::Index<2>, 2>* PreviousSourcePixelMap;
+
+  float WarmStartThreshold;
+
+  unsigned int NumberOfSearches;
+
+  unsigned int NumberOfAcceptedCandidates;
+
+  VideoWarmStartLevelSearch(itk::Image<itk::Index<2>, 2>* const previousSourcePixelMap,
+                            const float warmStartThreshold) :
+    PreviousSourcePixelMap(previousSourcePixelMap), WarmStartThreshold(warmStartThreshold), NumberOfSearches(0),
+    NumberOfAcceptedCandidates(0)
+  {
+
+  }
+
+  template <typename TGraph, typename TInpaintingVisitor, typename TBoundaryNodeQueue, typename TDescriptorMap,
+            typename TBestSearch, typename TPatchDifference, typename TInpainter>
+  void operator()(std::shared_ptr<TGraph> graph, std::shared_ptr<TInpaintingVisitor> inpaintingVisitor,
+                  std::shared_ptr<TBoundaryNodeQueue> boundaryNodeQueue,
+                  std::shared_ptr<TDescriptorMap> imagePatchDescriptorMap,
+                  std::shared_ptr<TBestSearch> bestSearch, const TPatchDifference& patchDifference,
+                  std::shared_ptr<TInpainter> inpainter, const itk::ImageRegion<2>& fullRegion)
+  {
+    typedef typename boost::graph_traits<TGraph>::vertex_descriptor VertexDescriptorType;
+    typedef NeighborhoodSearch<VertexDescriptorType, TDescriptorMap> NeighborhoodSearchType;
+    NeighborhoodSearchType neighborhoodSearch(fullRegion, fullRegion.GetSize()[0]/8, *imagePatchDescriptorMap);
+
+    if(!this->PreviousSourcePixelMap)
+    {
+      InpaintingAlgorithmWithLocalSearch(graph, inpaintingVisitor, boundaryNodeQueue,
+                                         bestSearch, inpainter, neighborhoodSearch);
+      return;
+    }
+
+    typedef CoherentSearchBest<TDescriptorMap, TBestSearch, TPatchDifference> WarmStartSearchType;
+    std::shared_ptr<WarmStartSearchType> warmStartSearch(new
+        WarmStartSearchType(*imagePatchDescriptorMap, this->PreviousSourcePixelMap, bestSearch, patchDifference));
+    warmStartSearch->SetAcceptanceThreshold(this->WarmStartThreshold);
+
+    InpaintingAlgorithmWithLocalSearch(graph, inpaintingVisitor, boundaryNodeQueue,
+                                       warmStartSearch, inpainter, neighborhoodSearch);
+
+    this->NumberOfSearches = warmStartSearch->GetNumberOfSearches();
+    this->NumberOfAcceptedCandidates = warmStartSearch->GetNumberOfAcceptedCandidates();
+  }
+};
+
+/** Inpaint one frame of a video in the same way as ClassicalImageInpainting, warm started from the previous frame.
+  * 'previousSourcePixelMap' is the source pixel map that this function returned for the previous frame (or null
+  * for the first frame). It records where every filled pixel of the previous frame was copied from, so it holds
+  * the source choices of all of its targets in the order they were filled (a later target only fills the pixels
+  * that were still holes).
+  *
+  * Each target patch is first compared to the candidates that the previous frame's shifts around it give (see
+  * CoherentSearchBest). If the best of them is within 'warmStartThreshold' (in the units of the patch
+  * difference, the mean squared difference of the valid pixels), it is used without searching. Otherwise the
+  * usual search runs, with that candidate as its initial bound. A static background is therefore filled from the
+  * same sources as in the previous frame, which is cheaper and reduces flicker. If 'numberOfAcceptedCandidates'
+  * is given, it is set to the number of targets that were filled without a search. Returns the source pixel map
+  * of this frame. */
+template <typename TImage>
+itk::Image<itk::Index<2>, 2>::Pointer
+VideoFrameInpainting(typename itk::SmartPointer<TImage> image, Mask* const mask,
+                     const unsigned int patchHalfWidth,
+                     itk::Image<itk::Index<2>, 2>* const previousSourcePixelMap,
+                     const float warmStartThreshold, unsigned int* const numberOfAcceptedCandidates = 0)
+{
+  if(previousSourcePixelMap && previousSourcePixelMap->GetLargestPossibleRegion() !=
+     image->GetLargestPossibleRegion())
+  {
+    throw std::runtime_error("VideoFrameInpainting: The frame is not the same size as the previous frame!");
+  }
+
+  VideoWarmStartLevelSearch warmStartSearch(previousSourcePixelMap, warmStartThreshold);
+  itk::Image<itk::Index<2>, 2>::Pointer sourcePixelMap =
+      InpaintLevelWithSearch(image, mask, patchHalfWidth, warmStartSearch);
+
+  if(previousSourcePixelMap)
+  {
+    std::cout << "VideoFrameInpainting: " << warmStartSearch.NumberOfAcceptedCandidates << " of "
+              << warmStartSearch.NumberOfSearches << " targets were filled from the previous frame's "
+              << "shifts without a search." << std::endl;
+  }
+
+  if(numberOfAcceptedCandidates)
+  {
+    *numberOfAcceptedCandidates = warmStartSearch.NumberOfAcceptedCandidates;
+  }
+
+  return sourcePixelMap;
+}
+
+#endif
@@ -20,6 +20,7 @@
 #define BoundaryEnergy_H
 
 #include "Mask/Mask.h"
+#include "ImageProcessing/FillFront.h"
 
 #include "itkVariableLengthVector.h"
 
@@ -41,9 +42,17 @@ public:
    * are adjacent (inside the same region in the image). */
   float operator()(const itk::ImageRegion<2>& sourceRegion, const itk::ImageRegion<2>& targetRegion);
 
+  /** Take the boundary pixels of a region from this fill front (which must be up to date with the mask)
+    * instead of creating a boundary image of the region. */
+  void SetFillFront(const FillFront* const fillFront);
+
 private:
   const TImage* Image;
   const Mask* MaskImage;
+  const FillFront* Front;
+
+  /** Get the pixels of the boundary of the valid region that are in 'region'. */
+  std::vector<itk::Index<2> > GetBoundaryPixels(const itk::ImageRegion<2>& region);
 
   /** Compute the difference between two pixels of unknown type. This will use operator-(). */
   template <typename T>
@@ -5,14 +5,25 @@
 #include "ImageProcessing/PixelFilterFunctors.hpp"
 
 template<typename TImage>
-BoundaryEnergy<TImage>::BoundaryEnergy(const TImage* const image, const Mask* const mask) : Image(image), MaskImage(mask)
+BoundaryEnergy<TImage>::BoundaryEnergy(const TImage* const image, const Mask* const mask) : Image(image), MaskImage(mask), Front(0)
 {
 
 }
 
 template<typename TImage>
-float BoundaryEnergy<TImage>::operator()(const itk::ImageRegion<2>& region)
+void BoundaryEnergy<TImage>::SetFillFront(const FillFront* const fillFront)
+{
+  this->Front = fillFront;
+}
+
+template<typename TImage>
+std::vector<itk::Index<2> > BoundaryEnergy<TImage>::GetBoundaryPixels(const itk::ImageRegion<2>& region)
 {
+  if(this->Front)
+  {
+    return this->Front->GetFrontPixelsInRegion(region);
+  }
+
   // Get the boundary of the valid region
   Mask::BoundaryImageType::Pointer boundaryImage = Mask::BoundaryImageType::New();
   this->MaskImage->CreateBoundaryImageInRegion(region, boundaryImage.GetPointer(), Mask::VALID);
@@ -20,8 +31,13 @@ float BoundaryEnergy<TImage>::operator()(const itk::ImageRegion<2>& region)
   // We are unsure about the values of the boundary pixels, but they are definitely greater than .5
   // (we'd hope non-boundary=0 and boundary = 1 or 255)
   GreaterThanOrEqualFunctor<Mask::BoundaryImageType::PixelType> greaterThanOrEqualFunctor(1);
-  std::vector<itk::Index<2> > pixelsSatisfyingFunctor = PixelsSatisfyingFunctor(boundaryImage.GetPointer(),
-                                                        region, greaterThanOrEqualFunctor);
+  return PixelsSatisfyingFunctor(boundaryImage.GetPointer(), region, greaterThanOrEqualFunctor);
+}
+
+template<typename TImage>
+float BoundaryEnergy<TImage>::operator()(const itk::ImageRegion<2>& region)
+{
+  std::vector<itk::Index<2> > pixelsSatisfyingFunctor = this->GetBoundaryPixels(region);
 
   if(pixelsSatisfyingFunctor.size() == 0)
   {
@@ -49,15 +65,7 @@ float BoundaryEnergy<TImage>::operator()(const itk::ImageRegion<2>& region)
 template<typename TImage>
 float BoundaryEnergy<TImage>::operator()(const itk::ImageRegion<2>& sourceRegion, const itk::ImageRegion<2>& targetRegion)
 {
-  // Get the boundary of the valid region
-  Mask::BoundaryImageType::Pointer boundaryImage = Mask::BoundaryImageType::New();
-  this->MaskImage->CreateBoundaryImageInRegion(targetRegion, boundaryImage.GetPointer(), Mask::VALID);
-
-  // We are unsure about the values of the boundary pixels, but they are definitely greater than .5
-  // (we'd hope non-boundary=0 and boundary = 1 or 255)
-  GreaterThanOrEqualFunctor<Mask::BoundaryImageType::PixelType> greaterThanOrEqualFunctor(1);
-  std::vector<itk::Index<2> > boundaryPixels = PixelsSatisfyingFunctor(boundaryImage.GetPointer(),
-                                                        targetRegion, greaterThanOrEqualFunctor);
+  std::vector<itk::Index<2> > boundaryPixels = this->GetBoundaryPixels(targetRegion);
 
   if(boundaryPixels.size() == 0)
   {
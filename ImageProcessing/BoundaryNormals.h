@@ -24,13 +24,19 @@
 #include <ITKHelpers/ITKHelpers.h>
 #include <Utilities/Debug/Debug.h>
 
+// STL
+#include <vector>
+
+// Custom
+#include "ImageProcessing/FillFront.h"
+
 /** This class computes the boundary normals of a mask at the valid side of the mask boundary. */
 class BoundaryNormals : public Debug
 {
 public:
 
   /** Constructor. */
-  BoundaryNormals(const Mask* const mask) : MaskImage(mask){}
+  BoundaryNormals(const Mask* const mask) : MaskImage(mask), Front(0), BlurKernelVariance(-1.0f){}
 
   /** Comput the boundary normals. 'TNormalsImage' should be a type that has an
     * operator[] for two components (a 2-vector). 'maskBlurVariance' indicates how much
@@ -45,9 +51,35 @@ public:
   void ComputeBoundaryNormals(TNormalsImage* const boundaryNormals, const float maskBlurVariance,
                               const itk::ImageRegion<2>& region);
 
+  /** Compute the normals of ComputeBoundaryNormals in 'region' directly from the mask pixels, without
+    * creating a boundary image and without running the ITK filters. The mask is blurred (with the kernel
+    * of itk::DiscreteGaussianImageFilter, which is only created again when 'maskBlurVariance' changes)
+    * into buffers that are kept in this object, and its gradient is only computed at the boundary pixels.
+    * Only the pixels of 'region' are written, and the image edges (not the region edges) are handled
+    * as the filters handle them. */
+  template <typename TNormalsImage>
+  void ComputeBoundaryNormalsDirect(TNormalsImage* const boundaryNormals, const float maskBlurVariance,
+                                    const itk::ImageRegion<2>& region);
+
+  /** Use this fill front to find the boundary pixels in ComputeBoundaryNormalsDirect. It must be
+    * up to date with the mask. */
+  void SetFillFront(const FillFront* const fillFront);
+
 private:
 
   const Mask* MaskImage;
+
+  const FillFront* Front;
+
+  /** The blur kernel of ComputeBoundaryNormalsDirect, and the variance it was created for. */
+  float BlurKernelVariance;
+  std::vector<float> BlurKernel;
+
+  /** The mask blurred along the rows, and then along the columns. */
+  std::vector<float> RowBlurBuffer;
+  std::vector<float> BlurredMaskBuffer;
+
+  bool IsBoundaryPixel(const itk::Index<2>& pixel) const;
 };
 
 #include "BoundaryNormals.hpp"
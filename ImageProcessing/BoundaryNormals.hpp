@@ -24,11 +24,15 @@
 // ITK
 #include "itkMaskImageFilter.h"
 #include "itkDiscreteGaussianImageFilter.h"
+#include "itkGaussianOperator.h"
 #include "itkGradientImageFilter.h"
 
 // Submodules
 #include <ITKHelpers/ITKHelpers.h>
 
+// STL
+#include <algorithm>
+
 template <typename TNormalsImage>
 void BoundaryNormals::ComputeBoundaryNormals(TNormalsImage* const boundaryNormalsImage, const float maskBlurVariance)
 {
@@ -107,4 +111,145 @@ void BoundaryNormals::ComputeBoundaryNormals(TNormalsImage* const boundaryNormal
 
 }
 
+template <typename TNormalsImage>
+void BoundaryNormals::ComputeBoundaryNormalsDirect(TNormalsImage* const boundaryNormalsImage,
+                                                   const float maskBlurVariance, const itk::ImageRegion<2>& region)
+{
+  const itk::ImageRegion<2> fullRegion = this->MaskImage->GetLargestPossibleRegion();
+
+  // Create the kernel that itk::DiscreteGaussianImageFilter uses (with its default maximum error and width)
+  if(maskBlurVariance != this->BlurKernelVariance)
+  {
+    typedef itk::GaussianOperator<float, 1> GaussianOperatorType;
+    GaussianOperatorType gaussianOperator;
+    gaussianOperator.SetDirection(0);
+    gaussianOperator.SetVariance(maskBlurVariance);
+    gaussianOperator.SetMaximumError(0.01);
+    gaussianOperator.SetMaximumKernelWidth(32);
+    gaussianOperator.CreateDirectional();
+
+    this->BlurKernel.resize(gaussianOperator.Size());
+    for(unsigned int elementId = 0; elementId < gaussianOperator.Size(); ++elementId)
+    {
+      this->BlurKernel[elementId] = gaussianOperator.GetElement(elementId);
+    }
+    this->BlurKernelVariance = maskBlurVariance;
+  }
+  const long kernelRadius = static_cast<long>(this->BlurKernel.size() / 2);
+
+  // The gradients at the pixels of the region read the blurred mask one pixel around the region,
+  // and the blur along the columns reads the rows up to the kernel radius around that.
+  itk::ImageRegion<2> blurredRegion = region;
+  blurredRegion.PadByRadius(1);
+  if(!blurredRegion.Crop(fullRegion))
+  {
+    return;
+  }
+
+  const long fullStart[2] = {fullRegion.GetIndex()[0], fullRegion.GetIndex()[1]};
+  const long fullEnd[2] = {fullStart[0] + static_cast<long>(fullRegion.GetSize()[0]) - 1,
+                           fullStart[1] + static_cast<long>(fullRegion.GetSize()[1]) - 1};
+
+  const long blurredStartX = blurredRegion.GetIndex()[0];
+  const long blurredStartY = blurredRegion.GetIndex()[1];
+  const long blurredWidth = static_cast<long>(blurredRegion.GetSize()[0]);
+  const long blurredHeight = static_cast<long>(blurredRegion.GetSize()[1]);
+
+  const long rowStartY = std::max(fullStart[1], blurredStartY - kernelRadius);
+  const long rowEndY = std::min(fullEnd[1], blurredStartY + blurredHeight - 1 + kernelRadius);
+
+  const size_t rowBlurSize = static_cast<size_t>(blurredWidth * (rowEndY - rowStartY + 1));
+  if(this->RowBlurBuffer.size() < rowBlurSize)
+  {
+    this->RowBlurBuffer.resize(rowBlurSize);
+  }
+
+  const size_t blurredMaskSize = static_cast<size_t>(blurredWidth * blurredHeight);
+  if(this->BlurredMaskBuffer.size() < blurredMaskSize)
+  {
+    this->BlurredMaskBuffer.resize(blurredMaskSize);
+  }
+
+  // Blur along the rows. The pixels outside of the image are the nearest image pixels (the zero flux
+  // Neumann boundary condition of the filters).
+  for(long y = rowStartY; y <= rowEndY; ++y)
+  {
+    float* const rowBlurRow = &this->RowBlurBuffer[(y - rowStartY) * blurredWidth];
+    for(long x = 0; x < blurredWidth; ++x)
+    {
+      float sum = 0.0f;
+      for(long k = -kernelRadius; k <= kernelRadius; ++k)
+      {
+        itk::Index<2> maskPixel = {{std::min(fullEnd[0], std::max(fullStart[0], blurredStartX + x + k)), y}};
+        sum += this->BlurKernel[k + kernelRadius] * static_cast<float>(this->MaskImage->GetPixel(maskPixel));
+      }
+      rowBlurRow[x] = sum;
+    }
+  }
+
+  // Blur along the columns
+  for(long y = 0; y < blurredHeight; ++y)
+  {
+    for(long x = 0; x < blurredWidth; ++x)
+    {
+      float sum = 0.0f;
+      for(long k = -kernelRadius; k <= kernelRadius; ++k)
+      {
+        const long rowY = std::min(rowEndY, std::max(rowStartY, blurredStartY + y + k));
+        sum += this->BlurKernel[k + kernelRadius] * this->RowBlurBuffer[(rowY - rowStartY) * blurredWidth + x];
+      }
+      this->BlurredMaskBuffer[y * blurredWidth + x] = sum;
+    }
+  }
+
+  // Keep the normalized gradient of the blurred mask at the boundary pixels only. The neighbors
+  // outside of the image are again the nearest image pixels.
+  typename TNormalsImage::PixelType zeroNormal;
+  zeroNormal.Fill(0);
+
+  itk::ImageRegionIteratorWithIndex<TNormalsImage> normalsImageIterator(boundaryNormalsImage, region);
+  while(!normalsImageIterator.IsAtEnd())
+  {
+    const itk::Index<2> pixel = normalsImageIterator.GetIndex();
+    if(!this->IsBoundaryPixel(pixel))
+    {
+      normalsImageIterator.Set(zeroNormal);
+      ++normalsImageIterator;
+      continue;
+    }
+
+    const long x = pixel[0] - blurredStartX;
+    const long y = pixel[1] - blurredStartY;
+    const long previousX = std::max(fullStart[0], pixel[0] - 1) - blurredStartX;
+    const long nextX = std::min(fullEnd[0], pixel[0] + 1) - blurredStartX;
+    const long previousY = std::max(fullStart[1], pixel[1] - 1) - blurredStartY;
+    const long nextY = std::min(fullEnd[1], pixel[1] + 1) - blurredStartY;
+
+    typename TNormalsImage::PixelType normal;
+    normal[0] = (this->BlurredMaskBuffer[y * blurredWidth + nextX] -
+                 this->BlurredMaskBuffer[y * blurredWidth + previousX]) / 2.0f;
+    normal[1] = (this->BlurredMaskBuffer[nextY * blurredWidth + x] -
+                 this->BlurredMaskBuffer[previousY * blurredWidth + x]) / 2.0f;
+    normal.Normalize();
+    normalsImageIterator.Set(normal);
+
+    ++normalsImageIterator;
+  }
+}
+
+inline void BoundaryNormals::SetFillFront(const FillFront* const fillFront)
+{
+  this->Front = fillFront;
+}
+
+inline bool BoundaryNormals::IsBoundaryPixel(const itk::Index<2>& pixel) const
+{
+  if(this->Front)
+  {
+    return this->Front->IsOnFront(pixel);
+  }
+
+  return this->MaskImage->IsValid(pixel) && this->MaskImage->HasHoleNeighbor(pixel);
+}
+
 #endif
@@ -0,0 +1,83 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2011 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef FillFront_H
+#define FillFront_H
+
+// Submodules
+#include <Mask/Mask.h>
+
+// STL
+#include <vector>
+
+/** The fill front of a mask: the valid pixels that have a hole neighbor. The front pixels are kept in a list,
+  * and a flag image (the position of the pixel in the list plus one, or zero) tells in constant time if a
+  * pixel is on the front. The front is computed from the whole mask once (Initialize()), and afterwards only
+  * the pixels around a filled region are looked at again (Update()), so the code that needs the front does not
+  * have to create a boundary image of the whole mask.
+  *
+  * The front is only correct if Update() is called every time the mask is changed (see
+  * InpaintingVisitor::FinishVertex, which owns the front of the inpainting). */
+class FillFront
+{
+public:
+  typedef std::vector<itk::Index<2> > PixelContainer;
+
+  FillFront(const Mask* const mask);
+
+  /** Find the front of the whole mask. */
+  void Initialize();
+
+  bool IsInitialized() const;
+
+  /** Update the front after the pixels of 'filledRegion' have been changed in the mask. Only the
+    * pixels within one pixel of the region can join or leave the front. */
+  void Update(const itk::ImageRegion<2>& filledRegion);
+
+  bool IsOnFront(const itk::Index<2>& pixel) const;
+
+  /** All of the front pixels, in no particular order. */
+  const PixelContainer& GetFrontPixels() const;
+
+  /** The front pixels inside 'region', in raster order. */
+  PixelContainer GetFrontPixelsInRegion(const itk::ImageRegion<2>& region) const;
+
+  /** The pixels that left the front in the last Update(). */
+  const PixelContainer& GetRemovedPixels() const;
+
+  /** Create an image of the whole mask size with 'frontValue' at the front pixels and zero elsewhere. */
+  void CreateBoundaryImage(Mask::BoundaryImageType* const boundaryImage, const unsigned char frontValue) const;
+
+private:
+  const Mask* MaskImage;
+
+  typedef itk::Image<unsigned int, 2> PositionImageType;
+  PositionImageType::Pointer PositionImage;
+
+  PixelContainer FrontPixels;
+
+  PixelContainer RemovedPixels;
+
+  void Add(const itk::Index<2>& pixel);
+
+  void Remove(const itk::Index<2>& pixel);
+};
+
+#include "FillFront.hpp"
+
+#endif
@@ -0,0 +1,166 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2011 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef FillFront_HPP
+#define FillFront_HPP
+
+#include "FillFront.h" // Appease syntax parser
+
+// ITK
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+// STL
+#include <stdexcept>
+
+inline FillFront::FillFront(const Mask* const mask) : MaskImage(mask)
+{
+
+}
+
+inline void FillFront::Initialize()
+{
+  this->PositionImage = PositionImageType::New();
+  this->PositionImage->SetRegions(this->MaskImage->GetLargestPossibleRegion());
+  this->PositionImage->Allocate();
+  this->PositionImage->FillBuffer(0);
+
+  this->FrontPixels.clear();
+  this->RemovedPixels.clear();
+
+  Mask::BoundaryImageType::Pointer boundaryImage = Mask::BoundaryImageType::New();
+  unsigned char boundaryPixelValue = 255;
+  this->MaskImage->CreateBoundaryImage(boundaryImage, Mask::VALID, boundaryPixelValue);
+
+  itk::ImageRegionConstIteratorWithIndex<Mask::BoundaryImageType> boundaryImageIterator(boundaryImage,
+                                                                         boundaryImage->GetLargestPossibleRegion());
+  while(!boundaryImageIterator.IsAtEnd())
+  {
+    if(boundaryImageIterator.Get() == boundaryPixelValue)
+    {
+      this->Add(boundaryImageIterator.GetIndex());
+    }
+    ++boundaryImageIterator;
+  }
+}
+
+inline bool FillFront::IsInitialized() const
+{
+  return this->PositionImage.IsNotNull();
+}
+
+inline void FillFront::Update(const itk::ImageRegion<2>& filledRegion)
+{
+  if(!this->IsInitialized())
+  {
+    throw std::runtime_error("FillFront::Update: The front has not been initialized!");
+  }
+
+  this->RemovedPixels.clear();
+
+  itk::ImageRegion<2> region = filledRegion;
+  region.PadByRadius(1);
+  region.Crop(this->PositionImage->GetLargestPossibleRegion());
+
+  itk::ImageRegionConstIteratorWithIndex<PositionImageType> positionIterator(this->PositionImage, region);
+  while(!positionIterator.IsAtEnd())
+  {
+    const itk::Index<2> pixel = positionIterator.GetIndex();
+    const bool wasOnFront = positionIterator.Get() != 0;
+    const bool isOnFront = this->MaskImage->IsValid(pixel) && this->MaskImage->HasHoleNeighbor(pixel);
+    if(isOnFront && !wasOnFront)
+    {
+      this->Add(pixel);
+    }
+    else if(wasOnFront && !isOnFront)
+    {
+      this->Remove(pixel);
+      this->RemovedPixels.push_back(pixel);
+    }
+    ++positionIterator;
+  }
+}
+
+inline bool FillFront::IsOnFront(const itk::Index<2>& pixel) const
+{
+  return this->PositionImage->GetLargestPossibleRegion().IsInside(pixel) &&
+         this->PositionImage->GetPixel(pixel) != 0;
+}
+
+inline const FillFront::PixelContainer& FillFront::GetFrontPixels() const
+{
+  return this->FrontPixels;
+}
+
+inline FillFront::PixelContainer FillFront::GetFrontPixelsInRegion(const itk::ImageRegion<2>& region) const
+{
+  PixelContainer frontPixels;
+
+  itk::ImageRegion<2> croppedRegion = region;
+  if(!croppedRegion.Crop(this->PositionImage->GetLargestPossibleRegion()))
+  {
+    return frontPixels;
+  }
+
+  itk::ImageRegionConstIteratorWithIndex<PositionImageType> positionIterator(this->PositionImage, croppedRegion);
+  while(!positionIterator.IsAtEnd())
+  {
+    if(positionIterator.Get() != 0)
+    {
+      frontPixels.push_back(positionIterator.GetIndex());
+    }
+    ++positionIterator;
+  }
+  return frontPixels;
+}
+
+inline const FillFront::PixelContainer& FillFront::GetRemovedPixels() const
+{
+  return this->RemovedPixels;
+}
+
+inline void FillFront::CreateBoundaryImage(Mask::BoundaryImageType* const boundaryImage,
+                                           const unsigned char frontValue) const
+{
+  boundaryImage->SetRegions(this->PositionImage->GetLargestPossibleRegion());
+  boundaryImage->Allocate();
+  boundaryImage->FillBuffer(0);
+
+  for(PixelContainer::const_iterator pixelIterator = this->FrontPixels.begin();
+      pixelIterator != this->FrontPixels.end(); ++pixelIterator)
+  {
+    boundaryImage->SetPixel(*pixelIterator, frontValue);
+  }
+}
+
+inline void FillFront::Add(const itk::Index<2>& pixel)
+{
+  this->FrontPixels.push_back(pixel);
+  this->PositionImage->SetPixel(pixel, static_cast<unsigned int>(this->FrontPixels.size()));
+}
+
+inline void FillFront::Remove(const itk::Index<2>& pixel)
+{
+  // Move the last front pixel into the place of the removed one
+  const unsigned int position = this->PositionImage->GetPixel(pixel) - 1;
+  this->FrontPixels[position] = this->FrontPixels.back();
+  this->PositionImage->SetPixel(this->FrontPixels[position], position + 1);
+  this->FrontPixels.pop_back();
+  this->PositionImage->SetPixel(pixel, 0);
+}
+
+#endif
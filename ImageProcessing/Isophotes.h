@@ -22,6 +22,9 @@
 #include "Mask/Mask.h"
 #include "ImageTypes.h"
 
+// STL
+#include <vector>
+
 class Isophotes
 {
 
@@ -31,6 +34,25 @@ public:
   static void ComputeColorIsophotesInRegion(const TVectorImageType* const image, const Mask* const mask,
                                             const itk::ImageRegion<2>& region , TIsophoteImageType* const isophotes);
 
+  /** The buffers of ComputeColorIsophotesInRegionDirect. Keep one of these between the calls so that
+    * the buffers are only allocated once (they only grow when a larger region is computed). */
+  struct DirectBuffers
+  {
+    std::vector<float> Luminance;
+    std::vector<float> DerivativeKernel;
+  };
+
+  /** Compute the isophotes of ComputeColorIsophotesInRegion directly from the pixels of 'image' in 'region',
+    * without converting the image to RGB and without running the ITK filters. The luminance is computed
+    * (from the first three components, or the first component of a scalar image) in 'region' padded by the
+    * radius of the derivative kernel, so unlike the filter path the derivatives at the edges of the region
+    * do not read uninitialized luminance values. */
+  template <typename TImage, typename TIsophoteImageType>
+  static void ComputeColorIsophotesInRegionDirect(const TImage* const image, const Mask* const mask,
+                                                  const itk::ImageRegion<2>& region,
+                                                  TIsophoteImageType* const isophotes,
+                                                  DirectBuffers* const buffers);
+
 private:
   /** This is a helper function that is called by ComputeColorIsophotesInRegion. */
   template <typename TScalarImageType, typename TIsophoteImageType>
@@ -38,6 +60,12 @@ private:
                                              const itk::ImageRegion<2>& region,
                                              TIsophoteImageType* const outputIsophotes);
 
+  /** The masked derivative of MaskedDerivativeGaussianInRegion at 'pixel', from a luminance buffer
+    * that covers 'luminanceRegion' in raster order. */
+  static float MaskedDerivativeDirect(const float* const luminance, const itk::ImageRegion<2>& luminanceRegion,
+                                      const Mask* const mask, const std::vector<float>& kernel,
+                                      const itk::Index<2>& pixel, const unsigned int direction);
+
 };
 
 #include "Isophotes.hpp"
@@ -28,8 +28,14 @@
 #include "Utilities/RotateVectors.h"
 
 // ITK
+#include "itkGaussianOperator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIteratorWithIndex.h"
 #include "itkRGBToLuminanceImageFilter.h"
 
+// STL
+#include <algorithm>
+
 template <typename TVectorImageType, typename TIsophoteImageType>
 void
 Isophotes::ComputeColorIsophotesInRegion(const TVectorImageType* const image,
@@ -134,4 +140,158 @@ void Isophotes::ComputeMaskedIsophotesInRegion(const TVectorImageType* const ima
 //  std::cout << "Finish ComputeMaskedIsophotesInRegion" << std::endl;
 }
 
+template <typename TImage, typename TIsophoteImageType>
+void Isophotes::ComputeColorIsophotesInRegionDirect(const TImage* const image, const Mask* const mask,
+                                                    const itk::ImageRegion<2>& region,
+                                                    TIsophoteImageType* const isophotes,
+                                                    DirectBuffers* const buffers)
+{
+  assert(isophotes->GetLargestPossibleRegion() == image->GetLargestPossibleRegion());
+  assert(image->GetLargestPossibleRegion() == mask->GetLargestPossibleRegion());
+  assert(image->GetLargestPossibleRegion().IsInside(region));
+
+  // The same kernel as MaskedDerivativeGaussianInRegion
+  const unsigned int kernelRadius = 5;
+  if(buffers->DerivativeKernel.empty())
+  {
+    typedef itk::GaussianOperator<float, 1> GaussianOperatorType;
+
+    itk::Size<1> radius;
+    radius.Fill(kernelRadius);
+
+    GaussianOperatorType gaussianOperator;
+    gaussianOperator.SetDirection(0);
+    gaussianOperator.SetVariance(3);
+    gaussianOperator.CreateToRadius(radius);
+
+    buffers->DerivativeKernel.resize(gaussianOperator.Size());
+    for(unsigned int elementId = 0; elementId < gaussianOperator.Size(); ++elementId)
+    {
+      buffers->DerivativeKernel[elementId] = gaussianOperator.GetElement(elementId);
+    }
+  }
+
+  // The derivatives read the luminance up to the kernel radius away from the region
+  itk::ImageRegion<2> luminanceRegion = region;
+  luminanceRegion.PadByRadius(kernelRadius);
+  luminanceRegion.Crop(mask->GetLargestPossibleRegion());
+
+  if(buffers->Luminance.size() < luminanceRegion.GetNumberOfPixels())
+  {
+    buffers->Luminance.resize(luminanceRegion.GetNumberOfPixels());
+  }
+
+  // Compute the luminance of the valid pixels (the hole pixels are never read) as
+  // RGBToLuminanceImageFilter does, from the components cast to unsigned char as the RGB conversion does.
+  const unsigned int numberOfComponents = image->GetNumberOfComponentsPerPixel();
+  float* luminancePixel = &buffers->Luminance[0];
+  itk::ImageRegionConstIteratorWithIndex<TImage> imageIterator(image, luminanceRegion);
+  while(!imageIterator.IsAtEnd())
+  {
+    if(mask->IsValid(imageIterator.GetIndex()))
+    {
+      typename TImage::PixelType pixel = imageIterator.Get();
+      float rgb[3];
+      for(unsigned int component = 0; component < 3; ++component)
+      {
+        rgb[component] = static_cast<unsigned char>(pixel[std::min(component, numberOfComponents - 1)]);
+      }
+      *luminancePixel = 0.30f * rgb[0] + 0.59f * rgb[1] + 0.11f * rgb[2];
+    }
+
+    ++luminancePixel;
+    ++imageIterator;
+  }
+
+  // The isophote is the gradient rotated by 90 degrees (see RotateVectors)
+  itk::ImageRegionIteratorWithIndex<TIsophoteImageType> isophoteIterator(isophotes, region);
+  while(!isophoteIterator.IsAtEnd())
+  {
+    typename TIsophoteImageType::PixelType isophote;
+    isophote[0] = 0;
+    isophote[1] = 0;
+
+    if(mask->IsValid(isophoteIterator.GetIndex()))
+    {
+      isophote[0] = -MaskedDerivativeDirect(&buffers->Luminance[0], luminanceRegion, mask,
+                                            buffers->DerivativeKernel, isophoteIterator.GetIndex(), 1);
+      isophote[1] = MaskedDerivativeDirect(&buffers->Luminance[0], luminanceRegion, mask,
+                                           buffers->DerivativeKernel, isophoteIterator.GetIndex(), 0);
+    }
+
+    isophoteIterator.Set(isophote);
+    ++isophoteIterator;
+  }
+}
+
+inline float Isophotes::MaskedDerivativeDirect(const float* const luminance,
+                                               const itk::ImageRegion<2>& luminanceRegion,
+                                               const Mask* const mask, const std::vector<float>& kernel,
+                                               const itk::Index<2>& pixel, const unsigned int direction)
+{
+  const itk::ImageRegion<2> fullRegion = mask->GetLargestPossibleRegion();
+  const itk::Index<2> corner = luminanceRegion.GetIndex();
+  const long width = static_cast<long>(luminanceRegion.GetSize()[0]);
+
+  // The kernel is applied across the direction of the derivative (over rows for the x derivative)
+  const unsigned int shiftIndex = (direction == 0) ? 1 : 0;
+  const int kernelRadius = static_cast<int>(kernel.size() / 2);
+
+  float totalDifference = 0.0f;
+  float totalWeight = 0.0f;
+  for(int shift = -kernelRadius; shift <= kernelRadius; ++shift)
+  {
+    itk::Index<2> centerIndex = pixel;
+    centerIndex[shiftIndex] += shift;
+    if(!(fullRegion.IsInside(centerIndex) && mask->IsValid(centerIndex)))
+    {
+      continue;
+    }
+
+    itk::Index<2> backwardIndex = centerIndex;
+    backwardIndex[direction]--;
+    const bool backwardValid = fullRegion.IsInside(backwardIndex) && mask->IsValid(backwardIndex);
+
+    itk::Index<2> forwardIndex = centerIndex;
+    forwardIndex[direction]++;
+    const bool forwardValid = fullRegion.IsInside(forwardIndex) && mask->IsValid(forwardIndex);
+
+    const float center = luminance[(centerIndex[1] - corner[1]) * width + centerIndex[0] - corner[0]];
+    const float backward = backwardValid ?
+                           luminance[(backwardIndex[1] - corner[1]) * width + backwardIndex[0] - corner[0]] : 0.0f;
+    const float forward = forwardValid ?
+                          luminance[(forwardIndex[1] - corner[1]) * width + forwardIndex[0] - corner[0]] : 0.0f;
+
+    const float weight = kernel[shift + kernelRadius];
+
+    // The weights are summed in the same way as MaskedDerivativeGaussianInRegion does
+    float difference = 0.0f;
+    if(backwardValid && !forwardValid)
+    {
+      difference = center - backward;
+      totalWeight += weight;
+    }
+    else if(!backwardValid && forwardValid)
+    {
+      difference = forward - center;
+      totalWeight += weight;
+    }
+    else if(backwardValid && forwardValid)
+    {
+      difference = (forward - backward) / 2.0f;
+      totalWeight += weight;
+    }
+
+    totalDifference += difference * weight;
+    totalWeight += weight;
+  }
+
+  if(totalWeight > 0.0f)
+  {
+    totalDifference /= totalWeight;
+  }
+
+  return totalDifference;
+}
+
 #endif
@@ -0,0 +1,155 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2011 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "FillFront.h"
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+#include <Mask/Mask.h>
+
+// STL
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+/** A mask with a few holes of different shapes, one of them touching the edge of the image. */
+static void CreateMask(Mask* const mask)
+{
+  itk::Index<2> corner = {{0, 0}};
+  itk::Size<2> size = {{40, 40}};
+  itk::ImageRegion<2> region(corner, size);
+
+  mask->SetRegions(region);
+  mask->Allocate();
+  ITKHelpers::SetImageToConstant(mask, mask->GetValidValue());
+
+  itk::Index<2> squareCorner = {{8, 8}};
+  itk::Size<2> squareSize = {{10, 12}};
+  ITKHelpers::SetRegionToConstant(mask, itk::ImageRegion<2>(squareCorner, squareSize), mask->GetHoleValue());
+
+  itk::Index<2> edgeCorner = {{30, 0}};
+  itk::Size<2> edgeSize = {{6, 9}};
+  ITKHelpers::SetRegionToConstant(mask, itk::ImageRegion<2>(edgeCorner, edgeSize), mask->GetHoleValue());
+
+  for(itk::IndexValueType diagonal = 5; diagonal < 35; ++diagonal)
+  {
+    itk::Index<2> pixel = {{diagonal, 39 - diagonal / 2}};
+    mask->SetPixel(pixel, mask->GetHoleValue());
+  }
+}
+
+/** Compare the front to the boundary image that Mask computes from the whole mask. */
+static bool MatchesMaskBoundary(const FillFront& fillFront, const Mask* const mask)
+{
+  const unsigned char boundaryValue = 255;
+
+  Mask::BoundaryImageType::Pointer maskBoundaryImage = Mask::BoundaryImageType::New();
+  mask->CreateBoundaryImage(maskBoundaryImage, Mask::VALID, boundaryValue);
+
+  Mask::BoundaryImageType::Pointer frontBoundaryImage = Mask::BoundaryImageType::New();
+  fillFront.CreateBoundaryImage(frontBoundaryImage, boundaryValue);
+
+  size_t numberOfBoundaryPixels = 0;
+  itk::ImageRegionConstIteratorWithIndex<Mask::BoundaryImageType> maskBoundaryIterator(
+        maskBoundaryImage, maskBoundaryImage->GetLargestPossibleRegion());
+  while(!maskBoundaryIterator.IsAtEnd())
+  {
+    const itk::Index<2> pixel = maskBoundaryIterator.GetIndex();
+    const bool onMaskBoundary = maskBoundaryIterator.Get() == boundaryValue;
+    if(onMaskBoundary != (frontBoundaryImage->GetPixel(pixel) == boundaryValue) ||
+       onMaskBoundary != fillFront.IsOnFront(pixel))
+    {
+      std::cerr << "The fill front and the mask boundary are different at " << pixel << "!" << std::endl;
+      return false;
+    }
+
+    if(onMaskBoundary)
+    {
+      numberOfBoundaryPixels++;
+    }
+    ++maskBoundaryIterator;
+  }
+
+  if(fillFront.GetFrontPixels().size() != numberOfBoundaryPixels)
+  {
+    std::cerr << "The fill front has " << fillFront.GetFrontPixels().size() << " pixels, but the mask boundary has "
+              << numberOfBoundaryPixels << "!" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+/** Fill patches around front pixels (as the inpainting does) and check the front after every Update(). */
+int main()
+{
+  Mask::Pointer mask = Mask::New();
+  CreateMask(mask);
+
+  FillFront fillFront(mask);
+  fillFront.Initialize();
+
+  if(!MatchesMaskBoundary(fillFront, mask))
+  {
+    std::cerr << "after Initialize()" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::mt19937 generator(0);
+  const unsigned int patchHalfWidth = 2;
+
+  unsigned int numberOfUpdates = 0;
+  while(!fillFront.GetFrontPixels().empty())
+  {
+    // Fill the patch around a random front pixel, cropped to the image
+    std::uniform_int_distribution<size_t> frontDistribution(0, fillFront.GetFrontPixels().size() - 1);
+    const itk::Index<2> center = fillFront.GetFrontPixels()[frontDistribution(generator)];
+
+    itk::ImageRegion<2> filledRegion = ITKHelpers::GetRegionInRadiusAroundPixel(center, patchHalfWidth);
+    filledRegion.Crop(mask->GetLargestPossibleRegion());
+    ITKHelpers::SetRegionToConstant(mask.GetPointer(), filledRegion, mask->GetValidValue());
+
+    fillFront.Update(filledRegion);
+    numberOfUpdates++;
+
+    if(!MatchesMaskBoundary(fillFront, mask))
+    {
+      std::cerr << "after " << numberOfUpdates << " updates (the last one filled " << filledRegion.GetIndex()
+                << " " << filledRegion.GetSize() << ")" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // A hole pixel that is left would make some valid pixel a front pixel, so the front can only be empty when the
+  // holes are filled
+  itk::ImageRegionConstIteratorWithIndex<Mask> maskIterator(mask, mask->GetLargestPossibleRegion());
+  while(!maskIterator.IsAtEnd())
+  {
+    if(mask->IsHole(maskIterator.GetIndex()))
+    {
+      std::cerr << "The front is empty, but " << maskIterator.GetIndex() << " is still a hole!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    ++maskIterator;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -8,6 +8,7 @@
 #include "Mask/Mask.h"
 #include "Priority/Priority.h"
 #include "ITKHelpers/ITKHelpers.h"
+#include "ImageProcessing/FillFront.h"
 
 template <typename TBoundaryNodeQueue, typename TPriority>
 inline void InitializePriority(Mask* const maskImage, TBoundaryNodeQueue* boundaryNodeQueue,
@@ -54,4 +55,31 @@ inline void InitializePriority(Mask* const maskImage, TBoundaryNodeQueue* bounda
 
 }
 
+/** Add the pixels of an already computed fill front (usually InpaintingVisitor::GetFillFront()) to the queue,
+  * instead of creating the boundary image of the whole mask. The queue must be new or cleared. */
+template <typename TBoundaryNodeQueue, typename TPriority>
+inline void InitializePriority(const FillFront* const fillFront, TBoundaryNodeQueue* boundaryNodeQueue,
+                               TPriority* const priorityFunction)
+{
+  const FillFront::PixelContainer& frontPixels = fillFront->GetFrontPixels();
+  for(FillFront::PixelContainer::const_iterator pixelIterator = frontPixels.begin();
+      pixelIterator != frontPixels.end(); ++pixelIterator)
+  {
+    typename TBoundaryNodeQueue::ValueType node =
+        Helpers::ConvertFrom<typename TBoundaryNodeQueue::ValueType, itk::Index<2> >(*pixelIterator);
+
+    boundaryNodeQueue->push_or_update(node, priorityFunction->ComputePriority(*pixelIterator));
+  }
+}
+
+/** Give the priority function the fill front of 'inpaintingVisitor' (see PriorityCriminisi::SetFillFront) and add
+  * the front pixels to the queue, so that neither of them creates the boundary image of the whole mask. */
+template <typename TInpaintingVisitor, typename TBoundaryNodeQueue, typename TPriority>
+inline void InitializePriorityFromFillFront(TInpaintingVisitor* const inpaintingVisitor,
+                                            TBoundaryNodeQueue* boundaryNodeQueue, TPriority* const priorityFunction)
+{
+  priorityFunction->SetFillFront(inpaintingVisitor->GetFillFront());
+  InitializePriority(inpaintingVisitor->GetFillFront().get(), boundaryNodeQueue, priorityFunction);
+}
+
 #endif
@@ -29,6 +29,7 @@ class PatchInpainter : public PatchInpainterParent, public Debug
   virtual PatchInpainter* DeepCopy() override
   {
     PatchInpainter* copiedPatchInpainter = new PatchInpainter(PatchHalfWidth, Image, MaskImage);
+    copiedPatchInpainter->SourceImage = SourceImage;
     copiedPatchInpainter->ImageName = ImageName;
     copiedPatchInpainter->Iteration = Iteration;
     return copiedPatchInpainter;
@@ -37,6 +38,9 @@ class PatchInpainter : public PatchInpainterParent, public Debug
   /** The image to inpaint. */
   typename TImage::Pointer Image;
 
+  /** The image to copy the source patches from. This is 'Image' unless SetSourceImage() is used. */
+  typename TImage::Pointer SourceImage;
+
   /** The mask to use to determine which pixels are holes (which pixels to inpaint). */
   const Mask* MaskImage;
 
@@ -55,7 +59,14 @@ public:
   /** Copy the pixel value at sourceIndex to targetIndex. */
   void PaintVertex(const itk::Index<2>& targetIndex, const itk::Index<2>& sourceIndex)
   {
-    this->Image->SetPixel(targetIndex, this->Image->GetPixel(sourceIndex));
+    this->Image->SetPixel(targetIndex, this->SourceImage->GetPixel(sourceIndex));
+  }
+
+  /** Copy the source patches from another image (with the same pixel type) instead of from the image that is
+    * being inpainted, e.g. from the reference image of a SharedSourceBank. */
+  void SetSourceImage(typename TImage::Pointer sourceImage)
+  {
+    this->SourceImage = sourceImage;
   }
 
   /** Specify a name for the image. */
@@ -66,7 +77,7 @@ public:
 
   /** Inpaint a patch only in the masked pixels. */
   PatchInpainter(std::size_t patchHalfWidth, typename TImage::Pointer image, const Mask* const mask) :
-    Image(image), MaskImage(mask), PatchHalfWidth(patchHalfWidth)
+    Image(image), SourceImage(image), MaskImage(mask), PatchHalfWidth(patchHalfWidth)
   {
 //    std::cout << "PatchInpainter: size: " << this->Image->GetLargestPossibleRegion().GetSize() << std::endl;
   }
@@ -89,7 +100,7 @@ public:
     itk::ImageRegion<2> targetRegion = fullTargetRegion;
     targetRegion.Crop(this->Image->GetLargestPossibleRegion());
 
-    assert(this->Image->GetLargestPossibleRegion().IsInside(sourceRegion));
+    assert(this->SourceImage->GetLargestPossibleRegion().IsInside(sourceRegion));
     assert(this->Image->GetLargestPossibleRegion().IsInside(targetRegion));
     assert(targetRegion.GetSize() == sourceRegion.GetSize());
 
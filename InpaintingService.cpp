@@ -0,0 +1,68 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// ITK
+#include "itkImage.h"
+#include "itkCovariantVector.h"
+
+// STL
+#include <iostream>
+
+// POSIX
+#include <unistd.h>
+
+#include "Drivers/InpaintingService.hpp"
+
+// Run with: (no arguments) to read the requests from stdin and write the responses to stdout,
+// or with: /tmp/inpainting.socket to serve the connections of a Unix socket.
+// See Utilities/InpaintingServiceProtocol.hpp for the messages.
+int main(int argc, char *argv[])
+{
+  // Verify arguments
+  if(argc > 2)
+  {
+    std::cerr << "Optional arguments: socketPath" << std::endl;
+    std::cerr << "Input arguments: ";
+    for(int i = 1; i < argc; ++i)
+    {
+      std::cerr << argv[i] << " ";
+    }
+    return EXIT_FAILURE;
+  }
+
+  typedef itk::Image<itk::CovariantVector<int, 3>, 2> OriginalImageType;
+
+  InpaintingService<OriginalImageType> service;
+
+  if(argc == 2)
+  {
+    service.ServeUnixSocket(argv[1]);
+    return EXIT_SUCCESS;
+  }
+
+  // The algorithms print their progress to stdout, so send that to stderr and keep the real stdout for the responses.
+  int responseFileDescriptor = dup(STDOUT_FILENO);
+  dup2(STDERR_FILENO, STDOUT_FILENO);
+
+  service.Serve(STDIN_FILENO, responseFileDescriptor);
+
+  std::cerr << "InpaintingService: handled " << service.GetNumberOfRequests() << " requests, "
+            << service.GetNumberOfReusedWorkspaces() << " of them in a reused workspace." << std::endl;
+
+  return EXIT_SUCCESS;
+}
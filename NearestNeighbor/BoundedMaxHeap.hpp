@@ -0,0 +1,153 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef BoundedMaxHeap_HPP
+#define BoundedMaxHeap_HPP
+
+// STL
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+/**
+  * This class keeps the K items with the smallest distances out of all of the items that are pushed.
+  * It is a max-heap that never holds more than K items, so the top is the worst of the items kept so far,
+  * and a new item is only kept if it is better than the top. The memory used is O(K) no matter how many
+  * items are pushed.
+  *
+  * This class is not thread safe. The KNN searches give each block of the range (a task of the TaskPool) its
+  * own BoundedMaxHeap (so no locking is needed in the loop over the candidates) and Merge() the per-block
+  * heaps once each block is done.
+  *
+  * By default, of several items with the same distance the ones that were pushed first are kept, so the
+  * kept items depend on the order of the pushes and merges. If 'breakTiesByItem' is true, items with the
+  * same distance are ordered by the item itself (TItem must then have operator<), so the kept items are
+  * the K smallest (distance, item) pairs no matter how the items were split between heaps.
+  */
+template <typename TDistance, typename TItem>
+class BoundedMaxHeap
+{
+public:
+  typedef std::pair<TDistance, TItem> PairType;
+
+  BoundedMaxHeap(const unsigned int k, const bool breakTiesByItem = false) : K(k), Compare(breakTiesByItem)
+  {
+    this->Heap.reserve(k);
+  }
+
+  /** Offer an item. Returns true if the item was kept. */
+  bool Push(const TDistance distance, const TItem& item)
+  {
+    if(this->Heap.size() < this->K)
+    {
+      this->Heap.push_back(PairType(distance, item));
+      std::push_heap(this->Heap.begin(), this->Heap.end(), this->Compare);
+      return true;
+    }
+
+    if(this->K == 0 || !this->Compare(PairType(distance, item), this->Heap.front()))
+    {
+      return false;
+    }
+
+    std::pop_heap(this->Heap.begin(), this->Heap.end(), this->Compare);
+    this->Heap.back() = PairType(distance, item);
+    std::push_heap(this->Heap.begin(), this->Heap.end(), this->Compare);
+    return true;
+  }
+
+  /** Get the distance an item must beat to be kept. This is infinity until K items have been kept,
+    * so it can be passed directly as the early termination threshold of a distance function. */
+  TDistance GetWorstDistance() const
+  {
+    if(this->Heap.size() < this->K)
+    {
+      return std::numeric_limits<TDistance>::infinity();
+    }
+
+    if(this->K == 0)
+    {
+      return -std::numeric_limits<TDistance>::infinity();
+    }
+
+    return this->Heap.front().first;
+  }
+
+  /** Offer all of the items of another heap. */
+  void Merge(const BoundedMaxHeap& other)
+  {
+    for(typename std::vector<PairType>::const_iterator otherIterator = other.Heap.begin();
+        otherIterator != other.Heap.end(); ++otherIterator)
+    {
+      this->Push(otherIterator->first, otherIterator->second);
+    }
+  }
+
+  /** Get the kept items sorted from best (smallest distance) to worst. The heap is unchanged. */
+  std::vector<PairType> GetSortedItems() const
+  {
+    std::vector<PairType> sortedItems = this->Heap;
+    std::sort_heap(sortedItems.begin(), sortedItems.end(), this->Compare);
+    return sortedItems;
+  }
+
+  size_t size() const
+  {
+    return this->Heap.size();
+  }
+
+  bool empty() const
+  {
+    return this->Heap.empty();
+  }
+
+  unsigned int GetK() const
+  {
+    return this->K;
+  }
+
+private:
+  /** The maximum number of items to keep. */
+  unsigned int K;
+
+  /** The kept items, arranged as a max-heap on the distance. */
+  std::vector<PairType> Heap;
+
+  /** Orders the pairs by distance, and if requested the pairs with the same distance by item. */
+  struct ComparePairs
+  {
+    bool BreakTiesByItem;
+
+    ComparePairs(const bool breakTiesByItem) : BreakTiesByItem(breakTiesByItem) {}
+
+    bool operator()(const PairType& a, const PairType& b) const
+    {
+      if(a.first < b.first)
+      {
+        return true;
+      }
+
+      return this->BreakTiesByItem && !(b.first < a.first) && a.second < b.second;
+    }
+  };
+
+  ComparePairs Compare;
+};
+
+#endif
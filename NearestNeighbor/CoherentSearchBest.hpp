@@ -0,0 +1,251 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef CoherentSearchBest_HPP
+#define CoherentSearchBest_HPP
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+// Submodules
+#include <Helpers/Helpers.h>
+#include <Utilities/Debug/Debug.h>
+
+// STL
+#include <limits>
+#include <memory>
+#include <set>
+#include <vector>
+
+/**
+  * This class wraps a best patch finder and gives it a good match to start from. Consecutive target patches
+  * are usually adjacent on the fill front, and a neighboring target that was just filled from source location s
+  * suggests that this target would be filled well from the same shift. The source pixel map of the
+  * InpaintingVisitor (GetSourcePixelMapImage()) stores, for every pixel that has been filled, the pixel it was
+  * copied from. Each filled pixel p in the target region with source pixel s gives the "shifted" candidate
+  * query + (s - p). The candidates that are source nodes are compared to the query, and the best of them
+  * is passed to the wrapped finder as its initial result.
+  *
+  * If the wrapped finder has the bounded overload
+  *   operator()(first, last, query, initialResult, initialDistance)
+  * (as LinearSearchBestProperty does), the candidate distance is used as the initial early termination threshold,
+  * so most of the elements of the range are rejected after only a few pixels. Otherwise the wrapped finder
+  * is called normally and the better of its result and the best candidate is returned.
+  *
+  * The result is the same as the result of the wrapped finder alone, except that a shifted candidate
+  * outside of [first, last) can be returned if it is better than everything in the range.
+  *
+  * The source pixel map can also be the one of the previous frame of a video (see VideoFrameInpainting),
+  * so that a target is first tried with the shifts its neighborhood was filled with in that frame. With
+  * SetAcceptanceThreshold(), a candidate that is at least that good is returned without searching the range
+  * at all.
+  */
+template <typename PropertyMapType, typename TBestPatchFinder, typename PatchDistanceFunctionType>
+class CoherentSearchBest : public Debug
+{
+public:
+  typedef itk::Image<itk::Index<2>, 2> SourcePixelMapImageType;
+
+  /** 'sourcePixelMapImage' is usually InpaintingVisitor::GetSourcePixelMapImage(). It is read at every
+    * search, so it must be the image that the visitor keeps updating. */
+  CoherentSearchBest(PropertyMapType propertyMap, SourcePixelMapImageType* const sourcePixelMapImage,
+                     std::shared_ptr<TBestPatchFinder> bestPatchFinder,
+                     PatchDistanceFunctionType patchDistanceFunction = PatchDistanceFunctionType()) :
+    PropertyMap(propertyMap), SourcePixelMapImage(sourcePixelMapImage), BestPatchFinder(bestPatchFinder),
+    PatchDistanceFunction(patchDistanceFunction), NumberOfSearches(0), NumberOfCoherentResults(0),
+    AcceptanceThreshold(-std::numeric_limits<float>::infinity()), NumberOfAcceptedCandidates(0)
+  {
+
+  }
+
+  template <typename TIterator>
+  typename TIterator::value_type operator()(TIterator first, TIterator last,
+                                            typename TIterator::value_type query)
+  {
+    typedef typename TIterator::value_type NodeType;
+
+    NodeType bestCandidate = query;
+    float bestCandidateDistance = this->GetBestShiftedCandidate(query, bestCandidate);
+
+    this->NumberOfSearches++;
+
+    if(bestCandidateDistance == std::numeric_limits<float>::infinity())
+    {
+      return (*this->BestPatchFinder)(first, last, query);
+    }
+
+    if(bestCandidateDistance <= this->AcceptanceThreshold)
+    {
+      this->NumberOfAcceptedCandidates++;
+      this->NumberOfCoherentResults++;
+      return bestCandidate;
+    }
+
+    NodeType result = this->CallBestPatchFinder(first, last, query, bestCandidate, bestCandidateDistance, 0);
+
+    if(result == bestCandidate)
+    {
+      this->NumberOfCoherentResults++;
+    }
+
+    return result;
+  }
+
+  /** The number of searches in which a shifted candidate was the final result, and the total number of searches. */
+  unsigned int GetNumberOfCoherentResults() const
+  {
+    return this->NumberOfCoherentResults;
+  }
+
+  unsigned int GetNumberOfSearches() const
+  {
+    return this->NumberOfSearches;
+  }
+
+  /** Return the best shifted candidate without searching the range if its distance is at most 'threshold'.
+    * By default the range is always searched. */
+  void SetAcceptanceThreshold(const float threshold)
+  {
+    this->AcceptanceThreshold = threshold;
+  }
+
+  /** The number of searches in which the range was not searched because of the acceptance threshold. */
+  unsigned int GetNumberOfAcceptedCandidates() const
+  {
+    return this->NumberOfAcceptedCandidates;
+  }
+
+private:
+  PropertyMapType PropertyMap;
+
+  SourcePixelMapImageType::Pointer SourcePixelMapImage;
+
+  std::shared_ptr<TBestPatchFinder> BestPatchFinder;
+
+  PatchDistanceFunctionType PatchDistanceFunction;
+
+  unsigned int NumberOfSearches;
+
+  unsigned int NumberOfCoherentResults;
+
+  float AcceptanceThreshold;
+
+  unsigned int NumberOfAcceptedCandidates;
+
+  /** Find the best shifted candidate of 'query'. Returns its distance, or infinity if there are no candidates. */
+  template <typename TNode>
+  float GetBestShiftedCandidate(const TNode& query, TNode& bestCandidate)
+  {
+    typedef typename PropertyMapType::value_type PatchType;
+    const PatchType& queryPatch = get(this->PropertyMap, query);
+
+    itk::ImageRegion<2> fullRegion = this->SourcePixelMapImage->GetLargestPossibleRegion();
+    itk::ImageRegion<2> queryRegion = queryPatch.GetRegion();
+    itk::Index<2> queryIndex = Helpers::ConvertFrom<itk::Index<2>, TNode>(query);
+
+    float bestDistance = std::numeric_limits<float>::infinity();
+    if(!queryRegion.Crop(fullRegion))
+    {
+      return bestDistance;
+    }
+
+    // Valid pixels map to themselves and hole pixels map to (-1,-1); only the pixels that were filled give a shift.
+    std::set<itk::Index<2>, itk::Index<2>::LexicographicCompare> candidates;
+    itk::ImageRegionConstIteratorWithIndex<SourcePixelMapImageType> sourcePixelIterator(this->SourcePixelMapImage,
+                                                                                        queryRegion);
+    while(!sourcePixelIterator.IsAtEnd())
+    {
+      itk::Index<2> sourcePixel = sourcePixelIterator.Get();
+      if(sourcePixel[0] >= 0 && sourcePixel != sourcePixelIterator.GetIndex())
+      {
+        itk::Index<2> candidate = queryIndex + (sourcePixel - sourcePixelIterator.GetIndex());
+        if(fullRegion.IsInside(candidate))
+        {
+          candidates.insert(candidate);
+        }
+      }
+      ++sourcePixelIterator;
+    }
+
+    if(candidates.empty())
+    {
+      return bestDistance;
+    }
+
+    // Gather the valid target pixels once for all of the candidates
+    typedef std::vector<typename PatchType::ImageType::PixelType> PixelVector;
+    typedef std::vector<itk::Offset<2> > OffsetVectorType;
+    const OffsetVectorType* validOffsets = queryPatch.GetValidOffsetsAddress();
+    PixelVector targetPixels(validOffsets->size());
+    for(size_t offsetId = 0; offsetId < validOffsets->size(); ++offsetId)
+    {
+      targetPixels[offsetId] = queryPatch.GetImage()->GetPixel(queryPatch.GetCorner() + (*validOffsets)[offsetId]);
+    }
+
+    for(typename std::set<itk::Index<2>, itk::Index<2>::LexicographicCompare>::const_iterator candidateIterator =
+        candidates.begin(); candidateIterator != candidates.end(); ++candidateIterator)
+    {
+      TNode candidate = Helpers::ConvertFrom<TNode, itk::Index<2> >(*candidateIterator);
+      const PatchType& candidatePatch = get(this->PropertyMap, candidate);
+      if(candidatePatch.GetStatus() != PatchType::SOURCE_NODE)
+      {
+        continue;
+      }
+
+      float distance = this->PatchDistanceFunction(candidatePatch, queryPatch, targetPixels, bestDistance);
+      if(distance < bestDistance)
+      {
+        bestDistance = distance;
+        bestCandidate = candidate;
+      }
+    }
+
+    return bestDistance;
+  }
+
+  /** Use the bounded overload of the wrapped finder if it has one. */
+  template <typename TIterator, typename TNode>
+  auto CallBestPatchFinder(TIterator first, TIterator last, const TNode& query,
+                           const TNode& initialResult, const float initialDistance, int)
+  -> decltype((*this->BestPatchFinder)(first, last, query, initialResult, initialDistance))
+  {
+    return (*this->BestPatchFinder)(first, last, query, initialResult, initialDistance);
+  }
+
+  /** Otherwise search the range and keep the better of its result and the initial result. */
+  template <typename TIterator, typename TNode>
+  TNode CallBestPatchFinder(TIterator first, TIterator last, const TNode& query,
+                            const TNode& initialResult, const float initialDistance, long)
+  {
+    TNode result = (*this->BestPatchFinder)(first, last, query);
+    if(first == last)
+    {
+      return initialResult;
+    }
+
+    float resultDistance = this->PatchDistanceFunction(get(this->PropertyMap, result), get(this->PropertyMap, query));
+    if(resultDistance < initialDistance)
+    {
+      return result;
+    }
+    return initialResult;
+  }
+};
+
+#endif
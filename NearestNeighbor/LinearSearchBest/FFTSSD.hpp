@@ -0,0 +1,608 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef LinearSearchBestFFTSSD_HPP
+#define LinearSearchBestFFTSSD_HPP
+
+// Submodules
+#include <Helpers/Helpers.h>
+#include <Utilities/Debug/Debug.h>
+
+// Custom
+#include "Utilities/TaskPool.h"
+
+// ITK
+#include "itkImageRegionConstIterator.h"
+
+// VNL
+#include <vnl/vnl_matrix.h>
+#include <vnl/algo/vnl_fft_2d.h>
+
+// STL
+#include <algorithm>
+#include <complex>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+/**
+  * This class finds the source patch with the smallest masked sum of squared differences (SSD)
+  * to a target patch. Instead of comparing the target patch to each source patch in turn
+  * (like LinearSearchBestProperty does), the SSD at every patch position in the image is
+  * computed at once by expanding it as
+  *
+  *   sum_o M(o) S(s+o)^2  -  2 sum_o M(o) S(s+o) T(o)  +  sum_o M(o) T(o)^2
+  *
+  * where M is the valid mask of the target patch, S is the image and T is the target patch.
+  * The first term is a box sum of a squared-intensity integral image when the target patch is fully
+  * valid, and a correlation of the squared intensities with M otherwise. The cross term is a
+  * correlation of each channel with the masked target patch. Both correlations are computed with
+  * FFTs.
+  *
+  * The image is split into tiles of TileSize x TileSize patch corners. Each tile is correlated on its
+  * own (overlap-save: the input of a tile extends by the patch size - 1 past its corners, so there is
+  * no wrap around), and only the tiles that contain a source patch of the search range are computed.
+  * The spectra and the integral image of a tile do not depend on the query, so they are cached between
+  * queries. A query only transforms its target patch and multiplies it with the cached spectra.
+  *
+  * The cache has to be told which pixels changed. The region of the previous query is invalidated
+  * at the start of each search, since that is the region that is filled after a best patch search.
+  * Any other change of the image has to be reported with InvalidateRegion().
+  *
+  * This is a drop-in replacement for LinearSearchBestProperty when PatchDistanceFunctionType is
+  * ImagePatchDifference with SumSquaredPixelDifference. The PatchDistanceFunction is only used to
+  * re-score the source patches whose FFT score is within RerankTolerance of the best FFT score, so
+  * the returned node is the one the exhaustive search would return (up to round-off in the FFTs).
+  */
+template <typename PropertyMapType, typename PatchDistanceFunctionType>
+struct LinearSearchBestFFTSSD : public Debug
+{
+  typedef std::complex<double> ComplexType;
+  typedef vnl_matrix<ComplexType> ComplexMatrixType;
+
+  /** The cached, query independent data of one tile. */
+  struct TileCache
+  {
+    /** Set when the entries below match the image. */
+    bool Valid = false;
+
+    /** The spectrum of each channel of the input region of the tile. */
+    std::vector<ComplexMatrixType> ChannelSpectra;
+
+    /** The spectrum of the squared norm of the pixels. It is only needed for partially valid target
+      * patches, so it is computed the first time one of them uses the tile. */
+    bool HasSquaredSpectrum = false;
+    ComplexMatrixType SquaredSpectrum;
+
+    /** An integral image of the squared norm of the pixels of the input region of the tile. */
+    std::vector<double> IntegralImage;
+  };
+
+  PropertyMapType PropertyMap;
+  PatchDistanceFunctionType PatchDistanceFunction;
+
+  /** Source patches with an FFT score (average SSD per valid pixel) within this value of the best
+    * FFT score are re-scored exactly with PatchDistanceFunction. */
+  float RerankTolerance = 1e-3f;
+
+  /** The number of patch corners along each side of a tile. */
+  unsigned int TileSize = 64;
+
+  /** The tile cache, and what it was computed for. */
+  std::vector<TileCache> Tiles;
+  const void* CachedImage = nullptr;
+  itk::Size<2> CachedImageSize = {{0, 0}};
+  unsigned int CachedPatchExtent = 0;
+  unsigned int NumberOfTilesX = 0;
+  unsigned int NumberOfTilesY = 0;
+  unsigned int FFTSize = 0;
+
+  /** The region of the last target patch, which is invalidated by the next search. */
+  bool HasPreviousQuery = false;
+  itk::ImageRegion<2> PreviousQueryRegion;
+
+  LinearSearchBestFFTSSD(PropertyMapType propertyMap,
+                         PatchDistanceFunctionType patchDistanceFunction = PatchDistanceFunctionType()) :
+  PropertyMap(propertyMap), PatchDistanceFunction(patchDistanceFunction){}
+
+  void SetRerankTolerance(const float rerankTolerance)
+  {
+    this->RerankTolerance = rerankTolerance;
+  }
+
+  /** Set the number of patch corners along each side of a tile. This clears the cache. */
+  void SetTileSize(const unsigned int tileSize)
+  {
+    if(tileSize == 0)
+    {
+      throw std::runtime_error("LinearSearchBestFFTSSD: The tile size must be positive!");
+    }
+
+    this->TileSize = tileSize;
+    this->ClearCache();
+  }
+
+  /** Drop all of the cached spectra and integral images. */
+  void ClearCache()
+  {
+    this->Tiles.clear();
+    this->CachedImage = nullptr;
+    this->CachedPatchExtent = 0;
+    this->HasPreviousQuery = false;
+  }
+
+  /** Mark the tiles that read any pixel of 'region' as out of date. */
+  void InvalidateRegion(const itk::ImageRegion<2>& region)
+  {
+    if(this->Tiles.empty() || region.GetNumberOfPixels() == 0)
+    {
+      return;
+    }
+
+    // The input region of tile t starts at t * TileSize and is TileSize + extent - 1 pixels long
+    const int inputLength = static_cast<int>(this->TileSize + this->CachedPatchExtent - 1);
+    const int tileSize = static_cast<int>(this->TileSize);
+
+    int tileMin[2];
+    int tileMax[2];
+    const unsigned int numberOfTiles[2] = {this->NumberOfTilesX, this->NumberOfTilesY};
+    for(unsigned int dimension = 0; dimension < 2; ++dimension)
+    {
+      const int regionMin = static_cast<int>(region.GetIndex()[dimension]);
+      const int regionMax = regionMin + static_cast<int>(region.GetSize()[dimension]) - 1;
+
+      // The first tile whose input region reaches regionMin, and the last one that starts before regionMax
+      const int firstInputStart = regionMin - inputLength + 1;
+      tileMin[dimension] = (firstInputStart <= 0) ? 0 : (firstInputStart + tileSize - 1) / tileSize;
+      tileMax[dimension] = (regionMax < 0) ? -1 :
+                           std::min(static_cast<int>(numberOfTiles[dimension]) - 1, regionMax / tileSize);
+    }
+
+    for(int tileY = tileMin[1]; tileY <= tileMax[1]; ++tileY)
+    {
+      for(int tileX = tileMin[0]; tileX <= tileMax[0]; ++tileX)
+      {
+        TileCache& tile = this->Tiles[tileY * this->NumberOfTilesX + tileX];
+        tile.Valid = false;
+        tile.HasSquaredSpectrum = false;
+      }
+    }
+  }
+
+  /**
+    * \param first Start of the range in which to search.
+    * \param last One element past the last element in the range in which to search.
+    * \param query The element to compare to.
+    * \return The best element in the range (the SOURCE_NODE with the smallest masked SSD to the query).
+    */
+  template <typename TIterator>
+  typename TIterator::value_type operator()(TIterator first, TIterator last,
+                                            typename TIterator::value_type query)
+  {
+    // If the input element range is empty, there is nothing to do.
+    if(first == last)
+    {
+      return *last;
+    }
+
+    typedef typename PropertyMapType::value_type PatchType;
+    typedef typename PatchType::ImageType ImageType;
+    typedef typename TIterator::value_type NodeType;
+
+    PatchType queryPatch = get(this->PropertyMap, query);
+
+    typedef std::vector<itk::Offset<2> > OffsetVectorType;
+    const OffsetVectorType* validOffsets = queryPatch.GetValidOffsetsAddress();
+
+    if(validOffsets->empty())
+    {
+      throw std::runtime_error("LinearSearchBestFFTSSD: The query patch does not have any valid pixels!");
+    }
+
+    ImageType* image = queryPatch.GetImage();
+
+    // The pixels of the previous target patch have been filled since it was searched
+    if(this->HasPreviousQuery)
+    {
+      this->InvalidateRegion(this->PreviousQueryRegion);
+    }
+    this->PreviousQueryRegion = queryPatch.GetRegion();
+    this->HasPreviousQuery = true;
+
+    // Determine the extent of the target patch from its valid offsets
+    unsigned int patchWidth = 0;
+    unsigned int patchHeight = 0;
+    for(size_t offsetId = 0; offsetId < validOffsets->size(); ++offsetId)
+    {
+      patchWidth = std::max(patchWidth, static_cast<unsigned int>((*validOffsets)[offsetId][0] + 1));
+      patchHeight = std::max(patchHeight, static_cast<unsigned int>((*validOffsets)[offsetId][1] + 1));
+    }
+
+    const bool fullyValid = (validOffsets->size() == patchWidth * patchHeight);
+
+    // Use the size of the whole patch so that partially valid target patches do not shrink the extent
+    const itk::Size<2> querySize = queryPatch.GetRegion().GetSize();
+    const unsigned int patchExtent = std::max(std::max(patchWidth, patchHeight),
+                                              static_cast<unsigned int>(std::max(querySize[0], querySize[1])));
+
+    this->PrepareCache(image, patchExtent);
+
+    // Find the tile of each source patch in the range
+    // The scores are kept in double: in float, the round-off of a score can be more than the rerank tolerance
+    typedef std::pair<double, NodeType> ScoredNodeType;
+    std::vector<ScoredNodeType> scoredNodes;
+
+    typedef std::pair<unsigned int, unsigned int> TileNodePairType; // (tile id, id in scoredNodes)
+    std::vector<TileNodePairType> tileNodePairs;
+
+    for(TIterator current = first; current != last; ++current)
+    {
+      const PatchType& currentPatch = get(this->PropertyMap, *current);
+      if(currentPatch.GetStatus() != PatchType::SOURCE_NODE)
+      {
+        continue;
+      }
+
+      itk::Index<2> corner = currentPatch.GetCorner();
+      unsigned int tileId = (corner[1] / this->TileSize) * this->NumberOfTilesX + corner[0] / this->TileSize;
+      tileNodePairs.push_back(TileNodePairType(tileId, scoredNodes.size()));
+      scoredNodes.push_back(ScoredNodeType(std::numeric_limits<double>::infinity(), *current));
+    }
+
+    if(scoredNodes.empty())
+    {
+      throw std::runtime_error("LinearSearchBestFFTSSD: There were no source patches in the search range!");
+    }
+
+    std::sort(tileNodePairs.begin(), tileNodePairs.end());
+
+    // The start of each tile's run of nodes in tileNodePairs
+    std::vector<size_t> runStarts;
+    for(size_t pairId = 0; pairId < tileNodePairs.size(); ++pairId)
+    {
+      if(pairId == 0 || tileNodePairs[pairId].first != tileNodePairs[pairId - 1].first)
+      {
+        runStarts.push_back(pairId);
+      }
+    }
+    runStarts.push_back(tileNodePairs.size());
+
+    // Transform the (conjugated) target patch once; all of the tiles have the same FFT size
+    const unsigned int numberOfComponents = Helpers::length(image->GetPixel(queryPatch.GetCorner()));
+    const unsigned int fftSize = this->FFTSize;
+
+    std::vector<ComplexMatrixType> kernelSpectra(numberOfComponents + 1);
+    double targetEnergy = 0.0;
+    {
+      vnl_fft_2d<double> fft(fftSize, fftSize);
+      for(unsigned int component = 0; component < numberOfComponents; ++component)
+      {
+        ComplexMatrixType& kernelSpectrum = kernelSpectra[component];
+        kernelSpectrum.set_size(fftSize, fftSize);
+        kernelSpectrum.fill(ComplexType(0.0, 0.0));
+        for(size_t offsetId = 0; offsetId < validOffsets->size(); ++offsetId)
+        {
+          const itk::Offset<2>& offset = (*validOffsets)[offsetId];
+          double value = static_cast<double>(Helpers::index(image->GetPixel(queryPatch.GetCorner() + offset),
+                                                            component));
+          kernelSpectrum(offset[1], offset[0]) = value;
+          targetEnergy += value * value;
+        }
+        fft.fwd_transform(kernelSpectrum);
+      }
+
+      if(!fullyValid)
+      {
+        ComplexMatrixType& maskSpectrum = kernelSpectra[numberOfComponents];
+        maskSpectrum.set_size(fftSize, fftSize);
+        maskSpectrum.fill(ComplexType(0.0, 0.0));
+        for(size_t offsetId = 0; offsetId < validOffsets->size(); ++offsetId)
+        {
+          maskSpectrum((*validOffsets)[offsetId][1], (*validOffsets)[offsetId][0]) = 1.0;
+        }
+        fft.fwd_transform(maskSpectrum);
+      }
+    }
+
+    const double numberOfValidPixels = static_cast<double>(validOffsets->size());
+    const double normalization = 1.0 / static_cast<double>(fftSize * fftSize);
+    const long numberOfRuns = static_cast<long>(runStarts.size()) - 1;
+
+    // Score the source patches tile by tile. The scores are divided by the number of valid pixels
+    // to be on the same scale as the scores of ImagePatchDifference. Each run is a whole tile, so the
+    // transforms are set up by each task.
+    TaskPool::GetGlobalInstance().ParallelFor(0, numberOfRuns, [&](const long runId)
+    {
+      vnl_fft_2d<double> fft(fftSize, fftSize);
+      ComplexMatrixType accumulatedSpectrum(fftSize, fftSize);
+
+      const unsigned int tileId = tileNodePairs[runStarts[runId]].first;
+      TileCache& tile = this->Tiles[tileId];
+      const itk::ImageRegion<2> inputRegion = this->GetTileInputRegion(tileId);
+      this->UpdateTile(image, tileId, !fullyValid, fft);
+
+      // -2 * sum_c correlation(S_c, M T_c) (+ correlation(sum_c S_c^2, M))
+      for(unsigned int row = 0; row < fftSize; ++row)
+      {
+        for(unsigned int col = 0; col < fftSize; ++col)
+        {
+          ComplexType value(0.0, 0.0);
+          for(unsigned int component = 0; component < numberOfComponents; ++component)
+          {
+            value -= 2.0 * tile.ChannelSpectra[component](row, col) *
+                     std::conj(kernelSpectra[component](row, col));
+          }
+          if(!fullyValid)
+          {
+            value += tile.SquaredSpectrum(row, col) * std::conj(kernelSpectra[numberOfComponents](row, col));
+          }
+          accumulatedSpectrum(row, col) = value;
+        }
+      }
+
+      // vnl's backward transform is not normalized
+      fft.bwd_transform(accumulatedSpectrum);
+
+      const unsigned int inputWidth = inputRegion.GetSize()[0];
+      const unsigned int inputHeight = inputRegion.GetSize()[1];
+      for(size_t pairId = runStarts[runId]; pairId < runStarts[runId + 1]; ++pairId)
+      {
+        ScoredNodeType& scoredNode = scoredNodes[tileNodePairs[pairId].second];
+        const itk::Index<2> corner = get(this->PropertyMap, scoredNode.second).GetCorner();
+        const unsigned int x = corner[0] - inputRegion.GetIndex()[0];
+        const unsigned int y = corner[1] - inputRegion.GetIndex()[1];
+
+        // The target patch does not fit at this corner
+        if(x + patchWidth > inputWidth || y + patchHeight > inputHeight)
+        {
+          continue;
+        }
+
+        double ssd = accumulatedSpectrum(y, x).real() * normalization + targetEnergy;
+        if(fullyValid)
+        {
+          ssd += BoxSum(tile.IntegralImage, inputWidth, x, y, patchWidth, patchHeight);
+        }
+        scoredNode.first = ssd / numberOfValidPixels;
+      }
+    });
+
+    double bestScore = std::numeric_limits<double>::infinity();
+    for(size_t scoredNodeId = 0; scoredNodeId < scoredNodes.size(); ++scoredNodeId)
+    {
+      bestScore = std::min(bestScore, scoredNodes[scoredNodeId].first);
+    }
+
+    // Extract the target pixels once for the exact re-scoring below
+    typedef std::vector<typename ImageType::PixelType> PixelVector;
+    PixelVector targetPixels(validOffsets->size());
+    for(OffsetVectorType::const_iterator offsetIterator = validOffsets->begin();
+        offsetIterator < validOffsets->end(); ++offsetIterator)
+    {
+      targetPixels[offsetIterator - validOffsets->begin()] =
+          image->GetPixel(queryPatch.GetCorner() + *offsetIterator);
+    }
+
+    // Re-score the patches that cannot be told apart from the best patch because of round-off in the FFTs
+    float d_best = std::numeric_limits<float>::infinity();
+    NodeType result = scoredNodes[0].second;
+    for(typename std::vector<ScoredNodeType>::const_iterator scoredNodeIterator = scoredNodes.begin();
+        scoredNodeIterator != scoredNodes.end(); ++scoredNodeIterator)
+    {
+      if(scoredNodeIterator->first > bestScore + this->RerankTolerance)
+      {
+        continue;
+      }
+
+      float d = this->PatchDistanceFunction(get(this->PropertyMap, scoredNodeIterator->second),
+                                            queryPatch, targetPixels);
+      if(d < d_best)
+      {
+        d_best = d;
+        result = scoredNodeIterator->second;
+      }
+    }
+
+    this->DebugIteration++;
+
+    return result;
+  }
+
+  /** Make sure the cache was computed for 'image' with input regions big enough for patches of size
+    * 'patchExtent'. It is cleared otherwise. */
+  template <typename TImage>
+  void PrepareCache(const TImage* const image, const unsigned int patchExtent)
+  {
+    const itk::Size<2> imageSize = image->GetLargestPossibleRegion().GetSize();
+    if(!this->Tiles.empty() && this->CachedImage == image && this->CachedImageSize == imageSize &&
+       patchExtent <= this->CachedPatchExtent)
+    {
+      return;
+    }
+
+    // Keep the previous query region, it is already invalidated (and the cache is empty anyway)
+    this->CachedImage = image;
+    this->CachedImageSize = imageSize;
+    this->CachedPatchExtent = std::max(patchExtent, this->CachedPatchExtent);
+    this->NumberOfTilesX = (imageSize[0] + this->TileSize - 1) / this->TileSize;
+    this->NumberOfTilesY = (imageSize[1] + this->TileSize - 1) / this->TileSize;
+    this->FFTSize = NextFFTSize(this->TileSize + this->CachedPatchExtent - 1);
+
+    this->Tiles.clear();
+    this->Tiles.resize(this->NumberOfTilesX * this->NumberOfTilesY);
+  }
+
+  /** The pixels that are read to score the patch corners of a tile: the corners of the tile and the
+    * patch extent - 1 pixels past them, cropped to the image. */
+  itk::ImageRegion<2> GetTileInputRegion(const unsigned int tileId) const
+  {
+    itk::Index<2> corner = {{static_cast<itk::IndexValueType>((tileId % this->NumberOfTilesX) * this->TileSize),
+                             static_cast<itk::IndexValueType>((tileId / this->NumberOfTilesX) * this->TileSize)}};
+    itk::Size<2> size;
+    size.Fill(this->TileSize + this->CachedPatchExtent - 1);
+
+    itk::ImageRegion<2> inputRegion(corner, size);
+    itk::ImageRegion<2> imageRegion(this->CachedImageSize);
+    inputRegion.Crop(imageRegion);
+    return inputRegion;
+  }
+
+  /** Compute the spectra and the integral image of a tile if they are out of date. The squared
+    * spectrum is only computed if 'needSquaredSpectrum' is set. */
+  template <typename TImage>
+  void UpdateTile(const TImage* const image, const unsigned int tileId, const bool needSquaredSpectrum,
+                  vnl_fft_2d<double>& fft)
+  {
+    TileCache& tile = this->Tiles[tileId];
+    if(tile.Valid && (tile.HasSquaredSpectrum || !needSquaredSpectrum))
+    {
+      return;
+    }
+
+    const itk::ImageRegion<2> inputRegion = this->GetTileInputRegion(tileId);
+    const unsigned int inputWidth = inputRegion.GetSize()[0];
+    const unsigned int inputHeight = inputRegion.GetSize()[1];
+    const unsigned int numberOfComponents = Helpers::length(image->GetPixel(inputRegion.GetIndex()));
+
+    typedef itk::ImageRegionConstIterator<TImage> IteratorType;
+
+    if(!tile.Valid)
+    {
+      tile.ChannelSpectra.resize(numberOfComponents);
+      for(unsigned int component = 0; component < numberOfComponents; ++component)
+      {
+        ComplexMatrixType& channelSpectrum = tile.ChannelSpectra[component];
+        channelSpectrum.set_size(this->FFTSize, this->FFTSize);
+        channelSpectrum.fill(ComplexType(0.0, 0.0));
+
+        IteratorType imageIterator(image, inputRegion);
+        for(unsigned int y = 0; y < inputHeight; ++y)
+        {
+          for(unsigned int x = 0; x < inputWidth; ++x)
+          {
+            channelSpectrum(y, x) = static_cast<double>(Helpers::index(imageIterator.Get(), component));
+            ++imageIterator;
+          }
+        }
+
+        fft.fwd_transform(channelSpectrum);
+      }
+
+      ComputeSquaredIntegralImage(image, inputRegion, numberOfComponents, tile.IntegralImage);
+
+      tile.Valid = true;
+      tile.HasSquaredSpectrum = false;
+    }
+
+    if(needSquaredSpectrum && !tile.HasSquaredSpectrum)
+    {
+      tile.SquaredSpectrum.set_size(this->FFTSize, this->FFTSize);
+      tile.SquaredSpectrum.fill(ComplexType(0.0, 0.0));
+
+      IteratorType imageIterator(image, inputRegion);
+      for(unsigned int y = 0; y < inputHeight; ++y)
+      {
+        for(unsigned int x = 0; x < inputWidth; ++x)
+        {
+          tile.SquaredSpectrum(y, x) = SquaredNorm(imageIterator.Get(), numberOfComponents);
+          ++imageIterator;
+        }
+      }
+
+      fft.fwd_transform(tile.SquaredSpectrum);
+      tile.HasSquaredSpectrum = true;
+    }
+  }
+
+  /** Compute an integral image with a one pixel border of zeros of the sum of the squared components
+    * of each pixel in 'region'. Entry (y * (width+1) + x) is the sum over all pixels of the region above
+    * and to the left of (x,y), relative to the corner of the region. */
+  template <typename TImage>
+  static void ComputeSquaredIntegralImage(const TImage* const image, const itk::ImageRegion<2>& region,
+                                          const unsigned int numberOfComponents,
+                                          std::vector<double>& integralImage)
+  {
+    const unsigned int width = region.GetSize()[0];
+    const unsigned int height = region.GetSize()[1];
+    const unsigned int integralWidth = width + 1;
+
+    integralImage.assign(integralWidth * (height + 1), 0.0);
+
+    itk::ImageRegionConstIterator<TImage> imageIterator(image, region);
+    for(unsigned int y = 0; y < height; ++y)
+    {
+      double rowSum = 0.0;
+      for(unsigned int x = 0; x < width; ++x)
+      {
+        rowSum += SquaredNorm(imageIterator.Get(), numberOfComponents);
+        integralImage[(y + 1) * integralWidth + (x + 1)] = integralImage[y * integralWidth + (x + 1)] + rowSum;
+        ++imageIterator;
+      }
+    }
+  }
+
+  /** Sum the box with corner (x,y) and size (boxWidth, boxHeight) from an integral image
+    * created by ComputeSquaredIntegralImage. */
+  static double BoxSum(const std::vector<double>& integralImage, const unsigned int width,
+                       const unsigned int x, const unsigned int y,
+                       const unsigned int boxWidth, const unsigned int boxHeight)
+  {
+    const unsigned int integralWidth = width + 1;
+    return integralImage[(y + boxHeight) * integralWidth + (x + boxWidth)]
+         - integralImage[y * integralWidth + (x + boxWidth)]
+         - integralImage[(y + boxHeight) * integralWidth + x]
+         + integralImage[y * integralWidth + x];
+  }
+
+  /** The smallest size >= 'size' that only has 2, 3 and 5 as prime factors (required by vnl_fft_2d). */
+  static unsigned int NextFFTSize(const unsigned int size)
+  {
+    for(unsigned int candidate = std::max(size, 1u); ; ++candidate)
+    {
+      unsigned int remainder = candidate;
+      const unsigned int factors[3] = {2, 3, 5};
+      for(unsigned int factorId = 0; factorId < 3; ++factorId)
+      {
+        while(remainder % factors[factorId] == 0)
+        {
+          remainder /= factors[factorId];
+        }
+      }
+
+      if(remainder == 1)
+      {
+        return candidate;
+      }
+    }
+  }
+
+  template <typename TPixel>
+  static double SquaredNorm(const TPixel& pixel, const unsigned int numberOfComponents)
+  {
+    double squaredNorm = 0.0;
+    for(unsigned int component = 0; component < numberOfComponents; ++component)
+    {
+      double value = static_cast<double>(Helpers::index(pixel, component));
+      squaredNorm += value * value;
+    }
+    return squaredNorm;
+  }
+};
+
+#endif
@@ -22,9 +22,16 @@
 // Submodules
 #include <Utilities/Debug/Debug.h>
 
+// Custom
+#include "Utilities/TaskPool.h"
+
 // STL
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <limits>
+#include <mutex>
+#include <vector>
 
 /**
    * This function template is similar to std::min_element but can be used when the comparison
@@ -42,9 +49,28 @@ struct LinearSearchBestProperty : public Debug
   PropertyMapType PropertyMap;
   PatchDistanceFunctionType PatchDistanceFunction;
 
+  /** If true, the result does not depend on the number of threads or on their timing (see SetDeterministic). */
+  bool Deterministic;
+
   LinearSearchBestProperty(PropertyMapType propertyMap,
                            PatchDistanceFunctionType patchDistanceFunction = PatchDistanceFunctionType()) :
-  PropertyMap(propertyMap), PatchDistanceFunction(patchDistanceFunction){}
+  PropertyMap(propertyMap), PatchDistanceFunction(patchDistanceFunction), Deterministic(false){}
+
+  /** In the default mode, when several elements tie for the smallest distance, the one that is returned
+    * is whichever a thread happened to record first. In deterministic mode the range is split into a fixed
+    * number of blocks, the best element of each block is found in parallel, and the block results are merged
+    * in block order. Ties are always broken in favor of the element that comes first in the range (for
+    * vertices(graph) this is the element with the smallest vertex index), so the result is the same for
+    * any number of threads. */
+  void SetDeterministic(const bool deterministic)
+  {
+    this->Deterministic = deterministic;
+  }
+
+  bool GetDeterministic() const
+  {
+    return this->Deterministic;
+  }
 
   /**
     * \param first Start of the range in which to search.
@@ -63,8 +89,27 @@ struct LinearSearchBestProperty : public Debug
       return *last;
     }
 
+    return (*this)(first, last, query, *last, std::numeric_limits<float>::infinity());
+  }
+
+  /**
+    * Search for an element that is better than 'initialResult', which is already known to have distance
+    * 'initialDistance' to the query (see CoherentSearchBest). 'initialDistance' is the initial early
+    * termination threshold, and 'initialResult' is returned if no element in the range is better.
+    */
+  template <typename TIterator>
+  typename TIterator::value_type operator()(TIterator first, TIterator last,
+                                            typename TIterator::value_type query,
+                                            typename TIterator::value_type initialResult,
+                                            const float initialDistance)
+  {
+    if(first == last)
+    {
+      return initialResult;
+    }
+
     // Initialize
-    float d_best = std::numeric_limits<float>::infinity();
+    float d_best = initialDistance;
 
     typedef typename PropertyMapType::value_type PatchType;
 
@@ -85,45 +130,125 @@ struct LinearSearchBestProperty : public Debug
           queryPatch.GetImage()->GetPixel(queryPatch.GetCorner() + currentOffset);
     }
 
-    // Extract the valid patches so this check does not have to be done inside the DistanceFunction call in the main loop below.
-    typedef std::vector<PatchType> PatchContainer;
-    typedef std::vector<typename TIterator::value_type> IteratorContainer;
-    IteratorContainer validSourceIterators;
+    // Iterate through all of the input elements. The descriptors are read in place (rather than first
+    // copying the valid source patches into a separate container) because the range is usually
+    // already restricted to the source patches (see SourcePatchBank).
+//    std::cout << "Start search..." << std::endl;
+    typename TIterator::value_type result = initialResult;
+
+    const long numberOfElements = last - first;
 
-    PatchContainer validSourcePatches;
-    for(TIterator current = first; current < last; ++current)
+    if(this->Deterministic)
     {
-      PatchType currentPatch = get(this->PropertyMap, *current);
-      if(currentPatch.GetStatus() == PatchType::SOURCE_NODE)
-      {
-        validSourceIterators.push_back(*current);
-        validSourcePatches.push_back(currentPatch);
-      }
+      return this->DeterministicSearch(first, numberOfElements, queryPatch, targetPixels,
+                                       initialResult, initialDistance);
     }
 
-    // Iterate through all of the input elements
-//    std::cout << "Start search..." << std::endl;
-    typename TIterator::value_type result = *last; // initialize to prevent "possibly used uninitialized" warning
+    // d_best and result are only changed while holding resultMutex. sharedBestDistance is a copy of d_best
+    // that the threads read without locking.
+    std::mutex resultMutex;
+    std::atomic<float> sharedBestDistance(d_best);
 
-    #pragma omp parallel for
-//    for(TIterator current = first; current != last; ++current) // OpenMP 3 doesn't allow != in a parallelized loop
-    for(typename PatchContainer::const_iterator current = validSourcePatches.begin();
-        current < validSourcePatches.end(); ++current)
+    TaskPool::GetGlobalInstance().ParallelFor(0, numberOfElements, [&](const long elementId)
     {
+      TIterator current = first + elementId;
+      const PatchType& currentPatch = get(this->PropertyMap, *current);
+      if(currentPatch.GetStatus() != PatchType::SOURCE_NODE)
+      {
+        return;
+      }
+
+      // Read the best distance found so far so that the difference computation can stop as soon
+      // as it is exceeded. A stale value is fine, it is only a looser threshold.
+      float threshold = sharedBestDistance.load(std::memory_order_relaxed);
+
       //DistanceValueType d = DistanceFunction(*first, query);
-      float d = this->PatchDistanceFunction(*current, queryPatch, targetPixels);
+      float d = this->PatchDistanceFunction(currentPatch, queryPatch, targetPixels, threshold);
 
-      #pragma omp critical // There are weird crashes without this guard
-      if(d < d_best)
+      // d_best can only have decreased since the threshold was read
+      if(d < threshold)
       {
-        d_best = d;
-        result = validSourceIterators[current - validSourcePatches.begin()];
+        std::lock_guard<std::mutex> lock(resultMutex);
+        if(d < d_best)
+        {
+          d_best = d;
+          result = *current;
+          sharedBestDistance.store(d, std::memory_order_relaxed);
+        }
       }
-    }
+    }, 64);
+
+    // DebugIteration is not incremented, so that concurrent searches (e.g. the batches of
+    // InpaintingAlgorithmSpeculativeParallel) do not write to the finder.
+
+    return result;
+  }
+
+private:
+  template <typename TIterator, typename PatchType, typename PixelVector>
+  typename TIterator::value_type DeterministicSearch(TIterator first, const long numberOfElements,
+                                                     const PatchType& queryPatch, const PixelVector& targetPixels,
+                                                     typename TIterator::value_type initialResult,
+                                                     const float initialDistance)
+  {
+    // The number of blocks does not depend on the number of threads, so neither do the block results.
+    const long maximumNumberOfBlocks = 64;
+    const long numberOfBlocks = std::min(numberOfElements, maximumNumberOfBlocks);
+
+    // The position in the range of the best element of each block (-1 if no element of the block
+    // is better than the initial distance), and its distance.
+    std::vector<long> blockBestElementIds(numberOfBlocks, -1);
+    std::vector<float> blockBestDistances(numberOfBlocks, initialDistance);
+
+    // Only used to stop the difference computations early, so it may be published by any block. The
+    // distance function must only stop an element that is strictly worse than the threshold
+    // (ImagePatchDifference keeps a margin above the rounded cutoff for this). Then an element that ties
+    // with a best element of a later block is still computed to the end and wins the merge below, no
+    // matter when the threads update this value.
+    std::atomic<float> sharedBestDistance(initialDistance);
 
-//    std::cout << "Iteration " << this->DebugIteration << " search complete." << std::endl;
+    TaskPool::GetGlobalInstance().ParallelFor(0, numberOfBlocks, [&](const long blockId)
+    {
+      const long blockBegin = numberOfElements * blockId / numberOfBlocks;
+      const long blockEnd = numberOfElements * (blockId + 1) / numberOfBlocks;
+
+      for(long elementId = blockBegin; elementId < blockEnd; ++elementId)
+      {
+        const PatchType& currentPatch = get(this->PropertyMap, *(first + elementId));
+        if(currentPatch.GetStatus() != PatchType::SOURCE_NODE)
+        {
+          continue;
+        }
+
+        float threshold = std::min(sharedBestDistance.load(std::memory_order_relaxed), blockBestDistances[blockId]);
+
+        float d = this->PatchDistanceFunction(currentPatch, queryPatch, targetPixels, threshold);
+
+        // Strictly better, so the first of the tied elements of the block is kept
+        if(d < blockBestDistances[blockId])
+        {
+          blockBestDistances[blockId] = d;
+          blockBestElementIds[blockId] = elementId;
 
-    this->DebugIteration++;
+          float sharedDistance = sharedBestDistance.load(std::memory_order_relaxed);
+          while(d < sharedDistance && !sharedBestDistance.compare_exchange_weak(sharedDistance, d))
+          {
+          }
+        }
+      }
+    });
+
+    // Merge the block results in block order, so a tie is won by the earlier block
+    typename TIterator::value_type result = initialResult;
+    float bestDistance = initialDistance;
+    for(long blockId = 0; blockId < numberOfBlocks; ++blockId)
+    {
+      if(blockBestElementIds[blockId] >= 0 && blockBestDistances[blockId] < bestDistance)
+      {
+        bestDistance = blockBestDistances[blockId];
+        result = *(first + blockBestElementIds[blockId]);
+      }
+    }
 
     return result;
   }
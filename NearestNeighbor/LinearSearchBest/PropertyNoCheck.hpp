@@ -16,15 +16,21 @@
  *
  *=========================================================================*/
 
-#ifndef LinearSearchBestProperty_HPP
-#define LinearSearchBestProperty_HPP
+#ifndef LinearSearchBestPropertyNoCheck_HPP
+#define LinearSearchBestPropertyNoCheck_HPP
 
 // Submodules
 #include <Utilities/Debug/Debug.h>
 
+// Custom
+#include "Utilities/TaskPool.h"
+
 // STL
+#include <atomic>
 #include <iostream>
 #include <limits>
+#include <mutex>
+#include <vector>
 
 /**
    * This function template is similar to std::min_element but can be used when the comparison
@@ -35,14 +41,17 @@
    * \tparam DistanceValueType The value-type for the distance measures.
    * \tparam DistanceFunctionType The functor type to compute the distance measure.
    * \tparam CompareFunctionType The functor type that can compare two distance measures (strict weak-ordering).
+   *
+   * Unlike LinearSearchBestProperty, the elements are not filtered by their status before the search, so the
+   * PatchDistanceFunction must reject patches that are not SOURCE_NODEs itself (ImagePatchDifference does).
    */
 template <typename PropertyMapType, typename PatchDistanceFunctionType>
-struct LinearSearchBestProperty : public Debug
+struct LinearSearchBestPropertyNoCheck : public Debug
 {
   PropertyMapType PropertyMap;
   PatchDistanceFunctionType PatchDistanceFunction;
 
-  LinearSearchBestProperty(PropertyMapType propertyMap,
+  LinearSearchBestPropertyNoCheck(PropertyMapType propertyMap,
                            PatchDistanceFunctionType patchDistanceFunction = PatchDistanceFunctionType()) :
   PropertyMap(propertyMap), PatchDistanceFunction(patchDistanceFunction){}
 
@@ -85,24 +94,37 @@ struct LinearSearchBestProperty : public Debug
     }
 
     // Iterate through all of the input elements
-    #pragma omp parallel for
-//    for(TIterator current = first; current != last; ++current)
-    for(TIterator current = first; current < last; ++current)
+    typename TIterator::value_type result = *last; // initialize to prevent "possibly used uninitialized" warning
+
+    const long numberOfElements = last - first;
+    std::mutex resultMutex;
+    std::atomic<float> sharedBestDistance(d_best);
+
+    TaskPool::GetGlobalInstance().ParallelFor(0, numberOfElements, [&](const long elementId)
     {
+      TIterator current = first + elementId;
+
+      // Read the best distance found so far so that the difference computation can stop as soon
+      // as it is exceeded. A stale value is fine, it is only a looser threshold.
+      float threshold = sharedBestDistance.load(std::memory_order_relaxed);
+
       //DistanceValueType d = DistanceFunction(*first, query);
-      float d = this->DistanceFunction(get(this->PropertyMap, *current), queryPatch, targetPixels);
+      float d = this->PatchDistanceFunction(get(this->PropertyMap, *current), queryPatch, targetPixels, threshold);
 
-      #pragma omp critical // There are weird crashes without this guard
-      if(d < d_best)
+      // d_best can only have decreased since the threshold was read
+      if(d < threshold)
       {
-        d_best = d;
-        result = current;
+        std::lock_guard<std::mutex> lock(resultMutex);
+        if(d < d_best)
+        {
+          d_best = d;
+          result = *current;
+          sharedBestDistance.store(d, std::memory_order_relaxed);
+        }
       }
-    }
-
-    std::cout << "Iteration " << this->DebugIteration << " search complete." << std::endl;
+    }, 64);
 
-    this->DebugIteration++;
+    // DebugIteration is not incremented, so that concurrent searches do not write to the finder.
 
     return result;
   }
@@ -0,0 +1,78 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// Custom
+#include "NearestNeighbor/Tests/SearchTestProblem.hpp"
+
+// Submodules
+#include <Helpers/Helpers.h>
+#include <ITKHelpers/ITKHelpers.h>
+
+// Nearest neighbors
+#include "NearestNeighbor/LinearSearchBest/FFTSSD.hpp"
+
+// STL
+#include <cstdlib>
+#include <iostream>
+
+int main()
+{
+  SearchTestProblem problem;
+
+  typedef SearchTestProblem::ImagePatchDescriptorMapType ImagePatchDescriptorMapType;
+  typedef SearchTestProblem::PatchDifferenceType PatchDifferenceType;
+
+  // Use small tiles so that the image is split into several of them
+  typedef LinearSearchBestFFTSSD<ImagePatchDescriptorMapType, PatchDifferenceType> FFTSearchBestType;
+  FFTSearchBestType fftSearchBest(*problem.ImagePatchDescriptorMap);
+  fftSearchBest.SetTileSize(16);
+
+  // A partially valid target patch on the hole boundary
+  itk::Index<2> boundaryTarget = {{25, 24}};
+  if(!problem.CompareToLinearSearch(fftSearchBest, boundaryTarget, "FFT", true))
+  {
+    std::cerr << "The FFT search did not match the linear search for a partially valid target patch!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // A fully valid target patch (this uses the integral image path)
+  itk::Index<2> validTarget = {{10, 10}};
+  if(!problem.CompareToLinearSearch(fftSearchBest, validTarget, "FFT", true))
+  {
+    std::cerr << "The FFT search did not match the linear search for a fully valid target patch!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Copy the boundary target patch to a source region. After the change is reported, the cached
+  // spectra of that region must be recomputed so that the copy is found.
+  SearchTestProblem::ImagePatchPixelDescriptorType boundaryPatch = get(*problem.ImagePatchDescriptorMap,
+      Helpers::ConvertFrom<SearchTestProblem::VertexDescriptorType, itk::Index<2> >(boundaryTarget));
+  itk::Index<2> copyCorner = {{40, 5}};
+  itk::ImageRegion<2> copyRegion(copyCorner, boundaryPatch.GetRegion().GetSize());
+  ITKHelpers::CopyRegion(problem.Image.GetPointer(), problem.Image.GetPointer(), boundaryPatch.GetRegion(),
+                         copyRegion);
+  fftSearchBest.InvalidateRegion(copyRegion);
+
+  if(!problem.CompareToLinearSearch(fftSearchBest, boundaryTarget, "FFT", true))
+  {
+    std::cerr << "The FFT search did not match the linear search after the image was modified!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
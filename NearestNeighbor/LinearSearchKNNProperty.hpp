@@ -22,6 +22,8 @@
 // STL
 #include <limits> // for infinity()
 #include <algorithm> // for lower_bound()
+#include <mutex>
+#include <vector>
 
 // Boost
 #include <boost/utility.hpp> // for enable_if()
@@ -29,6 +31,8 @@
 
 // Custom
 #include "Utilities/Utilities.hpp"
+#include "Utilities/TaskPool.h"
+#include "NearestNeighbor/BoundedMaxHeap.hpp"
 
 /**
   * This class searches a container for the K nearest neighbors of a query item.
@@ -46,14 +50,29 @@ class LinearSearchKNNProperty
   std::shared_ptr<PropertyMapType> PropertyMap;
   unsigned int K;
   DistanceFunctionType DistanceFunction;
+  bool Deterministic;
 
 public:
   LinearSearchKNNProperty(std::shared_ptr<PropertyMapType> propertyMap, const unsigned int k = 1000,
                           DistanceFunctionType distanceFunction = DistanceFunctionType()) :
-    PropertyMap(propertyMap), K(k), DistanceFunction(distanceFunction)
+    PropertyMap(propertyMap), K(k), DistanceFunction(distanceFunction), Deterministic(false)
   {
   }
 
+  /** In deterministic mode the range is split into a fixed number of blocks (independent of the number of
+    * threads), each block keeps its own K best items, and the blocks are merged in block order. Items with
+    * the same distance are ordered by their position in the range (for vertices(graph) this is the vertex
+    * index), so the output is the same for any number of threads. */
+  void SetDeterministic(const bool deterministic)
+  {
+    this->Deterministic = deterministic;
+  }
+
+  bool GetDeterministic() const
+  {
+    return this->Deterministic;
+  }
+
   std::shared_ptr<PropertyMapType> GetPropertyMap() const
   {
     return this->PropertyMap;
@@ -94,16 +113,9 @@ public:
       return outputFirst;
     }
 
-    // Create a type to associate a distance with its iterator
-    typedef std::pair<DistanceValueType, TIterator> PairType;
-
-    // Use a priority queue to keep the items (pairs of distances and their corresponding iterators) sorted
-    typedef std::priority_queue< PairType,
-        std::vector<PairType>,
-        compare_pair_first<DistanceValueType, TIterator,
-        std::greater<DistanceValueType> > > PriorityQueueType;
-
-    PriorityQueueType outputQueue;
+    // The K best items of all of the blocks
+    typedef BoundedMaxHeap<DistanceValueType, TIterator> HeapType;
+    HeapType outputHeap(this->K, this->Deterministic);
 
     // Get the query object
     typename PropertyMapType::value_type queryPatch = get(*(this->PropertyMap), queryNode);
@@ -125,67 +137,67 @@ public:
       targetPixels[offsetIterator - validOffsets->begin()] = queryPatch.GetImage()->GetPixel(queryPatch.GetCorner() + currentOffset);
     }
 
-    // The queue stores the items in descending score order.
-    #pragma omp parallel for
-//    for(ForwardIteratorType current = first; current != last; ++current) // OpenMP 3 doesn't allow != in the loop ending condition
-    for(TIterator current = first; current < last; ++current)
+    // Split the range into blocks that each keep their own K best items. In deterministic mode the number
+    // of blocks does not depend on the number of threads and the blocks are merged in block order,
+    // otherwise there is one block per thread and they are merged as they finish.
+    const long numberOfElements = last - first;
+    const long maximumNumberOfBlocks =
+        this->Deterministic ? 64 : static_cast<long>(TaskPool::GetGlobalInstance().GetNumberOfThreads());
+    const long numberOfBlocks = std::min(numberOfElements, maximumNumberOfBlocks);
+    std::vector<HeapType> blockHeaps(numberOfBlocks, HeapType(this->K, this->Deterministic));
+    std::mutex outputHeapMutex;
+
+    TaskPool::GetGlobalInstance().ParallelFor(0, numberOfBlocks, [&](const long blockId)
     {
-      typename PropertyMapType::value_type currentPatch = get(*(this->PropertyMap), *current);
-      // Argument order is (source, target) ("query node" is the same as "target node")
-      DistanceValueType d = this->DistanceFunction(currentPatch, queryPatch, targetPixels);
-
-      #pragma omp critical // There are weird crashes without this guard (concurrent access?)
-      outputQueue.push(PairType(d, current));
+      HeapType& blockHeap = blockHeaps[blockId];
+      TIterator blockEnd = first + numberOfElements * (blockId + 1) / numberOfBlocks;
+      for(TIterator current = first + numberOfElements * blockId / numberOfBlocks; current < blockEnd; ++current)
+      {
+        typename PropertyMapType::value_type currentPatch = get(*(this->PropertyMap), *current);
+        // Argument order is (source, target) ("query node" is the same as "target node")
+        // Candidates that are worse than this block's K-th best item cannot be in the output, so
+        // the difference computation can stop as soon as it is exceeded (the distance function only
+        // stops items that are strictly worse, so an item that ties with the K-th best is kept).
+        DistanceValueType d = this->DistanceFunction(currentPatch, queryPatch, targetPixels,
+                                                     blockHeap.GetWorstDistance());
+        blockHeap.Push(d, current);
+      }
+
+      if(!this->Deterministic)
+      {
+        std::lock_guard<std::mutex> lock(outputHeapMutex);
+        outputHeap.Merge(blockHeap);
+      }
+    });
+
+    if(this->Deterministic)
+    {
+      for(long blockId = 0; blockId < numberOfBlocks; ++blockId)
+      {
+        outputHeap.Merge(blockHeaps[blockId]);
+      }
     }
 
-//    std::cout << "There are " << outputQueue.size() << " items in the queue." << std::endl;
-
-    // Keep only the best K matches
-    Helpers::KeepTopN(outputQueue, this->K);
-
-//    std::cout << "There are " << outputQueue.size() << " items in the queue." << std::endl;
-
-    // Check if any of the top K matches are infinity (indicating they were invalid for some reason)
-//    {
-//      auto hasInvalidValue = [] (PriorityQueueType q)
-//      {
-//        while(!q.empty())
-//        {
-//          if(q.top().first == std::numeric_limits<float>::infinity() ||
-//             q.top().first == std::numeric_limits<float>::max())
-//          {
-//            return true;
-//          }
-//          q.pop();
-//        }
-
-//        return false;
-//      };
-
-//      assert(!hasInvalidValue(outputQueue));
-//      if(hasInvalidValue(outputQueue))
-//      {
-//        std::stringstream ss;
-//        ss << "LinearSearchKNNProperty::operator(): One of the matches had an invalid score!";
-//        throw std::runtime_error(ss.str());
-//      }
-//    }
-
-    if(outputQueue.size() < this->K)
+//    std::cout << "There are " << outputHeap.size() << " items in the queue." << std::endl;
+
+    if(outputHeap.size() < this->K)
     {
       std::stringstream ss;
-      ss << "Requested " << this->K << " items but only found " << outputQueue.size();
+      ss << "Requested " << this->K << " items but only found " << outputHeap.size();
       throw std::runtime_error(ss.str());
     }
 
-//    std::cout << "Best patch score is: " << outputQueue.top().first << std::endl;
+//    std::cout << "Best patch score is: " << outputHeap.GetSortedItems()[0].first << std::endl;
+
+    // Copy the best matches into the output (best first)
+    typedef typename HeapType::PairType PairType;
+    std::vector<PairType> sortedItems = outputHeap.GetSortedItems();
 
-    // Copy the best matches from the queue into the output
     TOutputIterator currentOutputIterator = outputFirst;
-    while( !outputQueue.empty() )
+    for(typename std::vector<PairType>::const_iterator sortedIterator = sortedItems.begin();
+        sortedIterator != sortedItems.end(); ++sortedIterator)
     {
-      *currentOutputIterator = *(outputQueue.top().second);
-      outputQueue.pop();
+      *currentOutputIterator = *(sortedIterator->second);
       ++currentOutputIterator;
     }
 
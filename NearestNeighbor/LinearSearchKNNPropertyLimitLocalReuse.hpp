@@ -22,6 +22,7 @@
 // STL
 #include <algorithm> // for lower_bound()
 #include <limits> // for infinity()
+#include <mutex>
 #include <set>
 
 // Boost
@@ -30,6 +31,8 @@
 
 // Custom
 #include "Utilities/Utilities.hpp"
+#include "Utilities/TaskPool.h"
+#include "NearestNeighbor/BoundedMaxHeap.hpp"
 
 // Submodules
 #include <Mask/Mask.h>
@@ -151,11 +154,8 @@ public:
       ITKHelpers::WriteIndexImage(this->SourcePixelMapImage, Helpers::GetSequentialFileName("SourcePixelMap", this->Iteration, "mha", 3));
     }
 
-    // Use a priority queue to keep the items sorted
-    typedef std::pair<DistanceValueType, TForwardIterator> PairType;
-    typedef compare_pair_first<DistanceValueType, TForwardIterator, std::greater<DistanceValueType> > CompareType;
-    typedef std::priority_queue< PairType, std::vector<PairType>,
-        CompareType> PriorityQueueType;
+    // Keep the K best items
+    typedef BoundedMaxHeap<DistanceValueType, TForwardIterator> HeapType;
 
     typedef typename TPatchDescriptorPropertyMap::value_type DescriptorType;
     DescriptorType queryDescriptor = get(this->PatchDescriptorPropertyMap, queryNode);
@@ -190,40 +190,36 @@ public:
     unsigned int numberOfHolePixels = this->MaskImage->CountHolePixels(queryRegion);
     unsigned int maxAllowedUsedPixels = this->MaxAllowedUsedPixelsRatio * numberOfHolePixels;
 
-    PriorityQueueType outputQueue;
-    while(outputQueue.size() == 0)
+    HeapType outputHeap(this->K);
+    while(outputHeap.empty())
     {
-      outputQueue = FindUsablePatches<PriorityQueueType, TForwardIterator, DescriptorType>(first, last, usedIndices, maxAllowedUsedPixels, queryDescriptor);
+      outputHeap = FindUsablePatches<HeapType, TForwardIterator, DescriptorType>(first, last, usedIndices, maxAllowedUsedPixels, queryDescriptor);
       maxAllowedUsedPixels += 10;
     }
 
-//    std::cout << "There are " << outputQueue.size() << " items in the queue." << std::endl;
+//    std::cout << "There are " << outputHeap.size() << " items in the heap." << std::endl;
 
-    // Keep only the best K matches
-    if(outputQueue.size() < this->K)
+    if(outputHeap.size() < this->K)
     {
-      std::cerr << "Warning: LinearSearchKNNPropertyLimitLocalReuse only has " << outputQueue.size()
+      std::cerr << "Warning: LinearSearchKNNPropertyLimitLocalReuse only has " << outputHeap.size()
                 << " nodes. (" << this->K << " were requested.)" << std::endl;
-    }
-    Helpers::KeepTopN(outputQueue, this->K);
-
-//    std::cout << "There are " << outputQueue.size() << " items in the queue." << std::endl;
 
-    if(outputQueue.size() < this->K)
-    {
       std::stringstream ss;
-      ss << "LinearSearchKNNPropertyLimitLocalReuse: Requested " << this->K << " items but only found " << outputQueue.size();
+      ss << "LinearSearchKNNPropertyLimitLocalReuse: Requested " << this->K << " items but only found " << outputHeap.size();
       throw std::runtime_error(ss.str());
     }
 
-    std::cout << "Best patch score is: " << outputQueue.top().first << std::endl;
+    // Copy the best matches into the output (best first)
+    typedef typename HeapType::PairType PairType;
+    std::vector<PairType> sortedItems = outputHeap.GetSortedItems();
+
+    std::cout << "Best patch score is: " << sortedItems[0].first << std::endl;
 
-    // Copy the best matches from the queue into the output
     TOutputIterator currentOutputIterator = outputFirst;
-    while( !outputQueue.empty() )
+    for(typename std::vector<PairType>::const_iterator sortedIterator = sortedItems.begin();
+        sortedIterator != sortedItems.end(); ++sortedIterator)
     {
-      *currentOutputIterator = *(outputQueue.top().second);
-      outputQueue.pop();
+      *currentOutputIterator = *(sortedIterator->second);
       ++currentOutputIterator;
     }
 
@@ -268,85 +264,98 @@ public:
     return result;
   }
 
-  template <typename TPriorityQueue, typename TForwardIterator, typename TDescriptor>
-  TPriorityQueue FindUsablePatches(TForwardIterator first, TForwardIterator last,
-                                   UsedIndexSetType usedIndices, unsigned int maxAllowedUsedPixels, TDescriptor& queryDescriptor)
+  /** Find the K best patches that have at most 'maxAllowedUsedPixels' pixels that were already used.
+    * Each block of the range keeps its own heap of the K best patches, and they are merged at the end. */
+  template <typename THeap, typename TForwardIterator, typename TDescriptor>
+  THeap FindUsablePatches(TForwardIterator first, TForwardIterator last,
+                          UsedIndexSetType usedIndices, unsigned int maxAllowedUsedPixels, TDescriptor& queryDescriptor)
   {
-    TPriorityQueue outputQueue;
+    THeap outputHeap(this->K);
 
     typedef typename TForwardIterator::value_type NodeType;
 
-    // The queue stores the items in descending score order.
-    #pragma omp parallel for
-//    for(ForwardIteratorType current = first; current != last; ++current) // OpenMP 3 doesn't allow != in the loop ending condition
-    for(TForwardIterator currentIterator = first; currentIterator < last; ++currentIterator)
+    // Split the range into one block per thread, each block keeps its own K best items
+    const long numberOfElements = last - first;
+    const long numberOfBlocks =
+        std::min(numberOfElements, static_cast<long>(TaskPool::GetGlobalInstance().GetNumberOfThreads()));
+    std::mutex outputHeapMutex;
+
+    TaskPool::GetGlobalInstance().ParallelFor(0, numberOfBlocks, [&](const long blockId)
     {
-      NodeType currentNode = *currentIterator;
+      THeap blockHeap(this->K);
 
-      itk::ImageRegion<2> queryRegion = queryDescriptor.GetRegion();
+      TForwardIterator blockEnd = first + numberOfElements * (blockId + 1) / numberOfBlocks;
+      for(TForwardIterator currentIterator = first + numberOfElements * blockId / numberOfBlocks;
+          currentIterator < blockEnd; ++currentIterator)
+      {
+        NodeType currentNode = *currentIterator;
 
-      typename TPatchDescriptorPropertyMap::value_type currentDescriptor = get(this->PatchDescriptorPropertyMap, currentNode);
+        itk::ImageRegion<2> queryRegion = queryDescriptor.GetRegion();
 
-      if(currentDescriptor.GetStatus() != PixelDescriptor::SOURCE_NODE)
-      {
-        throw std::runtime_error("LinearSearchKNNPropertyLimitLocalReuse: Node is not a source node!");
-      }
+        typename TPatchDescriptorPropertyMap::value_type currentDescriptor = get(this->PatchDescriptorPropertyMap, currentNode);
 
-      itk::ImageRegion<2> potentialSourceRegion = currentDescriptor.GetRegion();
+        if(currentDescriptor.GetStatus() != PixelDescriptor::SOURCE_NODE)
+        {
+          throw std::runtime_error("LinearSearchKNNPropertyLimitLocalReuse: Node is not a source node!");
+        }
 
-      potentialSourceRegion.Crop(this->FullRegion);
+        itk::ImageRegion<2> potentialSourceRegion = currentDescriptor.GetRegion();
 
-      if(!this->MaskImage->IsValid(potentialSourceRegion))
-      {
-        throw std::runtime_error("LinearSearchKNNPropertyLimitLocalReuse: potentialSourceRegion is not fully valid!");
-      }
+        potentialSourceRegion.Crop(this->FullRegion);
+
+        if(!this->MaskImage->IsValid(potentialSourceRegion))
+        {
+          throw std::runtime_error("LinearSearchKNNPropertyLimitLocalReuse: potentialSourceRegion is not fully valid!");
+        }
 
-      // Count the number of pixels that were already copied from this patch
-      unsigned int usedPixelCounter = 0;
+        // Count the number of pixels that were already copied from this patch
+        unsigned int usedPixelCounter = 0;
 
-      itk::ImageRegionConstIteratorWithIndex<SourcePixelMapImageType>
-          sourceRegionIterator(this->SourcePixelMapImage, potentialSourceRegion);
+        itk::ImageRegionConstIteratorWithIndex<SourcePixelMapImageType>
+            sourceRegionIterator(this->SourcePixelMapImage, potentialSourceRegion);
 
-      // The image that this is iterating over is irrelevant, we just need the indices.
-      itk::ImageRegionConstIteratorWithIndex<SourcePixelMapImageType>
-          queryRegionIterator(this->SourcePixelMapImage, queryRegion);
+        // The image that this is iterating over is irrelevant, we just need the indices.
+        itk::ImageRegionConstIteratorWithIndex<SourcePixelMapImageType>
+            queryRegionIterator(this->SourcePixelMapImage, queryRegion);
 
-      while(!sourceRegionIterator.IsAtEnd())
-      {
-        UsedIndexSetType::iterator usedIndexSetIterator;
-        if(this->MaskImage->IsHole(queryRegionIterator.GetIndex()))
+        while(!sourceRegionIterator.IsAtEnd())
         {
-          // We want to use the index value in the SourcePixelMapImage,
-          // because the value might not equal the current index in the case where new patches are allowed.
-          usedIndexSetIterator = usedIndices.find(sourceRegionIterator.Get());
-
-          if(usedIndexSetIterator != usedIndices.end()) // found
+          UsedIndexSetType::iterator usedIndexSetIterator;
+          if(this->MaskImage->IsHole(queryRegionIterator.GetIndex()))
           {
-            usedPixelCounter++;
+            // We want to use the index value in the SourcePixelMapImage,
+            // because the value might not equal the current index in the case where new patches are allowed.
+            usedIndexSetIterator = usedIndices.find(sourceRegionIterator.Get());
+
+            if(usedIndexSetIterator != usedIndices.end()) // found
+            {
+              usedPixelCounter++;
+            }
           }
+
+          ++sourceRegionIterator;
+          ++queryRegionIterator;
         }
 
-        ++sourceRegionIterator;
-        ++queryRegionIterator;
-      }
+        if(usedPixelCounter <= maxAllowedUsedPixels)
+        {
+          DistanceValueType d = this->PatchDistanceFunction(currentDescriptor, queryDescriptor); // (source, target) (the query node is the target node)
 
-      typedef std::pair<DistanceValueType, TForwardIterator> PairType;
-      if(usedPixelCounter <= maxAllowedUsedPixels)
-      {
-        DistanceValueType d = this->PatchDistanceFunction(currentDescriptor, queryDescriptor); // (source, target) (the query node is the target node)
+          blockHeap.Push(d, currentIterator);
+        }
+        else
+        {
+//          std::cout << "Prevented use because " << usedPixelCounter
+//                    << " pixels were already used (out of " << numberOfHolePixels
+//                    << " hole pixels)." << std::endl;
+        }
+      } // end loop over all patches
 
-        #pragma omp critical // There are weird crashes without this guard
-        outputQueue.push(PairType(d, currentIterator));
-      }
-      else
-      {
-//        std::cout << "Prevented use because " << usedPixelCounter
-//                  << " pixels were already used (out of " << numberOfHolePixels
-//                  << " hole pixels)." << std::endl;
-      }
-    } // end loop over all patches
+      std::lock_guard<std::mutex> lock(outputHeapMutex);
+      outputHeap.Merge(blockHeap);
+    });
 
-    return outputQueue;
+    return outputHeap;
   }
 
 };
@@ -22,6 +22,7 @@
 // STL
 #include <algorithm> // for lower_bound()
 #include <limits> // for infinity()
+#include <mutex>
 #include <set>
 
 // Boost
@@ -30,6 +31,8 @@
 
 // Custom
 #include "Utilities/Utilities.hpp"
+#include "Utilities/TaskPool.h"
+#include "NearestNeighbor/BoundedMaxHeap.hpp"
 
 // Submodules
 #include <Mask/Mask.h>
@@ -111,13 +114,9 @@ public:
       return outputFirst;
     }
 
-    // Use a priority queue to keep the items sorted
-    typedef std::pair<DistanceValueType, ForwardIteratorType> PairType;
-    typedef compare_pair_first<DistanceValueType, ForwardIteratorType, std::greater<DistanceValueType> > CompareType;
-    typedef std::priority_queue< PairType, std::vector<PairType>,
-        CompareType> PriorityQueueType;
-
-    PriorityQueueType outputQueue;
+    // The K best items of each block are merged into this heap
+    typedef BoundedMaxHeap<DistanceValueType, ForwardIteratorType> HeapType;
+    HeapType outputHeap(this->K);
 
     typename PropertyMapType::value_type queryPatch = get(this->PropertyMap, queryNode);
 
@@ -130,74 +129,87 @@ public:
         ITKHelpers::GetRegionInRadiusAroundPixel(queryIndex,
                                                  get(this->PropertyMap, queryNode).GetRegion().GetSize()[0]/2);
 
-    // The queue stores the items in descending score order.
-    #pragma omp parallel for
-//    for(ForwardIteratorType current = first; current != last; ++current) // OpenMP 3 doesn't allow != in the loop ending condition
-    for(ForwardIteratorType currentIterator = first; currentIterator < last; ++currentIterator)
+    // Split the range into one block per thread, each block keeps its own K best items
+    const long numberOfElements = last - first;
+    const long numberOfBlocks =
+        std::min(numberOfElements, static_cast<long>(TaskPool::GetGlobalInstance().GetNumberOfThreads()));
+    std::mutex outputHeapMutex;
+
+    TaskPool::GetGlobalInstance().ParallelFor(0, numberOfBlocks, [&](const long blockId)
     {
-      NodeType currentNode = *currentIterator;
-
-      itk::Index<2> currentIndex = Helpers::ConvertFrom<itk::Index<2>, NodeType>(currentNode);
-
-      itk::ImageRegion<2> potentialSourceRegion =
-          ITKHelpers::GetRegionInRadiusAroundPixel(currentIndex,
-                                                   get(this->PropertyMap, currentNode).GetRegion().GetSize()[0]/2);
-      potentialSourceRegion.Crop(this->CopiedPixelsImage->GetLargestPossibleRegion());
-      // Count the number of pixels that were already copied fromt this patch
-      itk::ImageRegionConstIteratorWithIndex<CopiedPixelsImageType> copiedPixelIterator(this->CopiedPixelsImage,
-                                                                                        potentialSourceRegion);
-      unsigned int usedPixelCounter = 0;
-      while(!copiedPixelIterator.IsAtEnd())
+      HeapType blockHeap(this->K);
+
+      ForwardIteratorType blockEnd = first + numberOfElements * (blockId + 1) / numberOfBlocks;
+      for(ForwardIteratorType currentIterator = first + numberOfElements * blockId / numberOfBlocks;
+          currentIterator < blockEnd; ++currentIterator)
       {
-        if(copiedPixelIterator.Get() == true)
+        NodeType currentNode = *currentIterator;
+
+        itk::Index<2> currentIndex = Helpers::ConvertFrom<itk::Index<2>, NodeType>(currentNode);
+
+        itk::ImageRegion<2> potentialSourceRegion =
+            ITKHelpers::GetRegionInRadiusAroundPixel(currentIndex,
+                                                     get(this->PropertyMap, currentNode).GetRegion().GetSize()[0]/2);
+        potentialSourceRegion.Crop(this->CopiedPixelsImage->GetLargestPossibleRegion());
+        // Count the number of pixels that were already copied fromt this patch
+        itk::ImageRegionConstIteratorWithIndex<CopiedPixelsImageType> copiedPixelIterator(this->CopiedPixelsImage,
+                                                                                          potentialSourceRegion);
+        unsigned int usedPixelCounter = 0;
+        while(!copiedPixelIterator.IsAtEnd())
         {
-          usedPixelCounter++;
-        }
+          if(copiedPixelIterator.Get() == true)
+          {
+            usedPixelCounter++;
+          }
 
-        ++copiedPixelIterator;
-      }
+          ++copiedPixelIterator;
+        }
 
-//      unsigned int maxUsedPixels = potentialSourceRegion.GetNumberOfPixels() / 4;
-      unsigned int numberOfHolePixels = this->MaskImage->CountHolePixels(queryRegion);
-      unsigned int maxAllowedUsedPixels = numberOfHolePixels / 2; // Arbitrary - only allow half of the hole pixels to have been used
+//        unsigned int maxUsedPixels = potentialSourceRegion.GetNumberOfPixels() / 4;
+        unsigned int numberOfHolePixels = this->MaskImage->CountHolePixels(queryRegion);
+        unsigned int maxAllowedUsedPixels = numberOfHolePixels / 2; // Arbitrary - only allow half of the hole pixels to have been used
 
-      if(usedPixelCounter < maxAllowedUsedPixels)
-      {
-        DistanceValueType d = this->PatchDistanceFunction(get(this->PropertyMap, currentNode), queryPatch); // (source, target) (the query node is the target node)
+        if(usedPixelCounter < maxAllowedUsedPixels)
+        {
+          DistanceValueType d = this->PatchDistanceFunction(get(this->PropertyMap, currentNode), queryPatch); // (source, target) (the query node is the target node)
 
-        #pragma omp critical // There are weird crashes without this guard
-        outputQueue.push(PairType(d, currentIterator));
-      }
-      else
-      {
-//        std::cout << "Prevented use because " << usedPixelCounter
-//                  << " pixels were already used (out of " << numberOfHolePixels
-//                  << " hole pixels)." << std::endl;
+          blockHeap.Push(d, currentIterator);
+        }
+        else
+        {
+//          std::cout << "Prevented use because " << usedPixelCounter
+//                    << " pixels were already used (out of " << numberOfHolePixels
+//                    << " hole pixels)." << std::endl;
+        }
       }
-    }
 
-//    std::cout << "There are " << outputQueue.size() << " items in the queue." << std::endl;
+      std::lock_guard<std::mutex> lock(outputHeapMutex);
+      outputHeap.Merge(blockHeap);
+    });
 
-    // Keep only the best K matches
-    Helpers::KeepTopN(outputQueue, this->K);
+//    std::cout << "There are " << outputHeap.size() << " items in the heap." << std::endl;
 
-//    std::cout << "There are " << outputQueue.size() << " items in the queue." << std::endl;
-
-    if(outputQueue.size() < this->K)
+    if(outputHeap.size() < this->K)
     {
       std::stringstream ss;
-      ss << "Requested " << this->K << " items but only found " << outputQueue.size();
+      ss << "Requested " << this->K << " items but only found " << outputHeap.size();
       throw std::runtime_error(ss.str());
     }
 
-    std::cout << "Best patch score is: " << outputQueue.top().first << std::endl;
+    // Copy the best matches into the output (best first)
+    typedef typename HeapType::PairType PairType;
+    std::vector<PairType> sortedItems = outputHeap.GetSortedItems();
+
+    if(!sortedItems.empty())
+    {
+      std::cout << "Best patch score is: " << sortedItems[0].first << std::endl;
+    }
 
-    // Copy the best matches from the queue into the output
     OutputIteratorType currentOutputIterator = outputFirst;
-    while( !outputQueue.empty() )
+    for(typename std::vector<PairType>::const_iterator sortedIterator = sortedItems.begin();
+        sortedIterator != sortedItems.end(); ++sortedIterator)
     {
-      *currentOutputIterator = *(outputQueue.top().second);
-      outputQueue.pop();
+      *currentOutputIterator = *(sortedIterator->second);
       ++currentOutputIterator;
     }
 
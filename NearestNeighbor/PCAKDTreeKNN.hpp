@@ -0,0 +1,761 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef PCAKDTreeKNN_HPP
+#define PCAKDTreeKNN_HPP
+
+// Submodules
+#include <Helpers/Helpers.h>
+#include <ITKHelpers/ITKContainerInterface.h>
+
+// ITK
+#include "itkImageRegionConstIterator.h"
+
+// VNL
+#include <vnl/vnl_matrix.h>
+#include <vnl/vnl_vector.h>
+#include <vnl/algo/vnl_cholesky.h>
+#include <vnl/algo/vnl_symmetric_eigensystem.h>
+
+// Boost
+#include <boost/property_map/property_map.hpp>
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Custom
+#include "NearestNeighbor/BoundedMaxHeap.hpp"
+#include "Utilities/TaskPool.h"
+
+/**
+  * This class finds K good neighbors of a query patch much faster than LinearSearchKNNProperty, so it can be
+  * used as the first step of TwoStepNearestNeighbor.
+  *
+  * The source patches are reduced to their coordinates in the top principal components of the patch vectors.
+  * The components are computed once, from a random sample of the source patches, with a subspace (block power)
+  * iteration, so the full covariance matrix is never formed. The reduced patches are stored in a kd-tree.
+  *
+  * The query patch is projected with only its valid pixels. This is a least squares fit of the components to
+  * the valid pixels, with a small ridge term that grows with the fraction of invalid pixels. A best-bin-first
+  * search of the kd-tree then finds NumberOfCandidates approximate neighbors (visiting at most
+  * MaximumNumberOfChecks points). The candidates are re-ranked with the exact DistanceFunction (e.g.
+  * ImagePatchDifference), and the best K are output best first.
+  *
+  * The index is built when the range passed to operator() changes. If the range only grew at its end (like a
+  * SourcePatchBank), the new patches are projected with the existing components and compared linearly until
+  * they make up a quarter of the index, at which point it is rebuilt.
+  * \tparam PropertyMapType The type of the property map containing the patch descriptors.
+  * \tparam DistanceFunctionType The functor type to compute the exact distance for the re-ranking.
+  */
+template <typename PropertyMapType,
+          typename DistanceFunctionType>
+class PCAKDTreeKNN
+{
+  typedef float DistanceValueType;
+
+  typedef typename boost::property_traits<PropertyMapType>::key_type NodeType;
+  typedef typename PropertyMapType::value_type PatchType;
+
+  std::shared_ptr<PropertyMapType> PropertyMap;
+  unsigned int K;
+  DistanceFunctionType DistanceFunction;
+
+public:
+  PCAKDTreeKNN(std::shared_ptr<PropertyMapType> propertyMap, const unsigned int k = 1000,
+               DistanceFunctionType distanceFunction = DistanceFunctionType()) :
+    PropertyMap(propertyMap), K(k), DistanceFunction(distanceFunction)
+  {
+  }
+
+  std::shared_ptr<PropertyMapType> GetPropertyMap() const
+  {
+    return this->PropertyMap;
+  }
+
+  /** Set the number of nearest neighbors to return. */
+  void SetK(const unsigned int k)
+  {
+    this->K = k;
+  }
+
+  /** Get the number of nearest neighbors to return. */
+  unsigned int GetK() const
+  {
+    return this->K;
+  }
+
+  /** Set the number of principal components to keep. This takes effect at the next build. */
+  void SetNumberOfPrincipalComponents(const unsigned int numberOfPrincipalComponents)
+  {
+    if(numberOfPrincipalComponents == 0)
+    {
+      throw std::runtime_error("PCAKDTreeKNN::SetNumberOfPrincipalComponents: at least one component is needed!");
+    }
+    this->NumberOfPrincipalComponents = numberOfPrincipalComponents;
+  }
+
+  /** Set the number of source patches that the principal components are computed from. */
+  void SetNumberOfSamples(const unsigned int numberOfSamples)
+  {
+    this->NumberOfSamples = numberOfSamples;
+  }
+
+  /** Set the number of candidates from the kd-tree that are re-ranked. 0 means 4*K. */
+  void SetNumberOfCandidates(const unsigned int numberOfCandidates)
+  {
+    this->NumberOfCandidates = numberOfCandidates;
+  }
+
+  /** Set the maximum number of points visited by the kd-tree search. 0 means 8 times the number of candidates. */
+  void SetMaximumNumberOfChecks(const unsigned int maximumNumberOfChecks)
+  {
+    this->MaximumNumberOfChecks = maximumNumberOfChecks;
+  }
+
+  void SetSeed(const unsigned int seed)
+  {
+    this->Seed = seed;
+  }
+
+  /** Get the number of source patches in the index. */
+  size_t GetNumberOfPoints() const
+  {
+    return this->Points.size();
+  }
+
+  /** Compute the principal components of the SOURCE_NODEs in [first, last) and build the kd-tree. */
+  template <typename TIterator>
+  void Build(TIterator first, TIterator last)
+  {
+    this->Points.clear();
+    this->ProjectedPoints.clear();
+    this->TreeNodes.clear();
+    this->TreePointIds.clear();
+    this->PatchWidth = 0;
+
+    for(TIterator current = first; current != last; ++current)
+    {
+      const PatchType& patch = get(*(this->PropertyMap), *current);
+      if(patch.GetStatus() == PatchType::SOURCE_NODE)
+      {
+        if(this->PatchWidth == 0)
+        {
+          this->PatchWidth = patch.GetRegion().GetSize()[0];
+          this->NumberOfPixelComponents = Helpers::length(patch.GetImage()->GetPixel(patch.GetCorner()));
+        }
+        this->Points.push_back(*current);
+      }
+    }
+
+    this->BuildRangeFirst = *first;
+    this->BuildRangeLength = last - first;
+    this->NumberOfIndexedPoints = this->Points.size();
+
+    if(this->Points.empty())
+    {
+      return;
+    }
+
+    this->ComputePrincipalComponents();
+
+    this->ProjectedPoints.resize(this->Points.size() * this->NumberOfPrincipalComponents);
+    this->ProjectPoints(0, this->Points.size());
+
+    this->TreePointIds.resize(this->Points.size());
+    for(unsigned int pointId = 0; pointId < this->TreePointIds.size(); ++pointId)
+    {
+      this->TreePointIds[pointId] = pointId;
+    }
+    this->BuildTreeNode(0, this->TreePointIds.size());
+  }
+
+  /**
+    * \tparam TIterator The forward-iterator type.
+    * \tparam TOutputIterator The iterator type of the output container.
+    * \param first Start of the range in which to search.
+    * \param last One element past the last element in the range in which to search (usually container.end() ).
+    * \param queryNode The item to compare the items in the container against.
+    * \param outputFirst An iterator to the beginning of the output container that will store the K nearest neighbors.
+    * \return One past the last element written to the output.
+    */
+  template <typename TIterator, typename TOutputIterator>
+  inline
+  TOutputIterator operator()(TIterator first,
+                             TIterator last,
+                             typename TIterator::value_type queryNode,
+                             TOutputIterator outputFirst)
+  {
+    // Nothing to do if the input range is empty
+    if(first == last)
+    {
+      return outputFirst;
+    }
+
+    this->UpdateIndex(first, last);
+
+    const PatchType& queryPatch = get(*(this->PropertyMap), queryNode);
+
+    // Step 1 - approximate neighbors in the reduced space
+    std::vector<float> projectedQuery = this->ProjectQuery(queryPatch);
+
+    unsigned int numberOfCandidates = this->NumberOfCandidates;
+    if(numberOfCandidates == 0)
+    {
+      numberOfCandidates = 4 * this->K;
+    }
+    numberOfCandidates = std::max(numberOfCandidates, this->K);
+
+    std::vector<unsigned int> candidates = this->FindCandidates(projectedQuery, numberOfCandidates);
+
+    // Step 2 - re-rank the candidates with the exact distance
+
+    // Get the offsets to compare
+    typedef std::vector<itk::Offset<2> > OffsetVectorType;
+    const OffsetVectorType* validOffsets = queryPatch.GetValidOffsetsAddress();
+
+    // Extract the pixel values that we want to compare
+    typedef std::vector<typename PatchType::ImageType::PixelType> PixelVector;
+    PixelVector targetPixels(validOffsets->size());
+    for(OffsetVectorType::const_iterator offsetIterator = validOffsets->begin();
+        offsetIterator < validOffsets->end(); ++offsetIterator)
+    {
+      targetPixels[offsetIterator - validOffsets->begin()] =
+          queryPatch.GetImage()->GetPixel(queryPatch.GetCorner() + *offsetIterator);
+    }
+
+    typedef BoundedMaxHeap<DistanceValueType, unsigned int> HeapType;
+    HeapType outputHeap(this->K);
+
+    // One block of candidates per thread, each block keeps its own K best items
+    const long numberOfCandidateIds = static_cast<long>(candidates.size());
+    const long numberOfBlocks =
+        std::min(numberOfCandidateIds, static_cast<long>(TaskPool::GetGlobalInstance().GetNumberOfThreads()));
+    std::mutex outputHeapMutex;
+
+    TaskPool::GetGlobalInstance().ParallelFor(0, numberOfBlocks, [&](const long blockId)
+    {
+      HeapType blockHeap(this->K);
+
+      const long blockEnd = numberOfCandidateIds * (blockId + 1) / numberOfBlocks;
+      for(long candidateId = numberOfCandidateIds * blockId / numberOfBlocks; candidateId < blockEnd; ++candidateId)
+      {
+        const unsigned int pointId = candidates[candidateId];
+        const PatchType& currentPatch = get(*(this->PropertyMap), this->Points[pointId]);
+        if(currentPatch.GetStatus() != PatchType::SOURCE_NODE)
+        {
+          continue;
+        }
+
+        // Argument order is (source, target) ("query node" is the same as "target node")
+        DistanceValueType d = this->DistanceFunction(currentPatch, queryPatch, targetPixels,
+                                                     blockHeap.GetWorstDistance());
+        blockHeap.Push(d, pointId);
+      }
+
+      std::lock_guard<std::mutex> lock(outputHeapMutex);
+      outputHeap.Merge(blockHeap);
+    });
+
+    if(outputHeap.size() < this->K)
+    {
+      std::stringstream ss;
+      ss << "Requested " << this->K << " items but only found " << outputHeap.size();
+      throw std::runtime_error(ss.str());
+    }
+
+    // Copy the best matches into the output (best first)
+    typedef typename HeapType::PairType PairType;
+    std::vector<PairType> sortedItems = outputHeap.GetSortedItems();
+
+    TOutputIterator currentOutputIterator = outputFirst;
+    for(typename std::vector<PairType>::const_iterator sortedIterator = sortedItems.begin();
+        sortedIterator != sortedItems.end(); ++sortedIterator)
+    {
+      *currentOutputIterator = this->Points[sortedIterator->second];
+      ++currentOutputIterator;
+    }
+
+    return currentOutputIterator;
+  } // end operator()
+
+private:
+  /** A node of the kd-tree. Leaves refer to the range [Begin, End) of TreePointIds. */
+  struct TreeNode
+  {
+    unsigned int SplitDimension = 0;
+    float SplitValue = 0.0f;
+
+    /** The indices (in TreeNodes) of the children. 0 for leaves, since the root is never a child. */
+    unsigned int Left = 0;
+    unsigned int Right = 0;
+
+    unsigned int Begin = 0;
+    unsigned int End = 0;
+
+    bool IsLeaf() const
+    {
+      return this->Left == 0;
+    }
+  };
+
+  unsigned int NumberOfPrincipalComponents = 16;
+  unsigned int NumberOfSamples = 2000;
+  unsigned int NumberOfCandidates = 0;
+  unsigned int MaximumNumberOfChecks = 0;
+  unsigned int Seed = 0;
+
+  /** The number of block power iterations used to compute the principal components. */
+  unsigned int NumberOfPowerIterations = 8;
+
+  /** The weight of the ridge term used to project partially valid query patches. */
+  double Regularization = 0.1;
+
+  /** The maximum number of points in a leaf of the kd-tree. */
+  unsigned int LeafSize = 16;
+
+  /** The nodes of the source patches in the index. */
+  std::vector<NodeType> Points;
+
+  /** The first NumberOfIndexedPoints points are in the kd-tree, the rest were added since it was built. */
+  size_t NumberOfIndexedPoints = 0;
+
+  unsigned int PatchWidth = 0;
+  unsigned int NumberOfPixelComponents = 0;
+
+  /** The mean patch vector. */
+  std::vector<float> Mean;
+
+  /** The principal components, one per row (NumberOfPrincipalComponents x patch vector length). */
+  std::vector<float> Components;
+
+  /** The coordinates of each point in the principal components (NumberOfPrincipalComponents per point). */
+  std::vector<float> ProjectedPoints;
+
+  std::vector<TreeNode> TreeNodes;
+  std::vector<unsigned int> TreePointIds;
+
+  /** The first element and length of the range the index was built from. */
+  NodeType BuildRangeFirst;
+  size_t BuildRangeLength = 0;
+
+  size_t GetVectorLength() const
+  {
+    return this->PatchWidth * this->PatchWidth * this->NumberOfPixelComponents;
+  }
+
+  /** Write the pixel components of the patch of a point into 'patchVector'. */
+  void GetPatchVector(const unsigned int pointId, double* const patchVector) const
+  {
+    const PatchType& patch = get(*(this->PropertyMap), this->Points[pointId]);
+    itk::ImageRegionConstIterator<typename PatchType::ImageType> imageIterator(patch.GetImage(), patch.GetRegion());
+    size_t valueId = 0;
+    while(!imageIterator.IsAtEnd())
+    {
+      typename PatchType::ImageType::PixelType pixel = imageIterator.Get();
+      for(unsigned int component = 0; component < this->NumberOfPixelComponents; ++component)
+      {
+        patchVector[valueId++] = Helpers::index(pixel, component);
+      }
+      ++imageIterator;
+    }
+  }
+
+  /** Rebuild the index if the range changed, or project the new points if the range only grew. */
+  template <typename TIterator>
+  void UpdateIndex(TIterator first, TIterator last)
+  {
+    const size_t rangeLength = last - first;
+    if(this->BuildRangeLength > 0 && *first == this->BuildRangeFirst && !this->Points.empty())
+    {
+      if(rangeLength == this->BuildRangeLength)
+      {
+        return;
+      }
+
+      if(rangeLength > this->BuildRangeLength)
+      {
+        const size_t firstNewPointId = this->Points.size();
+        for(TIterator current = first + this->BuildRangeLength; current != last; ++current)
+        {
+          if(get(*(this->PropertyMap), *current).GetStatus() == PatchType::SOURCE_NODE)
+          {
+            this->Points.push_back(*current);
+          }
+        }
+        this->BuildRangeLength = rangeLength;
+
+        // Too many points that are not in the tree make the queries slow, and the components stale
+        if(4 * (this->Points.size() - this->NumberOfIndexedPoints) < this->NumberOfIndexedPoints)
+        {
+          this->ProjectedPoints.resize(this->Points.size() * this->NumberOfPrincipalComponents);
+          this->ProjectPoints(firstNewPointId, this->Points.size());
+          return;
+        }
+      }
+    }
+
+    this->Build(first, last);
+  }
+
+  /** Compute Mean and the top NumberOfPrincipalComponents Components from a random sample of the points. */
+  void ComputePrincipalComponents()
+  {
+    const size_t vectorLength = this->GetVectorLength();
+    const unsigned int numberOfComponents = std::min<size_t>(this->NumberOfPrincipalComponents, vectorLength);
+    this->NumberOfPrincipalComponents = numberOfComponents;
+
+    std::mt19937 generator(this->Seed);
+
+    // Choose the sample
+    std::vector<unsigned int> sampleIds(this->Points.size());
+    for(unsigned int pointId = 0; pointId < sampleIds.size(); ++pointId)
+    {
+      sampleIds[pointId] = pointId;
+    }
+    std::shuffle(sampleIds.begin(), sampleIds.end(), generator);
+    sampleIds.resize(std::min<size_t>(this->NumberOfSamples, sampleIds.size()));
+    const size_t numberOfSamples = sampleIds.size();
+
+    // Centered sample vectors, one per row
+    vnl_matrix<double> samples(numberOfSamples, vectorLength);
+    TaskPool::GetGlobalInstance().ParallelFor(0, static_cast<long>(numberOfSamples), [&](const long sampleId)
+    {
+      this->GetPatchVector(sampleIds[sampleId], samples[sampleId]);
+    }, 16);
+
+    this->Mean.assign(vectorLength, 0.0f);
+    vnl_vector<double> mean(vectorLength, 0.0);
+    for(size_t sampleId = 0; sampleId < numberOfSamples; ++sampleId)
+    {
+      mean += samples.get_row(sampleId);
+    }
+    mean /= static_cast<double>(numberOfSamples);
+    for(size_t sampleId = 0; sampleId < numberOfSamples; ++sampleId)
+    {
+      samples.set_row(sampleId, samples.get_row(sampleId) - mean);
+    }
+
+    // Block power iteration on the covariance (samples^T * samples), with a few extra vectors for accuracy
+    const unsigned int subspaceSize = std::min<size_t>(numberOfComponents + 8, vectorLength);
+    std::normal_distribution<double> distribution;
+    vnl_matrix<double> basis(vectorLength, subspaceSize);
+    for(unsigned int row = 0; row < vectorLength; ++row)
+    {
+      for(unsigned int column = 0; column < subspaceSize; ++column)
+      {
+        basis(row, column) = distribution(generator);
+      }
+    }
+    Orthonormalize(basis);
+
+    for(unsigned int iteration = 0; iteration < this->NumberOfPowerIterations; ++iteration)
+    {
+      basis = samples.transpose() * (samples * basis);
+      Orthonormalize(basis);
+    }
+
+    // Rayleigh-Ritz: the eigenvectors of the covariance restricted to the subspace
+    vnl_matrix<double> projectedSamples = samples * basis;
+    vnl_matrix<double> smallCovariance = projectedSamples.transpose() * projectedSamples;
+    vnl_symmetric_eigensystem<double> eigensystem(smallCovariance);
+
+    // The eigenvalues are in increasing order
+    this->Components.resize(numberOfComponents * vectorLength);
+    for(unsigned int componentId = 0; componentId < numberOfComponents; ++componentId)
+    {
+      vnl_vector<double> component = basis * eigensystem.get_eigenvector(subspaceSize - 1 - componentId);
+      component.normalize();
+      for(size_t valueId = 0; valueId < vectorLength; ++valueId)
+      {
+        this->Components[componentId * vectorLength + valueId] = component[valueId];
+      }
+    }
+
+    for(size_t valueId = 0; valueId < vectorLength; ++valueId)
+    {
+      this->Mean[valueId] = mean[valueId];
+    }
+  }
+
+  /** Orthonormalize the columns of 'matrix' (modified Gram-Schmidt). */
+  static void Orthonormalize(vnl_matrix<double>& matrix)
+  {
+    for(unsigned int column = 0; column < matrix.cols(); ++column)
+    {
+      vnl_vector<double> currentColumn = matrix.get_column(column);
+      for(unsigned int previousColumn = 0; previousColumn < column; ++previousColumn)
+      {
+        vnl_vector<double> otherColumn = matrix.get_column(previousColumn);
+        currentColumn -= dot_product(currentColumn, otherColumn) * otherColumn;
+      }
+      const double norm = currentColumn.two_norm();
+      if(norm > 0.0)
+      {
+        currentColumn /= norm;
+      }
+      matrix.set_column(column, currentColumn);
+    }
+  }
+
+  /** Compute the coordinates of the points [firstPointId, lastPointId). */
+  void ProjectPoints(const size_t firstPointId, const size_t lastPointId)
+  {
+    const size_t vectorLength = this->GetVectorLength();
+
+    // Blocks of points, so that each block allocates its patch vector once
+    TaskPool& pool = TaskPool::GetGlobalInstance();
+    const long numberOfPoints = static_cast<long>(lastPointId - firstPointId);
+    const long numberOfBlocks = std::min(numberOfPoints, 4 * static_cast<long>(pool.GetNumberOfThreads()));
+
+    pool.ParallelFor(0, numberOfBlocks, [&](const long blockId)
+    {
+      std::vector<double> patchVector(vectorLength);
+
+      const long blockEnd = firstPointId + numberOfPoints * (blockId + 1) / numberOfBlocks;
+      for(long pointId = firstPointId + numberOfPoints * blockId / numberOfBlocks; pointId < blockEnd; ++pointId)
+      {
+        this->GetPatchVector(pointId, patchVector.data());
+        for(unsigned int componentId = 0; componentId < this->NumberOfPrincipalComponents; ++componentId)
+        {
+          const float* component = &this->Components[componentId * vectorLength];
+          double coordinate = 0.0;
+          for(size_t valueId = 0; valueId < vectorLength; ++valueId)
+          {
+            coordinate += component[valueId] * (patchVector[valueId] - this->Mean[valueId]);
+          }
+          this->ProjectedPoints[pointId * this->NumberOfPrincipalComponents + componentId] = coordinate;
+        }
+      }
+    });
+  }
+
+  /** Fit the components to the valid pixels of the query patch. */
+  std::vector<float> ProjectQuery(const PatchType& queryPatch) const
+  {
+    const unsigned int numberOfComponents = this->NumberOfPrincipalComponents;
+    const size_t vectorLength = this->GetVectorLength();
+    const std::vector<itk::Offset<2> >* validOffsets = queryPatch.GetValidOffsetsAddress();
+
+    // Accumulate the normal equations over the valid pixels
+    vnl_matrix<double> normalMatrix(numberOfComponents, numberOfComponents, 0.0);
+    vnl_vector<double> rightHandSide(numberOfComponents, 0.0);
+    std::vector<double> componentValues(numberOfComponents);
+
+    for(std::vector<itk::Offset<2> >::const_iterator offsetIterator = validOffsets->begin();
+        offsetIterator != validOffsets->end(); ++offsetIterator)
+    {
+      typename PatchType::ImageType::PixelType pixel =
+          queryPatch.GetImage()->GetPixel(queryPatch.GetCorner() + *offsetIterator);
+      const size_t firstValueId = ((*offsetIterator)[1] * this->PatchWidth + (*offsetIterator)[0]) *
+                                  this->NumberOfPixelComponents;
+      if(firstValueId >= vectorLength)
+      {
+        throw std::runtime_error("PCAKDTreeKNN: The query patch is larger than the source patches!");
+      }
+
+      for(unsigned int pixelComponent = 0; pixelComponent < this->NumberOfPixelComponents; ++pixelComponent)
+      {
+        const size_t valueId = firstValueId + pixelComponent;
+        const double centeredValue = Helpers::index(pixel, pixelComponent) - this->Mean[valueId];
+        for(unsigned int componentId = 0; componentId < numberOfComponents; ++componentId)
+        {
+          componentValues[componentId] = this->Components[componentId * vectorLength + valueId];
+          rightHandSide[componentId] += componentValues[componentId] * centeredValue;
+        }
+        for(unsigned int row = 0; row < numberOfComponents; ++row)
+        {
+          for(unsigned int column = 0; column < numberOfComponents; ++column)
+          {
+            normalMatrix(row, column) += componentValues[row] * componentValues[column];
+          }
+        }
+      }
+    }
+
+    // For a fully valid query the components are orthonormal over all of the pixels, so this is the identity
+    // and there is no ridge. The fewer valid pixels, the more the coefficients are pulled towards the mean.
+    const double invalidFraction = 1.0 - static_cast<double>(validOffsets->size()) /
+                                         static_cast<double>(this->PatchWidth * this->PatchWidth);
+    for(unsigned int componentId = 0; componentId < numberOfComponents; ++componentId)
+    {
+      normalMatrix(componentId, componentId) += this->Regularization * invalidFraction + 1e-9;
+    }
+
+    vnl_cholesky cholesky(normalMatrix, vnl_cholesky::quiet);
+    vnl_vector<double> coordinates = cholesky.solve(rightHandSide);
+
+    std::vector<float> projectedQuery(numberOfComponents);
+    for(unsigned int componentId = 0; componentId < numberOfComponents; ++componentId)
+    {
+      projectedQuery[componentId] = coordinates[componentId];
+    }
+    return projectedQuery;
+  }
+
+  float ProjectedSquaredDistance(const std::vector<float>& projectedQuery, const unsigned int pointId) const
+  {
+    const float* point = &this->ProjectedPoints[pointId * this->NumberOfPrincipalComponents];
+    float squaredDistance = 0.0f;
+    for(unsigned int componentId = 0; componentId < this->NumberOfPrincipalComponents; ++componentId)
+    {
+      const float difference = projectedQuery[componentId] - point[componentId];
+      squaredDistance += difference * difference;
+    }
+    return squaredDistance;
+  }
+
+  /** Build the subtree of TreePointIds[begin, end) and return its index in TreeNodes. */
+  unsigned int BuildTreeNode(const unsigned int begin, const unsigned int end)
+  {
+    const unsigned int nodeId = this->TreeNodes.size();
+    this->TreeNodes.push_back(TreeNode());
+    this->TreeNodes[nodeId].Begin = begin;
+    this->TreeNodes[nodeId].End = end;
+
+    if(end - begin <= this->LeafSize)
+    {
+      return nodeId;
+    }
+
+    // Split the dimension with the largest spread at the median
+    unsigned int splitDimension = 0;
+    float largestSpread = -1.0f;
+    for(unsigned int dimension = 0; dimension < this->NumberOfPrincipalComponents; ++dimension)
+    {
+      float minimum = std::numeric_limits<float>::max();
+      float maximum = std::numeric_limits<float>::lowest();
+      for(unsigned int position = begin; position < end; ++position)
+      {
+        const float value = this->ProjectedPoints[this->TreePointIds[position] * this->NumberOfPrincipalComponents + dimension];
+        minimum = std::min(minimum, value);
+        maximum = std::max(maximum, value);
+      }
+      if(maximum - minimum > largestSpread)
+      {
+        largestSpread = maximum - minimum;
+        splitDimension = dimension;
+      }
+    }
+
+    const unsigned int middle = begin + (end - begin) / 2;
+    const unsigned int numberOfComponents = this->NumberOfPrincipalComponents;
+    const std::vector<float>& projectedPoints = this->ProjectedPoints;
+    std::nth_element(this->TreePointIds.begin() + begin, this->TreePointIds.begin() + middle,
+                     this->TreePointIds.begin() + end,
+                     [&projectedPoints, numberOfComponents, splitDimension](const unsigned int a, const unsigned int b)
+                     {
+                       return projectedPoints[a * numberOfComponents + splitDimension] <
+                              projectedPoints[b * numberOfComponents + splitDimension];
+                     });
+
+    const float splitValue = this->ProjectedPoints[this->TreePointIds[middle] * numberOfComponents + splitDimension];
+
+    // TreeNodes may be reallocated by the recursive calls, so do not keep a reference to the node
+    const unsigned int left = this->BuildTreeNode(begin, middle);
+    const unsigned int right = this->BuildTreeNode(middle, end);
+
+    this->TreeNodes[nodeId].SplitDimension = splitDimension;
+    this->TreeNodes[nodeId].SplitValue = splitValue;
+    this->TreeNodes[nodeId].Left = left;
+    this->TreeNodes[nodeId].Right = right;
+
+    return nodeId;
+  }
+
+  /** Best-bin-first search of the kd-tree for the points closest to 'projectedQuery' in the reduced space,
+    * followed by a linear scan of the points that were added since the tree was built. */
+  std::vector<unsigned int> FindCandidates(const std::vector<float>& projectedQuery,
+                                           const unsigned int numberOfCandidates) const
+  {
+    BoundedMaxHeap<float, unsigned int> candidateHeap(numberOfCandidates);
+
+    unsigned int maximumNumberOfChecks = this->MaximumNumberOfChecks;
+    if(maximumNumberOfChecks == 0)
+    {
+      maximumNumberOfChecks = 8 * numberOfCandidates;
+    }
+
+    // The branches that were not taken, ordered by a lower bound of their distance to the query
+    typedef std::pair<float, unsigned int> BranchType;
+    std::priority_queue<BranchType, std::vector<BranchType>, std::greater<BranchType> > branches;
+    if(!this->TreeNodes.empty())
+    {
+      branches.push(BranchType(0.0f, 0));
+    }
+
+    unsigned int numberOfChecks = 0;
+    while(!branches.empty() && numberOfChecks < maximumNumberOfChecks)
+    {
+      const BranchType branch = branches.top();
+      branches.pop();
+
+      if(branch.first > candidateHeap.GetWorstDistance())
+      {
+        break;
+      }
+
+      // Descend to a leaf, remembering the other side of each split
+      unsigned int nodeId = branch.second;
+      while(!this->TreeNodes[nodeId].IsLeaf())
+      {
+        const TreeNode& node = this->TreeNodes[nodeId];
+        const float difference = projectedQuery[node.SplitDimension] - node.SplitValue;
+        const unsigned int nearChild = (difference < 0.0f) ? node.Left : node.Right;
+        const unsigned int farChild = (difference < 0.0f) ? node.Right : node.Left;
+        branches.push(BranchType(std::max(branch.first, difference * difference), farChild));
+        nodeId = nearChild;
+      }
+
+      const TreeNode& leaf = this->TreeNodes[nodeId];
+      for(unsigned int position = leaf.Begin; position < leaf.End; ++position)
+      {
+        const unsigned int pointId = this->TreePointIds[position];
+        candidateHeap.Push(this->ProjectedSquaredDistance(projectedQuery, pointId), pointId);
+        numberOfChecks++;
+      }
+    }
+
+    for(unsigned int pointId = this->NumberOfIndexedPoints; pointId < this->Points.size(); ++pointId)
+    {
+      candidateHeap.Push(this->ProjectedSquaredDistance(projectedQuery, pointId), pointId);
+    }
+
+    typedef typename BoundedMaxHeap<float, unsigned int>::PairType PairType;
+    std::vector<PairType> sortedCandidates = candidateHeap.GetSortedItems();
+
+    std::vector<unsigned int> candidates(sortedCandidates.size());
+    for(size_t candidateId = 0; candidateId < sortedCandidates.size(); ++candidateId)
+    {
+      candidates[candidateId] = sortedCandidates[candidateId].second;
+    }
+    return candidates;
+  }
+};
+
+#endif
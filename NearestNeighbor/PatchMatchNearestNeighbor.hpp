@@ -0,0 +1,391 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef PatchMatchNearestNeighbor_HPP
+#define PatchMatchNearestNeighbor_HPP
+
+// Submodules
+#include <Helpers/Helpers.h>
+#include <Utilities/Debug/Debug.h>
+
+// ITK
+#include "itkImageRegion.h"
+
+// STL
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+/**
+  * This class finds a good (but not necessarily the best) source patch for a target patch with the
+  * randomized propagation and random search of PatchMatch (Barnes et al. 2009).
+  *
+  * A nearest neighbor field (NNField) is kept for the life of the object. It stores, for every
+  * target pixel that has been queried, the offset from the target patch to its current match.
+  * When a pixel is queried, its match is refined by:
+  * - re-scoring its stored match (the valid pixels of the target patch change as the hole is filled),
+  * - propagation: trying the matches of its 8 neighbors, shifted by the offset to the neighbor,
+  * - random search: trying random patches in exponentially shrinking windows around the current match,
+  * - a few random samples from the whole search range.
+  * If none of these candidates is a source patch, every element of the search range is compared.
+  * Since consecutive targets on the fill front are usually adjacent, propagation lets each query start
+  * from a good match, and the cost of a query does not depend on the size of the search range.
+  *
+  * The PatchDistanceFunction is the same one that is used by LinearSearchBestProperty
+  * (e.g. ImagePatchDifference), so the quality of the matches can be compared directly.
+  *
+  * Candidates are restricted to SOURCE_NODEs that are elements of the search range [first, last), which is
+  * kept as a flag per pixel. The random candidates are drawn from the bounding box of the range. The flags and
+  * the bounding box are recomputed only when the range changes.
+  */
+template <typename PropertyMapType, typename PatchDistanceFunctionType>
+struct PatchMatchNearestNeighbor : public Debug
+{
+  PropertyMapType PropertyMap;
+  PatchDistanceFunctionType PatchDistanceFunction;
+
+  /** The number of propagation + random search rounds performed per query. */
+  unsigned int NumberOfIterations = 4;
+
+  /** The number of uniformly random candidates drawn from the search range per query. */
+  unsigned int NumberOfRandomSamples = 5;
+
+  /** The factor by which the random search window shrinks at each step. */
+  float Alpha = 0.5f;
+
+  PatchMatchNearestNeighbor(PropertyMapType propertyMap,
+                            PatchDistanceFunctionType patchDistanceFunction = PatchDistanceFunctionType(),
+                            const unsigned int seed = 0) :
+  PropertyMap(propertyMap), PatchDistanceFunction(patchDistanceFunction), Generator(seed){}
+
+  void SetNumberOfIterations(const unsigned int numberOfIterations)
+  {
+    this->NumberOfIterations = numberOfIterations;
+  }
+
+  void SetNumberOfRandomSamples(const unsigned int numberOfRandomSamples)
+  {
+    this->NumberOfRandomSamples = numberOfRandomSamples;
+  }
+
+  void SetAlpha(const float alpha)
+  {
+    if(alpha <= 0.0f || alpha >= 1.0f)
+    {
+      throw std::runtime_error("PatchMatchNearestNeighbor::SetAlpha: alpha must be in (0,1)!");
+    }
+    this->Alpha = alpha;
+  }
+
+  /** Forget all of the stored matches. */
+  void ClearNNField()
+  {
+    this->NNField.clear();
+    this->NNDistance.clear();
+    this->HasMatch.clear();
+    this->FieldRegion = itk::ImageRegion<2>();
+  }
+
+  /** Get the distance of the match that was returned by the last query of the pixel 'index'
+    * (or the maximum float if it has not been queried). */
+  float GetNNDistance(const itk::Index<2>& index) const
+  {
+    if(!this->FieldRegion.IsInside(index))
+    {
+      return std::numeric_limits<float>::max();
+    }
+    return this->NNDistance[this->LinearIndex(index)];
+  }
+
+  /**
+    * \param first Start of the range in which to search.
+    * \param last One element past the last element in the range in which to search.
+    * \param query The element to compare to.
+    * \return A good element in the range (a SOURCE_NODE with a small distance to the query).
+    */
+  template <typename TIterator>
+  typename TIterator::value_type operator()(TIterator first, TIterator last,
+                                            typename TIterator::value_type query)
+  {
+    // If the input element range is empty, there is nothing to do.
+    if(first == last)
+    {
+      return *last;
+    }
+
+    typedef typename PropertyMapType::value_type PatchType;
+    typedef typename PatchType::ImageType ImageType;
+    typedef typename TIterator::value_type NodeType;
+
+    PatchType queryPatch = get(this->PropertyMap, query);
+    ImageType* image = queryPatch.GetImage();
+
+    this->AllocateNNField(image->GetLargestPossibleRegion());
+    this->UpdateSearchRegion(first, last);
+
+    // Extract the target pixels once for all of the candidates
+    typedef std::vector<itk::Offset<2> > OffsetVectorType;
+    const OffsetVectorType* validOffsets = queryPatch.GetValidOffsetsAddress();
+
+    typedef std::vector<typename ImageType::PixelType> PixelVector;
+    PixelVector targetPixels(validOffsets->size());
+    for(OffsetVectorType::const_iterator offsetIterator = validOffsets->begin();
+        offsetIterator < validOffsets->end(); ++offsetIterator)
+    {
+      targetPixels[offsetIterator - validOffsets->begin()] =
+          image->GetPixel(queryPatch.GetCorner() + *offsetIterator);
+    }
+
+    const itk::Index<2> queryIndex = Helpers::ConvertFrom<itk::Index<2>, NodeType>(query);
+    const size_t queryLinearIndex = this->LinearIndex(queryIndex);
+
+    itk::Index<2> bestIndex = queryIndex;
+    float bestDistance = std::numeric_limits<float>::max();
+
+    // Evaluates a candidate source patch (given by its center pixel) and keeps it if it is better
+    auto tryCandidate = [&](const itk::Index<2>& candidateIndex)
+    {
+      if(!this->SearchRegion.IsInside(candidateIndex) || !this->InSearchRange[this->LinearIndex(candidateIndex)])
+      {
+        return;
+      }
+
+      NodeType candidateNode = Helpers::ConvertFrom<NodeType, itk::Index<2> >(candidateIndex);
+      const PatchType& candidatePatch = get(this->PropertyMap, candidateNode);
+      if(candidatePatch.GetStatus() != PatchType::SOURCE_NODE)
+      {
+        return;
+      }
+
+      float distance = this->PatchDistanceFunction(candidatePatch, queryPatch, targetPixels);
+      if(distance < bestDistance)
+      {
+        bestDistance = distance;
+        bestIndex = candidateIndex;
+      }
+    };
+
+    // Re-score the stored match of this pixel
+    if(this->HasMatch[queryLinearIndex])
+    {
+      tryCandidate(queryIndex + this->NNField[queryLinearIndex]);
+    }
+
+    const unsigned int maxRadius = std::max(this->SearchRegion.GetSize()[0], this->SearchRegion.GetSize()[1]);
+
+    for(unsigned int iteration = 0; iteration < this->NumberOfIterations; ++iteration)
+    {
+      // Propagation from the 8 neighbors that have a match
+      for(int dy = -1; dy <= 1; ++dy)
+      {
+        for(int dx = -1; dx <= 1; ++dx)
+        {
+          itk::Offset<2> neighborOffset = {{dx, dy}};
+          itk::Index<2> neighborIndex = queryIndex + neighborOffset;
+          if((dx == 0 && dy == 0) || !this->FieldRegion.IsInside(neighborIndex))
+          {
+            continue;
+          }
+
+          const size_t neighborLinearIndex = this->LinearIndex(neighborIndex);
+          if(this->HasMatch[neighborLinearIndex])
+          {
+            // The neighbor's match shifted by the offset from the neighbor to the query
+            tryCandidate(queryIndex + this->NNField[neighborLinearIndex]);
+          }
+        }
+      }
+
+      // Random samples from the whole search range. These seed pixels that have no matched
+      // neighbors and let the search escape from local minima.
+      if(iteration == 0 || bestDistance == std::numeric_limits<float>::max())
+      {
+        for(unsigned int sampleId = 0; sampleId < this->NumberOfRandomSamples; ++sampleId)
+        {
+          tryCandidate(this->RandomIndexInRegion(this->SearchRegion));
+        }
+      }
+
+      // Random search in exponentially shrinking windows around the current best match
+      if(bestDistance < std::numeric_limits<float>::max())
+      {
+        for(float radius = static_cast<float>(maxRadius); radius >= 1.0f; radius *= this->Alpha)
+        {
+          itk::Index<2> windowCorner = {{bestIndex[0] - static_cast<itk::IndexValueType>(radius),
+                                         bestIndex[1] - static_cast<itk::IndexValueType>(radius)}};
+          itk::Size<2> windowSize = {{2 * static_cast<itk::SizeValueType>(radius) + 1,
+                                      2 * static_cast<itk::SizeValueType>(radius) + 1}};
+          itk::ImageRegion<2> window(windowCorner, windowSize);
+          if(!window.Crop(this->SearchRegion))
+          {
+            continue;
+          }
+          tryCandidate(this->RandomIndexInRegion(window));
+        }
+      }
+    }
+
+    // Propagation and the random samples can all miss when source patches are sparse in the search
+    // region (e.g. early on, or with a small source region in a large image). Fall back to comparing
+    // every element of the range; the result seeds the NNField, so the neighbors can propagate from it.
+    if(bestDistance == std::numeric_limits<float>::max())
+    {
+      for(TIterator current = first; current != last; ++current)
+      {
+        const PatchType& currentPatch = get(this->PropertyMap, *current);
+        if(currentPatch.GetStatus() != PatchType::SOURCE_NODE)
+        {
+          continue;
+        }
+
+        float distance = this->PatchDistanceFunction(currentPatch, queryPatch, targetPixels);
+        if(distance < bestDistance)
+        {
+          bestDistance = distance;
+          bestIndex = Helpers::ConvertFrom<itk::Index<2>, NodeType>(*current);
+        }
+      }
+    }
+
+    if(bestDistance == std::numeric_limits<float>::max())
+    {
+      throw std::runtime_error("PatchMatchNearestNeighbor: There are no source patches in the search range!");
+    }
+
+    // Store the match for the next queries
+    this->NNField[queryLinearIndex] = bestIndex - queryIndex;
+    this->NNDistance[queryLinearIndex] = bestDistance;
+    this->HasMatch[queryLinearIndex] = true;
+
+    this->DebugIteration++;
+
+    return Helpers::ConvertFrom<NodeType, itk::Index<2> >(bestIndex);
+  }
+
+private:
+  /** The offset from each target pixel to its match. */
+  std::vector<itk::Offset<2> > NNField;
+
+  /** The distance from each target pixel to its match. */
+  std::vector<float> NNDistance;
+
+  /** Whether or not each pixel has a match. */
+  std::vector<bool> HasMatch;
+
+  /** The region covered by the NNField (the full image). */
+  itk::ImageRegion<2> FieldRegion;
+
+  /** The bounding box of the current search range. */
+  itk::ImageRegion<2> SearchRegion;
+
+  /** Whether or not each pixel (of FieldRegion) is an element of the current search range. */
+  std::vector<bool> InSearchRange;
+
+  /** The linear indices of the elements of the current search range, to clear their flags when it changes. */
+  std::vector<size_t> SearchRangeLinearIndices;
+
+  /** The first element and length of the range that SearchRegion was computed from. */
+  itk::Index<2> SearchRangeFirst;
+  size_t SearchRangeLength = 0;
+
+  std::mt19937 Generator;
+
+  size_t LinearIndex(const itk::Index<2>& index) const
+  {
+    return (index[1] - this->FieldRegion.GetIndex()[1]) * this->FieldRegion.GetSize()[0] +
+           (index[0] - this->FieldRegion.GetIndex()[0]);
+  }
+
+  void AllocateNNField(const itk::ImageRegion<2>& fullRegion)
+  {
+    if(fullRegion == this->FieldRegion)
+    {
+      return;
+    }
+
+    this->FieldRegion = fullRegion;
+    itk::Offset<2> zeroOffset = {{0, 0}};
+    this->NNField.assign(fullRegion.GetNumberOfPixels(), zeroOffset);
+    this->NNDistance.assign(fullRegion.GetNumberOfPixels(), std::numeric_limits<float>::max());
+    this->HasMatch.assign(fullRegion.GetNumberOfPixels(), false);
+
+    // The search range has to be flagged again in the new field
+    this->InSearchRange.assign(fullRegion.GetNumberOfPixels(), false);
+    this->SearchRangeLinearIndices.clear();
+    this->SearchRangeLength = 0;
+  }
+
+  /** Flag the elements of the range [first, last) and compute their bounding box if it is not the range of the
+    * previous query. This only reads the vertex coordinates, not the descriptors. */
+  template <typename TIterator>
+  void UpdateSearchRegion(TIterator first, TIterator last)
+  {
+    typedef typename TIterator::value_type NodeType;
+
+    const itk::Index<2> firstIndex = Helpers::ConvertFrom<itk::Index<2>, NodeType>(*first);
+    const size_t rangeLength = std::distance(first, last);
+    if(rangeLength == this->SearchRangeLength && firstIndex == this->SearchRangeFirst)
+    {
+      return;
+    }
+
+    for(size_t elementId = 0; elementId < this->SearchRangeLinearIndices.size(); ++elementId)
+    {
+      this->InSearchRange[this->SearchRangeLinearIndices[elementId]] = false;
+    }
+    this->SearchRangeLinearIndices.clear();
+
+    itk::Index<2> minIndex = firstIndex;
+    itk::Index<2> maxIndex = firstIndex;
+    for(TIterator current = first; current != last; ++current)
+    {
+      itk::Index<2> index = Helpers::ConvertFrom<itk::Index<2>, NodeType>(*current);
+      const size_t linearIndex = this->LinearIndex(index);
+      this->InSearchRange[linearIndex] = true;
+      this->SearchRangeLinearIndices.push_back(linearIndex);
+
+      for(unsigned int dimension = 0; dimension < 2; ++dimension)
+      {
+        minIndex[dimension] = std::min(minIndex[dimension], index[dimension]);
+        maxIndex[dimension] = std::max(maxIndex[dimension], index[dimension]);
+      }
+    }
+
+    itk::Size<2> size = {{static_cast<itk::SizeValueType>(maxIndex[0] - minIndex[0] + 1),
+                          static_cast<itk::SizeValueType>(maxIndex[1] - minIndex[1] + 1)}};
+    this->SearchRegion = itk::ImageRegion<2>(minIndex, size);
+    this->SearchRangeFirst = firstIndex;
+    this->SearchRangeLength = rangeLength;
+  }
+
+  itk::Index<2> RandomIndexInRegion(const itk::ImageRegion<2>& region)
+  {
+    std::uniform_int_distribution<itk::IndexValueType> xDistribution(region.GetIndex()[0],
+        region.GetIndex()[0] + static_cast<itk::IndexValueType>(region.GetSize()[0]) - 1);
+    std::uniform_int_distribution<itk::IndexValueType> yDistribution(region.GetIndex()[1],
+        region.GetIndex()[1] + static_cast<itk::IndexValueType>(region.GetSize()[1]) - 1);
+
+    itk::Index<2> index = {{xDistribution(this->Generator), yDistribution(this->Generator)}};
+    return index;
+  }
+};
+
+#endif
@@ -0,0 +1,191 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef SearchTestProblem_HPP
+#define SearchTestProblem_HPP
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegionIterator.h"
+
+// Submodules
+#include <Helpers/Helpers.h>
+#include <Mask/Mask.h>
+#include <ITKHelpers/ITKHelpers.h>
+
+// Pixel descriptors
+#include "PixelDescriptors/ImagePatchPixelDescriptor.h"
+
+// Descriptor visitors
+#include "Visitors/DescriptorVisitors/ImagePatchDescriptorVisitor.hpp"
+
+// Nearest neighbors
+#include "NearestNeighbor/LinearSearchBest/Property.hpp"
+
+// Difference functions
+#include "DifferenceFunctions/Patch/ImagePatchDifference.hpp"
+#include "DifferenceFunctions/Pixel/SumSquaredPixelDifference.hpp"
+
+// Boost
+#include <boost/graph/grid_graph.hpp>
+#include <boost/property_map/property_map.hpp>
+
+// STL
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+
+/** A 60x50 random image with a 10x10 square hole in the middle and the descriptors of all of its patches,
+  * which the nearest neighbor tests search with their finder and with LinearSearchBestProperty. */
+struct SearchTestProblem
+{
+  typedef itk::Image<itk::CovariantVector<unsigned char, 3>, 2> ImageType;
+
+  typedef boost::grid_graph<2> VertexListGraphType;
+  typedef boost::graph_traits<VertexListGraphType>::vertex_descriptor VertexDescriptorType;
+  typedef boost::property_map<VertexListGraphType, boost::vertex_index_t>::const_type IndexMapType;
+
+  typedef ImagePatchPixelDescriptor<ImageType> ImagePatchPixelDescriptorType;
+  typedef boost::vector_property_map<ImagePatchPixelDescriptorType, IndexMapType> ImagePatchDescriptorMapType;
+
+  typedef ImagePatchDescriptorVisitor<VertexListGraphType, ImageType, ImagePatchDescriptorMapType>
+      ImagePatchDescriptorVisitorType;
+
+  typedef ImagePatchDifference<ImagePatchPixelDescriptorType,
+      SumSquaredPixelDifference<ImageType::PixelType> > PatchDifferenceType;
+
+  ImageType::Pointer Image;
+  Mask::Pointer MaskImage;
+
+  std::shared_ptr<VertexListGraphType> Graph;
+  std::shared_ptr<ImagePatchDescriptorMapType> ImagePatchDescriptorMap;
+  std::shared_ptr<ImagePatchDescriptorVisitorType> DescriptorVisitor;
+
+  unsigned int PatchHalfWidth;
+
+  /** The image is created from srand(0), so every test searches the same pixels. */
+  SearchTestProblem() : PatchHalfWidth(3)
+  {
+    srand(0);
+
+    itk::Index<2> corner = {{0, 0}};
+    itk::Size<2> size = {{60, 50}};
+    itk::ImageRegion<2> region(corner, size);
+
+    this->Image = ImageType::New();
+    CreateRandomImage(this->Image, region);
+
+    this->MaskImage = Mask::New();
+    this->MaskImage->SetRegions(region);
+    this->MaskImage->Allocate();
+    ITKHelpers::SetImageToConstant(this->MaskImage.GetPointer(), this->MaskImage->GetValidValue());
+
+    itk::Index<2> holeCorner = {{25, 20}};
+    itk::Size<2> holeSize = {{10, 10}};
+    ITKHelpers::SetRegionToConstant(this->MaskImage.GetPointer(), itk::ImageRegion<2>(holeCorner, holeSize),
+                                    this->MaskImage->GetHoleValue());
+
+    boost::array<std::size_t, 2> graphSideLengths = { { size[0], size[1] } };
+    this->Graph.reset(new VertexListGraphType(graphSideLengths));
+
+    this->ImagePatchDescriptorMap = this->CreateDescriptorMap();
+    this->DescriptorVisitor.reset(new ImagePatchDescriptorVisitorType(this->Image, this->MaskImage,
+                                                                      this->ImagePatchDescriptorMap,
+                                                                      this->PatchHalfWidth));
+
+    typedef boost::graph_traits<VertexListGraphType>::vertex_iterator VertexIteratorType;
+    VertexIteratorType vertexIterator, vertexEnd;
+    for(boost::tie(vertexIterator, vertexEnd) = vertices(*this->Graph); vertexIterator != vertexEnd; ++vertexIterator)
+    {
+      this->DescriptorVisitor->InitializeVertex(*vertexIterator);
+    }
+  }
+
+  /** Fill 'image' with random pixels. */
+  static void CreateRandomImage(ImageType* const image, const itk::ImageRegion<2>& region)
+  {
+    image->SetRegions(region);
+    image->Allocate();
+
+    itk::ImageRegionIterator<ImageType> imageIterator(image, region);
+    while(!imageIterator.IsAtEnd())
+    {
+      ImageType::PixelType pixel;
+      for(unsigned int component = 0; component < 3; ++component)
+      {
+        pixel[component] = rand() % 255;
+      }
+      imageIterator.Set(pixel);
+      ++imageIterator;
+    }
+  }
+
+  /** An empty descriptor map with an entry for every vertex of the graph. */
+  std::shared_ptr<ImagePatchDescriptorMapType> CreateDescriptorMap() const
+  {
+    IndexMapType indexMap(get(boost::vertex_index, *this->Graph));
+    return std::shared_ptr<ImagePatchDescriptorMapType>(
+          new ImagePatchDescriptorMapType(num_vertices(*this->Graph), indexMap));
+  }
+
+  /** Make the patch centered at 'targetPixel' a target patch and return its vertex. */
+  VertexDescriptorType DiscoverTarget(const itk::Index<2>& targetPixel)
+  {
+    VertexDescriptorType targetNode = Helpers::ConvertFrom<VertexDescriptorType, itk::Index<2> >(targetPixel);
+    this->DescriptorVisitor->DiscoverVertex(targetNode);
+    return targetNode;
+  }
+
+  /** Compare the result of 'searchBest' to the result of the exhaustive search for the target patch centered at
+    * 'targetPixel'. The patches are compared by their differences, because equally good patches can be returned
+    * by either search, unless 'requireSameNode' is true. */
+  template <typename TSearchBest>
+  bool CompareToLinearSearch(TSearchBest& searchBest, const itk::Index<2>& targetPixel,
+                             const std::string& searchName, const bool requireSameNode = false)
+  {
+    VertexDescriptorType targetNode = this->DiscoverTarget(targetPixel);
+
+    LinearSearchBestProperty<ImagePatchDescriptorMapType, PatchDifferenceType>
+        linearSearchBest(*this->ImagePatchDescriptorMap);
+
+    VertexDescriptorType linearResult = linearSearchBest(vertices(*this->Graph).first, vertices(*this->Graph).second,
+                                                         targetNode);
+    VertexDescriptorType searchResult = searchBest(vertices(*this->Graph).first, vertices(*this->Graph).second,
+                                                   targetNode);
+
+    PatchDifferenceType patchDifference;
+    float linearDifference = patchDifference(get(*this->ImagePatchDescriptorMap, linearResult),
+                                             get(*this->ImagePatchDescriptorMap, targetNode));
+    float searchDifference = patchDifference(get(*this->ImagePatchDescriptorMap, searchResult),
+                                             get(*this->ImagePatchDescriptorMap, targetNode));
+
+    std::cout << "Target " << targetPixel << " linear search: " << linearResult[0] << " " << linearResult[1]
+              << " (" << linearDifference << ") " << searchName << " search: " << searchResult[0] << " "
+              << searchResult[1] << " (" << searchDifference << ")" << std::endl;
+
+    if(requireSameNode)
+    {
+      return searchResult == linearResult;
+    }
+
+    return searchDifference <= linearDifference * (1.0f + 1e-5f);
+  }
+};
+
+#endif
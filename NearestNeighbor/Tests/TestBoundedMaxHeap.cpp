@@ -0,0 +1,92 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "NearestNeighbor/BoundedMaxHeap.hpp"
+
+// STL
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+/** Check that splitting the items over several heaps and merging them gives the K smallest items, sorted. */
+int main()
+{
+  srand(0);
+
+  const unsigned int numberOfItems = 10000;
+  const unsigned int k = 100;
+  const unsigned int numberOfHeaps = 4;
+
+  std::vector<float> distances(numberOfItems);
+  for(unsigned int i = 0; i < numberOfItems; ++i)
+  {
+    distances[i] = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+  }
+
+  typedef BoundedMaxHeap<float, unsigned int> HeapType;
+
+  // Simulate one heap per thread
+  std::vector<HeapType> heaps(numberOfHeaps, HeapType(k));
+  for(unsigned int i = 0; i < numberOfItems; ++i)
+  {
+    HeapType& heap = heaps[i % numberOfHeaps];
+    heap.Push(distances[i], i);
+
+    if(heap.size() > k)
+    {
+      std::cerr << "The heap has more than K items!" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  HeapType mergedHeap(k);
+  for(unsigned int heapId = 0; heapId < numberOfHeaps; ++heapId)
+  {
+    mergedHeap.Merge(heaps[heapId]);
+  }
+
+  std::vector<HeapType::PairType> sortedItems = mergedHeap.GetSortedItems();
+
+  std::vector<float> sortedDistances = distances;
+  std::sort(sortedDistances.begin(), sortedDistances.end());
+
+  if(sortedItems.size() != k)
+  {
+    std::cerr << "Expected " << k << " items but got " << sortedItems.size() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  for(unsigned int i = 0; i < k; ++i)
+  {
+    if(sortedItems[i].first != sortedDistances[i] || distances[sortedItems[i].second] != sortedItems[i].first)
+    {
+      std::cerr << "Item " << i << " is " << sortedItems[i].first << " but should be " << sortedDistances[i] << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  if(mergedHeap.GetWorstDistance() != sortedDistances[k - 1])
+  {
+    std::cerr << "The worst distance is " << mergedHeap.GetWorstDistance()
+              << " but should be " << sortedDistances[k - 1] << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
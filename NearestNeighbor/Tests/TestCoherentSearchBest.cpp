@@ -0,0 +1,151 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// Custom
+#include "NearestNeighbor/Tests/SearchTestProblem.hpp"
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+// Submodules
+#include <Helpers/Helpers.h>
+#include <Mask/Mask.h>
+
+// Nearest neighbors
+#include "NearestNeighbor/LinearSearchBest/Property.hpp"
+#include "NearestNeighbor/CoherentSearchBest.hpp"
+
+// STL
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <memory>
+
+/** This finder does not have the bounded overload, so CoherentSearchBest has to compare its result
+  * to the best shifted candidate itself. */
+template <typename TDescriptorMap, typename TPatchDifference>
+struct UnboundedSearchBest
+{
+  LinearSearchBestProperty<TDescriptorMap, TPatchDifference> LinearSearchBest;
+
+  UnboundedSearchBest(TDescriptorMap descriptorMap) : LinearSearchBest(descriptorMap) {}
+
+  template <typename TIterator>
+  typename TIterator::value_type operator()(TIterator first, TIterator last, typename TIterator::value_type query)
+  {
+    return this->LinearSearchBest(first, last, query);
+  }
+};
+
+int main()
+{
+  SearchTestProblem problem;
+
+  typedef SearchTestProblem::VertexDescriptorType VertexDescriptorType;
+  typedef SearchTestProblem::ImagePatchDescriptorMapType ImagePatchDescriptorMapType;
+  typedef SearchTestProblem::PatchDifferenceType PatchDifferenceType;
+  const itk::ImageRegion<2> region = problem.Image->GetLargestPossibleRegion();
+  const SearchTestProblem::VertexListGraphType& graph = *problem.Graph;
+  const ImagePatchDescriptorMapType& imagePatchDescriptorMap = *problem.ImagePatchDescriptorMap;
+
+  // A partially valid target patch on the hole boundary
+  itk::Index<2> targetPixel = {{25, 24}};
+  VertexDescriptorType targetNode = problem.DiscoverTarget(targetPixel);
+
+  typedef LinearSearchBestProperty<ImagePatchDescriptorMapType, PatchDifferenceType> LinearSearchBestType;
+  std::shared_ptr<LinearSearchBestType> linearSearchBest(new LinearSearchBestType(imagePatchDescriptorMap));
+
+  VertexDescriptorType exactResult = (*linearSearchBest)(vertices(graph).first, vertices(graph).second, targetNode);
+  itk::Index<2> exactPixel = Helpers::ConvertFrom<itk::Index<2>, VertexDescriptorType>(exactResult);
+
+  // Create a source pixel map like the one InpaintingVisitor keeps: valid pixels map to themselves, holes to (-1,-1)
+  typedef itk::Image<itk::Index<2>, 2> SourcePixelMapImageType;
+  SourcePixelMapImageType::Pointer sourcePixelMapImage = SourcePixelMapImageType::New();
+  sourcePixelMapImage->SetRegions(region);
+  sourcePixelMapImage->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<SourcePixelMapImageType> sourcePixelMapIterator(sourcePixelMapImage, region);
+  while(!sourcePixelMapIterator.IsAtEnd())
+  {
+    itk::Index<2> dummyIndex = {{-1, -1}};
+    sourcePixelMapIterator.Set(problem.MaskImage->IsValid(sourcePixelMapIterator.GetIndex()) ?
+                               sourcePixelMapIterator.GetIndex() : dummyIndex);
+    ++sourcePixelMapIterator;
+  }
+
+  typedef CoherentSearchBest<ImagePatchDescriptorMapType, LinearSearchBestType, PatchDifferenceType>
+          CoherentSearchBestType;
+  CoherentSearchBestType coherentSearchBest(imagePatchDescriptorMap, sourcePixelMapImage, linearSearchBest);
+
+  typedef UnboundedSearchBest<ImagePatchDescriptorMapType, PatchDifferenceType> UnboundedSearchBestType;
+  std::shared_ptr<UnboundedSearchBestType> unboundedSearchBest(new UnboundedSearchBestType(imagePatchDescriptorMap));
+  CoherentSearchBest<ImagePatchDescriptorMapType, UnboundedSearchBestType, PatchDifferenceType>
+      coherentUnboundedSearchBest(imagePatchDescriptorMap, sourcePixelMapImage, unboundedSearchBest);
+
+  // Pretend that a neighboring target filled a pixel of this target patch with the shift to the best match
+  itk::Index<2> filledPixel = {{26, 25}};
+  sourcePixelMapImage->SetPixel(filledPixel, filledPixel + (exactPixel - targetPixel));
+
+  if(coherentSearchBest(vertices(graph).first, vertices(graph).second, targetNode) != exactResult)
+  {
+    std::cerr << "The bounded coherent search did not match the linear search for a good shift!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if(coherentSearchBest.GetNumberOfCoherentResults() != 1)
+  {
+    std::cerr << "The good shift was not the result of the coherent search!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if(coherentUnboundedSearchBest(vertices(graph).first, vertices(graph).second, targetNode) != exactResult)
+  {
+    std::cerr << "The unbounded coherent search did not match the linear search for a good shift!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // A shift to a poor match must not change the result
+  itk::Offset<2> poorShift = {{-20, -15}};
+  sourcePixelMapImage->SetPixel(filledPixel, filledPixel + poorShift);
+
+  if(coherentSearchBest(vertices(graph).first, vertices(graph).second, targetNode) != exactResult)
+  {
+    std::cerr << "The bounded coherent search did not match the linear search for a poor shift!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if(coherentUnboundedSearchBest(vertices(graph).first, vertices(graph).second, targetNode) != exactResult)
+  {
+    std::cerr << "The unbounded coherent search did not match the linear search for a poor shift!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // With an acceptance threshold above its distance, even the poor shift is returned without a search
+  coherentSearchBest.SetAcceptanceThreshold(std::numeric_limits<float>::max());
+  VertexDescriptorType poorCandidate =
+      Helpers::ConvertFrom<VertexDescriptorType, itk::Index<2> >(targetPixel + poorShift);
+  if(coherentSearchBest(vertices(graph).first, vertices(graph).second, targetNode) != poorCandidate ||
+     coherentSearchBest.GetNumberOfAcceptedCandidates() != 1)
+  {
+    std::cerr << "The shifted candidate was not accepted!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
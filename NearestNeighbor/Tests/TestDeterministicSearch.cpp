@@ -0,0 +1,315 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+// Submodules
+#include <Helpers/Helpers.h>
+#include <Mask/Mask.h>
+#include <Mask/MaskOperations.h>
+#include <ITKHelpers/ITKHelpers.h>
+
+// Custom
+#include "Utilities/IndirectPriorityQueue.h"
+#include "Utilities/TaskPool.h"
+
+// Pixel descriptors
+#include "PixelDescriptors/ImagePatchPixelDescriptor.h"
+
+// Descriptor visitors
+#include "Visitors/DescriptorVisitors/ImagePatchDescriptorVisitor.hpp"
+
+// Inpainting visitors
+#include "Visitors/InpaintingVisitors/InpaintingVisitor.hpp"
+#include "Visitors/AcceptanceVisitors/DefaultAcceptanceVisitor.hpp"
+
+// Nearest neighbors
+#include "NearestNeighbor/LinearSearchBest/Property.hpp"
+#include "NearestNeighbor/LinearSearchKNNProperty.hpp"
+
+// Initializers
+#include "Initializers/InitializeFromMaskImage.hpp"
+#include "Initializers/InitializePriority.hpp"
+
+// Inpainters
+#include "Inpainters/CompositePatchInpainter.hpp"
+#include "Inpainters/PatchInpainter.hpp"
+
+// Difference functions
+#include "DifferenceFunctions/Patch/ImagePatchDifference.hpp"
+#include "DifferenceFunctions/Pixel/SumSquaredPixelDifference.hpp"
+
+// Inpainting
+#include "Algorithms/InpaintingAlgorithm.hpp"
+
+// Priority
+#include "Priority/PriorityCriminisi.h"
+
+// Boost
+#include <boost/graph/grid_graph.hpp>
+#include <boost/property_map/property_map.hpp>
+
+// STL
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+
+typedef itk::Image<itk::CovariantVector<unsigned char, 3>, 2> ImageType;
+
+typedef boost::grid_graph<2> VertexListGraphType;
+typedef boost::graph_traits<VertexListGraphType>::vertex_descriptor VertexDescriptorType;
+
+/** The (target, source) pixels of every fill, in the order of the fills. */
+typedef std::vector<std::pair<itk::Index<2>, itk::Index<2> > > FillLogType;
+
+static itk::ImageRegion<2> GetHoleRegion()
+{
+  itk::Index<2> holeCorner = {{15, 15}};
+  itk::Size<2> holeSize = {{10, 10}};
+  return itk::ImageRegion<2>(holeCorner, holeSize);
+}
+
+/** A striped image has many identical patches, so almost every search has ties. */
+static void CreateStripedImage(ImageType* const image, Mask* const mask)
+{
+  itk::Index<2> corner = {{0, 0}};
+  itk::Size<2> size = {{40, 40}};
+  itk::ImageRegion<2> region(corner, size);
+
+  image->SetRegions(region);
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> imageIterator(image, region);
+  while(!imageIterator.IsAtEnd())
+  {
+    ImageType::PixelType pixel;
+    pixel[0] = 60 * (imageIterator.GetIndex()[0] % 4);
+    pixel[1] = 80 * (imageIterator.GetIndex()[1] % 3);
+    pixel[2] = 0;
+    imageIterator.Set(pixel);
+    ++imageIterator;
+  }
+
+  mask->SetRegions(region);
+  mask->Allocate();
+  ITKHelpers::SetImageToConstant(mask, mask->GetValidValue());
+
+  ITKHelpers::SetRegionToConstant(mask, GetHoleRegion(), mask->GetHoleValue());
+}
+
+/** Record the result of every search of the wrapped finder. */
+template <typename TBestPatchFinder>
+struct LoggingSearchBest
+{
+  std::shared_ptr<TBestPatchFinder> BestPatchFinder;
+
+  FillLogType* FillLog;
+
+  LoggingSearchBest(std::shared_ptr<TBestPatchFinder> bestPatchFinder, FillLogType* const fillLog) :
+    BestPatchFinder(bestPatchFinder), FillLog(fillLog) {}
+
+  template <typename TIterator>
+  typename TIterator::value_type operator()(TIterator first, TIterator last, typename TIterator::value_type query)
+  {
+    typename TIterator::value_type result = (*this->BestPatchFinder)(first, last, query);
+    this->FillLog->push_back(std::make_pair(ITKHelpers::CreateIndex(query), ITKHelpers::CreateIndex(result)));
+    return result;
+  }
+};
+
+/** Inpaint the striped image as ClassicalImageInpainting does, with a deterministic LinearSearchBestProperty. */
+static FillLogType RunInpainting(const unsigned int numberOfThreads)
+{
+  TaskPool::SetGlobalConfiguration(numberOfThreads);
+
+  ImageType::Pointer image = ImageType::New();
+  Mask::Pointer mask = Mask::New();
+  CreateStripedImage(image, mask);
+
+  const unsigned int patchHalfWidth = 3;
+
+  ImageType::Pointer blurredImage = ImageType::New();
+  MaskOperations::MaskedBlur(image.GetPointer(), mask.GetPointer(), 2.0f, blurredImage.GetPointer());
+
+  boost::array<std::size_t, 2> graphSideLengths = { { image->GetLargestPossibleRegion().GetSize()[0],
+                                                      image->GetLargestPossibleRegion().GetSize()[1] } };
+  std::shared_ptr<VertexListGraphType> graph(new VertexListGraphType(graphSideLengths));
+
+  typedef IndirectPriorityQueue<VertexListGraphType> BoundaryNodeQueueType;
+  std::shared_ptr<BoundaryNodeQueueType> boundaryNodeQueue(new BoundaryNodeQueueType(*graph));
+
+  typedef ImagePatchPixelDescriptor<ImageType> ImagePatchPixelDescriptorType;
+  typedef boost::vector_property_map<ImagePatchPixelDescriptorType,
+      BoundaryNodeQueueType::IndexMapType> ImagePatchDescriptorMapType;
+  std::shared_ptr<ImagePatchDescriptorMapType> imagePatchDescriptorMap(new
+      ImagePatchDescriptorMapType(num_vertices(*graph), *(boundaryNodeQueue->GetIndexMap())));
+
+  typedef PatchInpainter<ImageType> ImageInpainterType;
+  std::shared_ptr<ImageInpainterType> imagePatchInpainter(new ImageInpainterType(patchHalfWidth, image, mask));
+  std::shared_ptr<ImageInpainterType> blurredImagePatchInpainter(new
+      ImageInpainterType(patchHalfWidth, blurredImage, mask));
+
+  std::shared_ptr<CompositePatchInpainter> inpainter(new CompositePatchInpainter);
+  inpainter->AddInpainter(imagePatchInpainter);
+  inpainter->AddInpainter(blurredImagePatchInpainter);
+
+  typedef PriorityCriminisi<ImageType> PriorityType;
+  std::shared_ptr<PriorityType> priorityFunction(new PriorityType(blurredImage, mask, patchHalfWidth));
+
+  typedef ImagePatchDescriptorVisitor<VertexListGraphType, ImageType, ImagePatchDescriptorMapType>
+      ImagePatchDescriptorVisitorType;
+  std::shared_ptr<ImagePatchDescriptorVisitorType> imagePatchDescriptorVisitor(new
+      ImagePatchDescriptorVisitorType(image.GetPointer(), mask, imagePatchDescriptorMap, patchHalfWidth));
+
+  typedef DefaultAcceptanceVisitor<VertexListGraphType> AcceptanceVisitorType;
+  std::shared_ptr<AcceptanceVisitorType> acceptanceVisitor(new AcceptanceVisitorType);
+
+  typedef InpaintingVisitor<VertexListGraphType, BoundaryNodeQueueType,
+                            ImagePatchDescriptorVisitorType, AcceptanceVisitorType, PriorityType>
+                            InpaintingVisitorType;
+  std::shared_ptr<InpaintingVisitorType> inpaintingVisitor(new InpaintingVisitorType(mask, boundaryNodeQueue,
+                                          imagePatchDescriptorVisitor, acceptanceVisitor,
+                                          priorityFunction, patchHalfWidth, "InpaintingVisitor"));
+
+  InitializePriority(mask, boundaryNodeQueue.get(), priorityFunction.get());
+  InitializeFromMaskImage<InpaintingVisitorType, VertexDescriptorType>(mask, inpaintingVisitor.get());
+
+  typedef ImagePatchDifference<ImagePatchPixelDescriptorType,
+      SumSquaredPixelDifference<ImageType::PixelType> > PatchDifferenceType;
+  typedef LinearSearchBestProperty<ImagePatchDescriptorMapType, PatchDifferenceType> BestSearchType;
+  std::shared_ptr<BestSearchType> linearSearchBest(new BestSearchType(*imagePatchDescriptorMap));
+  linearSearchBest->SetDeterministic(true);
+
+  FillLogType fillLog;
+  typedef LoggingSearchBest<BestSearchType> LoggingSearchBestType;
+  std::shared_ptr<LoggingSearchBestType> loggingSearchBest(new LoggingSearchBestType(linearSearchBest, &fillLog));
+
+  InpaintingAlgorithm(graph, inpaintingVisitor, boundaryNodeQueue, loggingSearchBest, inpainter);
+
+  return fillLog;
+}
+
+/** Find the K nearest neighbors of every pixel on the edge of the hole with a deterministic LinearSearchKNNProperty. */
+static std::vector<itk::Index<2> > RunKNN(const unsigned int numberOfThreads)
+{
+  TaskPool::SetGlobalConfiguration(numberOfThreads);
+
+  ImageType::Pointer image = ImageType::New();
+  Mask::Pointer mask = Mask::New();
+  CreateStripedImage(image, mask);
+
+  const unsigned int patchHalfWidth = 3;
+
+  boost::array<std::size_t, 2> graphSideLengths = { { image->GetLargestPossibleRegion().GetSize()[0],
+                                                      image->GetLargestPossibleRegion().GetSize()[1] } };
+  VertexListGraphType graph(graphSideLengths);
+
+  typedef boost::property_map<VertexListGraphType, boost::vertex_index_t>::const_type IndexMapType;
+  IndexMapType indexMap(get(boost::vertex_index, graph));
+
+  typedef ImagePatchPixelDescriptor<ImageType> ImagePatchPixelDescriptorType;
+  typedef boost::vector_property_map<ImagePatchPixelDescriptorType, IndexMapType> ImagePatchDescriptorMapType;
+  std::shared_ptr<ImagePatchDescriptorMapType> imagePatchDescriptorMap(
+        new ImagePatchDescriptorMapType(num_vertices(graph), indexMap));
+
+  typedef ImagePatchDescriptorVisitor<VertexListGraphType, ImageType, ImagePatchDescriptorMapType>
+          ImagePatchDescriptorVisitorType;
+  ImagePatchDescriptorVisitorType imagePatchDescriptorVisitor(image, mask, imagePatchDescriptorMap, patchHalfWidth);
+
+  typedef boost::graph_traits<VertexListGraphType>::vertex_iterator VertexIteratorType;
+  VertexIteratorType vertexIterator, vertexEnd;
+  for(boost::tie(vertexIterator, vertexEnd) = vertices(graph); vertexIterator != vertexEnd; ++vertexIterator)
+  {
+    imagePatchDescriptorVisitor.InitializeVertex(*vertexIterator);
+  }
+
+  typedef ImagePatchDifference<ImagePatchPixelDescriptorType,
+      SumSquaredPixelDifference<ImageType::PixelType> > PatchDifferenceType;
+  typedef LinearSearchKNNProperty<ImagePatchDescriptorMapType, PatchDifferenceType> KNNSearchType;
+  KNNSearchType linearSearchKNN(imagePatchDescriptorMap, 20);
+  linearSearchKNN.SetDeterministic(true);
+
+  itk::ImageRegion<2> holeRegion = GetHoleRegion();
+
+  std::vector<itk::Index<2> > neighborLog;
+  for(boost::tie(vertexIterator, vertexEnd) = vertices(graph); vertexIterator != vertexEnd; ++vertexIterator)
+  {
+    itk::Index<2> pixel = ITKHelpers::CreateIndex(*vertexIterator);
+    itk::ImageRegion<2> innerRegion = holeRegion;
+    innerRegion.ShrinkByRadius(1);
+    if(!holeRegion.IsInside(pixel) || innerRegion.IsInside(pixel))
+    {
+      continue;
+    }
+
+    imagePatchDescriptorVisitor.DiscoverVertex(*vertexIterator);
+
+    std::vector<VertexDescriptorType> neighbors(linearSearchKNN.GetK());
+    linearSearchKNN(vertices(graph).first, vertices(graph).second, *vertexIterator, neighbors.begin());
+    for(size_t neighborId = 0; neighborId < neighbors.size(); ++neighborId)
+    {
+      neighborLog.push_back(ITKHelpers::CreateIndex(neighbors[neighborId]));
+    }
+  }
+
+  return neighborLog;
+}
+
+/** Run the same jobs with 1 and with several threads and require identical results. */
+int main()
+{
+  FillLogType serialFillLog = RunInpainting(1);
+  FillLogType parallelFillLog = RunInpainting(4);
+
+  if(serialFillLog.empty())
+  {
+    std::cerr << "Nothing was filled!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if(serialFillLog != parallelFillLog)
+  {
+    std::cerr << "The fill logs with 1 and 4 threads are different!" << std::endl;
+    for(size_t fillId = 0; fillId < serialFillLog.size() && fillId < parallelFillLog.size(); ++fillId)
+    {
+      if(serialFillLog[fillId] != parallelFillLog[fillId])
+      {
+        std::cerr << "First difference at fill " << fillId << ": target " << serialFillLog[fillId].first
+                  << " was filled from " << serialFillLog[fillId].second << " and "
+                  << parallelFillLog[fillId].second << std::endl;
+        break;
+      }
+    }
+    return EXIT_FAILURE;
+  }
+
+  std::vector<itk::Index<2> > serialNeighborLog = RunKNN(1);
+  std::vector<itk::Index<2> > parallelNeighborLog = RunKNN(4);
+
+  if(serialNeighborLog != parallelNeighborLog)
+  {
+    std::cerr << "The nearest neighbors with 1 and 4 threads are different!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
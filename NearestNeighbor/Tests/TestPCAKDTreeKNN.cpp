@@ -0,0 +1,83 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// Custom
+#include "NearestNeighbor/Tests/SearchTestProblem.hpp"
+
+// Nearest neighbors
+#include "NearestNeighbor/LinearSearchBest/Property.hpp"
+#include "NearestNeighbor/PCAKDTreeKNN.hpp"
+#include "NearestNeighbor/TwoStepNearestNeighbor.hpp"
+
+// STL
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+int main()
+{
+  SearchTestProblem problem;
+
+  typedef SearchTestProblem::ImagePatchDescriptorMapType ImagePatchDescriptorMapType;
+  typedef SearchTestProblem::PatchDifferenceType PatchDifferenceType;
+  const itk::Size<2> size = problem.Image->GetLargestPossibleRegion().GetSize();
+
+  typedef PCAKDTreeKNN<ImagePatchDescriptorMapType, PatchDifferenceType> KNNSearchType;
+  KNNSearchType knnSearch(problem.ImagePatchDescriptorMap, 10);
+
+  // Re-rank every patch so that the result must be exact
+  knnSearch.SetNumberOfCandidates(size[0] * size[1]);
+  knnSearch.SetMaximumNumberOfChecks(size[0] * size[1]);
+
+  // Re-rank the candidates of the kd-tree with LinearSearchBestProperty
+  typedef LinearSearchBestProperty<ImagePatchDescriptorMapType, PatchDifferenceType> BestSearchType;
+  BestSearchType linearSearchBest(*problem.ImagePatchDescriptorMap);
+  TwoStepNearestNeighbor<KNNSearchType, BestSearchType> twoStepSearch(knnSearch, linearSearchBest);
+
+  // Partially valid target patches on each side of the hole, and fully valid target patches
+  itk::Index<2> targets[] = {{{25, 24}}, {{34, 27}}, {{29, 20}}, {{31, 29}}, {{10, 10}}, {{50, 40}}};
+  for(unsigned int targetId = 0; targetId < sizeof(targets) / sizeof(targets[0]); ++targetId)
+  {
+    if(!problem.CompareToLinearSearch(twoStepSearch, targets[targetId], "PCA kd-tree"))
+    {
+      std::cerr << "The PCA kd-tree search did not find the best patch for " << targets[targetId] << "!" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // With the default (approximate) settings, check that K neighbors are found and that they are sorted
+  KNNSearchType approximateKNNSearch(problem.ImagePatchDescriptorMap, 10);
+  typedef SearchTestProblem::VertexDescriptorType VertexDescriptorType;
+  std::vector<VertexDescriptorType> neighbors(approximateKNNSearch.GetK());
+  VertexDescriptorType targetNode = Helpers::ConvertFrom<VertexDescriptorType, itk::Index<2> >(targets[0]);
+  approximateKNNSearch(vertices(*problem.Graph).first, vertices(*problem.Graph).second, targetNode, neighbors.begin());
+
+  const ImagePatchDescriptorMapType& descriptorMap = *problem.ImagePatchDescriptorMap;
+  PatchDifferenceType patchDifference;
+  for(size_t neighborId = 1; neighborId < neighbors.size(); ++neighborId)
+  {
+    if(patchDifference(get(descriptorMap, neighbors[neighborId]), get(descriptorMap, targetNode)) <
+       patchDifference(get(descriptorMap, neighbors[neighborId - 1]), get(descriptorMap, targetNode)))
+    {
+      std::cerr << "The neighbors are not sorted!" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
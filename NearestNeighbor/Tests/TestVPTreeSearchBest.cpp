@@ -0,0 +1,77 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// Custom
+#include "NearestNeighbor/Tests/SearchTestProblem.hpp"
+
+// Submodules
+#include <Helpers/Helpers.h>
+#include <ITKHelpers/ITKHelpers.h>
+
+// Nearest neighbors
+#include "NearestNeighbor/VPTreeSearchBest.hpp"
+
+// STL
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+
+int main()
+{
+  SearchTestProblem problem;
+
+  typedef SearchTestProblem::ImageType ImageType;
+  typedef SearchTestProblem::ImagePatchDescriptorMapType ImagePatchDescriptorMapType;
+
+  VPTreeSearchBest<ImagePatchDescriptorMapType> vpTreeSearchBest(*problem.ImagePatchDescriptorMap);
+
+  // Partially valid target patches on each side of the hole, and fully valid target patches
+  itk::Index<2> targets[] = {{{25, 24}}, {{34, 27}}, {{29, 20}}, {{31, 29}}, {{10, 10}}, {{50, 40}}};
+  for(unsigned int targetId = 0; targetId < sizeof(targets) / sizeof(targets[0]); ++targetId)
+  {
+    if(!problem.CompareToLinearSearch(vpTreeSearchBest, targets[targetId], "VP-tree"))
+    {
+      std::cerr << "The VP-tree search did not find the best patch for " << targets[targetId] << "!" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // A query patch of another image with the same pixels (as SharedSourceBank searches) finds the same patch
+  ImageType::Pointer imageCopy = ImageType::New();
+  ITKHelpers::DeepCopy(problem.Image.GetPointer(), imageCopy.GetPointer());
+
+  std::shared_ptr<ImagePatchDescriptorMapType> copyDescriptorMap = problem.CreateDescriptorMap();
+  SearchTestProblem::ImagePatchDescriptorVisitorType copyDescriptorVisitor(imageCopy, problem.MaskImage,
+                                                                           copyDescriptorMap, problem.PatchHalfWidth);
+
+  typedef SearchTestProblem::VertexDescriptorType VertexDescriptorType;
+  VertexDescriptorType targetNode = Helpers::ConvertFrom<VertexDescriptorType, itk::Index<2> >(targets[0]);
+  copyDescriptorVisitor.InitializeVertex(targetNode);
+  copyDescriptorVisitor.DiscoverVertex(targetNode);
+
+  VertexDescriptorType copyResult = vpTreeSearchBest.FindBest(get(*copyDescriptorMap, targetNode));
+  VertexDescriptorType result = vpTreeSearchBest(vertices(*problem.Graph).first, vertices(*problem.Graph).second,
+                                                targetNode);
+  if(copyResult != result)
+  {
+    std::cerr << "The search for a patch of another image found a different patch!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
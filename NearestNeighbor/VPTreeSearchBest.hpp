@@ -0,0 +1,790 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef VPTreeSearchBest_HPP
+#define VPTreeSearchBest_HPP
+
+// Custom
+#include "DifferenceFunctions/Patch/SpanDifferenceKernels.hpp"
+#include "Utilities/RowMasks.hpp"
+#include "Utilities/TaskPool.h"
+
+// Submodules
+#include <Helpers/Helpers.h>
+#include <ITKHelpers/ITKContainerInterface.h>
+#include <Utilities/Debug/Debug.h>
+
+// ITK
+#include "itkImageRegionConstIterator.h"
+
+// Boost
+#include <boost/property_map/property_map.hpp>
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/**
+  * This class finds the source patch with the smallest sum of squared differences to a (partially valid) target
+  * patch using a vantage-point tree. It returns the same patch as LinearSearchBestProperty with
+  * ImagePatchDifference<..., SumSquaredPixelDifference> (up to ties).
+  *
+  * The tree is built over the SOURCE_NODEs of the range [first, last) with the Euclidean distance between the
+  * full patches. The full distances do not bound the distance over the valid pixels of a partially valid target
+  * patch (each invalid pixel can hide up to the largest squared difference of two pixels), so each node also
+  * keeps the smallest and largest value of every pixel component over the points of its subtree. The distance
+  * from the valid pixels of the query to this box is a lower bound of the masked distance to every point of the
+  * subtree, so it prunes the searches of the partially valid target patches on the fill front. Fully valid
+  * target patches use both these bounds and the usual vantage-point tree bounds. Both are exact, so the search
+  * is exact. The boxes take two floats per pixel component per node. FindBest can report how many tree nodes
+  * a query visited (see SearchStatistics).
+  *
+  * The tree is built when the range passed to operator() changes. If the range only grew at its end (which is
+  * how a SourcePatchBank grows when new patches are allowed), the new patches are inserted into the existing
+  * tree instead. The subtrees are built in parallel with tasks of the global TaskPool.
+  *
+  * The tree only stores the corner of each source patch. The pixels are read from the image when a distance
+  * is computed, which is fine because the pixels of a source patch do not change during the inpainting.
+  */
+template <typename PropertyMapType>
+class VPTreeSearchBest : public Debug
+{
+public:
+  typedef typename boost::property_traits<PropertyMapType>::key_type NodeType;
+  typedef typename PropertyMapType::value_type PatchType;
+  typedef typename PatchType::ImageType ImageType;
+
+  /** What one FindBest call did, to measure how well the tree prunes. */
+  struct SearchStatistics
+  {
+    /** Whether the query patch was fully valid, so the vantage point bounds were used too. */
+    bool FullyValid = false;
+
+    /** The number of nodes in the tree. */
+    size_t NumberOfNodes = 0;
+
+    /** The number of nodes the search visited. */
+    size_t NumberOfVisitedNodes = 0;
+  };
+
+  VPTreeSearchBest(PropertyMapType propertyMap, const unsigned int leafSize = 8) :
+    PropertyMap(propertyMap), LeafSize(leafSize) {}
+
+  /** Set the maximum number of points in a leaf when the tree is built. */
+  void SetLeafSize(const unsigned int leafSize)
+  {
+    if(leafSize == 0)
+    {
+      throw std::runtime_error("VPTreeSearchBest::SetLeafSize: the leaf size must be at least 1!");
+    }
+    this->LeafSize = leafSize;
+  }
+
+  /** Set the number of random points that are considered as the vantage point of each node. */
+  void SetNumberOfVantagePointCandidates(const unsigned int numberOfCandidates)
+  {
+    this->NumberOfVantagePointCandidates = std::max(numberOfCandidates, 1u);
+  }
+
+  /** Set the seed of the random vantage point selection, so that the tree is reproducible. */
+  void SetSeed(const unsigned int seed)
+  {
+    this->Seed = seed;
+  }
+
+  /** Get the number of source patches in the tree. */
+  size_t GetNumberOfPoints() const
+  {
+    return this->Points.size();
+  }
+
+  /** Get the number of nodes in the tree. */
+  size_t GetNumberOfNodes() const
+  {
+    return this->NumberOfNodes;
+  }
+
+  /** Build the tree from the SOURCE_NODEs in [first, last). */
+  template <typename TIterator>
+  void Build(TIterator first, TIterator last)
+  {
+    this->Points.clear();
+    this->PointCorners.clear();
+    this->SourceImage = nullptr;
+    this->Root.reset();
+    this->NumberOfNodes = 0;
+    this->NumberOfInsertedPoints = 0;
+    this->PatchWidth = 0;
+
+    this->AddSourcePatches(first, last);
+
+    this->BuildRangeFirst = *first;
+    this->BuildRangeLength = last - first;
+
+    if(this->Points.empty())
+    {
+      return;
+    }
+
+    std::vector<unsigned int> pointIds(this->Points.size());
+    for(unsigned int pointId = 0; pointId < pointIds.size(); ++pointId)
+    {
+      pointIds[pointId] = pointId;
+    }
+
+    std::mt19937 generator(this->Seed);
+    const unsigned int rootSeed = generator();
+
+    this->Root = this->BuildNode(pointIds.begin(), pointIds.end(), rootSeed);
+
+    this->NumberOfNodes = CountNodes(this->Root.get());
+  }
+
+  /**
+    * \param first Start of the range in which to search.
+    * \param last One element past the last element in the range in which to search.
+    * \param query The element to compare to.
+    * \return The element of the range whose patch best matches the valid pixels of the query patch.
+    */
+  template <typename TIterator>
+  typename TIterator::value_type operator()(TIterator first, TIterator last,
+                                            typename TIterator::value_type query)
+  {
+    // If the input element range is empty, there is nothing to do.
+    if(first == last)
+    {
+      return *last;
+    }
+
+    this->UpdateTree(first, last);
+
+    NodeType result = this->FindBest(get(this->PropertyMap, query));
+
+    this->DebugIteration++;
+
+    return result;
+  }
+
+  /** Search the tree as it was last built for the best match to 'queryPatch'. The query patch does not have to
+    * be in the property map (or even in the same image) as the source patches, since only its valid pixels are
+    * used. This does not change the tree, so it can be called concurrently (see SharedSourceBank).
+    * If 'statistics' is given, it is filled with what the search did. */
+  NodeType FindBest(const PatchType& queryPatch, SearchStatistics* const statistics = nullptr) const
+  {
+    if(!this->Root)
+    {
+      throw std::runtime_error("VPTreeSearchBest: No source patch was found in the search range!");
+    }
+
+    // Lay out the valid pixels of the query like the pixels of an extracted source patch (offsets from the corner)
+    std::vector<float> queryData;
+    std::vector<uint64_t> rowMasks;
+    const unsigned int numberOfValidPixels = this->ExtractQuery(queryPatch, queryData, rowMasks);
+    const bool fullyValid = (numberOfValidPixels == this->PatchWidth * this->PatchWidth);
+
+    // The pixels of the point being compared
+    std::vector<float> pointData(this->GetPointSize());
+
+    float bestSquaredDistance = std::numeric_limits<float>::infinity();
+    unsigned int bestPointId = 0;
+    size_t numberOfVisitedNodes = 0;
+    this->SearchNode(this->Root.get(), queryData, rowMasks, fullyValid, pointData, bestSquaredDistance, bestPointId,
+                     numberOfVisitedNodes);
+
+    if(statistics)
+    {
+      statistics->FullyValid = fullyValid;
+      statistics->NumberOfNodes = this->NumberOfNodes;
+      statistics->NumberOfVisitedNodes = numberOfVisitedNodes;
+    }
+
+    if(bestSquaredDistance == std::numeric_limits<float>::infinity())
+    {
+      throw std::runtime_error("VPTreeSearchBest: None of the patches in the tree is a source patch anymore!");
+    }
+
+    return this->Points[bestPointId];
+  }
+
+private:
+  /** A node of the tree. Internal nodes have a vantage point and two children, leaves have a list of points. */
+  struct TreeNode
+  {
+    unsigned int VantagePoint = 0;
+
+    /** The points closer to the vantage point than the median distance, and the others. */
+    std::unique_ptr<TreeNode> Inside;
+    std::unique_ptr<TreeNode> Outside;
+
+    /** The range of the distances from the vantage point to the points in each child. */
+    float InsideMin = 0.0f;
+    float InsideMax = 0.0f;
+    float OutsideMin = 0.0f;
+    float OutsideMax = 0.0f;
+
+    /** The points of a leaf. */
+    std::vector<unsigned int> LeafPoints;
+
+    /** The smallest and largest value of each pixel component (in the layout of ExtractPoint) over the points of
+      * the subtree, including the vantage point. */
+    std::vector<float> BoxMin;
+    std::vector<float> BoxMax;
+
+    bool IsLeaf() const
+    {
+      return !this->Inside;
+    }
+  };
+
+  PropertyMapType PropertyMap;
+
+  /** The maximum number of points in a leaf when the tree is built. */
+  unsigned int LeafSize;
+
+  /** The number of random points that are considered as the vantage point of each node. */
+  unsigned int NumberOfVantagePointCandidates = 5;
+
+  /** The number of random points used to estimate the spread of the distances from a candidate vantage point. */
+  unsigned int NumberOfSpreadSamples = 100;
+
+  /** Do not create tasks for subtrees smaller than this. */
+  unsigned int MinimumTaskSize = 1000;
+
+  unsigned int Seed = 0;
+
+  /** The nodes of the source patches in the tree. */
+  std::vector<NodeType> Points;
+
+  /** The corner of each source patch in SourceImage. */
+  std::vector<itk::Index<2> > PointCorners;
+
+  /** The image the source patches are in. */
+  const ImageType* SourceImage = nullptr;
+
+  unsigned int PatchWidth = 0;
+  unsigned int NumberOfComponents = 0;
+
+  std::unique_ptr<TreeNode> Root;
+
+  size_t NumberOfNodes = 0;
+
+  /** The first element and length of the range the tree was built from. */
+  NodeType BuildRangeFirst;
+  size_t BuildRangeLength = 0;
+
+  /** The number of points that have been inserted since the tree was built. */
+  size_t NumberOfInsertedPoints = 0;
+
+  size_t GetPointSize() const
+  {
+    return this->PatchWidth * this->PatchWidth * this->NumberOfComponents;
+  }
+
+  /** Copy the pixel components of a point from the image into 'pointData' (GetPointSize() floats, row by row). */
+  void ExtractPoint(const unsigned int pointId, std::vector<float>& pointData) const
+  {
+    itk::Size<2> patchSize = {{this->PatchWidth, this->PatchWidth}};
+    itk::ImageRegion<2> region(this->PointCorners[pointId], patchSize);
+
+    pointData.resize(this->GetPointSize());
+    std::vector<float>::iterator pointDataIterator = pointData.begin();
+
+    itk::ImageRegionConstIterator<ImageType> imageIterator(this->SourceImage, region);
+    while(!imageIterator.IsAtEnd())
+    {
+      typename ImageType::PixelType pixel = imageIterator.Get();
+      for(unsigned int component = 0; component < this->NumberOfComponents; ++component)
+      {
+        *pointDataIterator = static_cast<float>(Helpers::index(pixel, component));
+        ++pointDataIterator;
+      }
+      ++imageIterator;
+    }
+  }
+
+  float FullDistance(const std::vector<float>& pointDataA, const std::vector<float>& pointDataB) const
+  {
+    return std::sqrt(SpanDifferenceKernels::SumSquaredDifferences(pointDataA.data(), pointDataB.data(),
+                                                                  this->GetPointSize()));
+  }
+
+  static size_t CountNodes(const TreeNode* const node)
+  {
+    if(node->IsLeaf())
+    {
+      return 1;
+    }
+    return 1 + CountNodes(node->Inside.get()) + CountNodes(node->Outside.get());
+  }
+
+  /** Add the SOURCE_NODEs in [first, last) to Points. */
+  template <typename TIterator>
+  void AddSourcePatches(TIterator first, TIterator last)
+  {
+    for(TIterator current = first; current != last; ++current)
+    {
+      const PatchType& patch = get(this->PropertyMap, *current);
+      if(patch.GetStatus() != PatchType::SOURCE_NODE)
+      {
+        continue;
+      }
+
+      const itk::ImageRegion<2> region = patch.GetRegion();
+      if(this->PatchWidth == 0)
+      {
+        if(region.GetSize()[0] > 64 || region.GetSize()[0] != region.GetSize()[1])
+        {
+          throw std::runtime_error("VPTreeSearchBest: Patches must be square and at most 64 pixels wide!");
+        }
+        this->PatchWidth = region.GetSize()[0];
+        this->SourceImage = patch.GetImage();
+        this->NumberOfComponents = Helpers::length(this->SourceImage->GetPixel(region.GetIndex()));
+      }
+      else if(patch.GetImage() != this->SourceImage)
+      {
+        throw std::runtime_error("VPTreeSearchBest: All of the source patches must be in the same image!");
+      }
+
+      this->Points.push_back(*current);
+      this->PointCorners.push_back(region.GetIndex());
+    }
+  }
+
+  /** Rebuild the tree if the range changed, or insert the new points if the range only grew. */
+  template <typename TIterator>
+  void UpdateTree(TIterator first, TIterator last)
+  {
+    const size_t rangeLength = last - first;
+    if(this->BuildRangeLength > 0 && *first == this->BuildRangeFirst)
+    {
+      if(rangeLength == this->BuildRangeLength)
+      {
+        return;
+      }
+
+      // Rebuild once many points have been inserted, because insertion does not keep the tree balanced
+      if(rangeLength > this->BuildRangeLength && this->Root &&
+         this->NumberOfInsertedPoints + (rangeLength - this->BuildRangeLength) < this->Points.size() / 4)
+      {
+        const size_t firstNewPointId = this->Points.size();
+        this->AddSourcePatches(first + this->BuildRangeLength, last);
+        for(size_t pointId = firstNewPointId; pointId < this->Points.size(); ++pointId)
+        {
+          this->InsertPoint(pointId);
+        }
+        this->NumberOfInsertedPoints += this->Points.size() - firstNewPointId;
+        this->BuildRangeLength = rangeLength;
+        return;
+      }
+    }
+
+    this->Build(first, last);
+  }
+
+  /** Add a point to the leaf it falls in, widening the distance ranges of the nodes on the way. */
+  void InsertPoint(const unsigned int pointId)
+  {
+    std::vector<float> pointData;
+    this->ExtractPoint(pointId, pointData);
+    std::vector<float> vantagePointData;
+
+    TreeNode* node = this->Root.get();
+    while(!node->IsLeaf())
+    {
+      AddToBox(node, pointData);
+      this->ExtractPoint(node->VantagePoint, vantagePointData);
+      const float distance = this->FullDistance(vantagePointData, pointData);
+      if(distance < node->OutsideMin)
+      {
+        node->InsideMin = std::min(node->InsideMin, distance);
+        node->InsideMax = std::max(node->InsideMax, distance);
+        node = node->Inside.get();
+      }
+      else
+      {
+        node->OutsideMax = std::max(node->OutsideMax, distance);
+        node = node->Outside.get();
+      }
+    }
+    AddToBox(node, pointData);
+    node->LeafPoints.push_back(pointId);
+  }
+
+  /** Widen the box of 'node' so that it contains the point. */
+  static void AddToBox(TreeNode* const node, const std::vector<float>& pointData)
+  {
+    if(node->BoxMin.empty())
+    {
+      node->BoxMin = pointData;
+      node->BoxMax = pointData;
+      return;
+    }
+
+    for(size_t valueId = 0; valueId < pointData.size(); ++valueId)
+    {
+      node->BoxMin[valueId] = std::min(node->BoxMin[valueId], pointData[valueId]);
+      node->BoxMax[valueId] = std::max(node->BoxMax[valueId], pointData[valueId]);
+    }
+  }
+
+  /** Widen the box of 'node' so that it contains the box of 'child'. */
+  static void AddToBox(TreeNode* const node, const TreeNode* const child)
+  {
+    for(size_t valueId = 0; valueId < node->BoxMin.size(); ++valueId)
+    {
+      node->BoxMin[valueId] = std::min(node->BoxMin[valueId], child->BoxMin[valueId]);
+      node->BoxMax[valueId] = std::max(node->BoxMax[valueId], child->BoxMax[valueId]);
+    }
+  }
+
+  /** Build the subtree of the points [first, last). */
+  std::unique_ptr<TreeNode> BuildNode(std::vector<unsigned int>::iterator first,
+                                      std::vector<unsigned int>::iterator last, const unsigned int seed)
+  {
+    std::unique_ptr<TreeNode> node(new TreeNode);
+    const size_t numberOfPoints = last - first;
+
+    // Leaves need at least 2 points in each child to be worth splitting
+    if(numberOfPoints <= std::max(this->LeafSize, 2u))
+    {
+      node->LeafPoints.assign(first, last);
+
+      std::vector<float> pointData;
+      for(std::vector<unsigned int>::iterator pointIterator = first; pointIterator != last; ++pointIterator)
+      {
+        this->ExtractPoint(*pointIterator, pointData);
+        AddToBox(node.get(), pointData);
+      }
+      return node;
+    }
+
+    std::mt19937 generator(seed);
+
+    // Choose the vantage point with the largest spread of distances to a random sample of the points
+    std::iter_swap(first, first + this->ChooseVantagePoint(first, last, generator));
+    node->VantagePoint = *first;
+
+    std::vector<float> vantagePointData;
+    this->ExtractPoint(node->VantagePoint, vantagePointData);
+    std::vector<float> pointData;
+
+    std::vector<std::pair<float, unsigned int> > distances(numberOfPoints - 1);
+    for(size_t pointId = 1; pointId < numberOfPoints; ++pointId)
+    {
+      const unsigned int point = *(first + pointId);
+      this->ExtractPoint(point, pointData);
+      distances[pointId - 1] = std::make_pair(this->FullDistance(vantagePointData, pointData), point);
+    }
+
+    // Split at the median distance
+    const size_t numberOfInsidePoints = distances.size() / 2;
+    std::nth_element(distances.begin(), distances.begin() + numberOfInsidePoints, distances.end());
+
+    node->InsideMin = std::numeric_limits<float>::max();
+    node->InsideMax = 0.0f;
+    for(size_t pointId = 0; pointId < numberOfInsidePoints; ++pointId)
+    {
+      node->InsideMin = std::min(node->InsideMin, distances[pointId].first);
+      node->InsideMax = std::max(node->InsideMax, distances[pointId].first);
+    }
+
+    node->OutsideMin = std::numeric_limits<float>::max();
+    node->OutsideMax = 0.0f;
+    for(size_t pointId = numberOfInsidePoints; pointId < distances.size(); ++pointId)
+    {
+      node->OutsideMin = std::min(node->OutsideMin, distances[pointId].first);
+      node->OutsideMax = std::max(node->OutsideMax, distances[pointId].first);
+    }
+
+    for(size_t pointId = 0; pointId < distances.size(); ++pointId)
+    {
+      *(first + 1 + pointId) = distances[pointId].second;
+    }
+
+    // The seeds of the children are drawn here so the tree does not depend on the order the tasks run in
+    const unsigned int insideSeed = generator();
+    const unsigned int outsideSeed = generator();
+
+    std::vector<unsigned int>::iterator middle = first + 1 + numberOfInsidePoints;
+    TreeNode* nodePointer = node.get();
+
+    if(numberOfInsidePoints > this->MinimumTaskSize)
+    {
+      TaskGroup taskGroup;
+      taskGroup.Run([this, nodePointer, first, middle, insideSeed]()
+      {
+        nodePointer->Inside = this->BuildNode(first + 1, middle, insideSeed);
+      });
+      nodePointer->Outside = this->BuildNode(middle, last, outsideSeed);
+      taskGroup.Wait();
+    }
+    else
+    {
+      nodePointer->Inside = this->BuildNode(first + 1, middle, insideSeed);
+      nodePointer->Outside = this->BuildNode(middle, last, outsideSeed);
+    }
+
+    AddToBox(nodePointer, vantagePointData);
+    AddToBox(nodePointer, nodePointer->Inside.get());
+    AddToBox(nodePointer, nodePointer->Outside.get());
+
+    return node;
+  }
+
+  /** Return the position in [first, last) of the candidate with the largest standard deviation of the
+    * distances to a random sample of the points. */
+  size_t ChooseVantagePoint(std::vector<unsigned int>::iterator first, std::vector<unsigned int>::iterator last,
+                            std::mt19937& generator) const
+  {
+    const size_t numberOfPoints = last - first;
+    std::uniform_int_distribution<size_t> distribution(0, numberOfPoints - 1);
+
+    std::vector<float> candidateData;
+    std::vector<float> sampleData;
+
+    size_t bestCandidate = 0;
+    float bestSpread = -1.0f;
+    for(unsigned int candidateId = 0; candidateId < this->NumberOfVantagePointCandidates; ++candidateId)
+    {
+      const size_t candidate = distribution(generator);
+      this->ExtractPoint(*(first + candidate), candidateData);
+
+      const unsigned int numberOfSamples = std::min<size_t>(this->NumberOfSpreadSamples, numberOfPoints);
+      double sum = 0.0;
+      double squaredSum = 0.0;
+      for(unsigned int sampleId = 0; sampleId < numberOfSamples; ++sampleId)
+      {
+        this->ExtractPoint(*(first + distribution(generator)), sampleData);
+        const double distance = this->FullDistance(candidateData, sampleData);
+        sum += distance;
+        squaredSum += distance * distance;
+      }
+
+      const double mean = sum / numberOfSamples;
+      const float spread = static_cast<float>(std::max(squaredSum / numberOfSamples - mean * mean, 0.0));
+      if(spread > bestSpread)
+      {
+        bestSpread = spread;
+        bestCandidate = candidate;
+      }
+    }
+
+    return bestCandidate;
+  }
+
+  /** Copy the pixels of the query patch into 'queryData' with the same layout as ExtractPoint. The invalid pixels
+    * are left at 0 and are excluded by 'rowMasks'. Returns the number of valid pixels. */
+  unsigned int ExtractQuery(const PatchType& queryPatch, std::vector<float>& queryData,
+                            std::vector<uint64_t>& rowMasks) const
+  {
+    const std::vector<itk::Offset<2> >* validOffsets = queryPatch.GetValidOffsetsAddress();
+
+    queryData.assign(this->GetPointSize(), 0.0f);
+    for(std::vector<itk::Offset<2> >::const_iterator offsetIterator = validOffsets->begin();
+        offsetIterator != validOffsets->end(); ++offsetIterator)
+    {
+      if((*offsetIterator)[0] >= static_cast<itk::OffsetValueType>(this->PatchWidth) ||
+         (*offsetIterator)[1] >= static_cast<itk::OffsetValueType>(this->PatchWidth))
+      {
+        throw std::runtime_error("VPTreeSearchBest: The query patch is larger than the source patches!");
+      }
+
+      typename ImageType::PixelType pixel = queryPatch.GetImage()->GetPixel(queryPatch.GetCorner() + *offsetIterator);
+      float* queryPixel = &queryData[((*offsetIterator)[1] * this->PatchWidth + (*offsetIterator)[0]) *
+                                     this->NumberOfComponents];
+      for(unsigned int component = 0; component < this->NumberOfComponents; ++component)
+      {
+        queryPixel[component] = static_cast<float>(Helpers::index(pixel, component));
+      }
+    }
+
+    rowMasks = *(queryPatch.GetValidRowMasksAddress());
+
+    return validOffsets->size();
+  }
+
+  /** Points are only returned if they are still SOURCE_NODEs (like in LinearSearchBestProperty), but they are
+    * kept in the tree since their pixels are still valid for the bounds. */
+  bool IsSourcePatch(const unsigned int pointId) const
+  {
+    return get(this->PropertyMap, this->Points[pointId]).GetStatus() == PatchType::SOURCE_NODE;
+  }
+
+  /** The squared masked distance from extracted point data to the query, or std::numeric_limits<float>::max()
+    * if it is larger than 'threshold'. */
+  float MaskedSquaredDistance(const std::vector<float>& pointData, const std::vector<float>& queryData,
+                              const std::vector<uint64_t>& rowMasks, const float threshold) const
+  {
+    return SpanDifferenceKernels::MaskedPatchDifference(pointData.data(), queryData.data(),
+                                                        this->PatchWidth * this->NumberOfComponents,
+                                                        this->NumberOfComponents, rowMasks, threshold,
+                                                        SpanDifferenceKernels::SquaredDifferenceSpan());
+  }
+
+  /** Keep the point if it is a source patch that is closer to the query than the best one so far. */
+  void ComparePoint(const unsigned int pointId, const std::vector<float>& queryData,
+                    const std::vector<uint64_t>& rowMasks, std::vector<float>& pointData,
+                    float& bestSquaredDistance, unsigned int& bestPointId) const
+  {
+    if(!this->IsSourcePatch(pointId))
+    {
+      return;
+    }
+
+    this->ExtractPoint(pointId, pointData);
+    const float squaredDistance = this->MaskedSquaredDistance(pointData, queryData, rowMasks, bestSquaredDistance);
+    if(squaredDistance < bestSquaredDistance)
+    {
+      bestSquaredDistance = squaredDistance;
+      bestPointId = pointId;
+    }
+  }
+
+  /** Whether a child whose points are between 'minimum' and 'maximum' from the vantage point can contain a point
+    * closer than the best one so far (by the triangle inequality). */
+  static bool CanContainCloser(const float queryDistance, const float minimum, const float maximum,
+                               const float bestSquaredDistance)
+  {
+    // Allow for the rounding of the distances so that near ties are not pruned
+    const float bestDistance = std::sqrt(bestSquaredDistance) * (1.0f + 1e-4f) + 1e-4f;
+
+    return std::max(queryDistance - maximum, minimum - queryDistance) <= bestDistance;
+  }
+
+  /** The largest lower bound of the squared masked distance that can still belong to a point closer than the best
+    * one so far (allowing for the rounding of the distances, so that near ties are not pruned). */
+  static float GetBoxThreshold(const float bestSquaredDistance)
+  {
+    return bestSquaredDistance * (1.0f + 1e-4f) + 1e-4f;
+  }
+
+  /** The squared distance from the valid pixels of the query to the box of 'node', which is a lower bound of the
+    * squared masked distance to every point of the subtree. std::numeric_limits<float>::max() is returned as soon
+    * as it is known to be larger than 'threshold'. */
+  float BoxSquaredDistance(const TreeNode* const node, const std::vector<float>& queryData,
+                           const std::vector<uint64_t>& rowMasks, const float threshold) const
+  {
+    const size_t rowLength = this->PatchWidth * this->NumberOfComponents;
+    float squaredDistance = 0.0f;
+    for(size_t row = 0; row < rowMasks.size(); ++row)
+    {
+      uint64_t rowMask = rowMasks[row];
+      while(rowMask != 0)
+      {
+        const size_t firstValueId = row * rowLength + RowMasks::CountTrailingZeros(rowMask) *
+                                    this->NumberOfComponents;
+        rowMask &= rowMask - 1;
+
+        for(size_t valueId = firstValueId; valueId < firstValueId + this->NumberOfComponents; ++valueId)
+        {
+          const float outside = std::max(std::max(node->BoxMin[valueId] - queryData[valueId],
+                                                  queryData[valueId] - node->BoxMax[valueId]), 0.0f);
+          squaredDistance += outside * outside;
+        }
+      }
+
+      if(squaredDistance > threshold)
+      {
+        return std::numeric_limits<float>::max();
+      }
+    }
+
+    return squaredDistance;
+  }
+
+  void SearchNode(const TreeNode* node, const std::vector<float>& queryData, const std::vector<uint64_t>& rowMasks,
+                  const bool fullyValid, std::vector<float>& pointData, float& bestSquaredDistance,
+                  unsigned int& bestPointId, size_t& numberOfVisitedNodes) const
+  {
+    numberOfVisitedNodes++;
+
+    if(node->IsLeaf())
+    {
+      for(size_t leafPointId = 0; leafPointId < node->LeafPoints.size(); ++leafPointId)
+      {
+        this->ComparePoint(node->LeafPoints[leafPointId], queryData, rowMasks, pointData,
+                           bestSquaredDistance, bestPointId);
+      }
+      return;
+    }
+
+    const TreeNode* const children[2] = {node->Inside.get(), node->Outside.get()};
+
+    // The vantage point bounds only hold for the full distance
+    float queryDistance = 0.0f;
+    if(fullyValid)
+    {
+      // The exact distance to the vantage point is needed for the bounds, so do not stop early
+      this->ExtractPoint(node->VantagePoint, pointData);
+      const float squaredDistance = this->MaskedSquaredDistance(pointData, queryData, rowMasks,
+                                                                std::numeric_limits<float>::infinity());
+      if(squaredDistance < bestSquaredDistance && this->IsSourcePatch(node->VantagePoint))
+      {
+        bestSquaredDistance = squaredDistance;
+        bestPointId = node->VantagePoint;
+      }
+
+      queryDistance = std::sqrt(squaredDistance);
+    }
+    else
+    {
+      this->ComparePoint(node->VantagePoint, queryData, rowMasks, pointData, bestSquaredDistance, bestPointId);
+    }
+
+    float boxSquaredDistances[2];
+    for(unsigned int childId = 0; childId < 2; ++childId)
+    {
+      boxSquaredDistances[childId] = this->BoxSquaredDistance(children[childId], queryData, rowMasks,
+                                                              GetBoxThreshold(bestSquaredDistance));
+    }
+
+    // Search the child that is most likely to contain the best point first, so the best distance is small when
+    // the other one is checked
+    const bool insideFirst = fullyValid ? (queryDistance < node->OutsideMin) :
+                                          (boxSquaredDistances[0] <= boxSquaredDistances[1]);
+    for(unsigned int childOrder = 0; childOrder < 2; ++childOrder)
+    {
+      const unsigned int childId = ((childOrder == 0) == insideFirst) ? 0 : 1;
+      if(boxSquaredDistances[childId] > GetBoxThreshold(bestSquaredDistance))
+      {
+        continue;
+      }
+
+      if(fullyValid)
+      {
+        const float minimum = (childId == 0) ? node->InsideMin : node->OutsideMin;
+        const float maximum = (childId == 0) ? node->InsideMax : node->OutsideMax;
+        if(!CanContainCloser(queryDistance, minimum, maximum, bestSquaredDistance))
+        {
+          continue;
+        }
+      }
+
+      this->SearchNode(children[childId], queryData, rowMasks, fullyValid, pointData, bestSquaredDistance,
+                       bestPointId, numberOfVisitedNodes);
+    }
+  }
+};
+
+#endif
@@ -101,10 +101,8 @@ class random_best_vp_chooser {
       RandomAccessIter best_pt = aEnd;
       double best_dev = -1;
       //std::cout << "Number of loops: " << (aEnd - aBegin) / m_divider + 1 << std::endl;
-      int numLoops = (aEnd - aBegin) / m_divider + 1;
 
       for(unsigned int i=0; i < (aEnd - aBegin) / m_divider + 1;++i) {
-        std::cout << i << " out of " << numLoops << std::endl;
 	RandomAccessIter current_pt = aBegin + (m_rand() % (aEnd - aBegin));
 	double current_mean = 0.0;
 	double current_dev = 0.0;
@@ -24,6 +24,10 @@
 // ITK
 #include "itkImageRegion.h"
 
+// STL
+#include <cstdint>
+#include <vector>
+
 class Mask;
 
 /**
@@ -89,6 +93,10 @@ public:
   /** Get the valid offsets of the patch. */
   const std::vector<itk::Offset<2> > * GetValidOffsetsAddress() const {return &this->ValidOffsets;}
 
+  /** Get the valid pixel bitmask of each row of the patch (bit i is set if the pixel in column i is valid).
+    * This is empty if the patch is too wide to be described this way. */
+  const std::vector<uint64_t> * GetValidRowMasksAddress() const {return &this->ValidRowMasks;}
+
 private:
   /** The region in the image defining the location of the patch. */
   itk::ImageRegion<2> Region;
@@ -112,6 +120,10 @@ private:
       This is only used during the comparison to another patch if this patch has status TARGET_PATCH.*/
   std::vector<itk::Offset<2> > ValidOffsets;
 
+  /** The same information as ValidOffsets, stored as one bitmask per row so the difference functions can
+      compare runs of valid pixels at once (see SpanDifferenceKernels). */
+  std::vector<uint64_t> ValidRowMasks;
+
 };
 
 #include "ImagePatchPixelDescriptor.hpp"
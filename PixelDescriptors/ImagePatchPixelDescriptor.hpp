@@ -21,6 +21,9 @@
 
 #include "ImagePatchPixelDescriptor.h" // Appease syntax parser
 
+// Custom
+#include "Utilities/RowMasks.hpp"
+
 // Submodules
 #include <Mask/Mask.h>
 
@@ -129,6 +132,7 @@ template <typename TImage>
 void ImagePatchPixelDescriptor<TImage>::SetValidOffsets(const std::vector<itk::Offset<2> >& validOffsets)
 {
   this->ValidOffsets = validOffsets;
+  this->ValidRowMasks = RowMasks::ComputeRowMasks(validOffsets);
 }
 
 #endif
@@ -49,4 +49,25 @@ void PriorityConfidence::InitializeConfidenceMap()
 
 //   ITKHelpers::WriteImage(ConfidenceMapImage.GetPointer(), "ConfidenceMapInitial.mha");
 //   ITKHelpers::WriteScaledScalarImage(ConfidenceMapImage.GetPointer(), "ConfidenceMapInitial.png");
+
+  // With tiles as wide as a patch, a patch overlaps at most four tiles
+  this->ConfidenceSums.Initialize(this->MaskImage->GetLargestPossibleRegion(), 2 * this->PatchRadius + 1);
+  this->UpdateConfidenceSums(this->MaskImage->GetLargestPossibleRegion());
+}
+
+float PriorityConfidence::GetValidConfidence(const itk::Index<2>& pixel) const
+{
+  if(this->MaskImage->GetPixel(pixel) == this->MaskImage->GetValidValue())
+  {
+    return this->ConfidenceMapImage->GetPixel(pixel);
+  }
+  return 0.0f;
+}
+
+void PriorityConfidence::UpdateConfidenceSums(const itk::ImageRegion<2>& region)
+{
+  this->ConfidenceSums.Update(region, [this](const itk::Index<2>& pixel)
+  {
+    return this->GetValidConfidence(pixel);
+  });
 }
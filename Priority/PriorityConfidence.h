@@ -25,10 +25,16 @@
 #include <Mask/Mask.h>
 #include <Utilities/Debug/Debug.h>
 
+// Custom
+#include "Utilities/TiledSummedAreaTable.h"
+
 /**
 \class PriorityConfidence
 \brief This class ranks the priority of a patch based on confidence values
-       of the pixels it contains.
+       of the pixels it contains. The sums of the confidences of the valid pixels are kept in a
+       TiledSummedAreaTable, so the confidence term of a patch does not have to visit every pixel of the patch.
+       The table is refreshed around the target in Update(), so the mask must only change in the target
+       patches, and before Update() is called (as the inpainting visitors do).
 */
 class PriorityConfidence : public Debug
 {
@@ -64,6 +70,15 @@ protected:
   /** Keep track of the Confidence of each pixel*/
   ConfidenceImageType::Pointer ConfidenceMapImage;
 
+  /** The sums of the confidences of the valid pixels (see GetValidConfidence), in tiles as wide as a patch. */
+  TiledSummedAreaTable ConfidenceSums;
+
+  /** The confidence of a valid pixel, or zero for the other pixels. This is what ComputeConfidenceTerm sums. */
+  float GetValidConfidence(const itk::Index<2>& pixel) const;
+
+  /** Recompute the confidence sums of the tiles that overlap 'region'. */
+  void UpdateConfidenceSums(const itk::ImageRegion<2>& region);
+
   /** The initial confidence is 0 in the hole and 1 outside the hole.*/
   void InitializeConfidenceMap();
 
@@ -82,6 +82,8 @@ void PriorityConfidence::UpdateConfidences(const TNode& targetNode, const float
     ++confidenceImageIterator;
   }
 
+  // The mask has already been updated in this region, so the sums also pick up the newly valid pixels
+  this->UpdateConfidenceSums(region);
 }
 
 // Two iterators
@@ -129,7 +131,7 @@ void PriorityConfidence::UpdateConfidences(const TNode& targetNode, const float
 //  return confidence;
 //}
 
-// Single iterator, this is only marginally faster than the two iterator method above (~5s total in 300 iterations)
+// Summed area table, this reads at most four tiles per patch instead of every pixel of the patch
 template <typename TNode>
 float PriorityConfidence::ComputeConfidenceTerm(const TNode& queryNode) const
 {
@@ -142,21 +144,10 @@ float PriorityConfidence::ComputeConfidenceTerm(const TNode& queryNode) const
   // Ensure that the patch to use to compute the confidence is entirely inside the image
   region.Crop(this->MaskImage->GetLargestPossibleRegion());
 
-  itk::ImageRegionConstIteratorWithIndex<ConfidenceImageType> confidenceImageIterator(this->ConfidenceMapImage, region);
-
   // The confidence is computed as the sum of the confidences of patch pixels
   // in the source region / area of the patch
 
-  float sum = 0.0f;
-
-  while(!confidenceImageIterator.IsAtEnd())
-  {
-    if(this->MaskImage->GetPixel(confidenceImageIterator.GetIndex()) == this->MaskImage->GetValidValue())
-    {
-      sum += confidenceImageIterator.Get();
-    }
-    ++confidenceImageIterator;
-  }
+  float sum = static_cast<float>(this->ConfidenceSums.GetSum(region));
 
 //  if(sum == 0.0f)
 //  {
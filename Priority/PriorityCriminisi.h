@@ -21,9 +21,17 @@
 
 #include "PriorityConfidence.h"
 
+// Custom
+#include "ImageProcessing/BoundaryNormals.h"
+#include "ImageProcessing/FillFront.h"
+#include "ImageProcessing/Isophotes.h"
+
 // Submodules
 #include <Utilities/Debug/Debug.h>
 
+// STL
+#include <memory>
+
 /**
 \class PriorityCriminisi
 \brief This class implements Criminisi's priority function. It includes a Data term
@@ -55,6 +63,16 @@ public:
 
   using PriorityConfidence::ComputeConfidenceTerm;
 
+  /** Use this fill front (usually InpaintingVisitor::GetFillFront()) to find the boundary pixels for the
+    * debugging images, instead of creating a boundary image of the whole mask. */
+  void SetFillFront(std::shared_ptr<const FillFront> fillFront);
+
+  /** Compute the isophotes and the boundary normals in Update() with the direct kernels
+    * (Isophotes::ComputeColorIsophotesInRegionDirect and BoundaryNormals::ComputeBoundaryNormalsDirect)
+    * instead of the ITK filters. These reuse their buffers between the iterations, so they do not allocate
+    * after the first few iterations. This is off by default. */
+  void SetUseDirectKernels(const bool useDirectKernels);
+
 protected:
 
   typedef PriorityConfidence Superclass;
@@ -75,6 +93,18 @@ protected:
 //  const TImage* Image;
   const typename TImage::Pointer Image;
 
+  /** The fill front, if it has been set. */
+  std::shared_ptr<const FillFront> Front;
+
+  bool UseDirectKernels;
+
+  /** The boundary normals computer and the isophote buffers of the direct kernels. */
+  BoundaryNormals DirectBoundaryNormals;
+  Isophotes::DirectBuffers DirectIsophoteBuffers;
+
+  /** Get the pixels on the boundary of the hole, from the fill front if it is set. */
+  FillFront::PixelContainer GetBoundaryPixels() const;
+
   /** Write the current data image. */
   void WriteDataImage(const unsigned int patchNumber);
 
@@ -41,7 +41,8 @@ template <typename TImage>
 PriorityCriminisi<TImage>::PriorityCriminisi(const typename TImage::Pointer image,
                                              const Mask* const maskImage,
                                              const unsigned int patchRadius) :
-  PriorityConfidence(maskImage, patchRadius), Image(image)
+  PriorityConfidence(maskImage, patchRadius), Image(image), UseDirectKernels(false),
+  DirectBoundaryNormals(maskImage)
 {
   this->BoundaryNormalsImage = Vector2ImageType::New();
   ITKHelpers::InitializeImage(this->BoundaryNormalsImage.GetPointer(), image->GetLargestPossibleRegion());
@@ -77,18 +78,30 @@ void PriorityCriminisi<TImage>::Update(const TNode& sourceNode, const TNode& tar
   // Make sure the region is inside the image
   dilatedRegion.Crop(this->IsophoteImage->GetLargestPossibleRegion());
 
-  Isophotes::ComputeColorIsophotesInRegion(this->Image.GetPointer(), this->MaskImage,
-                                           dilatedRegion, this->IsophoteImage.GetPointer());
+  float maskBlurVariance = 2.0f;
 
-  // For debugging, we want to do this over the whole image
-//  Isophotes::ComputeColorIsophotesInRegion(this->Image, this->MaskImage,
-//                                           this->Image->GetLargestPossibleRegion(), this->IsophoteImage.GetPointer());
+  if(this->UseDirectKernels)
+  {
+    Isophotes::ComputeColorIsophotesInRegionDirect(this->Image.GetPointer(), this->MaskImage, dilatedRegion,
+                                                   this->IsophoteImage.GetPointer(), &this->DirectIsophoteBuffers);
 
-  BoundaryNormals boundaryNormals(this->MaskImage);
-  float maskBlurVariance = 2.0f;
-  boundaryNormals.SetDebugImages(true);
-  boundaryNormals.ComputeBoundaryNormals(this->BoundaryNormalsImage.GetPointer(),
-                                         maskBlurVariance, dilatedRegion);
+    this->DirectBoundaryNormals.ComputeBoundaryNormalsDirect(this->BoundaryNormalsImage.GetPointer(),
+                                                             maskBlurVariance, dilatedRegion);
+  }
+  else
+  {
+    Isophotes::ComputeColorIsophotesInRegion(this->Image.GetPointer(), this->MaskImage,
+                                             dilatedRegion, this->IsophoteImage.GetPointer());
+
+    // For debugging, we want to do this over the whole image
+//    Isophotes::ComputeColorIsophotesInRegion(this->Image, this->MaskImage,
+//                                             this->Image->GetLargestPossibleRegion(), this->IsophoteImage.GetPointer());
+
+    BoundaryNormals boundaryNormals(this->MaskImage);
+    boundaryNormals.SetDebugImages(true);
+    boundaryNormals.ComputeBoundaryNormals(this->BoundaryNormalsImage.GetPointer(),
+                                           maskBlurVariance, dilatedRegion);
+  }
 
   if(this->GetDebugImages())
   {
@@ -136,6 +149,36 @@ float PriorityCriminisi<TImage>::ComputeDataTerm(const itk::Index<2>& queryPixel
   return dataTerm;
 }
 
+template <typename TImage>
+void PriorityCriminisi<TImage>::SetFillFront(std::shared_ptr<const FillFront> fillFront)
+{
+  this->Front = fillFront;
+  this->DirectBoundaryNormals.SetFillFront(fillFront.get());
+}
+
+template <typename TImage>
+void PriorityCriminisi<TImage>::SetUseDirectKernels(const bool useDirectKernels)
+{
+  this->UseDirectKernels = useDirectKernels;
+}
+
+template <typename TImage>
+FillFront::PixelContainer PriorityCriminisi<TImage>::GetBoundaryPixels() const
+{
+  if(this->Front)
+  {
+    return this->Front->GetFrontPixels();
+  }
+
+  Mask::BoundaryImageType::Pointer boundaryImage = Mask::BoundaryImageType::New();
+  boundaryImage->SetRegions(this->Image->GetLargestPossibleRegion());
+  boundaryImage->Allocate();
+
+  this->MaskImage->CreateBoundaryImage(boundaryImage, Mask::VALID, 255);
+
+  return ITKHelpers::GetNonZeroPixels(boundaryImage.GetPointer());
+}
+
 template <typename TImage>
 void PriorityCriminisi<TImage>::WriteBoundaryImage(const unsigned int patchNumber)
 {
@@ -145,7 +188,14 @@ void PriorityCriminisi<TImage>::WriteBoundaryImage(const unsigned int patchNumbe
   boundaryImage->SetRegions(this->Image->GetLargestPossibleRegion());
   boundaryImage->Allocate();
 
-  this->MaskImage->CreateBoundaryImage(boundaryImage, Mask::VALID, 255);
+  if(this->Front)
+  {
+    this->Front->CreateBoundaryImage(boundaryImage, 255);
+  }
+  else
+  {
+    this->MaskImage->CreateBoundaryImage(boundaryImage, Mask::VALID, 255);
+  }
 
   ITKHelpers::WriteImage(boundaryImage.GetPointer(),
                          Helpers::GetSequentialFileName("BoundaryImage", patchNumber, "mha", 3));
@@ -160,14 +210,8 @@ void PriorityCriminisi<TImage>::WriteDataImage(const unsigned int patchNumber)
   dataImage->Allocate();
   dataImage->FillBuffer(0);
 
-  Mask::BoundaryImageType::Pointer boundaryImage = Mask::BoundaryImageType::New();
-  boundaryImage->SetRegions(this->Image->GetLargestPossibleRegion());
-  boundaryImage->Allocate();
-  
-  this->MaskImage->CreateBoundaryImage(boundaryImage, Mask::VALID, 255);
-
   typedef std::vector<itk::Index<2> > PixelCollection;
-  PixelCollection boundaryPixels = ITKHelpers::GetNonZeroPixels(boundaryImage.GetPointer());
+  PixelCollection boundaryPixels = this->GetBoundaryPixels();
 
   for(PixelCollection::const_iterator iter = boundaryPixels.begin(); iter != boundaryPixels.end(); ++iter)
   {
@@ -187,14 +231,8 @@ void PriorityCriminisi<TImage>::WritePriorityImage(const unsigned int patchNumbe
   priorityImage->Allocate();
   priorityImage->FillBuffer(0);
 
-  Mask::BoundaryImageType::Pointer boundaryImage = Mask::BoundaryImageType::New();
-  boundaryImage->SetRegions(this->Image->GetLargestPossibleRegion());
-  boundaryImage->Allocate();
-
-  this->MaskImage->CreateBoundaryImage(boundaryImage, Mask::VALID, 255);
-
   typedef std::vector<itk::Index<2> > PixelCollection;
-  PixelCollection boundaryPixels = ITKHelpers::GetNonZeroPixels(boundaryImage.GetPointer());
+  PixelCollection boundaryPixels = this->GetBoundaryPixels();
 
   for(PixelCollection::const_iterator iter = boundaryPixels.begin(); iter != boundaryPixels.end(); ++iter)
   {
@@ -9,6 +9,8 @@
 # then the call to this script would be
 # bash RunOnAllImages.bash ~/build/Projects/PatchBasedInpainting/ClassicalImageInpainting /media/portable/Inpainting/pictures/small 15
 
+# To run many images in one process (and concurrently), write a job list for the BatchImageInpainting executable instead.
+
 # CVPR Paper timings:
 # SSD:
 # time bash /media/portable/Projects/PatchBasedInpaintingDevelop/Scripts/RunOnAllImages.bash ~/build/Projects/PatchBasedInpainting/ClassicalImageInpainting /media/portable/Data/Inpainting/pictures/small/ 15
@@ -0,0 +1,184 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef CoarseToFineSearch_HPP
+#define CoarseToFineSearch_HPP
+
+// Custom
+#include <Helpers/Helpers.h>
+#include <ITKHelpers/ITKHelpers.h>
+#include <PixelDescriptors/PixelDescriptor.h>
+#include "Utilities/PyramidHelpers.hpp"
+
+// ITK
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImage.h"
+
+// STL
+#include <algorithm>
+#include <set>
+#include <vector>
+
+/**
+  * This class returns the source nodes in small windows around the locations that the level above
+  * (half the resolution) of an image pyramid copied the target patch from. It is intended for use with
+  * InpaintingAlgorithmWithLocalSearch in PyramidImageInpainting.
+  *
+  * 'coarseSourcePixelMap' is the InpaintingVisitor::GetSourcePixelMapImage() of the level above: the pixel
+  * that each coarse pixel was copied from, or (-1,-1) if it was not copied. Each coarse pixel under the target
+  * patch that was copied predicts a fine source patch location (the target plus twice the coarse offset), and
+  * the windows of 'radius' around the distinct predictions are searched. If the level above has no prediction
+  * for the target patch, or there are no source patches in the windows, a NeighborhoodSearch-like region of
+  * 'fallbackRadius' around the target (and finally the whole image) is searched instead.
+  */
+template <typename TVertexDescriptorType, typename TImagePatchDescriptorMap>
+struct CoarseToFineSearch
+{
+  typedef itk::Image<itk::Index<2>, 2> SourcePixelMapImageType;
+
+  typedef std::vector<TVertexDescriptorType> VectorType;
+
+  itk::ImageRegion<2> FullRegion;
+
+  SourcePixelMapImageType::Pointer CoarseSourcePixelMap;
+
+  unsigned int PatchHalfWidth;
+
+  unsigned int Radius;
+
+  unsigned int FallbackRadius;
+
+  TImagePatchDescriptorMap ImagePatchDescriptorMap;
+
+  /** The pixels of FullRegion that were searched for a target patch are set to the current SearchId, so the
+    * windows do not have to be cleared or compared with each other. */
+  std::vector<unsigned int> SearchIds;
+
+  unsigned int SearchId;
+
+  /**
+    * 'fullRegion' is the region of the image that is being inpainted.
+    */
+  CoarseToFineSearch(const itk::ImageRegion<2>& fullRegion, SourcePixelMapImageType* const coarseSourcePixelMap,
+                     const unsigned int patchHalfWidth, const unsigned int radius,
+                     const unsigned int fallbackRadius, TImagePatchDescriptorMap imagePatchDescriptorMap) :
+    FullRegion(fullRegion), CoarseSourcePixelMap(coarseSourcePixelMap), PatchHalfWidth(patchHalfWidth),
+    Radius(radius), FallbackRadius(fallbackRadius), ImagePatchDescriptorMap(imagePatchDescriptorMap),
+    SearchIds(fullRegion.GetNumberOfPixels(), 0), SearchId(0)
+  {
+
+  }
+
+  VectorType operator()(const TVertexDescriptorType& center)
+  {
+    // Convert to an ITK type
+    itk::Index<2> centerIndex =
+        Helpers::ConvertFrom<itk::Index<2>, TVertexDescriptorType>(center);
+
+    // Collect the distinct predicted source locations from the coarse pixels under the target patch
+    itk::ImageRegion<2> coarseRegion =
+        ITKHelpers::GetRegionInRadiusAroundPixel(PyramidHelpers::GetCoarseIndex(centerIndex),
+                                                 (this->PatchHalfWidth + 1) / 2);
+    coarseRegion.Crop(this->CoarseSourcePixelMap->GetLargestPossibleRegion());
+
+    std::set<itk::Index<2>, itk::Index<2>::LexicographicCompare> predictions;
+    itk::ImageRegionConstIteratorWithIndex<SourcePixelMapImageType> coarseIterator(this->CoarseSourcePixelMap,
+                                                                                   coarseRegion);
+    while(!coarseIterator.IsAtEnd())
+    {
+      itk::Index<2> coarseSource = coarseIterator.Get();
+
+      // Valid coarse pixels map to themselves and do not say anything about where the hole was copied from
+      if(coarseSource[0] >= 0 && coarseSource != coarseIterator.GetIndex())
+      {
+        itk::Offset<2> coarseOffset = coarseSource - coarseIterator.GetIndex();
+        predictions.insert(centerIndex + coarseOffset + coarseOffset);
+      }
+      ++coarseIterator;
+    }
+
+    this->SearchId++;
+    if(this->SearchId == 0)
+    {
+      // The ids wrapped around, so the pixels searched by an earlier target could look searched
+      std::fill(this->SearchIds.begin(), this->SearchIds.end(), 0);
+      this->SearchId = 1;
+    }
+
+    VectorType vertices;
+    for(typename std::set<itk::Index<2>, itk::Index<2>::LexicographicCompare>::const_iterator predictionIterator =
+        predictions.begin(); predictionIterator != predictions.end(); ++predictionIterator)
+    {
+      this->AddSourceNodesInRegion(ITKHelpers::GetRegionInRadiusAroundPixel(*predictionIterator, this->Radius),
+                                   vertices);
+    }
+
+    if(vertices.empty())
+    {
+      this->AddSourceNodesInRegion(ITKHelpers::GetRegionInRadiusAroundPixel(centerIndex, this->FallbackRadius),
+                                   vertices);
+    }
+
+    if(vertices.empty())
+    {
+      this->AddSourceNodesInRegion(this->FullRegion, vertices);
+    }
+
+    return vertices;
+  }
+
+private:
+  /** Append the source nodes in 'region' that were not in a region that was already searched for this target
+    * patch. The windows around nearby predictions usually overlap, and each node must only be returned once. */
+  void AddSourceNodesInRegion(itk::ImageRegion<2> region, VectorType& vertices)
+  {
+    // Ensure the region is entirely inside the image
+    if(!region.Crop(this->FullRegion))
+    {
+      return;
+    }
+
+    const itk::Index<2> fullCorner = this->FullRegion.GetIndex();
+    const size_t fullWidth = this->FullRegion.GetSize()[0];
+
+    const itk::Index<2> corner = region.GetIndex();
+    for(long y = corner[1]; y < corner[1] + static_cast<long>(region.GetSize()[1]); ++y)
+    {
+      for(long x = corner[0]; x < corner[0] + static_cast<long>(region.GetSize()[0]); ++x)
+      {
+        const size_t linearIndex = (y - fullCorner[1]) * fullWidth + (x - fullCorner[0]);
+        if(this->SearchIds[linearIndex] == this->SearchId)
+        {
+          continue;
+        }
+        this->SearchIds[linearIndex] = this->SearchId;
+
+        itk::Index<2> index = {{x, y}};
+        TVertexDescriptorType vert = Helpers::ConvertFrom<TVertexDescriptorType, itk::Index<2> > (index);
+
+        if(get(this->ImagePatchDescriptorMap, vert).GetStatus() == PixelDescriptor::SOURCE_NODE)
+        {
+          vertices.push_back(vert);
+        }
+      }
+    }
+  }
+
+};
+
+#endif
@@ -0,0 +1,209 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// Custom
+#include "PixelDescriptors/PixelDescriptor.h"
+#include "SearchRegions/CoarseToFineSearch.hpp"
+
+// Submodules
+#include <Helpers/Helpers.h>
+#include <ITKHelpers/ITKHelpers.h>
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+// Boost
+#include <boost/graph/grid_graph.hpp>
+#include <boost/property_map/property_map.hpp>
+
+// STL
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+typedef boost::grid_graph<2> VertexListGraphType;
+typedef boost::graph_traits<VertexListGraphType>::vertex_descriptor VertexDescriptorType;
+typedef boost::property_map<VertexListGraphType, boost::vertex_index_t>::const_type IndexMapType;
+typedef boost::vector_property_map<PixelDescriptor, IndexMapType> DescriptorMapType;
+typedef CoarseToFineSearch<VertexDescriptorType, DescriptorMapType> CoarseToFineSearchType;
+
+typedef std::set<std::pair<size_t, size_t> > NodeSetType;
+
+/** Create a coarse source pixel map in which every pixel maps to itself, as valid pixels do. */
+static CoarseToFineSearchType::SourcePixelMapImageType::Pointer CreateCoarseSourcePixelMap(
+    const itk::ImageRegion<2>& coarseRegion)
+{
+  CoarseToFineSearchType::SourcePixelMapImageType::Pointer coarseSourcePixelMap =
+      CoarseToFineSearchType::SourcePixelMapImageType::New();
+  coarseSourcePixelMap->SetRegions(coarseRegion);
+  coarseSourcePixelMap->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<CoarseToFineSearchType::SourcePixelMapImageType>
+      coarseIterator(coarseSourcePixelMap, coarseRegion);
+  while(!coarseIterator.IsAtEnd())
+  {
+    coarseIterator.Set(coarseIterator.GetIndex());
+    ++coarseIterator;
+  }
+
+  return coarseSourcePixelMap;
+}
+
+/** The source nodes that are in any of the 'regions'. */
+static NodeSetType GetSourceNodesInRegions(const DescriptorMapType& descriptorMap,
+                                           const itk::ImageRegion<2>& fullRegion,
+                                           const std::vector<itk::ImageRegion<2> >& regions)
+{
+  NodeSetType nodes;
+  std::vector<itk::Index<2> > indices = ITKHelpers::GetIndicesInRegion(fullRegion);
+  for(size_t indexId = 0; indexId < indices.size(); ++indexId)
+  {
+    bool inside = false;
+    for(size_t regionId = 0; regionId < regions.size(); ++regionId)
+    {
+      inside = inside || regions[regionId].IsInside(indices[indexId]);
+    }
+
+    VertexDescriptorType node = Helpers::ConvertFrom<VertexDescriptorType, itk::Index<2> >(indices[indexId]);
+    if(inside && get(descriptorMap, node).GetStatus() == PixelDescriptor::SOURCE_NODE)
+    {
+      nodes.insert(std::make_pair(node[0], node[1]));
+    }
+  }
+  return nodes;
+}
+
+/** Search around 'targetPixel' and check that exactly the 'expectedNodes' are returned, each of them once. */
+static bool CheckSearch(CoarseToFineSearchType& coarseToFineSearch, const itk::Index<2>& targetPixel,
+                        const NodeSetType& expectedNodes, const std::string& description)
+{
+  CoarseToFineSearchType::VectorType vertices =
+      coarseToFineSearch(Helpers::ConvertFrom<VertexDescriptorType, itk::Index<2> >(targetPixel));
+
+  NodeSetType nodes;
+  for(size_t vertexId = 0; vertexId < vertices.size(); ++vertexId)
+  {
+    if(!nodes.insert(std::make_pair(vertices[vertexId][0], vertices[vertexId][1])).second)
+    {
+      std::cerr << description << ": " << vertices[vertexId][0] << " " << vertices[vertexId][1]
+                << " was returned twice!" << std::endl;
+      return false;
+    }
+  }
+
+  if(nodes != expectedNodes)
+  {
+    std::cerr << description << ": " << nodes.size() << " nodes were returned instead of the "
+              << expectedNodes.size() << " expected source nodes!" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+int main(int, char*[])
+{
+  const unsigned int patchHalfWidth = 3;
+  const unsigned int radius = 2;
+  const unsigned int fallbackRadius = 3;
+
+  itk::Index<2> corner = {{0, 0}};
+  itk::Size<2> size = {{20, 16}};
+  itk::ImageRegion<2> fullRegion(corner, size);
+
+  boost::array<std::size_t, 2> graphSideLengths = { { size[0], size[1] } };
+  VertexListGraphType graph(graphSideLengths);
+  IndexMapType indexMap(get(boost::vertex_index, graph));
+  DescriptorMapType descriptorMap(num_vertices(graph), indexMap);
+
+  // Every patch is a source patch except those around a hole
+  itk::Index<2> holeCorner = {{6, 4}};
+  itk::Size<2> holeSize = {{8, 8}};
+  itk::ImageRegion<2> holeRegion(holeCorner, holeSize);
+
+  std::vector<itk::Index<2> > indices = ITKHelpers::GetIndicesInRegion(fullRegion);
+  for(size_t indexId = 0; indexId < indices.size(); ++indexId)
+  {
+    VertexDescriptorType node = Helpers::ConvertFrom<VertexDescriptorType, itk::Index<2> >(indices[indexId]);
+    PixelDescriptor descriptor;
+    descriptor.SetStatus(holeRegion.IsInside(indices[indexId]) ? PixelDescriptor::INVALID :
+                                                                 PixelDescriptor::SOURCE_NODE);
+    put(descriptorMap, node, descriptor);
+  }
+
+  itk::ImageRegion<2> coarseRegion = PyramidHelpers::GetDownsampledRegion(fullRegion);
+  CoarseToFineSearchType::SourcePixelMapImageType::Pointer coarseSourcePixelMap =
+      CreateCoarseSourcePixelMap(coarseRegion);
+
+  // Two coarse pixels under the target patch at (10, 8) were copied with the offset (-3, -3), and one with the
+  // offset (-2, -1). The windows around the two predicted fine locations overlap outside of the hole.
+  itk::Index<2> copiedPixels[] = {{{5, 4}}, {{5, 5}}, {{4, 4}}};
+  itk::Offset<2> copyOffsets[] = {{{-3, -3}}, {{-3, -3}}, {{-2, -1}}};
+  for(unsigned int pixelId = 0; pixelId < 3; ++pixelId)
+  {
+    coarseSourcePixelMap->SetPixel(copiedPixels[pixelId], copiedPixels[pixelId] + copyOffsets[pixelId]);
+  }
+
+  CoarseToFineSearchType coarseToFineSearch(fullRegion, coarseSourcePixelMap, patchHalfWidth, radius,
+                                            fallbackRadius, descriptorMap);
+
+  itk::Index<2> predictedTarget = {{10, 8}};
+  std::vector<itk::ImageRegion<2> > predictedWindows;
+  predictedWindows.push_back(ITKHelpers::GetRegionInRadiusAroundPixel(predictedTarget + copyOffsets[0] +
+                                                                      copyOffsets[0], radius));
+  predictedWindows.push_back(ITKHelpers::GetRegionInRadiusAroundPixel(predictedTarget + copyOffsets[2] +
+                                                                      copyOffsets[2], radius));
+  NodeSetType predictedNodes = GetSourceNodesInRegions(descriptorMap, fullRegion, predictedWindows);
+  if(!CheckSearch(coarseToFineSearch, predictedTarget, predictedNodes, "Predicted windows"))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // The level above has no prediction for a target patch in the corner, so the fallback window is searched
+  itk::Index<2> cornerTarget = {{2, 14}};
+  std::vector<itk::ImageRegion<2> > fallbackWindow(1,
+      ITKHelpers::GetRegionInRadiusAroundPixel(cornerTarget, fallbackRadius));
+  if(!CheckSearch(coarseToFineSearch, cornerTarget,
+                  GetSourceNodesInRegions(descriptorMap, fullRegion, fallbackWindow), "Fallback window"))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // The pixels that were searched for the previous target patches are searched again for the next ones
+  if(!CheckSearch(coarseToFineSearch, predictedTarget, predictedNodes, "Predicted windows again"))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Without a prediction and without source nodes in the fallback window, the whole image is searched
+  CoarseToFineSearchType fullImageFallbackSearch(fullRegion, CreateCoarseSourcePixelMap(coarseRegion),
+                                                 patchHalfWidth, radius, 1, descriptorMap);
+  itk::Index<2> holeTarget = {{10, 8}};
+  std::vector<itk::ImageRegion<2> > wholeImage(1, fullRegion);
+  if(!CheckSearch(fullImageFallbackSearch, holeTarget,
+                  GetSourceNodesInRegions(descriptorMap, fullRegion, wholeImage), "Whole image"))
+  {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
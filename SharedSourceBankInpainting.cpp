@@ -0,0 +1,114 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// ITK
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkCovariantVector.h"
+
+// Submodules
+#include <Helpers/Helpers.h>
+#include <ITKHelpers/ITKHelpers.h>
+#include <Mask/Mask.h>
+
+// STL
+#include <sstream>
+#include <vector>
+
+#include "Drivers/SharedSourceBankInpainting.hpp"
+
+// Run with: Data/background.png Data/background.mask 15 frame1.png frame1.mask frame1_filled.png frame2.png ...
+int main(int argc, char *argv[])
+{
+  // Verify arguments
+  if(argc < 7 || (argc - 4) % 3 != 0)
+  {
+    std::cerr << "Required arguments: reference.png reference.mask patchHalfWidth "
+              << "image1.png image1.mask output1.png [image2.png image2.mask output2.png ...]" << std::endl;
+    std::cerr << "Input arguments: ";
+    for(int i = 1; i < argc; ++i)
+    {
+      std::cerr << argv[i] << " ";
+    }
+    return EXIT_FAILURE;
+  }
+
+  // Parse arguments
+  std::string referenceFilename = argv[1];
+  std::string referenceMaskFilename = argv[2];
+
+  std::stringstream ssPatchHalfWidth;
+  ssPatchHalfWidth << argv[3];
+  unsigned int patchHalfWidth = 0;
+  ssPatchHalfWidth >> patchHalfWidth;
+
+  typedef itk::Image<itk::CovariantVector<int, 3>, 2> OriginalImageType;
+  typedef itk::ImageFileReader<OriginalImageType> ImageReaderType;
+
+  // Build the source bank of the reference image
+  ImageReaderType::Pointer referenceReader = ImageReaderType::New();
+  referenceReader->SetFileName(referenceFilename);
+  referenceReader->Update();
+
+  OriginalImageType::Pointer referenceImage = OriginalImageType::New();
+  ITKHelpers::DeepCopy(referenceReader->GetOutput(), referenceImage.GetPointer());
+
+  Mask::Pointer referenceMask = Mask::New();
+  referenceMask->Read(referenceMaskFilename);
+
+  SharedSourceBank<OriginalImageType> sourceBank(referenceImage, referenceMask.GetPointer(), patchHalfWidth);
+
+  // Read the images to inpaint
+  std::vector<OriginalImageType::Pointer> images;
+  std::vector<Mask::Pointer> masks;
+  std::vector<std::string> outputFileNames;
+  for(int argumentId = 4; argumentId + 2 < argc; argumentId += 3)
+  {
+    ImageReaderType::Pointer imageReader = ImageReaderType::New();
+    imageReader->SetFileName(argv[argumentId]);
+    imageReader->Update();
+
+    OriginalImageType::Pointer image = OriginalImageType::New();
+    ITKHelpers::DeepCopy(imageReader->GetOutput(), image.GetPointer());
+    images.push_back(image);
+
+    Mask::Pointer mask = Mask::New();
+    mask->Read(argv[argumentId + 1]);
+    masks.push_back(mask);
+
+    outputFileNames.push_back(argv[argumentId + 2]);
+  }
+
+  SharedSourceBankInpainting(sourceBank, images, masks);
+
+  for(size_t imageId = 0; imageId < images.size(); ++imageId)
+  {
+    // If the output filename is a png file, then use the RGBImage writer so that it is first
+    // casted to unsigned char. Otherwise, write the file directly.
+    if(Helpers::GetFileExtension(outputFileNames[imageId]) == "png")
+    {
+      ITKHelpers::WriteRGBImage(images[imageId].GetPointer(), outputFileNames[imageId]);
+    }
+    else
+    {
+      ITKHelpers::WriteImage(images[imageId].GetPointer(), outputFileNames[imageId]);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
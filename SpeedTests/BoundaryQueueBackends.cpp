@@ -0,0 +1,276 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// ITK
+#include "itkImageFileReader.h"
+#include "itkTimeProbe.h"
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+#include <Mask/Mask.h>
+
+// Custom
+#include "Drivers/ClassicalImageInpainting.hpp"
+#include "Utilities/IndirectPriorityQueue.h"
+#include "Utilities/PriorityQueueBackends.h"
+
+// Boost
+#include <boost/graph/grid_graph.hpp>
+
+// STL
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+typedef boost::grid_graph<2> VertexListGraphType;
+typedef boost::graph_traits<VertexListGraphType>::vertex_descriptor VertexDescriptorType;
+
+/** One line of a queue trace (see IndirectPriorityQueue::SetTraceStream). */
+struct QueueOperation
+{
+  char Type;
+  VertexDescriptorType Node;
+  float Priority;
+};
+
+struct QueueTrace
+{
+  boost::array<std::size_t, 2> SideLengths;
+  std::vector<QueueOperation> Operations;
+  float MinimumPriority;
+  float MaximumPriority;
+};
+
+/** Read a trace whose first line is the width and height of the image. */
+QueueTrace ReadQueueTrace(const std::string& traceFileName)
+{
+  std::ifstream traceStream(traceFileName.c_str());
+  if(!traceStream)
+  {
+    throw std::runtime_error("Could not open " + traceFileName);
+  }
+
+  QueueTrace trace;
+  trace.MinimumPriority = std::numeric_limits<float>::max();
+  trace.MaximumPriority = -std::numeric_limits<float>::max();
+  traceStream >> trace.SideLengths[0] >> trace.SideLengths[1];
+
+  QueueOperation operation;
+  while(traceStream >> operation.Type)
+  {
+    operation.Priority = 0.0f;
+    if(operation.Type == 'P' || operation.Type == 'I' || operation.Type == 'T')
+    {
+      traceStream >> operation.Node[0] >> operation.Node[1];
+    }
+    if(operation.Type == 'P')
+    {
+      traceStream >> operation.Priority;
+      trace.MinimumPriority = std::min(trace.MinimumPriority, operation.Priority);
+      trace.MaximumPriority = std::max(trace.MaximumPriority, operation.Priority);
+    }
+    trace.Operations.push_back(operation);
+  }
+
+  return trace;
+}
+
+template <typename TQueueBackend>
+void ConfigureBackend(TQueueBackend&, const QueueTrace&)
+{
+
+}
+
+/** Spread the priorities of the trace over the buckets. */
+void ConfigureBackend(BucketQueueBackend<VertexListGraphType>& backend, const QueueTrace& trace)
+{
+  backend.SetNumberOfBuckets(1024);
+  if(trace.MinimumPriority < trace.MaximumPriority)
+  {
+    backend.SetPriorityRange(trace.MinimumPriority, trace.MaximumPriority);
+  }
+}
+
+/** Replay the trace 'numberOfRepetitions' times on a new queue with TQueueBackend, and output the mean time.
+  * The nodes that are pushed and invalidated after a top() depend on the node that top() returned when the
+  * trace was recorded, so each top() is compared to the recorded node. A node of the same priority counts as
+  * the same (ties can come out in any order). If the node is different, it is pushed back and the recorded node
+  * is invalidated, so that the rest of the trace is replayed on the same nodes as when it was recorded.
+  * Returns the number of top() calls that returned the recorded node or a node of the same priority. */
+template <typename TQueueBackend>
+size_t ReplayQueueTrace(const QueueTrace& trace, const std::string& backendName,
+                        const unsigned int numberOfRepetitions)
+{
+  typedef IndirectPriorityQueue<VertexListGraphType, TQueueBackend> QueueType;
+
+  VertexListGraphType graph(trace.SideLengths);
+
+  // The last priority that each node was pushed with
+  std::vector<float> priorities(trace.SideLengths[0] * trace.SideLengths[1], 0.0f);
+
+  size_t numberOfSameNodes = 0;
+  itk::TimeProbe replayClock;
+  for(unsigned int repetition = 0; repetition < numberOfRepetitions; ++repetition)
+  {
+    QueueType queue(graph);
+    ConfigureBackend(queue.GetBackend(), trace);
+    numberOfSameNodes = 0;
+
+    replayClock.Start();
+    for(size_t operationId = 0; operationId < trace.Operations.size(); ++operationId)
+    {
+      const QueueOperation& operation = trace.Operations[operationId];
+      switch(operation.Type)
+      {
+        case 'P':
+          priorities[operation.Node[1] * trace.SideLengths[0] + operation.Node[0]] = operation.Priority;
+          queue.push_or_update(operation.Node, operation.Priority);
+          break;
+        case 'I':
+          queue.mark_as_invalid(operation.Node);
+          break;
+        case 'T':
+        {
+          VertexDescriptorType topNode = queue.top();
+          const float topPriority = priorities[topNode[1] * trace.SideLengths[0] + topNode[0]];
+          if(topNode == operation.Node ||
+             topPriority == priorities[operation.Node[1] * trace.SideLengths[0] + operation.Node[0]])
+          {
+            numberOfSameNodes++;
+          }
+          if(topNode != operation.Node)
+          {
+            queue.push_or_update(topNode, topPriority);
+            queue.mark_as_invalid(operation.Node);
+          }
+          break;
+        }
+        case 'C':
+          queue.clear();
+          break;
+        default:
+          throw std::runtime_error(std::string("Unknown queue operation ") + operation.Type);
+      }
+    }
+    replayClock.Stop();
+  }
+
+  std::cout << backendName << ": " << replayClock.GetMean() << " s per replay." << std::endl;
+
+  return numberOfSameNodes;
+}
+
+/** Compare the boundary node queue backends (see PriorityQueueBackends.h) on the push_or_update, mark_as_invalid
+  * and top calls of a real inpainting (most of them from InpaintingVisitor::FinishVertex). With an image, a mask
+  * and a patch half width, ClassicalImageInpainting is run and its queue trace is written to trace.txt first;
+  * with only a trace file, that trace is replayed. */
+// Run with: Data/trashcan.png Data/trashcan.mask 15 trace.txt
+//       or: trace.txt
+int main(int argc, char *argv[])
+{
+  // Verify arguments
+  if(argc != 2 && argc != 5)
+  {
+    std::cerr << "Required arguments: [image.png imageMask.mask patchHalfWidth] trace.txt" << std::endl;
+    std::cerr << "Input arguments: ";
+    for(int i = 1; i < argc; ++i)
+    {
+      std::cerr << argv[i] << " ";
+    }
+    return EXIT_FAILURE;
+  }
+
+  std::string traceFileName = argv[argc - 1];
+
+  if(argc == 5)
+  {
+    // Parse arguments
+    std::string imageFilename = argv[1];
+    std::string maskFilename = argv[2];
+
+    std::stringstream ssPatchHalfWidth;
+    ssPatchHalfWidth << argv[3];
+    unsigned int patchHalfWidth = 0;
+    ssPatchHalfWidth >> patchHalfWidth;
+
+    typedef itk::Image<itk::CovariantVector<int, 3>, 2> ImageType;
+
+    typedef itk::ImageFileReader<ImageType> ImageReaderType;
+    ImageReaderType::Pointer imageReader = ImageReaderType::New();
+    imageReader->SetFileName(imageFilename);
+    imageReader->Update();
+
+    ImageType::Pointer image = ImageType::New();
+    ITKHelpers::DeepCopy(imageReader->GetOutput(), image.GetPointer());
+
+    Mask::Pointer mask = Mask::New();
+    mask->Read(maskFilename);
+
+    // Write the priorities with enough digits that the replay sees the same priorities
+    std::ofstream traceStream(traceFileName.c_str());
+    traceStream << std::setprecision(9);
+    traceStream << image->GetLargestPossibleRegion().GetSize()[0] << " "
+                << image->GetLargestPossibleRegion().GetSize()[1] << "\n";
+
+    ClassicalImageInpainting(image, mask, patchHalfWidth, &traceStream);
+  }
+
+  QueueTrace trace = ReadQueueTrace(traceFileName);
+
+  std::cout << "The trace has " << trace.Operations.size() << " operations with priorities from "
+            << trace.MinimumPriority << " to " << trace.MaximumPriority << "." << std::endl;
+
+  const unsigned int numberOfRepetitions = 5;
+
+  size_t numberOfTopOperations = 0;
+  for(size_t operationId = 0; operationId < trace.Operations.size(); ++operationId)
+  {
+    if(trace.Operations[operationId].Type == 'T')
+    {
+      numberOfTopOperations++;
+    }
+  }
+
+  size_t binomialSameNodes =
+      ReplayQueueTrace<BinomialHeapQueueBackend<VertexListGraphType> >(trace, "Binomial heap", numberOfRepetitions);
+
+  size_t dArySameNodes =
+      ReplayQueueTrace<DAryHeapQueueBackend<VertexListGraphType, 4> >(trace, "4-ary heap", numberOfRepetitions);
+
+  size_t bucketSameNodes =
+      ReplayQueueTrace<BucketQueueBackend<VertexListGraphType> >(trace, "Bucket queue", numberOfRepetitions);
+
+  // The trace is recorded with the binomial heap (the default backend of ClassicalImageInpainting), which does
+  // not move up the nodes whose priority increases (see BinomialHeapQueueBackend). The exact backends can
+  // therefore choose another target than the recorded one, and the bucket queue only orders the nodes up to
+  // the width of a bucket.
+  std::cout << "The top() of the binomial heap was the recorded one for " << binomialSameNodes << " of "
+            << numberOfTopOperations << " targets." << std::endl;
+  std::cout << "The top() of the 4-ary heap was the recorded one for " << dArySameNodes << " of "
+            << numberOfTopOperations << " targets." << std::endl;
+  std::cout << "The top() of the bucket queue was the recorded one for " << bucketSameNodes << " of "
+            << numberOfTopOperations << " targets." << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,200 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+// ITK
+#include "itkImageFileReader.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkTimeProbe.h"
+
+// Submodules
+#include <Helpers/Helpers.h>
+#include <ITKHelpers/ITKHelpers.h>
+#include <Mask/Mask.h>
+
+// Pixel descriptors
+#include "PixelDescriptors/ImagePatchPixelDescriptor.h"
+
+// Descriptor visitors
+#include "Visitors/DescriptorVisitors/ImagePatchDescriptorVisitor.hpp"
+
+// Nearest neighbors
+#include "NearestNeighbor/LinearSearchBest/Property.hpp"
+#include "NearestNeighbor/LinearSearchBest/FFTSSD.hpp"
+
+// Difference functions
+#include "DifferenceFunctions/Patch/ImagePatchDifference.hpp"
+#include "DifferenceFunctions/Pixel/SumSquaredPixelDifference.hpp"
+
+// Boost
+#include <boost/graph/grid_graph.hpp>
+#include <boost/property_map/property_map.hpp>
+
+// STL
+#include <iostream>
+#include <memory>
+#include <vector>
+
+/** Compare LinearSearchBestFFTSSD and LinearSearchBestProperty for every target patch on the initial hole boundary.
+  * The first FFT query computes the spectra of all of the tiles, so it is reported separately from the
+  * following queries, which reuse them. Both methods should find equally good patches. */
+// Run with: Data/trashcan.png Data/trashcan.mask 15
+int main(int argc, char *argv[])
+{
+  // Verify arguments
+  if(argc != 4)
+  {
+    std::cerr << "Required arguments: image.png imageMask.mask patchHalfWidth" << std::endl;
+    std::cerr << "Input arguments: ";
+    for(int i = 1; i < argc; ++i)
+    {
+      std::cerr << argv[i] << " ";
+    }
+    return EXIT_FAILURE;
+  }
+
+  // Parse arguments
+  std::string imageFilename = argv[1];
+  std::string maskFilename = argv[2];
+
+  std::stringstream ssPatchHalfWidth;
+  ssPatchHalfWidth << argv[3];
+  unsigned int patchHalfWidth = 0;
+  ssPatchHalfWidth >> patchHalfWidth;
+
+  typedef itk::Image<itk::CovariantVector<int, 3>, 2> ImageType;
+
+  typedef itk::ImageFileReader<ImageType> ImageReaderType;
+  ImageReaderType::Pointer imageReader = ImageReaderType::New();
+  imageReader->SetFileName(imageFilename);
+  imageReader->Update();
+
+  ImageType::Pointer image = ImageType::New();
+  ITKHelpers::DeepCopy(imageReader->GetOutput(), image.GetPointer());
+
+  Mask::Pointer mask = Mask::New();
+  mask->Read(maskFilename);
+
+  itk::ImageRegion<2> fullRegion = image->GetLargestPossibleRegion();
+
+  // Create the graph and the descriptors
+  typedef boost::grid_graph<2> VertexListGraphType;
+  boost::array<std::size_t, 2> graphSideLengths = { { fullRegion.GetSize()[0],
+                                                      fullRegion.GetSize()[1] } };
+  VertexListGraphType graph(graphSideLengths);
+  typedef boost::graph_traits<VertexListGraphType>::vertex_descriptor VertexDescriptorType;
+  typedef boost::graph_traits<VertexListGraphType>::vertex_iterator VertexIteratorType;
+
+  typedef boost::property_map<VertexListGraphType, boost::vertex_index_t>::const_type IndexMapType;
+  IndexMapType indexMap(get(boost::vertex_index, graph));
+
+  typedef ImagePatchPixelDescriptor<ImageType> ImagePatchPixelDescriptorType;
+  typedef boost::vector_property_map<ImagePatchPixelDescriptorType, IndexMapType> ImagePatchDescriptorMapType;
+  std::shared_ptr<ImagePatchDescriptorMapType> imagePatchDescriptorMap(
+        new ImagePatchDescriptorMapType(num_vertices(graph), indexMap));
+
+  typedef ImagePatchDescriptorVisitor<VertexListGraphType, ImageType, ImagePatchDescriptorMapType>
+          ImagePatchDescriptorVisitorType;
+  ImagePatchDescriptorVisitorType imagePatchDescriptorVisitor(image, mask, imagePatchDescriptorMap, patchHalfWidth);
+
+  VertexIteratorType vertexIterator, vertexEnd;
+  for(boost::tie(vertexIterator, vertexEnd) = vertices(graph); vertexIterator != vertexEnd; ++vertexIterator)
+  {
+    imagePatchDescriptorVisitor.InitializeVertex(*vertexIterator);
+  }
+
+  // Collect the target nodes
+  Mask::BoundaryImageType::Pointer boundaryImage = Mask::BoundaryImageType::New();
+  unsigned char boundaryPixelValue = 255;
+  mask->CreateBoundaryImage(boundaryImage, Mask::VALID, boundaryPixelValue);
+
+  std::vector<VertexDescriptorType> targetNodes;
+  itk::ImageRegionConstIteratorWithIndex<Mask::BoundaryImageType> boundaryImageIterator(boundaryImage, fullRegion);
+  while(!boundaryImageIterator.IsAtEnd())
+  {
+    if(boundaryImageIterator.Get() == boundaryPixelValue)
+    {
+      VertexDescriptorType node = Helpers::ConvertFrom<VertexDescriptorType, itk::Index<2> >(boundaryImageIterator.GetIndex());
+      imagePatchDescriptorVisitor.DiscoverVertex(node);
+      targetNodes.push_back(node);
+    }
+    ++boundaryImageIterator;
+  }
+
+  std::cout << "There are " << targetNodes.size() << " target patches." << std::endl;
+  if(targetNodes.empty())
+  {
+    std::cerr << "The mask does not have a hole boundary!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  typedef ImagePatchDifference<ImagePatchPixelDescriptorType,
+                               SumSquaredPixelDifference<ImageType::PixelType> > PatchDifferenceType;
+
+  LinearSearchBestProperty<ImagePatchDescriptorMapType, PatchDifferenceType> linearSearchBest(*imagePatchDescriptorMap);
+  LinearSearchBestFFTSSD<ImagePatchDescriptorMapType, PatchDifferenceType> fftSearchBest(*imagePatchDescriptorMap);
+
+  PatchDifferenceType patchDifference;
+
+  // The distances of the matches found by each method
+  std::vector<float> linearDistances(targetNodes.size());
+  std::vector<float> fftDistances(targetNodes.size());
+
+  itk::TimeProbe linearClock;
+  linearClock.Start();
+  for(size_t targetId = 0; targetId < targetNodes.size(); ++targetId)
+  {
+    VertexDescriptorType result = linearSearchBest(vertices(graph).first, vertices(graph).second, targetNodes[targetId]);
+    linearDistances[targetId] = patchDifference(get(*imagePatchDescriptorMap, result),
+                                                get(*imagePatchDescriptorMap, targetNodes[targetId]));
+  }
+  linearClock.Stop();
+
+  itk::TimeProbe firstQueryClock;
+  firstQueryClock.Start();
+  VertexDescriptorType firstResult = fftSearchBest(vertices(graph).first, vertices(graph).second, targetNodes[0]);
+  fftDistances[0] = patchDifference(get(*imagePatchDescriptorMap, firstResult),
+                                    get(*imagePatchDescriptorMap, targetNodes[0]));
+  firstQueryClock.Stop();
+
+  itk::TimeProbe fftClock;
+  fftClock.Start();
+  for(size_t targetId = 1; targetId < targetNodes.size(); ++targetId)
+  {
+    VertexDescriptorType result = fftSearchBest(vertices(graph).first, vertices(graph).second, targetNodes[targetId]);
+    fftDistances[targetId] = patchDifference(get(*imagePatchDescriptorMap, result),
+                                             get(*imagePatchDescriptorMap, targetNodes[targetId]));
+  }
+  fftClock.Stop();
+
+  // Compare the quality of the matches
+  unsigned int numberOfExactMatches = 0;
+  for(size_t targetId = 0; targetId < targetNodes.size(); ++targetId)
+  {
+    if(fftDistances[targetId] <= linearDistances[targetId] * (1.0f + 1e-5f))
+    {
+      numberOfExactMatches++;
+    }
+  }
+
+  std::cout << "Linear search total time: " << linearClock.GetTotal() << std::endl;
+  std::cout << "FFT search first query time (fills the cache): " << firstQueryClock.GetTotal() << std::endl;
+  std::cout << "FFT search time of the other queries: " << fftClock.GetTotal() << std::endl;
+  std::cout << "The FFT search found the best patch for " << numberOfExactMatches << " of "
+            << targetNodes.size() << " target patches." << std::endl;
+
+  return EXIT_SUCCESS;
+}
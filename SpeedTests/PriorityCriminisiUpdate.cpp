@@ -0,0 +1,158 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// ITK
+#include "itkImageFileReader.h"
+#include "itkTimeProbe.h"
+
+// Submodules
+#include <Helpers/Helpers.h>
+#include <ITKHelpers/ITKHelpers.h>
+#include <Mask/Mask.h>
+
+// Custom
+#include "ImageProcessing/FillFront.h"
+#include "Priority/PriorityCriminisi.h"
+
+// Boost
+#include <boost/graph/grid_graph.hpp>
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+typedef boost::grid_graph<2> VertexListGraphType;
+typedef boost::graph_traits<VertexListGraphType>::vertex_descriptor VertexDescriptorType;
+
+/** Call Update() of 'priorityFunction' at each of the 'targets', and output the mean time per call. */
+template <typename TPriority>
+void TimeUpdates(TPriority* const priorityFunction, const std::vector<itk::Index<2> >& targets,
+                 const std::string& name)
+{
+  itk::TimeProbe updateClock;
+  for(size_t targetId = 0; targetId < targets.size(); ++targetId)
+  {
+    VertexDescriptorType target = Helpers::ConvertFrom<VertexDescriptorType, itk::Index<2> >(targets[targetId]);
+
+    updateClock.Start();
+    priorityFunction->Update(target, target, targetId);
+    updateClock.Stop();
+  }
+
+  std::cout << name << ": " << updateClock.GetMean() << " s per Update()." << std::endl;
+}
+
+/** Compare the time of PriorityCriminisi::Update() with the ITK filter pipelines (the default) and with the direct
+  * kernels (SetUseDirectKernels). The updates are run at boundary pixels spread along the fill front, without
+  * filling anything, and the priorities of the front pixels are compared afterwards. Note that the filter path
+  * also writes the debug images of BoundaryNormals (Update() turns them on), which is part of its cost. */
+// Run with: Data/trashcan.png Data/trashcan.mask 15 100
+int main(int argc, char *argv[])
+{
+  // Verify arguments
+  if(argc != 5)
+  {
+    std::cerr << "Required arguments: image.png imageMask.mask patchHalfWidth numberOfUpdates" << std::endl;
+    std::cerr << "Input arguments: ";
+    for(int i = 1; i < argc; ++i)
+    {
+      std::cerr << argv[i] << " ";
+    }
+    return EXIT_FAILURE;
+  }
+
+  // Parse arguments
+  std::string imageFilename = argv[1];
+  std::string maskFilename = argv[2];
+
+  std::stringstream ssPatchHalfWidth;
+  ssPatchHalfWidth << argv[3];
+  unsigned int patchHalfWidth = 0;
+  ssPatchHalfWidth >> patchHalfWidth;
+
+  std::stringstream ssNumberOfUpdates;
+  ssNumberOfUpdates << argv[4];
+  unsigned int numberOfUpdates = 0;
+  ssNumberOfUpdates >> numberOfUpdates;
+
+  typedef itk::Image<itk::CovariantVector<float, 3>, 2> ImageType;
+
+  typedef itk::ImageFileReader<ImageType> ImageReaderType;
+  ImageReaderType::Pointer imageReader = ImageReaderType::New();
+  imageReader->SetFileName(imageFilename);
+  imageReader->Update();
+
+  ImageType::Pointer image = ImageType::New();
+  ITKHelpers::DeepCopy(imageReader->GetOutput(), image.GetPointer());
+
+  Mask::Pointer mask = Mask::New();
+  mask->Read(maskFilename);
+
+  std::shared_ptr<FillFront> fillFront(new FillFront(mask));
+  fillFront->Initialize();
+
+  // Spread the targets along the front
+  const FillFront::PixelContainer& frontPixels = fillFront->GetFrontPixels();
+  if(frontPixels.empty() || numberOfUpdates == 0)
+  {
+    std::cerr << "There are no boundary pixels (or no updates) to time!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::vector<itk::Index<2> > targets;
+  const size_t step = std::max<size_t>(1, frontPixels.size() / numberOfUpdates);
+  for(size_t pixelId = 0; pixelId < frontPixels.size() && targets.size() < numberOfUpdates; pixelId += step)
+  {
+    targets.push_back(frontPixels[pixelId]);
+  }
+
+  std::cout << "Timing " << targets.size() << " updates with patch half width " << patchHalfWidth << "." << std::endl;
+
+  typedef PriorityCriminisi<ImageType> PriorityType;
+
+  PriorityType filterPriority(image, mask, patchHalfWidth);
+  TimeUpdates(&filterPriority, targets, "ITK filters");
+
+  PriorityType directPriority(image, mask, patchHalfWidth);
+  directPriority.SetFillFront(fillFront);
+  directPriority.SetUseDirectKernels(true);
+  TimeUpdates(&directPriority, targets, "Direct kernels");
+
+  // The two paths differ a little at the edges of the updated regions and of the image (see
+  // ComputeColorIsophotesInRegionDirect and ComputeBoundaryNormalsDirect)
+  float maximumDifference = 0.0f;
+  float maximumPriority = 0.0f;
+  for(size_t pixelId = 0; pixelId < frontPixels.size(); ++pixelId)
+  {
+    const float filterPriorityValue = filterPriority.ComputePriority(frontPixels[pixelId]);
+    maximumDifference = std::max(maximumDifference,
+                                 std::abs(filterPriorityValue - directPriority.ComputePriority(frontPixels[pixelId])));
+    maximumPriority = std::max(maximumPriority, filterPriorityValue);
+  }
+
+  std::cout << "The largest difference of the front priorities is " << maximumDifference
+            << " (the largest priority is " << maximumPriority << ")." << std::endl;
+
+  return EXIT_SUCCESS;
+}
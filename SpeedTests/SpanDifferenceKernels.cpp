@@ -0,0 +1,177 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegionIterator.h"
+#include "itkTimeProbe.h"
+#include "itkVectorImage.h"
+
+// Custom
+#include "DifferenceFunctions/Patch/SpanDifferenceKernels.hpp"
+#include "DifferenceFunctions/Pixel/SumAbsolutePixelDifference.hpp"
+#include "DifferenceFunctions/Pixel/SumSquaredPixelDifference.hpp"
+#include "Utilities/RowMasks.hpp"
+
+// STL
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+/** Compare the time to compute the masked difference between a target patch and every source patch of a random
+  * image with the per pixel difference functors (as ImagePatchDifference did before the span kernels were
+  * added) and with SpanDifferenceKernels::MaskedPatchDifference. About a third of the target pixels are invalid. */
+// Run with: 15 (the patch half width)
+
+template <typename TImage>
+static void RandomizeImage(TImage* const image)
+{
+  itk::ImageRegionIterator<TImage> imageIterator(image, image->GetLargestPossibleRegion());
+  while(!imageIterator.IsAtEnd())
+  {
+    typename TImage::PixelType pixel = imageIterator.Get();
+    for(unsigned int component = 0; component < image->GetNumberOfComponentsPerPixel(); ++component)
+    {
+      pixel[component] = rand() % 256;
+    }
+    imageIterator.Set(pixel);
+    ++imageIterator;
+  }
+}
+
+/** Time both methods with one pixel difference functor and the matching span function. */
+template <typename TImage, typename TPixelDifference, typename TComponent, typename TSpanFunction>
+static void Compare(const std::string& name, TImage* const image, const TComponent* buffer,
+                    const std::vector<itk::Offset<2> >& validOffsets, const unsigned int patchWidth,
+                    TPixelDifference pixelDifference, TSpanFunction spanFunction)
+{
+  const itk::ImageRegion<2> fullRegion = image->GetLargestPossibleRegion();
+  const unsigned int numberOfComponents = image->GetNumberOfComponentsPerPixel();
+  const size_t rowStride = fullRegion.GetSize()[0] * numberOfComponents;
+  const std::vector<uint64_t> rowMasks = RowMasks::ComputeRowMasks(validOffsets);
+
+  itk::Index<2> targetCorner = {{0, 0}};
+  const TComponent* target = buffer;
+
+  // Keep the results so the computations are not optimized away, and so the two methods can be compared
+  float pixelTotal = 0.0f;
+  float spanTotal = 0.0f;
+
+  itk::TimeProbe pixelClock;
+  pixelClock.Start();
+  for(unsigned int y = 0; y + patchWidth <= fullRegion.GetSize()[1]; ++y)
+  {
+    for(unsigned int x = 0; x + patchWidth <= fullRegion.GetSize()[0]; ++x)
+    {
+      itk::Index<2> sourceCorner = {{x, y}};
+      float difference = 0.0f;
+      for(size_t offsetId = 0; offsetId < validOffsets.size(); ++offsetId)
+      {
+        difference += pixelDifference(image->GetPixel(sourceCorner + validOffsets[offsetId]),
+                                      image->GetPixel(targetCorner + validOffsets[offsetId]));
+      }
+      pixelTotal += difference;
+    }
+  }
+  pixelClock.Stop();
+
+  itk::TimeProbe spanClock;
+  spanClock.Start();
+  for(unsigned int y = 0; y + patchWidth <= fullRegion.GetSize()[1]; ++y)
+  {
+    for(unsigned int x = 0; x + patchWidth <= fullRegion.GetSize()[0]; ++x)
+    {
+      const TComponent* source = buffer + (y * fullRegion.GetSize()[0] + x) * numberOfComponents;
+      spanTotal += SpanDifferenceKernels::MaskedPatchDifference(source, target, rowStride, numberOfComponents,
+                                                                rowMasks, std::numeric_limits<float>::infinity(),
+                                                                spanFunction);
+    }
+  }
+  spanClock.Stop();
+
+  std::cout << name << ": per pixel " << pixelClock.GetTotal() << "s, "
+            << SpanDifferenceKernels::GetInstructionSetName() << " spans " << spanClock.GetTotal() << "s, speedup "
+            << pixelClock.GetTotal() / spanClock.GetTotal() << "x (relative difference of the results "
+            << (pixelTotal - spanTotal) / pixelTotal << ")" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned int patchHalfWidth = 15;
+  if(argc == 2)
+  {
+    patchHalfWidth = atoi(argv[1]);
+  }
+
+  const unsigned int patchWidth = 2 * patchHalfWidth + 1;
+  if(patchWidth > 64)
+  {
+    std::cerr << "The span kernels only handle patches up to 64 pixels wide." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  srand(0);
+
+  itk::Index<2> corner = {{0, 0}};
+  itk::Size<2> size = {{300, 300}};
+  itk::ImageRegion<2> region(corner, size);
+
+  // The valid pixels of the target patch
+  std::vector<itk::Offset<2> > validOffsets;
+  for(unsigned int y = 0; y < patchWidth; ++y)
+  {
+    for(unsigned int x = 0; x < patchWidth; ++x)
+    {
+      // A hole in the bottom right corner, like a patch on the hole boundary
+      if(x < 2 * patchWidth / 3 || y < 2 * patchWidth / 3)
+      {
+        itk::Offset<2> offset = {{x, y}};
+        validOffsets.push_back(offset);
+      }
+    }
+  }
+
+  std::cout << "Patch width " << patchWidth << ", " << validOffsets.size() << " valid pixels." << std::endl;
+
+  typedef itk::Image<itk::CovariantVector<unsigned char, 3>, 2> RGBImageType;
+  RGBImageType::Pointer rgbImage = RGBImageType::New();
+  rgbImage->SetRegions(region);
+  rgbImage->Allocate();
+  RandomizeImage(rgbImage.GetPointer());
+  const unsigned char* rgbBuffer = reinterpret_cast<const unsigned char*>(rgbImage->GetBufferPointer());
+
+  Compare("RGB SSD", rgbImage.GetPointer(), rgbBuffer, validOffsets, patchWidth,
+          SumSquaredPixelDifference<RGBImageType::PixelType>(), SpanDifferenceKernels::SquaredDifferenceSpan());
+  Compare("RGB SAD", rgbImage.GetPointer(), rgbBuffer, validOffsets, patchWidth,
+          SumAbsolutePixelDifference<RGBImageType::PixelType>(), SpanDifferenceKernels::AbsoluteDifferenceSpan());
+
+  typedef itk::VectorImage<float, 2> FloatImageType;
+  FloatImageType::Pointer floatImage = FloatImageType::New();
+  floatImage->SetRegions(region);
+  floatImage->SetNumberOfComponentsPerPixel(5);
+  floatImage->Allocate();
+  RandomizeImage(floatImage.GetPointer());
+
+  Compare("5 channel float SSD", floatImage.GetPointer(), floatImage->GetBufferPointer(), validOffsets, patchWidth,
+          SumSquaredPixelDifference<FloatImageType::PixelType>(), SpanDifferenceKernels::SquaredDifferenceSpan());
+  Compare("5 channel float SAD", floatImage.GetPointer(), floatImage->GetBufferPointer(), validOffsets, patchWidth,
+          SumAbsolutePixelDifference<FloatImageType::PixelType>(), SpanDifferenceKernels::AbsoluteDifferenceSpan());
+
+  return EXIT_SUCCESS;
+}
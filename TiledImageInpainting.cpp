@@ -0,0 +1,77 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// ITK
+#include "itkImage.h"
+#include "itkCovariantVector.h"
+
+// Submodules
+#include <Mask/Mask.h>
+
+// STL
+#include <sstream>
+
+#include "Drivers/TiledImageInpainting.hpp"
+
+// Run with: Data/trashcan.mha Data/trashcan.mask 15 100 1000 filled.mha
+int main(int argc, char *argv[])
+{
+  // Verify arguments
+  if(argc != 7)
+  {
+    std::cerr << "Required arguments: image.mha imageMask.mask patchHalfWidth searchRadius memoryBudgetInMB output.mha"
+              << std::endl;
+    std::cerr << "Input arguments: ";
+    for(int i = 1; i < argc; ++i)
+    {
+      std::cerr << argv[i] << " ";
+    }
+    return EXIT_FAILURE;
+  }
+
+  // Parse arguments
+  std::string imageFilename = argv[1];
+  std::string maskFilename = argv[2];
+
+  std::stringstream ssPatchHalfWidth;
+  ssPatchHalfWidth << argv[3];
+  unsigned int patchHalfWidth = 0;
+  ssPatchHalfWidth >> patchHalfWidth;
+
+  std::stringstream ssSearchRadius;
+  ssSearchRadius << argv[4];
+  unsigned int searchRadius = 0;
+  ssSearchRadius >> searchRadius;
+
+  std::stringstream ssMemoryBudget;
+  ssMemoryBudget << argv[5];
+  size_t memoryBudgetInMB = 0;
+  ssMemoryBudget >> memoryBudgetInMB;
+
+  std::string outputFileName = argv[6];
+
+  typedef itk::Image<itk::CovariantVector<int, 3>, 2> OriginalImageType;
+
+  Mask::Pointer mask = Mask::New();
+  mask->Read(maskFilename);
+
+  TiledImageInpainting<OriginalImageType>(imageFilename, mask.GetPointer(), outputFileName, patchHalfWidth,
+                                          searchRadius, memoryBudgetInMB * 1024 * 1024);
+
+  return EXIT_SUCCESS;
+}
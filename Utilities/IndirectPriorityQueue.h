@@ -21,14 +21,20 @@
 
 // STL
 #include <iostream>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
 
 // Boost
-#include <boost/heap/binomial_heap.hpp>
-#include <boost/pending/indirect_cmp.hpp>
 #include <boost/graph/grid_graph.hpp>
 #include <boost/property_map/property_map.hpp>
 
-template <typename TGraph>
+// Custom
+#include "Utilities/PriorityQueueBackends.h"
+
+/** The queue of boundary nodes, highest priority first. The nodes are kept in a TQueueBackend (see
+  * PriorityQueueBackends.h): the default binomial heap, a DAryHeapQueueBackend or a BucketQueueBackend. */
+template <typename TGraph, typename TQueueBackend = BinomialHeapQueueBackend<TGraph> >
 struct IndirectPriorityQueue
 {
   // Typedefs
@@ -37,18 +43,13 @@ struct IndirectPriorityQueue
   typedef typename boost::graph_traits<TGraph>::vertex_descriptor VertexDescriptorType;
   typedef typename boost::property_map<TGraph, boost::vertex_index_t>::const_type IndexMapType;
 
-  typedef std::less<float> PriorityCompareType;
   typedef boost::vector_property_map<float, IndexMapType> PriorityMapType;
-  typedef boost::indirect_cmp<PriorityMapType, PriorityCompareType> IndirectComparisonType;
 
-  typedef boost::heap::binomial_heap<VertexDescriptorType,
-      boost::heap::compare<IndirectComparisonType> >
-      QueueType;
+  typedef TQueueBackend QueueType;
 
-  typedef typename QueueType::handle_type HandleType;
-  typedef boost::vector_property_map<HandleType, IndexMapType> HandleMapType;
+  typedef typename QueueType::HandleType HandleType;
 
-  typedef typename QueueType::value_type ValueType;
+  typedef VertexDescriptorType ValueType;
 
   // Member variables
   TGraph Graph;
@@ -57,10 +58,6 @@ struct IndirectPriorityQueue
 
   PriorityMapType PriorityMap;
 
-  HandleMapType HandleMap;
-
-  IndirectComparisonType IndirectComparison;
-
   QueueType Queue;
 
   /** Create the boundary status map. A node is on the current boundary if this property is true.
@@ -70,23 +67,69 @@ struct IndirectPriorityQueue
   typedef boost::vector_property_map<bool, IndexMapType> BoundaryStatusMapType;
   BoundaryStatusMapType BoundaryStatusMap;
 
+  /** The number of nodes in the heap that are still valid (on the boundary). The other nodes in the heap
+    * are stale: they are skipped by top(), or removed by Compact(). The BoundaryStatusMap must only be changed
+    * through push_or_update() and mark_as_invalid(), otherwise this count is wrong. */
+  size_t NumberOfValidNodes;
+
+  /** The heap is compacted when more than this fraction of its nodes are stale (see SetCompactionFraction). */
+  float CompactionFraction;
+
+  /** Heaps smaller than this are never compacted, as skipping their stale nodes is cheap anyway. */
+  size_t MinimumCompactionSize;
+
+  size_t NumberOfCompactions;
+
+  /** The valid nodes gathered by Compact(), kept so that compacting does not allocate every time. */
+  std::vector<ValueType> CompactionBuffer;
+
+  /** If set, every operation that changes the valid nodes is written here (see SetTraceStream). */
+  std::ostream* TraceStream;
+
+  /** If true, only the nodes between TargetRegionLowerCorner and TargetRegionUpperCorner are pushed
+    * (see SetTargetRegion). */
+  bool HasTargetRegion;
+  ValueType TargetRegionLowerCorner;
+  ValueType TargetRegionUpperCorner;
+
   IndirectPriorityQueue(TGraph graph) :
     Graph(graph),
     IndexMap(get(boost::vertex_index, Graph)),
     PriorityMap(num_vertices(Graph), IndexMap),
-    HandleMap(IndexMap),
-    IndirectComparison(PriorityMap),
-    Queue(IndirectComparison),
-    BoundaryStatusMap(num_vertices(Graph), IndexMap)
+    Queue(IndexMap, num_vertices(Graph), PriorityMap),
+    BoundaryStatusMap(num_vertices(Graph), IndexMap),
+    NumberOfValidNodes(0), CompactionFraction(0.5f), MinimumCompactionSize(64), NumberOfCompactions(0),
+    TraceStream(0), HasTargetRegion(false)
   {
-    // Initialize the handle map
-    HandleType invalidHandle(0); // An invalid node handle (a node_pointer of NULL)
-    VertexIteratorType vertexIterator, vertexIteratorEnd;
-    for( tie(vertexIterator, vertexIteratorEnd) = vertices(graph);
-         vertexIterator != vertexIteratorEnd; ++vertexIterator)
-    {
-      put(this->HandleMap, *vertexIterator, invalidHandle);
-    }
+
+  }
+
+  /** The backend, to configure it (for example BucketQueueBackend::SetPriorityRange). */
+  QueueType& GetBackend()
+  {
+    return this->Queue;
+  }
+
+  /** Write every operation to 'traceStream' (0 to stop), one per line, so that it can be replayed with another
+    * backend (see SpeedTests/BoundaryQueueBackends):
+    *   P x y priority   push_or_update
+    *   I x y            mark_as_invalid of a valid node in the queue (the other calls do not change the queue)
+    *   T x y            top, which returned (x, y)
+    *   C                clear
+    * The nodes are written as two coordinates, so this only works for 2D grid graphs. */
+  void SetTraceStream(std::ostream* const traceStream)
+  {
+    this->TraceStream = traceStream;
+  }
+
+  /** Only accept the nodes whose coordinates are between 'lowerCorner' and 'upperCorner' (inclusive):
+    * push_or_update() ignores the other nodes, so they are never targets. Like the trace, this only works for 2D
+    * grid graphs. */
+  void SetTargetRegion(const ValueType& lowerCorner, const ValueType& upperCorner)
+  {
+    this->HasTargetRegion = true;
+    this->TargetRegionLowerCorner = lowerCorner;
+    this->TargetRegionUpperCorner = upperCorner;
   }
 
   BoundaryStatusMapType* GetBoundaryStatusMap()
@@ -102,58 +145,79 @@ struct IndirectPriorityQueue
   size_t CountValidNodes()
   {
     size_t numberOfValidNodes = 0;
-    for (typename QueueType::iterator it = this->Queue.begin();
-         it != this->Queue.end(); ++it)
+    this->Queue.for_each([this, &numberOfValidNodes](const ValueType& v)
     {
-      bool valid = get(this->BoundaryStatusMap, *it);
-      if(valid)
+      if(get(this->BoundaryStatusMap, v))
       {
         numberOfValidNodes++;
-//        std::cout << "(" << queuedNode[0] << ", " << queuedNode[1] << ") : " << priority << std::endl;
       }
-    }
+    });
 
     return numberOfValidNodes;
   }
 
-  HandleType push(ValueType v)
+  /** Compact the heap when more than 'fraction' of its nodes are stale. A fraction of 1 never compacts. */
+  void SetCompactionFraction(const float fraction)
   {
-    return this->Queue.push(v);
+    if(fraction <= 0.0f || fraction > 1.0f)
+    {
+      throw std::runtime_error("IndirectPriorityQueue: The compaction fraction must be in (0, 1]!");
+    }
+    this->CompactionFraction = fraction;
   }
 
-  size_t size()
+  void SetMinimumCompactionSize(const size_t minimumCompactionSize)
   {
-    // We need to check if the queue contains any valid items
-//    return this->Queue.size();
+    this->MinimumCompactionSize = minimumCompactionSize;
+  }
 
-    size_t numberOfValidItems = 0;
-    for (typename QueueType::iterator it = this->Queue.begin();
-         it != this->Queue.end(); ++it)
-    {
-      bool valid = get(this->BoundaryStatusMap, *it);
-      if(valid)
-      {
-        numberOfValidItems++;
-      }
-    }
-    return numberOfValidItems;
+  size_t GetNumberOfCompactions() const
+  {
+    return this->NumberOfCompactions;
+  }
+
+  /** The number of nodes in the heap, including the stale ones. */
+  size_t GetHeapSize() const
+  {
+    return this->Queue.size();
   }
 
-  bool empty()
+  void push(ValueType v)
   {
-    // We need to check if the queue contains any valid items
-//    return this->Queue.empty();
+    this->Queue.push(v);
+  }
+
+  /** The number of valid nodes. */
+  size_t size() const
+  {
+    return this->NumberOfValidNodes;
+  }
+
+  /** Determine if there are no valid nodes left (there can still be stale nodes in the heap). */
+  bool empty() const
+  {
+    return this->NumberOfValidNodes == 0;
+  }
+
+  /** Get up to 'n' of the valid nodes with the highest priorities, best first, without removing them
+    * from the queue. This is used to look ahead at the next targets (see InpaintingAlgorithmSpeculativeParallel). */
+  std::vector<ValueType> peek(const unsigned int n)
+  {
+    std::vector<ValueType> nodes;
+    if(n == 0)
+    {
+      return nodes;
+    }
 
-    for (typename QueueType::iterator it = this->Queue.begin();
-         it != this->Queue.end(); ++it)
+    this->Queue.for_each_ordered([this, &nodes, n](const ValueType& v)
     {
-      bool valid = get(this->BoundaryStatusMap, *it);
-      if(valid)
+      if(get(this->BoundaryStatusMap, v))
       {
-        return false;
+        nodes.push_back(v);
       }
-    }
-    return true;
+      return nodes.size() < n;
+    });
+    return nodes;
   }
 
   ValueType top()
@@ -171,11 +235,7 @@ struct IndirectPriorityQueue
       // Get the top node
       topNode = this->Queue.top();
 
-      // Invalidate the top node
-      typename HandleMapType::value_type invalidHandle(0);
-      put(this->HandleMap, topNode, invalidHandle);
-
-      // Pop the top node
+      // Pop the top node (this also invalidates its handle)
       this->Queue.pop();
 
       validNodeFound = get(this->BoundaryStatusMap, topNode);
@@ -183,6 +243,7 @@ struct IndirectPriorityQueue
       if(validNodeFound)
       {
 //        std::cout << "Processing node with priority " << get(this->PriorityMap, topNode) << std::endl;
+        this->NumberOfValidNodes--;
         break;
       }
     }
@@ -192,23 +253,93 @@ struct IndirectPriorityQueue
       throw std::runtime_error("IndirectPriorityQueue: There were no valid nodes to return in top()!");
     }
 
+    if(this->TraceStream)
+    {
+      *this->TraceStream << "T " << topNode[0] << " " << topNode[1] << "\n";
+    }
+
     return topNode;
   }
 
   void pop()
   {
+    ValueType topNode = this->Queue.top();
+    if(get(this->BoundaryStatusMap, topNode))
+    {
+      this->NumberOfValidNodes--;
+    }
+
     this->Queue.pop();
   }
 
-  void update(HandleType handle, ValueType value)
+  void update(ValueType value)
+  {
+    this->Queue.update(value);
+  }
+
+  /** Remove all of the nodes, keeping the property maps allocated, so that the queue can be reused for
+    * another image of the same size (see InpaintingWorkspace). */
+  void clear()
   {
-    this->Queue.update(get(this->HandleMap, value), value);
+    if(this->TraceStream)
+    {
+      *this->TraceStream << "C\n";
+    }
+
+    this->Queue.clear();
+
+    VertexIteratorType vertexIterator, vertexIteratorEnd;
+    for( tie(vertexIterator, vertexIteratorEnd) = vertices(this->Graph);
+         vertexIterator != vertexIteratorEnd; ++vertexIterator)
+    {
+      put(this->BoundaryStatusMap, *vertexIterator, false);
+    }
+
+    this->NumberOfValidNodes = 0;
   }
 
   void mark_as_invalid(ValueType v)
   {
     // This makes a patch ignored if it is still in the boundaryNodeQueue.
+    if(this->IsValidQueuedNode(v))
+    {
+      if(this->TraceStream)
+      {
+        *this->TraceStream << "I " << v[0] << " " << v[1] << "\n";
+      }
+      this->NumberOfValidNodes--;
+    }
     put(this->BoundaryStatusMap, v, false);
+
+    // Stale nodes are left in the heap (lazy deletion) until there are too many of them
+    const size_t heapSize = this->Queue.size();
+    if(heapSize >= this->MinimumCompactionSize &&
+       static_cast<float>(heapSize - this->NumberOfValidNodes) > this->CompactionFraction * heapSize)
+    {
+      this->Compact();
+    }
+  }
+
+  /** Rebuild the heap from its valid nodes only. The stale nodes get an invalid handle, so that they
+    * are pushed again if they come back to the boundary. */
+  void Compact()
+  {
+    this->CompactionBuffer.clear();
+    this->Queue.for_each([this](const ValueType& v)
+    {
+      if(get(this->BoundaryStatusMap, v))
+      {
+        this->CompactionBuffer.push_back(v);
+      }
+    });
+
+    this->Queue.clear();
+    for(size_t nodeId = 0; nodeId < this->CompactionBuffer.size(); ++nodeId)
+    {
+      this->Queue.push(this->CompactionBuffer[nodeId]);
+    }
+
+    this->NumberOfCompactions++;
   }
 
   void push_or_update(ValueType v, const float priority)
@@ -216,23 +347,46 @@ struct IndirectPriorityQueue
     // Note: we must set the value in the priority map before pushing the node
     // into the queue (as the priority is what determines the node's position in the queue).
 
-    put(this->PriorityMap, v, priority);
+    if(this->HasTargetRegion &&
+       (v[0] < this->TargetRegionLowerCorner[0] || v[0] > this->TargetRegionUpperCorner[0] ||
+        v[1] < this->TargetRegionLowerCorner[1] || v[1] > this->TargetRegionUpperCorner[1]))
+    {
+      return;
+    }
+
+    if(this->TraceStream)
+    {
+      *this->TraceStream << "P " << v[0] << " " << v[1] << " " << priority << "\n";
+    }
 
-    put(this->BoundaryStatusMap, v, true);
+    put(this->PriorityMap, v, priority);
 
-    if(get(this->HandleMap, v).node_ != 0) // the node is not already in the queue (the node_pointer of the node_handle is not NULL)
+    if(this->Queue.contains(v)) // the node is already in the queue
     {
-      update(get(this->HandleMap, v), v);
+      if(!get(this->BoundaryStatusMap, v))
+      {
+        this->NumberOfValidNodes++;
+      }
+      put(this->BoundaryStatusMap, v, true);
+      update(v);
 //          std::cout << "Updated priority of node (" << v[0] << ", " << v[1] << "): " << priority << std::endl;
     }
     else
     {
-      HandleType handle = push(v);
-      put(this->HandleMap, v, handle);
+      this->NumberOfValidNodes++;
+      put(this->BoundaryStatusMap, v, true);
+      push(v);
 //          std::cout << "Added new node (" << v[0] << ", " << v[1] << "): " << priority << std::endl;
     }
   }
 
+private:
+  /** Determine if 'v' is counted in NumberOfValidNodes (it is in the heap and on the boundary). */
+  bool IsValidQueuedNode(ValueType v)
+  {
+    return this->Queue.contains(v) && get(this->BoundaryStatusMap, v);
+  }
+
 };
 
 #endif // IndirectPriorityQueue_H
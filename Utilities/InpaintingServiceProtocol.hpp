@@ -0,0 +1,259 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef InpaintingServiceProtocol_HPP
+#define InpaintingServiceProtocol_HPP
+
+// STL
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// POSIX
+#include <unistd.h>
+
+/** The messages of InpaintingService. Every message is a 4 byte little endian length followed by that many
+  * bytes. All of the integers in the messages are 4 byte little endian.
+  *
+  * A request is: width, height, patchHalfWidth, the RGB pixels (3 * width * height bytes, row by row), and
+  * the mask (width * height bytes, 0 is valid and anything else is a hole). The patch half width must be at
+  * least 1, and the patches (2 * patchHalfWidth + 1 pixels wide) must fit in the image.
+  *
+  * A response is: a status byte (0 for success), followed by the RGB pixels of the inpainted image (in the
+  * same layout as the request) if the request succeeded, or by the error message if it failed.
+  */
+namespace InpaintingServiceProtocol
+{
+
+/** Messages larger than this are rejected, so that a corrupt length does not allocate all of the memory. */
+const size_t MaximumMessageSize = 1u << 30;
+
+struct Request
+{
+  unsigned int Width;
+  unsigned int Height;
+  unsigned int PatchHalfWidth;
+  std::vector<unsigned char> Pixels;
+  std::vector<unsigned char> MaskPixels;
+};
+
+struct Response
+{
+  bool Succeeded;
+  std::vector<unsigned char> Pixels;
+  std::string Error;
+};
+
+/** Read exactly 'size' bytes. Returns false if the end of the file is reached before the first byte. */
+inline bool ReadBytes(const int fileDescriptor, void* const buffer, const size_t size)
+{
+  size_t numberOfBytesRead = 0;
+  while(numberOfBytesRead < size)
+  {
+    ssize_t result = read(fileDescriptor, static_cast<char*>(buffer) + numberOfBytesRead, size - numberOfBytesRead);
+    if(result < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if(result < 0)
+    {
+      throw std::runtime_error(std::string("InpaintingServiceProtocol: read failed: ") + std::strerror(errno));
+    }
+    if(result == 0)
+    {
+      if(numberOfBytesRead == 0)
+      {
+        return false;
+      }
+      throw std::runtime_error("InpaintingServiceProtocol: The stream ended in the middle of a message!");
+    }
+    numberOfBytesRead += result;
+  }
+  return true;
+}
+
+inline void WriteBytes(const int fileDescriptor, const void* const buffer, const size_t size)
+{
+  size_t numberOfBytesWritten = 0;
+  while(numberOfBytesWritten < size)
+  {
+    ssize_t result = write(fileDescriptor, static_cast<const char*>(buffer) + numberOfBytesWritten,
+                           size - numberOfBytesWritten);
+    if(result < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if(result < 0)
+    {
+      throw std::runtime_error(std::string("InpaintingServiceProtocol: write failed: ") + std::strerror(errno));
+    }
+    numberOfBytesWritten += result;
+  }
+}
+
+inline void AppendUnsignedInt(const unsigned int value, std::vector<unsigned char>& bytes)
+{
+  for(unsigned int byteId = 0; byteId < 4; ++byteId)
+  {
+    bytes.push_back(static_cast<unsigned char>((value >> (8 * byteId)) & 0xff));
+  }
+}
+
+inline unsigned int GetUnsignedInt(const unsigned char* const bytes)
+{
+  return static_cast<unsigned int>(bytes[0]) | (static_cast<unsigned int>(bytes[1]) << 8) |
+         (static_cast<unsigned int>(bytes[2]) << 16) | (static_cast<unsigned int>(bytes[3]) << 24);
+}
+
+/** Read one message. Returns false if the stream ended before the message. */
+inline bool ReadMessage(const int fileDescriptor, std::vector<unsigned char>& message)
+{
+  unsigned char lengthBytes[4];
+  if(!ReadBytes(fileDescriptor, lengthBytes, 4))
+  {
+    return false;
+  }
+
+  const size_t length = GetUnsignedInt(lengthBytes);
+  if(length > MaximumMessageSize)
+  {
+    throw std::runtime_error("InpaintingServiceProtocol: The message is too large!");
+  }
+
+  // resize() keeps the capacity of 'message', so reading into the same vector does not reallocate it.
+  message.resize(length);
+  if(length > 0 && !ReadBytes(fileDescriptor, message.data(), length))
+  {
+    throw std::runtime_error("InpaintingServiceProtocol: The stream ended in the middle of a message!");
+  }
+  return true;
+}
+
+inline void WriteMessage(const int fileDescriptor, const std::vector<unsigned char>& message)
+{
+  std::vector<unsigned char> lengthBytes;
+  AppendUnsignedInt(static_cast<unsigned int>(message.size()), lengthBytes);
+  WriteBytes(fileDescriptor, lengthBytes.data(), lengthBytes.size());
+  WriteBytes(fileDescriptor, message.data(), message.size());
+}
+
+inline std::vector<unsigned char> EncodeRequest(const Request& request)
+{
+  std::vector<unsigned char> message;
+  AppendUnsignedInt(request.Width, message);
+  AppendUnsignedInt(request.Height, message);
+  AppendUnsignedInt(request.PatchHalfWidth, message);
+  message.insert(message.end(), request.Pixels.begin(), request.Pixels.end());
+  message.insert(message.end(), request.MaskPixels.begin(), request.MaskPixels.end());
+  return message;
+}
+
+/** Throws if the message is not a valid request. */
+inline void DecodeRequest(const std::vector<unsigned char>& message, Request& request)
+{
+  if(message.size() < 12)
+  {
+    throw std::runtime_error("InpaintingServiceProtocol: The request is too short!");
+  }
+
+  request.Width = GetUnsignedInt(&message[0]);
+  request.Height = GetUnsignedInt(&message[4]);
+  request.PatchHalfWidth = GetUnsignedInt(&message[8]);
+
+  const size_t numberOfPixels = static_cast<size_t>(request.Width) * request.Height;
+  if(numberOfPixels == 0 || message.size() != 12 + 4 * numberOfPixels)
+  {
+    throw std::runtime_error("InpaintingServiceProtocol: The size of the request does not match its image size!");
+  }
+
+  const size_t patchWidth = 2 * static_cast<size_t>(request.PatchHalfWidth) + 1;
+  if(request.PatchHalfWidth == 0 || patchWidth > request.Width || patchWidth > request.Height)
+  {
+    throw std::runtime_error("InpaintingServiceProtocol: The patch half width must be at least 1 and the "
+                             "patches must fit in the image!");
+  }
+
+  request.Pixels.assign(message.begin() + 12, message.begin() + 12 + 3 * numberOfPixels);
+  request.MaskPixels.assign(message.begin() + 12 + 3 * numberOfPixels, message.end());
+}
+
+/** Returns true if the mask of the request has at least one patch (of the request's patch size) that is
+  * entirely inside of the image and has no hole pixels, i.e. a source patch for the inpainting. */
+inline bool HasValidSourcePatch(const Request& request)
+{
+  const size_t patchWidth = 2 * static_cast<size_t>(request.PatchHalfWidth) + 1;
+
+  // The number of consecutive valid pixels in each column that end at the current row
+  std::vector<size_t> validColumnLengths(request.Width, 0);
+  for(size_t y = 0; y < request.Height; ++y)
+  {
+    // The number of consecutive columns (ending at the current one) whose valid run covers a whole patch
+    size_t numberOfValidColumns = 0;
+    for(size_t x = 0; x < request.Width; ++x)
+    {
+      validColumnLengths[x] = request.MaskPixels[y * request.Width + x] ? 0 : validColumnLengths[x] + 1;
+      numberOfValidColumns = validColumnLengths[x] >= patchWidth ? numberOfValidColumns + 1 : 0;
+      if(numberOfValidColumns >= patchWidth)
+      {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+inline std::vector<unsigned char> EncodeResponse(const Response& response)
+{
+  std::vector<unsigned char> message(1, response.Succeeded ? 0 : 1);
+  if(response.Succeeded)
+  {
+    message.insert(message.end(), response.Pixels.begin(), response.Pixels.end());
+  }
+  else
+  {
+    message.insert(message.end(), response.Error.begin(), response.Error.end());
+  }
+  return message;
+}
+
+inline void DecodeResponse(const std::vector<unsigned char>& message, Response& response)
+{
+  if(message.empty())
+  {
+    throw std::runtime_error("InpaintingServiceProtocol: The response is empty!");
+  }
+
+  response.Succeeded = (message[0] == 0);
+  response.Pixels.clear();
+  response.Error.clear();
+  if(response.Succeeded)
+  {
+    response.Pixels.assign(message.begin() + 1, message.end());
+  }
+  else
+  {
+    response.Error.assign(message.begin() + 1, message.end());
+  }
+}
+
+} // end namespace
+
+#endif
@@ -0,0 +1,578 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef PriorityQueueBackends_H
+#define PriorityQueueBackends_H
+
+// STL
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+// Boost
+#include <boost/heap/binomial_heap.hpp>
+#include <boost/pending/indirect_cmp.hpp>
+#include <boost/graph/graph_traits.hpp>
+#include <boost/property_map/property_map.hpp>
+#include <boost/property_map/vector_property_map.hpp>
+
+/** The heaps that IndirectPriorityQueue can keep its nodes in. The node with the highest priority is at the top.
+  * The priorities are read from the PriorityMap, which the IndirectPriorityQueue writes before it calls push() or
+  * update(). Every backend has this interface:
+  *
+  *   Backend(IndexMapType indexMap, size_t numberOfVertices, PriorityMapType priorityMap);
+  *   bool contains(const ValueType& v) const;  // Is 'v' in the heap?
+  *   void push(const ValueType& v);            // 'v' must not be in the heap
+  *   void update(const ValueType& v);          // 'v' must be in the heap, and its priority has changed
+  *   ValueType top() const;
+  *   void pop();
+  *   bool empty() const;
+  *   size_t size() const;
+  *   void clear();
+  *   void for_each(TFunctor f) const;          // Call f(v) for every node, in any order
+  *   void for_each_ordered(TFunctor f) const;  // Call f(v) best first, until f returns false
+  */
+
+/** A binomial heap (boost::heap::binomial_heap) with a handle per node. This is the original queue of
+  * IndirectPriorityQueue, and the default. Note that update() only sifts the node down (the binomial_heap
+  * update(handle, value) sees the same node before and after), so a node whose priority increases keeps its place. */
+template <typename TGraph>
+struct BinomialHeapQueueBackend
+{
+  typedef typename boost::graph_traits<TGraph>::vertex_descriptor ValueType;
+  typedef typename boost::property_map<TGraph, boost::vertex_index_t>::const_type IndexMapType;
+  typedef boost::vector_property_map<float, IndexMapType> PriorityMapType;
+
+  typedef boost::indirect_cmp<PriorityMapType, std::less<float> > IndirectComparisonType;
+  typedef boost::heap::binomial_heap<ValueType, boost::heap::compare<IndirectComparisonType> > HeapType;
+
+  typedef typename HeapType::handle_type HandleType;
+  typedef boost::vector_property_map<HandleType, IndexMapType> HandleMapType;
+
+  HandleMapType HandleMap;
+
+  HeapType Heap;
+
+  BinomialHeapQueueBackend(IndexMapType indexMap, const size_t numberOfVertices, PriorityMapType priorityMap) :
+    HandleMap(numberOfVertices, indexMap), Heap(IndirectComparisonType(priorityMap))
+  {
+    // The default handle is an invalid node handle (a node_pointer of NULL)
+  }
+
+  bool contains(const ValueType& v) const
+  {
+    return get(this->HandleMap, v).node_ != 0;
+  }
+
+  void push(const ValueType& v)
+  {
+    put(this->HandleMap, v, this->Heap.push(v));
+  }
+
+  void update(const ValueType& v)
+  {
+    this->Heap.update(get(this->HandleMap, v), v);
+  }
+
+  ValueType top() const
+  {
+    return this->Heap.top();
+  }
+
+  void pop()
+  {
+    put(this->HandleMap, this->Heap.top(), HandleType());
+    this->Heap.pop();
+  }
+
+  bool empty() const
+  {
+    return this->Heap.empty();
+  }
+
+  size_t size() const
+  {
+    return this->Heap.size();
+  }
+
+  void clear()
+  {
+    for(typename HeapType::iterator it = this->Heap.begin(); it != this->Heap.end(); ++it)
+    {
+      put(this->HandleMap, *it, HandleType());
+    }
+    this->Heap.clear();
+  }
+
+  template <typename TFunctor>
+  void for_each(TFunctor f) const
+  {
+    for(typename HeapType::iterator it = this->Heap.begin(); it != this->Heap.end(); ++it)
+    {
+      f(*it);
+    }
+  }
+
+  template <typename TFunctor>
+  void for_each_ordered(TFunctor f) const
+  {
+    for(typename HeapType::ordered_iterator it = this->Heap.ordered_begin(); it != this->Heap.ordered_end(); ++it)
+    {
+      if(!f(*it))
+      {
+        return;
+      }
+    }
+  }
+};
+
+/** An implicit d-ary heap (4-ary by default) in a single array, with the position of every node in a property
+  * map (like the boost::d_ary_heap_indirect that 3D/InpaintingRGBD uses). The priority is stored next to the node
+  * in the array, so that sifting does not read the priority map. update() sifts the node in either direction. */
+template <typename TGraph, unsigned int Arity = 4>
+struct DAryHeapQueueBackend
+{
+  typedef typename boost::graph_traits<TGraph>::vertex_descriptor ValueType;
+  typedef typename boost::property_map<TGraph, boost::vertex_index_t>::const_type IndexMapType;
+  typedef boost::vector_property_map<float, IndexMapType> PriorityMapType;
+
+  /** The position of the node in the heap array. */
+  typedef size_t HandleType;
+  typedef boost::vector_property_map<HandleType, IndexMapType> PositionMapType;
+
+  struct HeapEntry
+  {
+    float Priority;
+    ValueType Node;
+  };
+
+  PriorityMapType PriorityMap;
+
+  PositionMapType PositionMap;
+
+  std::vector<HeapEntry> Heap;
+
+  static const HandleType NotInHeap = static_cast<HandleType>(-1);
+
+  DAryHeapQueueBackend(IndexMapType indexMap, const size_t numberOfVertices, PriorityMapType priorityMap) :
+    PriorityMap(priorityMap), PositionMap(numberOfVertices, indexMap)
+  {
+    static_assert(Arity >= 2, "DAryHeapQueueBackend: The arity must be at least 2!");
+    for(size_t vertexId = 0; vertexId < numberOfVertices; ++vertexId)
+    {
+      this->PositionMap.storage_begin()[vertexId] = NotInHeap;
+    }
+  }
+
+  bool contains(const ValueType& v) const
+  {
+    return get(this->PositionMap, v) != NotInHeap;
+  }
+
+  void push(const ValueType& v)
+  {
+    HeapEntry entry = {get(this->PriorityMap, v), v};
+    this->Heap.push_back(entry);
+    this->SiftUp(this->Heap.size() - 1);
+  }
+
+  void update(const ValueType& v)
+  {
+    const size_t position = get(this->PositionMap, v);
+    const float oldPriority = this->Heap[position].Priority;
+    this->Heap[position].Priority = get(this->PriorityMap, v);
+    if(this->Heap[position].Priority > oldPriority)
+    {
+      this->SiftUp(position);
+    }
+    else
+    {
+      this->SiftDown(position);
+    }
+  }
+
+  ValueType top() const
+  {
+    return this->Heap.front().Node;
+  }
+
+  void pop()
+  {
+    put(this->PositionMap, this->Heap.front().Node, NotInHeap);
+    if(this->Heap.size() > 1)
+    {
+      this->Heap.front() = this->Heap.back();
+      this->Heap.pop_back();
+      this->SiftDown(0);
+    }
+    else
+    {
+      this->Heap.pop_back();
+    }
+  }
+
+  bool empty() const
+  {
+    return this->Heap.empty();
+  }
+
+  size_t size() const
+  {
+    return this->Heap.size();
+  }
+
+  void clear()
+  {
+    for(size_t position = 0; position < this->Heap.size(); ++position)
+    {
+      put(this->PositionMap, this->Heap[position].Node, NotInHeap);
+    }
+    this->Heap.clear();
+  }
+
+  template <typename TFunctor>
+  void for_each(TFunctor f) const
+  {
+    for(size_t position = 0; position < this->Heap.size(); ++position)
+    {
+      f(this->Heap[position].Node);
+    }
+  }
+
+  /** Visit the nodes best first by expanding the heap tree from its root: the next node is the best
+    * of the children of the nodes visited so far. */
+  template <typename TFunctor>
+  void for_each_ordered(TFunctor f) const
+  {
+    if(this->Heap.empty())
+    {
+      return;
+    }
+
+    // A max-heap of heap positions, ordered by their priority
+    auto lowerPriority = [this](const size_t a, const size_t b)
+    {
+      return this->Heap[a].Priority < this->Heap[b].Priority;
+    };
+
+    std::vector<size_t> frontier(1, 0);
+    while(!frontier.empty())
+    {
+      std::pop_heap(frontier.begin(), frontier.end(), lowerPriority);
+      const size_t position = frontier.back();
+      frontier.pop_back();
+
+      if(!f(this->Heap[position].Node))
+      {
+        return;
+      }
+
+      const size_t firstChild = Arity * position + 1;
+      for(size_t child = firstChild; child < firstChild + Arity && child < this->Heap.size(); ++child)
+      {
+        frontier.push_back(child);
+        std::push_heap(frontier.begin(), frontier.end(), lowerPriority);
+      }
+    }
+  }
+
+private:
+  void SiftUp(size_t position)
+  {
+    HeapEntry entry = this->Heap[position];
+    while(position > 0)
+    {
+      const size_t parent = (position - 1) / Arity;
+      if(!(this->Heap[parent].Priority < entry.Priority))
+      {
+        break;
+      }
+      this->Heap[position] = this->Heap[parent];
+      put(this->PositionMap, this->Heap[position].Node, position);
+      position = parent;
+    }
+    this->Heap[position] = entry;
+    put(this->PositionMap, entry.Node, position);
+  }
+
+  void SiftDown(size_t position)
+  {
+    HeapEntry entry = this->Heap[position];
+    const size_t heapSize = this->Heap.size();
+    while(true)
+    {
+      const size_t firstChild = Arity * position + 1;
+      if(firstChild >= heapSize)
+      {
+        break;
+      }
+
+      size_t bestChild = firstChild;
+      const size_t lastChild = std::min(firstChild + Arity, heapSize);
+      for(size_t child = firstChild + 1; child < lastChild; ++child)
+      {
+        if(this->Heap[bestChild].Priority < this->Heap[child].Priority)
+        {
+          bestChild = child;
+        }
+      }
+
+      if(!(entry.Priority < this->Heap[bestChild].Priority))
+      {
+        break;
+      }
+      this->Heap[position] = this->Heap[bestChild];
+      put(this->PositionMap, this->Heap[position].Node, position);
+      position = bestChild;
+    }
+    this->Heap[position] = entry;
+    put(this->PositionMap, entry.Node, position);
+  }
+};
+
+/** A bucket (radix) queue for priorities that are quantized into SetNumberOfBuckets() buckets over the range
+  * SetPriorityRange(); priorities outside of the range go into the first or the last bucket. push(), update() and
+  * pop() move a node between buckets in constant time. top() is the best node of the highest non-empty bucket,
+  * found by scanning that bucket, so the order is exact, and the queue is fast as long as the buckets near the top
+  * stay small (the range should cover the priorities of the workload; see SpeedTests/BoundaryQueueBackends). */
+template <typename TGraph>
+struct BucketQueueBackend
+{
+  typedef typename boost::graph_traits<TGraph>::vertex_descriptor ValueType;
+  typedef typename boost::property_map<TGraph, boost::vertex_index_t>::const_type IndexMapType;
+  typedef boost::vector_property_map<float, IndexMapType> PriorityMapType;
+
+  /** The bucket of the node. */
+  typedef unsigned int HandleType;
+  typedef boost::vector_property_map<HandleType, IndexMapType> BucketMapType;
+  typedef boost::vector_property_map<unsigned int, IndexMapType> PositionMapType;
+
+  PriorityMapType PriorityMap;
+
+  BucketMapType BucketMap;
+
+  /** The position of the node in its bucket. */
+  PositionMapType PositionMap;
+
+  std::vector<std::vector<ValueType> > Buckets;
+
+  float MinimumPriority;
+
+  float MaximumPriority;
+
+  /** The highest bucket that can be non-empty. The buckets above the highest node are skipped lazily. */
+  mutable unsigned int HighestBucket;
+
+  size_t NumberOfNodes;
+
+  static const HandleType NotInQueue = static_cast<HandleType>(-1);
+
+  BucketQueueBackend(IndexMapType indexMap, const size_t numberOfVertices, PriorityMapType priorityMap) :
+    PriorityMap(priorityMap), BucketMap(numberOfVertices, indexMap), PositionMap(numberOfVertices, indexMap),
+    Buckets(1024), MinimumPriority(0.0f), MaximumPriority(1.0f), HighestBucket(0), NumberOfNodes(0)
+  {
+    for(size_t vertexId = 0; vertexId < numberOfVertices; ++vertexId)
+    {
+      this->BucketMap.storage_begin()[vertexId] = NotInQueue;
+    }
+  }
+
+  /** The buckets can only be changed while the queue is empty. */
+  void SetNumberOfBuckets(const unsigned int numberOfBuckets)
+  {
+    if(numberOfBuckets == 0 || this->NumberOfNodes != 0)
+    {
+      throw std::runtime_error("BucketQueueBackend: The number of buckets must be positive and the queue empty!");
+    }
+    this->Buckets.resize(numberOfBuckets);
+    this->HighestBucket = 0;
+  }
+
+  void SetPriorityRange(const float minimumPriority, const float maximumPriority)
+  {
+    if(!(minimumPriority < maximumPriority) || this->NumberOfNodes != 0)
+    {
+      throw std::runtime_error("BucketQueueBackend: The priority range must not be empty and the queue empty!");
+    }
+    this->MinimumPriority = minimumPriority;
+    this->MaximumPriority = maximumPriority;
+  }
+
+  bool contains(const ValueType& v) const
+  {
+    return get(this->BucketMap, v) != NotInQueue;
+  }
+
+  void push(const ValueType& v)
+  {
+    this->Insert(v, this->ComputeBucket(get(this->PriorityMap, v)));
+    this->NumberOfNodes++;
+  }
+
+  void update(const ValueType& v)
+  {
+    const HandleType bucket = this->ComputeBucket(get(this->PriorityMap, v));
+    if(bucket != get(this->BucketMap, v))
+    {
+      this->Remove(v);
+      this->Insert(v, bucket);
+    }
+  }
+
+  ValueType top() const
+  {
+    const std::vector<ValueType>& bucket = this->Buckets[this->GetHighestNonEmptyBucket()];
+    return bucket[this->FindBest(bucket)];
+  }
+
+  void pop()
+  {
+    const std::vector<ValueType>& bucket = this->Buckets[this->GetHighestNonEmptyBucket()];
+    this->Remove(bucket[this->FindBest(bucket)]);
+    this->NumberOfNodes--;
+  }
+
+  bool empty() const
+  {
+    return this->NumberOfNodes == 0;
+  }
+
+  size_t size() const
+  {
+    return this->NumberOfNodes;
+  }
+
+  void clear()
+  {
+    for(size_t bucketId = 0; bucketId < this->Buckets.size(); ++bucketId)
+    {
+      for(size_t nodeId = 0; nodeId < this->Buckets[bucketId].size(); ++nodeId)
+      {
+        put(this->BucketMap, this->Buckets[bucketId][nodeId], NotInQueue);
+      }
+      this->Buckets[bucketId].clear();
+    }
+    this->HighestBucket = 0;
+    this->NumberOfNodes = 0;
+  }
+
+  template <typename TFunctor>
+  void for_each(TFunctor f) const
+  {
+    for(size_t bucketId = 0; bucketId < this->Buckets.size(); ++bucketId)
+    {
+      for(size_t nodeId = 0; nodeId < this->Buckets[bucketId].size(); ++nodeId)
+      {
+        f(this->Buckets[bucketId][nodeId]);
+      }
+    }
+  }
+
+  template <typename TFunctor>
+  void for_each_ordered(TFunctor f) const
+  {
+    auto higherPriority = [this](const ValueType& a, const ValueType& b)
+    {
+      return get(this->PriorityMap, a) > get(this->PriorityMap, b);
+    };
+
+    std::vector<ValueType> sortedBucket;
+    for(size_t bucketId = this->HighestBucket + 1; bucketId-- > 0; )
+    {
+      sortedBucket = this->Buckets[bucketId];
+      std::stable_sort(sortedBucket.begin(), sortedBucket.end(), higherPriority);
+      for(size_t nodeId = 0; nodeId < sortedBucket.size(); ++nodeId)
+      {
+        if(!f(sortedBucket[nodeId]))
+        {
+          return;
+        }
+      }
+    }
+  }
+
+private:
+  HandleType ComputeBucket(const float priority) const
+  {
+    const float normalizedPriority = (priority - this->MinimumPriority) / (this->MaximumPriority - this->MinimumPriority);
+    if(!(normalizedPriority > 0.0f)) // This also catches NaN
+    {
+      return 0;
+    }
+    const float bucket = normalizedPriority * static_cast<float>(this->Buckets.size());
+    if(bucket >= static_cast<float>(this->Buckets.size() - 1))
+    {
+      return static_cast<HandleType>(this->Buckets.size() - 1);
+    }
+    return static_cast<HandleType>(bucket);
+  }
+
+  void Insert(const ValueType& v, const HandleType bucket)
+  {
+    put(this->BucketMap, v, bucket);
+    put(this->PositionMap, v, static_cast<unsigned int>(this->Buckets[bucket].size()));
+    this->Buckets[bucket].push_back(v);
+    this->HighestBucket = std::max(this->HighestBucket, bucket);
+  }
+
+  /** Remove 'v' from its bucket by moving the last node of the bucket into its place. */
+  void Remove(const ValueType v)
+  {
+    std::vector<ValueType>& bucket = this->Buckets[get(this->BucketMap, v)];
+    const unsigned int position = get(this->PositionMap, v);
+    bucket[position] = bucket.back();
+    put(this->PositionMap, bucket[position], position);
+    bucket.pop_back();
+    put(this->BucketMap, v, NotInQueue);
+  }
+
+  unsigned int GetHighestNonEmptyBucket() const
+  {
+    while(this->HighestBucket > 0 && this->Buckets[this->HighestBucket].empty())
+    {
+      this->HighestBucket--;
+    }
+    return this->HighestBucket;
+  }
+
+  size_t FindBest(const std::vector<ValueType>& bucket) const
+  {
+    size_t best = 0;
+    float bestPriority = get(this->PriorityMap, bucket[0]);
+    for(size_t nodeId = 1; nodeId < bucket.size(); ++nodeId)
+    {
+      const float priority = get(this->PriorityMap, bucket[nodeId]);
+      if(priority > bestPriority)
+      {
+        best = nodeId;
+        bestPriority = priority;
+      }
+    }
+    return best;
+  }
+};
+
+template <typename TGraph, unsigned int Arity>
+const typename DAryHeapQueueBackend<TGraph, Arity>::HandleType DAryHeapQueueBackend<TGraph, Arity>::NotInHeap;
+
+template <typename TGraph>
+const typename BucketQueueBackend<TGraph>::HandleType BucketQueueBackend<TGraph>::NotInQueue;
+
+#endif // PriorityQueueBackends_H
@@ -0,0 +1,128 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef PyramidHelpers_HPP
+#define PyramidHelpers_HPP
+
+// ITK
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+// Submodules
+#include <Helpers/Helpers.h>
+#include <ITKHelpers/ITKHelpers.h>
+#include <Mask/Mask.h>
+
+// STL
+#include <algorithm>
+#include <vector>
+
+namespace PyramidHelpers
+{
+
+/** Get the region of the level above (half the resolution, rounded up) of an image with region 'region'. */
+inline itk::ImageRegion<2> GetDownsampledRegion(const itk::ImageRegion<2>& region)
+{
+  itk::Index<2> corner = {{0, 0}};
+  itk::Size<2> size = {{(region.GetSize()[0] + 1) / 2, (region.GetSize()[1] + 1) / 2}};
+  return itk::ImageRegion<2>(corner, size);
+}
+
+/** Get the pixel of the level above that covers 'index'. */
+inline itk::Index<2> GetCoarseIndex(const itk::Index<2>& index)
+{
+  itk::Index<2> coarseIndex = {{index[0] / 2, index[1] / 2}};
+  return coarseIndex;
+}
+
+/** Create the next (coarser) level of a masked image pyramid. Each coarse pixel covers a 2x2 block of
+  * 'image'. A coarse pixel is a hole if any pixel of its block is a hole, so that the coarse hole covers
+  * the upsampled fine hole and every fine hole pixel has a coarse parent that was inpainted. The valid coarse
+  * pixels are the mean of their (all valid) blocks, so no hole values leak into the coarse source patches.
+  * A 2x2 box filter is used instead of a wider Gaussian kernel so that the hole does not grow by more than
+  * one coarse pixel per level. */
+template <typename TImage>
+void DownsampleMasked(const TImage* const image, const Mask* const mask,
+                      TImage* const outputImage, Mask* const outputMask)
+{
+  itk::ImageRegion<2> fullRegion = image->GetLargestPossibleRegion();
+  itk::ImageRegion<2> coarseRegion = GetDownsampledRegion(fullRegion);
+
+  outputImage->SetRegions(coarseRegion);
+  outputImage->SetNumberOfComponentsPerPixel(image->GetNumberOfComponentsPerPixel());
+  outputImage->Allocate();
+
+  outputMask->SetRegions(coarseRegion);
+  outputMask->Allocate();
+  ITKHelpers::SetImageToConstant(outputMask, outputMask->GetValidValue());
+
+  const unsigned int numberOfComponents = Helpers::length(image->GetPixel(fullRegion.GetIndex()));
+  std::vector<float> sum(numberOfComponents);
+
+  itk::ImageRegionConstIteratorWithIndex<TImage> coarseIterator(outputImage, coarseRegion);
+  while(!coarseIterator.IsAtEnd())
+  {
+    itk::Index<2> coarseIndex = coarseIterator.GetIndex();
+    itk::Index<2> blockCorner = {{fullRegion.GetIndex()[0] + 2 * coarseIndex[0],
+                                  fullRegion.GetIndex()[1] + 2 * coarseIndex[1]}};
+    itk::Size<2> blockSize = {{2, 2}};
+    itk::ImageRegion<2> blockRegion(blockCorner, blockSize);
+    blockRegion.Crop(fullRegion);
+
+    std::fill(sum.begin(), sum.end(), 0.0f);
+    bool hole = false;
+    typename TImage::PixelType pixel = image->GetPixel(blockCorner);
+
+    itk::ImageRegionConstIteratorWithIndex<TImage> blockIterator(image, blockRegion);
+    while(!blockIterator.IsAtEnd())
+    {
+      if(mask->IsHole(blockIterator.GetIndex()))
+      {
+        hole = true;
+        break;
+      }
+
+      for(unsigned int component = 0; component < numberOfComponents; ++component)
+      {
+        sum[component] += static_cast<float>(Helpers::index(blockIterator.Get(), component));
+      }
+      ++blockIterator;
+    }
+
+    if(hole)
+    {
+      outputMask->SetPixel(coarseIndex, outputMask->GetHoleValue());
+    }
+    else
+    {
+      const float numberOfPixels = static_cast<float>(blockRegion.GetNumberOfPixels());
+      for(unsigned int component = 0; component < numberOfComponents; ++component)
+      {
+        Helpers::index(pixel, component) = sum[component] / numberOfPixels;
+      }
+    }
+
+    // Hole pixels keep an arbitrary value from their block; they are overwritten when the level is inpainted.
+    outputImage->SetPixel(coarseIndex, pixel);
+
+    ++coarseIterator;
+  }
+}
+
+} // end PyramidHelpers namespace
+
+#endif
@@ -0,0 +1,81 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef RowMasks_HPP
+#define RowMasks_HPP
+
+// STL
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/** The valid pixels of each row of a patch as a bitmask (bit i is set if the pixel in column i is valid), so
+  * patches can be at most 64 pixels wide. ImagePatchPixelDescriptor keeps the masks of its valid pixels, and
+  * SpanDifferenceKernels and VPTreeSearchBest walk the runs of set bits.
+  */
+namespace RowMasks
+{
+
+/** Get the position of the lowest set bit of a non-zero 'value'. */
+inline unsigned int CountTrailingZeros(const uint64_t value)
+{
+#if defined(__GNUC__)
+  return static_cast<unsigned int>(__builtin_ctzll(value));
+#else
+  unsigned int count = 0;
+  while(!((value >> count) & 1))
+  {
+    count++;
+  }
+  return count;
+#endif
+}
+
+/** Compute the valid pixel bitmask of each row of a patch from the offsets (from the patch corner) of its valid
+  * pixels. There is one mask for each row up to the last row that contains a valid pixel. An empty vector is
+  * returned if a valid pixel is more than 63 pixels to the right of the corner (or if an offset is negative),
+  * in which case the patch cannot be described with 64 bit masks. */
+template <typename TOffsetContainer>
+std::vector<uint64_t> ComputeRowMasks(const TOffsetContainer& validOffsets)
+{
+  std::vector<uint64_t> rowMasks;
+
+  long numberOfRows = 0;
+  for(typename TOffsetContainer::const_iterator offsetIterator = validOffsets.begin();
+      offsetIterator != validOffsets.end(); ++offsetIterator)
+  {
+    if((*offsetIterator)[0] < 0 || (*offsetIterator)[0] >= 64 || (*offsetIterator)[1] < 0)
+    {
+      return rowMasks;
+    }
+    numberOfRows = std::max(numberOfRows, static_cast<long>((*offsetIterator)[1]) + 1);
+  }
+
+  rowMasks.assign(numberOfRows, 0);
+  for(typename TOffsetContainer::const_iterator offsetIterator = validOffsets.begin();
+      offsetIterator != validOffsets.end(); ++offsetIterator)
+  {
+    rowMasks[(*offsetIterator)[1]] |= (static_cast<uint64_t>(1) << (*offsetIterator)[0]);
+  }
+
+  return rowMasks;
+}
+
+} // end namespace RowMasks
+
+#endif
@@ -0,0 +1,178 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef SourcePatchBank_HPP
+#define SourcePatchBank_HPP
+
+// ITK
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+// Submodules
+#include <Helpers/Helpers.h>
+#include <ITKHelpers/ITKHelpers.h>
+#include <Mask/Mask.h>
+
+// STL
+#include <vector>
+
+/**
+  * This class stores the list of nodes whose patches are valid source patches (entirely inside the image
+  * and entirely valid in the mask, which is the same rule ImagePatchPixelDescriptor uses to set SOURCE_NODE).
+  *
+  * The list is built once from the mask, and then only grows: source patches never become invalid,
+  * and when new patches are allowed (InpaintingVisitor::SetAllowNewPatches) the visitor adds the
+  * patches in each filled region that became valid. The searchers can then iterate over begin()/end()
+  * directly instead of scanning (and copying the descriptors of) every vertex of the graph at each iteration.
+  */
+template <typename TNode>
+class SourcePatchBank
+{
+public:
+  typedef std::vector<TNode> NodeContainerType;
+  typedef typename NodeContainerType::const_iterator ConstIteratorType;
+
+  /** Find all of the valid source patches in 'mask'. */
+  SourcePatchBank(Mask* const mask, const unsigned int patchHalfWidth) :
+    MaskImage(mask), PatchHalfWidth(patchHalfWidth)
+  {
+    this->FullRegion = mask->GetLargestPossibleRegion();
+    this->InBank.assign(this->FullRegion.GetNumberOfPixels(), false);
+
+    const unsigned int width = this->FullRegion.GetSize()[0];
+    const unsigned int height = this->FullRegion.GetSize()[1];
+    const unsigned int patchWidth = 2 * patchHalfWidth + 1;
+
+    if(width < patchWidth || height < patchWidth)
+    {
+      return;
+    }
+
+    // Count the invalid pixels in every patch with a summed area table, so the initialization is
+    // linear in the number of pixels instead of in the number of pixels times the patch size.
+    const unsigned int integralWidth = width + 1;
+    std::vector<unsigned int> invalidCounts(integralWidth * (height + 1), 0);
+
+    itk::ImageRegionConstIteratorWithIndex<Mask> maskIterator(mask, this->FullRegion);
+    for(unsigned int y = 0; y < height; ++y)
+    {
+      unsigned int rowCount = 0;
+      for(unsigned int x = 0; x < width; ++x)
+      {
+        if(!mask->IsValid(maskIterator.GetIndex()))
+        {
+          rowCount++;
+        }
+        invalidCounts[(y + 1) * integralWidth + (x + 1)] = invalidCounts[y * integralWidth + (x + 1)] + rowCount;
+        ++maskIterator;
+      }
+    }
+
+    for(unsigned int y = 0; y + patchWidth <= height; ++y)
+    {
+      for(unsigned int x = 0; x + patchWidth <= width; ++x)
+      {
+        unsigned int numberOfInvalidPixels = invalidCounts[(y + patchWidth) * integralWidth + (x + patchWidth)]
+                                           - invalidCounts[y * integralWidth + (x + patchWidth)]
+                                           - invalidCounts[(y + patchWidth) * integralWidth + x]
+                                           + invalidCounts[y * integralWidth + x];
+        if(numberOfInvalidPixels == 0)
+        {
+          itk::Index<2> center = {{this->FullRegion.GetIndex()[0] + x + patchHalfWidth,
+                                   this->FullRegion.GetIndex()[1] + y + patchHalfWidth}};
+          this->AddNode(center);
+        }
+      }
+    }
+  }
+
+  ConstIteratorType begin() const
+  {
+    return this->Nodes.begin();
+  }
+
+  ConstIteratorType end() const
+  {
+    return this->Nodes.end();
+  }
+
+  size_t size() const
+  {
+    return this->Nodes.size();
+  }
+
+  bool Contains(const itk::Index<2>& index) const
+  {
+    return this->FullRegion.IsInside(index) && this->InBank[this->LinearIndex(index)];
+  }
+
+  /** Add the patches centered in 'region' that are now valid source patches and are not in the bank yet.
+    * Returns the number of patches that were added. */
+  unsigned int AddValidPatchesInRegion(itk::ImageRegion<2> region)
+  {
+    region.Crop(this->FullRegion);
+
+    unsigned int numberOfAddedPatches = 0;
+    itk::ImageRegionConstIteratorWithIndex<Mask> regionIterator(this->MaskImage, region);
+    while(!regionIterator.IsAtEnd())
+    {
+      itk::Index<2> index = regionIterator.GetIndex();
+      if(!this->InBank[this->LinearIndex(index)])
+      {
+        itk::ImageRegion<2> patchRegion = ITKHelpers::GetRegionInRadiusAroundPixel(index, this->PatchHalfWidth);
+        if(this->FullRegion.IsInside(patchRegion) && this->MaskImage->IsValid(patchRegion))
+        {
+          this->AddNode(index);
+          numberOfAddedPatches++;
+        }
+      }
+      ++regionIterator;
+    }
+
+    return numberOfAddedPatches;
+  }
+
+private:
+  /** The mask that determines which patches are valid. */
+  Mask* MaskImage;
+
+  /** The radius of the patches. */
+  unsigned int PatchHalfWidth;
+
+  /** The region of the mask. */
+  itk::ImageRegion<2> FullRegion;
+
+  /** The nodes of the valid source patches. */
+  NodeContainerType Nodes;
+
+  /** Whether or not the patch centered at each pixel is in 'Nodes'. */
+  std::vector<bool> InBank;
+
+  size_t LinearIndex(const itk::Index<2>& index) const
+  {
+    return (index[1] - this->FullRegion.GetIndex()[1]) * this->FullRegion.GetSize()[0] +
+           (index[0] - this->FullRegion.GetIndex()[0]);
+  }
+
+  void AddNode(const itk::Index<2>& index)
+  {
+    this->Nodes.push_back(Helpers::ConvertFrom<TNode, itk::Index<2> >(index));
+    this->InBank[this->LinearIndex(index)] = true;
+  }
+};
+
+#endif
@@ -0,0 +1,330 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "TaskPool.h"
+
+// STL
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace
+{
+  /** The pool and the id of the worker that the calling thread is, if it is a worker. */
+  thread_local const TaskPool* CurrentPool = 0;
+  thread_local int CurrentWorkerId = -1;
+
+  std::mutex GlobalInstanceMutex;
+  std::unique_ptr<TaskPool> GlobalInstance;
+
+  void PinCurrentThread(const unsigned int core)
+  {
+#ifdef __linux__
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(core, &cpuSet);
+    if(pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet) != 0)
+    {
+      std::cerr << "TaskPool: Could not pin a worker to core " << core << "." << std::endl;
+    }
+#else
+    (void)core;
+#endif
+  }
+}
+
+TaskPool::TaskPool(const unsigned int numberOfThreads, const std::vector<unsigned int>& cores) :
+  NumberOfQueuedTasks(0), Stop(false)
+{
+  unsigned int numberOfWorkers = numberOfThreads;
+  if(numberOfWorkers == 0)
+  {
+    numberOfWorkers = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  // One queue per worker, and the last queue for the tasks submitted from outside of the pool
+  for(unsigned int queueId = 0; queueId <= numberOfWorkers; ++queueId)
+  {
+    this->Queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue));
+  }
+
+  for(unsigned int workerId = 0; workerId < numberOfWorkers; ++workerId)
+  {
+    this->Threads.push_back(std::thread([this, workerId, cores]()
+    {
+      if(!cores.empty())
+      {
+        PinCurrentThread(cores[workerId % cores.size()]);
+      }
+      this->WorkerLoop(workerId);
+    }));
+  }
+}
+
+TaskPool::~TaskPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->SleepMutex);
+    this->Stop = true;
+  }
+  this->WakeUp.notify_all();
+
+  for(size_t threadId = 0; threadId < this->Threads.size(); ++threadId)
+  {
+    this->Threads[threadId].join();
+  }
+}
+
+unsigned int TaskPool::GetNumberOfThreads() const
+{
+  return static_cast<unsigned int>(this->Threads.size());
+}
+
+void TaskPool::Submit(const TaskType& task)
+{
+  int workerId = this->GetCurrentWorkerId();
+  size_t queueId = (workerId >= 0) ? static_cast<size_t>(workerId) : this->Queues.size() - 1;
+
+  {
+    std::lock_guard<std::mutex> lock(this->Queues[queueId]->Mutex);
+    this->Queues[queueId]->Tasks.push_back(task);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->SleepMutex);
+    this->NumberOfQueuedTasks++;
+  }
+  this->WakeUp.notify_one();
+}
+
+bool TaskPool::TakeTask(const int workerId, TaskType& task)
+{
+  if(this->NumberOfQueuedTasks == 0)
+  {
+    return false;
+  }
+
+  // The newest task of the worker's own queue
+  if(workerId >= 0)
+  {
+    WorkerQueue& queue = *(this->Queues[workerId]);
+    std::lock_guard<std::mutex> lock(queue.Mutex);
+    if(!queue.Tasks.empty())
+    {
+      task = queue.Tasks.back();
+      queue.Tasks.pop_back();
+      this->NumberOfQueuedTasks--;
+      return true;
+    }
+  }
+
+  // Otherwise the oldest task of the queue of the tasks from outside of the pool (so they are run in the
+  // order they were submitted), and then the oldest task of another worker, starting after the worker's
+  // own queue so that the thieves spread over the queues
+  const size_t numberOfQueues = this->Queues.size();
+  const size_t firstWorkerQueueId = (workerId >= 0) ? static_cast<size_t>(workerId) + 1 : 0;
+  for(size_t i = 0; i < numberOfQueues; ++i)
+  {
+    const size_t queueId = (i == 0) ? numberOfQueues - 1 : (firstWorkerQueueId + i - 1) % (numberOfQueues - 1);
+    WorkerQueue& queue = *(this->Queues[queueId]);
+    std::lock_guard<std::mutex> lock(queue.Mutex);
+    if(!queue.Tasks.empty())
+    {
+      task = queue.Tasks.front();
+      queue.Tasks.pop_front();
+      this->NumberOfQueuedTasks--;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void TaskPool::WorkerLoop(const unsigned int workerId)
+{
+  CurrentPool = this;
+  CurrentWorkerId = static_cast<int>(workerId);
+
+  while(true)
+  {
+    TaskType task;
+    if(this->TakeTask(static_cast<int>(workerId), task))
+    {
+      task();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(this->SleepMutex);
+    this->WakeUp.wait(lock, [this]() { return this->Stop || this->NumberOfQueuedTasks > 0; });
+    if(this->Stop && this->NumberOfQueuedTasks == 0)
+    {
+      return;
+    }
+  }
+}
+
+int TaskPool::GetCurrentWorkerId() const
+{
+  return (CurrentPool == this) ? CurrentWorkerId : -1;
+}
+
+TaskPool& TaskPool::GetGlobalInstance()
+{
+  std::lock_guard<std::mutex> lock(GlobalInstanceMutex);
+  if(!GlobalInstance)
+  {
+    unsigned int numberOfThreads = 0;
+    const char* numberOfThreadsVariable = std::getenv("PATCHBASEDINPAINTING_NUMBER_OF_THREADS");
+    if(numberOfThreadsVariable)
+    {
+      std::stringstream ss;
+      ss << numberOfThreadsVariable;
+      ss >> numberOfThreads;
+    }
+
+    GlobalInstance.reset(new TaskPool(numberOfThreads));
+  }
+
+  return *GlobalInstance;
+}
+
+void TaskPool::SetGlobalConfiguration(const unsigned int numberOfThreads, const std::vector<unsigned int>& cores)
+{
+  std::lock_guard<std::mutex> lock(GlobalInstanceMutex);
+  if(GlobalInstance && GlobalInstance->GetCurrentWorkerId() >= 0)
+  {
+    throw std::runtime_error("TaskPool::SetGlobalConfiguration: The global pool can not be replaced by one of its tasks!");
+  }
+
+  // The old pool runs its queued tasks before it is destroyed
+  GlobalInstance.reset(new TaskPool(numberOfThreads, cores));
+}
+
+struct TaskGroup::SharedState
+{
+  std::mutex Mutex;
+
+  /** Signaled when the last task is done. */
+  std::condition_variable AllTasksDone;
+
+  std::deque<TaskPool::TaskType> PendingTasks;
+
+  long NumberOfUnfinishedTasks;
+
+  std::exception_ptr FirstException;
+
+  SharedState() : NumberOfUnfinishedTasks(0) {}
+
+  /** Run the oldest task that was not started yet. Returns false if all of the tasks were started. */
+  bool RunPendingTask()
+  {
+    TaskPool::TaskType task;
+    {
+      std::lock_guard<std::mutex> lock(this->Mutex);
+      if(this->PendingTasks.empty())
+      {
+        return false;
+      }
+      task = this->PendingTasks.front();
+      this->PendingTasks.pop_front();
+    }
+
+    std::exception_ptr exception;
+    try
+    {
+      task();
+    }
+    catch(...)
+    {
+      exception = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    if(exception && !this->FirstException)
+    {
+      this->FirstException = exception;
+    }
+    this->NumberOfUnfinishedTasks--;
+    if(this->NumberOfUnfinishedTasks == 0)
+    {
+      this->AllTasksDone.notify_all();
+    }
+    return true;
+  }
+};
+
+TaskGroup::TaskGroup(TaskPool& pool) : Pool(pool), State(new SharedState)
+{
+
+}
+
+TaskGroup::~TaskGroup()
+{
+  // Never throw from the destructor, the exceptions are only reported by Wait()
+  this->WaitForTasks();
+}
+
+void TaskGroup::Run(const TaskPool::TaskType& task)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->State->Mutex);
+    this->State->PendingTasks.push_back(task);
+    this->State->NumberOfUnfinishedTasks++;
+  }
+
+  // The pool only gets a ticket for one task of the group. If the waiting thread already ran the task
+  // itself, the ticket does nothing.
+  std::shared_ptr<SharedState> state = this->State;
+  this->Pool.Submit([state]()
+  {
+    state->RunPendingTask();
+  });
+}
+
+void TaskGroup::WaitForTasks()
+{
+  while(this->State->RunPendingTask())
+  {
+  }
+
+  // The remaining tasks are being run by other threads
+  std::unique_lock<std::mutex> lock(this->State->Mutex);
+  this->State->AllTasksDone.wait(lock, [this]() { return this->State->NumberOfUnfinishedTasks == 0; });
+}
+
+void TaskGroup::Wait()
+{
+  this->WaitForTasks();
+
+  std::exception_ptr exception;
+  {
+    std::lock_guard<std::mutex> lock(this->State->Mutex);
+    std::swap(exception, this->State->FirstException);
+  }
+
+  if(exception)
+  {
+    std::rethrow_exception(exception);
+  }
+}
@@ -0,0 +1,185 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef TaskPool_H
+#define TaskPool_H
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+  * A small work-stealing thread pool. Each worker thread has its own queue of tasks. A worker runs the
+  * newest task of its own queue first. When its queue is empty it takes the oldest task submitted from
+  * outside of the pool (these are run in the order they were submitted), and otherwise steals the oldest
+  * task of another worker's queue. Tasks that are submitted from a worker (e.g. by a search that is run from a task of a
+  * driver) go to that worker's queue, so nested parallel work uses the same threads instead of starting
+  * more threads than there are cores. A thread that waits for a TaskGroup only runs the tasks of that group
+  * (see TaskGroup).
+  *
+  * Most code should use the global pool (GetGlobalInstance()) through TaskGroup or ParallelFor. The number of
+  * threads of the global pool is the value of the PATCHBASEDINPAINTING_NUMBER_OF_THREADS environment
+  * variable, or the number of cores if it is not set, unless it is changed with SetGlobalConfiguration(). A job that should only use some of the cores can create its own pool with the cores
+  * to pin its workers to (pinning is only supported on Linux and is ignored elsewhere).
+  */
+class TaskPool
+{
+public:
+  typedef std::function<void()> TaskType;
+
+  /** Start 'numberOfThreads' workers (the number of cores if 0). If 'cores' is not empty, worker i is
+    * pinned to cores[i % cores.size()]. */
+  TaskPool(const unsigned int numberOfThreads = 0, const std::vector<unsigned int>& cores = std::vector<unsigned int>());
+
+  /** Run the tasks that are still queued and stop the workers. */
+  ~TaskPool();
+
+  unsigned int GetNumberOfThreads() const;
+
+  /** Queue a task. The task must not throw (use TaskGroup to get the exceptions of tasks). */
+  void Submit(const TaskType& task);
+
+  /** Call function(i) for every i in [begin, end). The range is split into about four chunks per thread
+    * (but chunks of at least 'minimumChunkSize' indices), the calling thread works on the chunks too, and
+    * the function returns when all of the chunks are done. If one of the calls throws, the first exception
+    * is rethrown here. */
+  template <typename TFunction>
+  void ParallelFor(const long begin, const long end, TFunction function, const long minimumChunkSize = 1);
+
+  /** Get the pool shared by the whole program. It is created the first time it is used. */
+  static TaskPool& GetGlobalInstance();
+
+  /** Replace the global pool by one with 'numberOfThreads' threads pinned to 'cores'. This must not be called
+    * while the global pool is in use (the references returned by GetGlobalInstance() become invalid). */
+  static void SetGlobalConfiguration(const unsigned int numberOfThreads,
+                                     const std::vector<unsigned int>& cores = std::vector<unsigned int>());
+
+private:
+  TaskPool(const TaskPool&); // Not implemented
+  void operator=(const TaskPool&); // Not implemented
+
+  /** The tasks of one worker (or of the threads outside of the pool). The owner takes tasks from the back,
+    * the other workers take them from the front. */
+  struct WorkerQueue
+  {
+    std::mutex Mutex;
+    std::deque<TaskType> Tasks;
+  };
+
+  std::vector<std::unique_ptr<WorkerQueue> > Queues;
+
+  std::vector<std::thread> Threads;
+
+  /** The number of tasks that are in the queues (not the ones being run). */
+  std::atomic<long> NumberOfQueuedTasks;
+
+  bool Stop;
+
+  /** Protects Stop, and lets the idle workers sleep until there is a task. */
+  std::mutex SleepMutex;
+  std::condition_variable WakeUp;
+
+  void WorkerLoop(const unsigned int workerId);
+
+  /** Take a task, from the queue of 'workerId' first if it is a worker of this pool. */
+  bool TakeTask(const int workerId, TaskType& task);
+
+  /** Get the id of the calling thread in this pool, or -1 if it is not a worker of this pool. */
+  int GetCurrentWorkerId() const;
+};
+
+/**
+  * A set of tasks that can be waited for. Wait() (and the destructor) runs the tasks of the group that no
+  * worker has started yet in the calling thread, then sleeps until the tasks that other threads are running
+  * are done, and rethrows the first exception that one of the tasks threw. A waiting thread never runs tasks
+  * of other groups, so independent jobs (e.g. the images of a batch) are not nested in each other's waits.
+  */
+class TaskGroup
+{
+public:
+  TaskGroup(TaskPool& pool = TaskPool::GetGlobalInstance());
+
+  ~TaskGroup();
+
+  void Run(const TaskPool::TaskType& task);
+
+  void Wait();
+
+private:
+  TaskGroup(const TaskGroup&); // Not implemented
+  void operator=(const TaskGroup&); // Not implemented
+
+  TaskPool& Pool;
+
+  /** The tasks of the group that were not started, the number of tasks that are not done, and the first
+    * exception. It is shared with the pool, which may still hold tasks of the group after the group was
+    * destroyed by an exception in the thread that owns it. */
+  struct SharedState;
+  std::shared_ptr<SharedState> State;
+
+  /** Wait until all of the tasks are done, without rethrowing their exceptions. */
+  void WaitForTasks();
+};
+
+template <typename TFunction>
+void TaskPool::ParallelFor(const long begin, const long end, TFunction function, const long minimumChunkSize)
+{
+  const long numberOfIndices = end - begin;
+  if(numberOfIndices <= 0)
+  {
+    return;
+  }
+
+  const long maximumNumberOfChunks = 4 * static_cast<long>(this->GetNumberOfThreads());
+  const long numberOfChunks =
+      std::max(1L, std::min(maximumNumberOfChunks, numberOfIndices / std::max(1L, minimumChunkSize)));
+
+  if(numberOfChunks == 1)
+  {
+    for(long i = begin; i < end; ++i)
+    {
+      function(i);
+    }
+    return;
+  }
+
+  TaskGroup taskGroup(*this);
+  for(long chunkId = 0; chunkId < numberOfChunks; ++chunkId)
+  {
+    const long chunkBegin = begin + numberOfIndices * chunkId / numberOfChunks;
+    const long chunkEnd = begin + numberOfIndices * (chunkId + 1) / numberOfChunks;
+    taskGroup.Run([chunkBegin, chunkEnd, &function]()
+    {
+      for(long i = chunkBegin; i < chunkEnd; ++i)
+      {
+        function(i);
+      }
+    });
+  }
+  taskGroup.Wait();
+}
+
+#endif
@@ -0,0 +1,193 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// Custom
+#include "Utilities/IndirectPriorityQueue.h"
+
+// Boost
+#include <boost/graph/grid_graph.hpp>
+
+// STL
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+typedef boost::grid_graph<2> VertexListGraphType;
+typedef boost::graph_traits<VertexListGraphType>::vertex_descriptor VertexDescriptorType;
+
+/** Compare the constant time size() to the number of valid nodes counted in the heap. */
+template <typename TQueue>
+static bool CheckSize(TQueue& queue, const size_t expectedSize)
+{
+  if(queue.size() != expectedSize || queue.CountValidNodes() != expectedSize ||
+     queue.empty() != (expectedSize == 0))
+  {
+    std::cerr << "The queue has size " << queue.size() << " and " << queue.CountValidNodes()
+              << " valid nodes, but should have " << expectedSize << "!" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+template <typename TQueueBackend>
+static void ConfigureBackend(TQueueBackend&)
+{
+
+}
+
+/** Put a few nodes in each bucket. The priorities above 400 are clamped into the last bucket. */
+static void ConfigureBackend(BucketQueueBackend<VertexListGraphType>& backend)
+{
+  backend.SetNumberOfBuckets(64);
+  backend.SetPriorityRange(0.0f, 400.0f);
+}
+
+/** Run the same operations on a queue with each backend. */
+template <typename TQueueBackend>
+static bool TestQueue()
+{
+  typedef IndirectPriorityQueue<VertexListGraphType, TQueueBackend> QueueType;
+
+  const unsigned int sideLength = 20;
+  boost::array<std::size_t, 2> graphSideLengths = {{sideLength, sideLength}};
+  VertexListGraphType graph(graphSideLengths);
+
+  std::vector<VertexDescriptorType> nodes;
+  for(unsigned int y = 0; y < sideLength; ++y)
+  {
+    for(unsigned int x = 0; x < sideLength; ++x)
+    {
+      VertexDescriptorType v = {{x, y}};
+      nodes.push_back(v);
+    }
+  }
+
+  QueueType queue(graph);
+  ConfigureBackend(queue.GetBackend());
+  queue.SetMinimumCompactionSize(16);
+  queue.SetCompactionFraction(0.25f);
+  if(!CheckSize(queue, 0))
+  {
+    return false;
+  }
+
+  for(size_t nodeId = 0; nodeId < nodes.size(); ++nodeId)
+  {
+    queue.push_or_update(nodes[nodeId], static_cast<float>(nodeId));
+  }
+
+  // Updating a queued node does not count it twice
+  queue.push_or_update(nodes[0], 1000.0f);
+  if(!CheckSize(queue, nodes.size()))
+  {
+    return false;
+  }
+
+  // Invalidate the odd nodes (and a node that is not queued, twice) so that the heap is compacted
+  for(size_t nodeId = 1; nodeId < nodes.size(); nodeId += 2)
+  {
+    queue.mark_as_invalid(nodes[nodeId]);
+    queue.mark_as_invalid(nodes[nodeId]);
+  }
+
+  size_t expectedSize = nodes.size() / 2;
+  if(!CheckSize(queue, expectedSize))
+  {
+    return false;
+  }
+
+  if(queue.GetNumberOfCompactions() == 0 || queue.GetHeapSize() > 2 * expectedSize)
+  {
+    std::cerr << "The heap was not compacted: it has " << queue.GetHeapSize() << " nodes after "
+              << queue.GetNumberOfCompactions() << " compactions." << std::endl;
+    return false;
+  }
+
+  // A node that was removed by the first compaction can come back to the boundary
+  queue.push_or_update(nodes[1], 2000.0f);
+  expectedSize++;
+  if(!CheckSize(queue, expectedSize))
+  {
+    return false;
+  }
+
+  // The nodes still come out in priority order
+  VertexDescriptorType expectedOrder[] = {nodes[1], nodes[0], nodes[nodes.size() - 2]};
+  for(unsigned int i = 0; i < 3; ++i)
+  {
+    VertexDescriptorType topNode = queue.top();
+    if(topNode != expectedOrder[i])
+    {
+      std::cerr << "Node " << i << " is (" << topNode[0] << ", " << topNode[1] << ") but should be ("
+                << expectedOrder[i][0] << ", " << expectedOrder[i][1] << ")!" << std::endl;
+      return false;
+    }
+    expectedSize--;
+  }
+
+  // Invalidating a node that was already returned by top() does not change the size
+  queue.mark_as_invalid(nodes[0]);
+  if(!CheckSize(queue, expectedSize))
+  {
+    return false;
+  }
+
+  while(!queue.empty())
+  {
+    queue.top();
+    expectedSize--;
+  }
+
+  if(expectedSize != 0 || !CheckSize(queue, 0))
+  {
+    std::cerr << "The queue returned the wrong number of nodes!" << std::endl;
+    return false;
+  }
+
+  queue.push_or_update(nodes[5], 1.0f);
+  queue.clear();
+  if(!CheckSize(queue, 0))
+  {
+    return false;
+  }
+
+  return true;
+}
+
+int main(int argc, char*argv[])
+{
+  if(!TestQueue<BinomialHeapQueueBackend<VertexListGraphType> >())
+  {
+    std::cerr << "The binomial heap queue failed!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if(!TestQueue<DAryHeapQueueBackend<VertexListGraphType, 4> >())
+  {
+    std::cerr << "The 4-ary heap queue failed!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if(!TestQueue<BucketQueueBackend<VertexListGraphType> >())
+  {
+    std::cerr << "The bucket queue failed!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,205 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// Custom
+#include "Drivers/InpaintingService.hpp"
+#include "Utilities/InpaintingServiceProtocol.hpp"
+
+// ITK
+#include "itkImage.h"
+#include "itkCovariantVector.h"
+
+// STL
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// POSIX
+#include <sys/socket.h>
+#include <unistd.h>
+
+// The client side of a request: an image of a single color with a square hole in the middle.
+static InpaintingServiceProtocol::Request CreateRequest(const unsigned int sideLength)
+{
+  InpaintingServiceProtocol::Request request;
+  request.Width = sideLength;
+  request.Height = sideLength;
+  request.PatchHalfWidth = 2;
+  request.Pixels.resize(3 * sideLength * sideLength);
+  request.MaskPixels.resize(sideLength * sideLength, 0);
+  for(unsigned int pixelId = 0; pixelId < sideLength * sideLength; ++pixelId)
+  {
+    request.Pixels[3 * pixelId + 0] = 10;
+    request.Pixels[3 * pixelId + 1] = 20;
+    request.Pixels[3 * pixelId + 2] = 30;
+
+    unsigned int x = pixelId % sideLength;
+    unsigned int y = pixelId / sideLength;
+    if(x >= sideLength / 2 - 2 && x < sideLength / 2 + 2 && y >= sideLength / 2 - 2 && y < sideLength / 2 + 2)
+    {
+      // The hole gets a value that must not survive the inpainting
+      request.Pixels[3 * pixelId + 0] = 255;
+      request.MaskPixels[pixelId] = 1;
+    }
+  }
+  return request;
+}
+
+int main(int argc, char*argv[])
+{
+  // The messages survive encoding, sending and decoding
+  int pipeFileDescriptors[2];
+  if(pipe(pipeFileDescriptors) != 0)
+  {
+    std::cerr << "Could not create a pipe!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  InpaintingServiceProtocol::Request request = CreateRequest(8);
+  InpaintingServiceProtocol::WriteMessage(pipeFileDescriptors[1], InpaintingServiceProtocol::EncodeRequest(request));
+  close(pipeFileDescriptors[1]);
+
+  std::vector<unsigned char> message;
+  InpaintingServiceProtocol::Request decodedRequest;
+  if(!InpaintingServiceProtocol::ReadMessage(pipeFileDescriptors[0], message))
+  {
+    std::cerr << "The request was not received!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  InpaintingServiceProtocol::DecodeRequest(message, decodedRequest);
+  if(decodedRequest.Width != 8 || decodedRequest.Height != 8 || decodedRequest.PatchHalfWidth != 2 ||
+     decodedRequest.Pixels != request.Pixels || decodedRequest.MaskPixels != request.MaskPixels)
+  {
+    std::cerr << "The decoded request is not the request that was sent!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if(InpaintingServiceProtocol::ReadMessage(pipeFileDescriptors[0], message))
+  {
+    std::cerr << "A message was read after the end of the stream!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  close(pipeFileDescriptors[0]);
+
+  // Patches that are empty or do not fit in the image are rejected
+  const unsigned int invalidPatchHalfWidths[] = {0, 4, 0x80000000u};
+  for(unsigned int halfWidthId = 0; halfWidthId < 3; ++halfWidthId)
+  {
+    InpaintingServiceProtocol::Request invalidRequest = request;
+    invalidRequest.PatchHalfWidth = invalidPatchHalfWidths[halfWidthId];
+    try
+    {
+      InpaintingServiceProtocol::DecodeRequest(InpaintingServiceProtocol::EncodeRequest(invalidRequest),
+                                               decodedRequest);
+    }
+    catch(const std::runtime_error&)
+    {
+      continue;
+    }
+    std::cerr << "A patch half width of " << invalidPatchHalfWidths[halfWidthId] << " was accepted!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Run the service on one end of a socket pair and act as its client on the other end
+  int socketFileDescriptors[2];
+  if(socketpair(AF_UNIX, SOCK_STREAM, 0, socketFileDescriptors) != 0)
+  {
+    std::cerr << "Could not create a socket pair!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  typedef itk::Image<itk::CovariantVector<int, 3>, 2> ImageType;
+  InpaintingService<ImageType> service;
+  std::thread serviceThread([&service, &socketFileDescriptors]()
+  {
+    service.Serve(socketFileDescriptors[1], socketFileDescriptors[1]);
+  });
+
+  // Two requests of the same size (the second one reuses the workspace of the first), a malformed one and
+  // one without any source patch
+  InpaintingServiceProtocol::Request imageRequest = CreateRequest(30);
+  for(unsigned int requestId = 0; requestId < 2; ++requestId)
+  {
+    InpaintingServiceProtocol::WriteMessage(socketFileDescriptors[0],
+                                            InpaintingServiceProtocol::EncodeRequest(imageRequest));
+  }
+  InpaintingServiceProtocol::WriteMessage(socketFileDescriptors[0], std::vector<unsigned char>(5, 0));
+  InpaintingServiceProtocol::Request holeRequest = CreateRequest(30);
+  std::fill(holeRequest.MaskPixels.begin(), holeRequest.MaskPixels.end(), 1);
+  InpaintingServiceProtocol::WriteMessage(socketFileDescriptors[0],
+                                          InpaintingServiceProtocol::EncodeRequest(holeRequest));
+  shutdown(socketFileDescriptors[0], SHUT_WR);
+
+  bool correct = true;
+  for(unsigned int responseId = 0; responseId < 4; ++responseId)
+  {
+    InpaintingServiceProtocol::Response response;
+    if(!InpaintingServiceProtocol::ReadMessage(socketFileDescriptors[0], message))
+    {
+      std::cerr << "Response " << responseId << " was not received!" << std::endl;
+      correct = false;
+      break;
+    }
+    InpaintingServiceProtocol::DecodeResponse(message, response);
+
+    if(responseId >= 2)
+    {
+      if(response.Succeeded)
+      {
+        std::cerr << "The malformed request " << responseId << " did not fail!" << std::endl;
+        correct = false;
+      }
+      continue;
+    }
+
+    if(!response.Succeeded || response.Pixels.size() != imageRequest.Pixels.size())
+    {
+      std::cerr << "Response " << responseId << " failed: " << response.Error << std::endl;
+      correct = false;
+      continue;
+    }
+
+    // Every pixel, including the filled hole, has the color of the image
+    for(size_t pixelId = 0; pixelId < response.Pixels.size() / 3; ++pixelId)
+    {
+      if(response.Pixels[3 * pixelId + 0] != 10 || response.Pixels[3 * pixelId + 1] != 20 ||
+         response.Pixels[3 * pixelId + 2] != 30)
+      {
+        std::cerr << "Pixel " << pixelId << " of response " << responseId << " was not filled correctly!" << std::endl;
+        correct = false;
+        break;
+      }
+    }
+  }
+
+  serviceThread.join();
+  close(socketFileDescriptors[0]);
+  close(socketFileDescriptors[1]);
+
+  if(service.GetNumberOfReusedWorkspaces() != 1)
+  {
+    std::cerr << "The second request reused " << service.GetNumberOfReusedWorkspaces()
+              << " workspaces but should have reused 1." << std::endl;
+    correct = false;
+  }
+
+  return correct ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,143 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// Custom
+#include "Utilities/PyramidHelpers.hpp"
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+#include <Mask/Mask.h>
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegionIterator.h"
+
+// STL
+#include <cstdlib>
+#include <iostream>
+
+typedef itk::Image<itk::CovariantVector<unsigned char, 3>, 2> ImageType;
+
+int main(int, char*[])
+{
+  srand(0);
+
+  // Odd sizes, so the last coarse column and row cover partial blocks
+  itk::Index<2> corner = {{0, 0}};
+  itk::Size<2> size = {{9, 7}};
+  itk::ImageRegion<2> region(corner, size);
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(region);
+  image->Allocate();
+
+  itk::ImageRegionIterator<ImageType> imageIterator(image, region);
+  while(!imageIterator.IsAtEnd())
+  {
+    ImageType::PixelType pixel;
+    for(unsigned int component = 0; component < 3; ++component)
+    {
+      pixel[component] = rand() % 255;
+    }
+    imageIterator.Set(pixel);
+    ++imageIterator;
+  }
+
+  Mask::Pointer mask = Mask::New();
+  mask->SetRegions(region);
+  mask->Allocate();
+  ITKHelpers::SetImageToConstant(mask.GetPointer(), mask->GetValidValue());
+
+  // A hole that covers only part of some blocks, and a single hole pixel in the last (partial) column
+  itk::Index<2> holeCorner = {{3, 2}};
+  itk::Size<2> holeSize = {{3, 2}};
+  ITKHelpers::SetRegionToConstant(mask.GetPointer(), itk::ImageRegion<2>(holeCorner, holeSize),
+                                  mask->GetHoleValue());
+  itk::Index<2> holePixel = {{8, 5}};
+  mask->SetPixel(holePixel, mask->GetHoleValue());
+
+  ImageType::Pointer coarseImage = ImageType::New();
+  Mask::Pointer coarseMask = Mask::New();
+  PyramidHelpers::DownsampleMasked(image.GetPointer(), mask.GetPointer(), coarseImage.GetPointer(),
+                                   coarseMask.GetPointer());
+
+  itk::Size<2> expectedSize = {{5, 4}};
+  if(coarseImage->GetLargestPossibleRegion() != PyramidHelpers::GetDownsampledRegion(region) ||
+     coarseImage->GetLargestPossibleRegion().GetSize() != expectedSize ||
+     coarseMask->GetLargestPossibleRegion() != coarseImage->GetLargestPossibleRegion())
+  {
+    std::cerr << "The coarse region is " << coarseImage->GetLargestPossibleRegion() << "!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  itk::ImageRegionIterator<ImageType> coarseIterator(coarseImage, coarseImage->GetLargestPossibleRegion());
+  while(!coarseIterator.IsAtEnd())
+  {
+    itk::Index<2> coarseIndex = coarseIterator.GetIndex();
+
+    // The fine pixels that this coarse pixel covers
+    float sum[3] = {0.0f, 0.0f, 0.0f};
+    unsigned int numberOfPixels = 0;
+    bool hole = false;
+    for(long y = 2 * coarseIndex[1]; y < 2 * coarseIndex[1] + 2 && y < static_cast<long>(size[1]); ++y)
+    {
+      for(long x = 2 * coarseIndex[0]; x < 2 * coarseIndex[0] + 2 && x < static_cast<long>(size[0]); ++x)
+      {
+        itk::Index<2> pixel = {{x, y}};
+        if(PyramidHelpers::GetCoarseIndex(pixel) != coarseIndex)
+        {
+          std::cerr << "The coarse index of " << pixel << " is not " << coarseIndex << "!" << std::endl;
+          return EXIT_FAILURE;
+        }
+
+        hole = hole || mask->IsHole(pixel);
+        for(unsigned int component = 0; component < 3; ++component)
+        {
+          sum[component] += image->GetPixel(pixel)[component];
+        }
+        numberOfPixels++;
+      }
+    }
+
+    if(coarseMask->IsHole(coarseIndex) != hole)
+    {
+      std::cerr << "The coarse pixel " << coarseIndex << " should " << (hole ? "" : "not ") << "be a hole!"
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    // The valid coarse pixels are the mean of their blocks
+    if(!hole)
+    {
+      for(unsigned int component = 0; component < 3; ++component)
+      {
+        unsigned char expected = static_cast<unsigned char>(sum[component] / static_cast<float>(numberOfPixels));
+        if(coarseIterator.Get()[component] != expected)
+        {
+          std::cerr << "The coarse pixel " << coarseIndex << " is " << coarseIterator.Get()
+                    << " instead of the mean of its block!" << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+    }
+
+    ++coarseIterator;
+  }
+
+  return EXIT_SUCCESS;
+}
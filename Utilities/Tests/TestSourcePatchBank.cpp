@@ -0,0 +1,200 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// Custom
+#include "Utilities/SourcePatchBank.hpp"
+
+// ITK
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+#include <Mask/Mask.h>
+
+// Boost
+#include <boost/graph/grid_graph.hpp>
+
+// STL
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <string>
+#include <utility>
+
+typedef boost::graph_traits<boost::grid_graph<2> >::vertex_descriptor VertexDescriptorType;
+typedef SourcePatchBank<VertexDescriptorType> SourcePatchBankType;
+
+/** Check every pixel of the patch centered at 'center' instead of using the summed area table. */
+static bool IsValidSourcePatch(const Mask* const mask, const itk::Index<2>& center, const unsigned int patchHalfWidth)
+{
+  const long radius = static_cast<long>(patchHalfWidth);
+  for(long y = center[1] - radius; y <= center[1] + radius; ++y)
+  {
+    for(long x = center[0] - radius; x <= center[0] + radius; ++x)
+    {
+      itk::Index<2> pixel = {{x, y}};
+      if(!mask->GetLargestPossibleRegion().IsInside(pixel) || !mask->IsValid(pixel))
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/** Check that the bank contains exactly the valid source patches of 'mask', each of them once. */
+static bool MatchesMask(const SourcePatchBankType& bank, const Mask* const mask, const unsigned int patchHalfWidth,
+                        const std::string& description)
+{
+  size_t numberOfValidPatches = 0;
+  itk::ImageRegionConstIteratorWithIndex<Mask> maskIterator(mask, mask->GetLargestPossibleRegion());
+  while(!maskIterator.IsAtEnd())
+  {
+    const bool valid = IsValidSourcePatch(mask, maskIterator.GetIndex(), patchHalfWidth);
+    if(bank.Contains(maskIterator.GetIndex()) != valid)
+    {
+      std::cerr << description << ": Contains(" << maskIterator.GetIndex() << ") is " << !valid
+                << " but should be " << valid << "!" << std::endl;
+      return false;
+    }
+    if(valid)
+    {
+      numberOfValidPatches++;
+    }
+    ++maskIterator;
+  }
+
+  std::set<std::pair<size_t, size_t> > nodes;
+  for(SourcePatchBankType::ConstIteratorType nodeIterator = bank.begin(); nodeIterator != bank.end(); ++nodeIterator)
+  {
+    if(!nodes.insert(std::make_pair((*nodeIterator)[0], (*nodeIterator)[1])).second)
+    {
+      std::cerr << description << ": the bank contains " << (*nodeIterator)[0] << " " << (*nodeIterator)[1]
+                << " twice!" << std::endl;
+      return false;
+    }
+  }
+
+  if(bank.size() != numberOfValidPatches)
+  {
+    std::cerr << description << ": the bank has " << bank.size() << " patches but there are "
+              << numberOfValidPatches << " valid source patches!" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+static itk::ImageRegion<2> RandomRegion(const itk::ImageRegion<2>& fullRegion, const unsigned int maximumSize)
+{
+  itk::Index<2> corner = {{fullRegion.GetIndex()[0] + rand() % static_cast<long>(fullRegion.GetSize()[0]),
+                           fullRegion.GetIndex()[1] + rand() % static_cast<long>(fullRegion.GetSize()[1])}};
+  itk::Size<2> size = {{static_cast<itk::SizeValueType>(rand() % maximumSize + 1),
+                        static_cast<itk::SizeValueType>(rand() % maximumSize + 1)}};
+  itk::ImageRegion<2> region(corner, size);
+  region.Crop(fullRegion);
+  return region;
+}
+
+int main(int, char*[])
+{
+  srand(0);
+
+  const unsigned int patchHalfWidth = 2;
+
+  // The region does not start at zero, so the bank has to offset its indices
+  itk::Index<2> corner = {{4, 3}};
+  itk::Size<2> size = {{41, 33}};
+  itk::ImageRegion<2> region(corner, size);
+
+  Mask::Pointer mask = Mask::New();
+  mask->SetRegions(region);
+  mask->Allocate();
+  ITKHelpers::SetImageToConstant(mask.GetPointer(), mask->GetValidValue());
+
+  for(unsigned int holeId = 0; holeId < 8; ++holeId)
+  {
+    ITKHelpers::SetRegionToConstant(mask.GetPointer(), RandomRegion(region, 7), mask->GetHoleValue());
+  }
+
+  // The integral image of the invalid pixels in the constructor
+  SourcePatchBankType bank(mask, patchHalfWidth);
+  if(!MatchesMask(bank, mask, patchHalfWidth, "Initial mask"))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Fill patches as InpaintingVisitor does, and add the patches around each one that became valid
+  for(unsigned int fillId = 0; fillId < 40; ++fillId)
+  {
+    itk::ImageRegion<2> filledRegion = RandomRegion(region, 2 * patchHalfWidth + 1);
+    ITKHelpers::SetRegionToConstant(mask.GetPointer(), filledRegion, mask->GetValidValue());
+
+    const size_t previousSize = bank.size();
+    const unsigned int numberOfAddedPatches =
+        bank.AddValidPatchesInRegion(ITKHelpers::DilateRegion(filledRegion, patchHalfWidth));
+    if(bank.size() != previousSize + numberOfAddedPatches)
+    {
+      std::cerr << "Fill " << fillId << ": " << numberOfAddedPatches << " patches were reported added but the bank "
+                << "grew by " << bank.size() - previousSize << "!" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    if(!MatchesMask(bank, mask, patchHalfWidth, "After the fill"))
+    {
+      return EXIT_FAILURE;
+    }
+  }
+
+  // The patches that are already in the bank are not added again
+  if(bank.AddValidPatchesInRegion(region) != 0)
+  {
+    std::cerr << "Patches were added twice!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Once there are no holes left, every patch inside the image is a source patch
+  ITKHelpers::SetImageToConstant(mask.GetPointer(), mask->GetValidValue());
+  bank.AddValidPatchesInRegion(region);
+  if(!MatchesMask(bank, mask, patchHalfWidth, "Without holes"))
+  {
+    return EXIT_FAILURE;
+  }
+
+  if(bank.size() != (size[0] - 2 * patchHalfWidth) * (size[1] - 2 * patchHalfWidth))
+  {
+    std::cerr << "Not every patch inside the image is a source patch!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // A mask that is smaller than a patch has no source patches
+  itk::Size<2> smallSize = {{2 * patchHalfWidth, 2 * patchHalfWidth + 1}};
+  Mask::Pointer smallMask = Mask::New();
+  smallMask->SetRegions(itk::ImageRegion<2>(corner, smallSize));
+  smallMask->Allocate();
+  ITKHelpers::SetImageToConstant(smallMask.GetPointer(), smallMask->GetValidValue());
+
+  SourcePatchBankType smallBank(smallMask, patchHalfWidth);
+  if(smallBank.size() != 0)
+  {
+    std::cerr << "A mask smaller than a patch has source patches!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
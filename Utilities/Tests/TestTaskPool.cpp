@@ -0,0 +1,130 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// Custom
+#include "Utilities/TaskPool.h"
+
+// STL
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+int main(int argc, char*argv[])
+{
+  TaskPool pool(4);
+
+  // Every index is visited exactly once
+  const long numberOfIndices = 10000;
+  std::vector<int> visits(numberOfIndices, 0);
+  pool.ParallelFor(0, numberOfIndices, [&visits](const long i) { visits[i]++; });
+  for(long i = 0; i < numberOfIndices; ++i)
+  {
+    if(visits[i] != 1)
+    {
+      std::cerr << "Index " << i << " was visited " << visits[i] << " times!" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Nested loops run on the same workers and must not deadlock, even when there are more outer
+  // iterations than workers.
+  std::atomic<long> sum(0);
+  pool.ParallelFor(0, 16, [&pool, &sum](const long i)
+  {
+    pool.ParallelFor(0, 1000, [&sum, i](const long j) { sum += i * j; });
+  });
+
+  const long expectedSum = (15 * 16 / 2) * (999 * 1000 / 2);
+  if(sum != expectedSum)
+  {
+    std::cerr << "The nested sum is " << sum << " but should be " << expectedSum << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // The exception of a task is rethrown by the loop
+  bool caught = false;
+  try
+  {
+    pool.ParallelFor(0, 100, [](const long i)
+    {
+      if(i == 42)
+      {
+        throw std::runtime_error("Task 42 failed");
+      }
+    });
+  }
+  catch(std::runtime_error&)
+  {
+    caught = true;
+  }
+
+  if(!caught)
+  {
+    std::cerr << "The exception of a task was not rethrown!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Independent task groups
+  std::atomic<int> numberOfTasksRun(0);
+  {
+    TaskGroup taskGroup(pool);
+    for(int taskId = 0; taskId < 50; ++taskId)
+    {
+      taskGroup.Run([&numberOfTasksRun]() { numberOfTasksRun++; });
+    }
+    taskGroup.Wait();
+  }
+
+  if(numberOfTasksRun != 50)
+  {
+    std::cerr << "Only " << numberOfTasksRun << " of 50 tasks were run!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // A thread that waits for its own loop must not start another task of the outer group, otherwise
+  // independent jobs would be nested in each other's waits
+  std::atomic<int> numberOfNestedTasks(0);
+  {
+    TaskGroup taskGroup(pool);
+    for(int taskId = 0; taskId < 32; ++taskId)
+    {
+      taskGroup.Run([&pool, &numberOfNestedTasks]()
+      {
+        static thread_local int depth = 0;
+        if(++depth > 1)
+        {
+          numberOfNestedTasks++;
+        }
+        pool.ParallelFor(0, 1000, [](const long) { std::this_thread::yield(); });
+        depth--;
+      });
+    }
+    taskGroup.Wait();
+  }
+
+  if(numberOfNestedTasks != 0)
+  {
+    std::cerr << numberOfNestedTasks << " tasks were run while another task of their group waited!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,138 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// Custom
+#include "Utilities/TiledSummedAreaTable.h"
+
+// STL
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+/** The values of a small image, with the same interface as the value function of TiledSummedAreaTable::Update. */
+struct ValueImage
+{
+  itk::ImageRegion<2> Region;
+  std::vector<float> Values;
+
+  float operator()(const itk::Index<2>& pixel) const
+  {
+    return this->Values[(pixel[1] - this->Region.GetIndex()[1]) * this->Region.GetSize()[0] +
+                        pixel[0] - this->Region.GetIndex()[0]];
+  }
+
+  double Sum(const itk::ImageRegion<2>& region) const
+  {
+    double sum = 0.0;
+    for(long y = region.GetIndex()[1]; y < region.GetIndex()[1] + static_cast<long>(region.GetSize()[1]); ++y)
+    {
+      for(long x = region.GetIndex()[0]; x < region.GetIndex()[0] + static_cast<long>(region.GetSize()[0]); ++x)
+      {
+        itk::Index<2> pixel = {{x, y}};
+        sum += (*this)(pixel);
+      }
+    }
+    return sum;
+  }
+};
+
+static itk::ImageRegion<2> RandomRegion(const itk::ImageRegion<2>& fullRegion, const unsigned int maximumSize)
+{
+  itk::Index<2> corner = {{fullRegion.GetIndex()[0] + rand() % static_cast<long>(fullRegion.GetSize()[0]),
+                           fullRegion.GetIndex()[1] + rand() % static_cast<long>(fullRegion.GetSize()[1])}};
+  itk::Size<2> size = {{static_cast<itk::SizeValueType>(rand() % maximumSize + 1),
+                        static_cast<itk::SizeValueType>(rand() % maximumSize + 1)}};
+  itk::ImageRegion<2> region(corner, size);
+  region.Crop(fullRegion);
+  return region;
+}
+
+/** Change the values in random regions and compare the sums over random regions to the sums of the pixels. */
+static bool TestTileSize(const unsigned int tileSize)
+{
+  // The region does not start at zero and is not a multiple of the tile size
+  itk::Index<2> corner = {{3, -2}};
+  itk::Size<2> size = {{37, 29}};
+
+  ValueImage image;
+  image.Region = itk::ImageRegion<2>(corner, size);
+  image.Values.resize(image.Region.GetNumberOfPixels());
+  for(size_t pixelId = 0; pixelId < image.Values.size(); ++pixelId)
+  {
+    image.Values[pixelId] = static_cast<float>(rand() % 100) / 100.0f;
+  }
+
+  TiledSummedAreaTable table;
+  table.Initialize(image.Region, tileSize);
+  table.Update(image.Region, image);
+
+  for(unsigned int iteration = 0; iteration < 200; ++iteration)
+  {
+    // Change a region, as the confidences of a filled patch change
+    itk::ImageRegion<2> changedRegion = RandomRegion(image.Region, 2 * tileSize + 1);
+    for(long y = changedRegion.GetIndex()[1];
+        y < changedRegion.GetIndex()[1] + static_cast<long>(changedRegion.GetSize()[1]); ++y)
+    {
+      for(long x = changedRegion.GetIndex()[0];
+          x < changedRegion.GetIndex()[0] + static_cast<long>(changedRegion.GetSize()[0]); ++x)
+      {
+        image.Values[(y - corner[1]) * size[0] + x - corner[0]] = static_cast<float>(rand() % 100) / 100.0f;
+      }
+    }
+    table.Update(changedRegion, image);
+
+    for(unsigned int queryId = 0; queryId < 10; ++queryId)
+    {
+      itk::ImageRegion<2> queryRegion = RandomRegion(image.Region, 3 * tileSize + 2);
+      const double expectedSum = image.Sum(queryRegion);
+      const double sum = table.GetSum(queryRegion);
+      if(std::abs(sum - expectedSum) > 1e-6)
+      {
+        std::cerr << "Tile size " << tileSize << ": the sum over " << queryRegion.GetIndex() << " "
+                  << queryRegion.GetSize() << " is " << sum << " but should be " << expectedSum << "!" << std::endl;
+        return false;
+      }
+    }
+  }
+
+  // The whole image
+  if(std::abs(table.GetSum(image.Region) - image.Sum(image.Region)) > 1e-6)
+  {
+    std::cerr << "Tile size " << tileSize << ": the sum over the whole image is wrong!" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+int main(int, char*[])
+{
+  srand(0);
+
+  const unsigned int tileSizes[] = {1, 4, 7, 11, 64};
+  for(unsigned int tileSizeId = 0; tileSizeId < sizeof(tileSizes) / sizeof(tileSizes[0]); ++tileSizeId)
+  {
+    if(!TestTileSize(tileSizes[tileSizeId]))
+    {
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
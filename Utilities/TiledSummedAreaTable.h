@@ -0,0 +1,189 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef TiledSummedAreaTable_H
+#define TiledSummedAreaTable_H
+
+// ITK
+#include "itkImageRegion.h"
+
+// STL
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+/** The sums of a value over rectangles of an image, where the values change in small regions. The image is split
+  * into square tiles, and each tile has its own summed area table: the value at a pixel is the sum of the values
+  * of the tile from the tile corner to that pixel. The sum over a rectangle is then four lookups in each of the
+  * tiles it overlaps, and a change of the values only recomputes the tables of the tiles it overlaps.
+  *
+  * With tiles as wide as the rectangles that are summed, a sum reads at most four tiles, and a change of a
+  * rectangle of that size recomputes at most four tiles. A single summed area table of the whole image would
+  * make every change recompute the table up to the far corner of the image.
+  *
+  * The sums are kept in doubles, so summing many floats in a different order than a plain loop does only
+  * differs in the last bits of a float. */
+class TiledSummedAreaTable
+{
+public:
+  TiledSummedAreaTable() : TileSize(0), Width(0), Height(0)
+  {
+
+  }
+
+  /** Allocate the tables for 'fullRegion' and set all of the values to zero. */
+  void Initialize(const itk::ImageRegion<2>& fullRegion, const unsigned int tileSize)
+  {
+    if(tileSize == 0)
+    {
+      throw std::runtime_error("TiledSummedAreaTable: The tile size must be at least 1!");
+    }
+
+    this->FullRegion = fullRegion;
+    this->TileSize = tileSize;
+    this->Width = static_cast<long>(fullRegion.GetSize()[0]);
+    this->Height = static_cast<long>(fullRegion.GetSize()[1]);
+    this->Sums.assign(fullRegion.GetNumberOfPixels(), 0.0);
+  }
+
+  const itk::ImageRegion<2>& GetFullRegion() const
+  {
+    return this->FullRegion;
+  }
+
+  unsigned int GetTileSize() const
+  {
+    return this->TileSize;
+  }
+
+  /** Recompute the tables of the tiles that overlap 'region' from valueFunction(itk::Index<2>), which is called
+    * for every pixel of those tiles (not only for the pixels of 'region'). */
+  template <typename TValueFunction>
+  void Update(const itk::ImageRegion<2>& region, TValueFunction valueFunction)
+  {
+    itk::ImageRegion<2> croppedRegion = region;
+    if(!croppedRegion.Crop(this->FullRegion))
+    {
+      return;
+    }
+
+    const long firstTileX = (croppedRegion.GetIndex()[0] - this->FullRegion.GetIndex()[0]) / this->TileSize;
+    const long firstTileY = (croppedRegion.GetIndex()[1] - this->FullRegion.GetIndex()[1]) / this->TileSize;
+    const long lastTileX = (croppedRegion.GetIndex()[0] - this->FullRegion.GetIndex()[0] +
+                            static_cast<long>(croppedRegion.GetSize()[0]) - 1) / this->TileSize;
+    const long lastTileY = (croppedRegion.GetIndex()[1] - this->FullRegion.GetIndex()[1] +
+                            static_cast<long>(croppedRegion.GetSize()[1]) - 1) / this->TileSize;
+
+    for(long tileY = firstTileY; tileY <= lastTileY; ++tileY)
+    {
+      for(long tileX = firstTileX; tileX <= lastTileX; ++tileX)
+      {
+        this->UpdateTile(tileX, tileY, valueFunction);
+      }
+    }
+  }
+
+  /** The sum of the values in 'region', which must be inside the full region. */
+  double GetSum(const itk::ImageRegion<2>& region) const
+  {
+    const long startX = region.GetIndex()[0] - this->FullRegion.GetIndex()[0];
+    const long startY = region.GetIndex()[1] - this->FullRegion.GetIndex()[1];
+    const long endX = startX + static_cast<long>(region.GetSize()[0]) - 1;
+    const long endY = startY + static_cast<long>(region.GetSize()[1]) - 1;
+
+    const long tileSize = static_cast<long>(this->TileSize);
+
+    double sum = 0.0;
+    for(long tileStartY = (startY / tileSize) * tileSize; tileStartY <= endY; tileStartY += tileSize)
+    {
+      // The part of the region in this row of tiles
+      const long y0 = std::max(startY, tileStartY);
+      const long y1 = std::min(endY, tileStartY + tileSize - 1);
+
+      for(long tileStartX = (startX / tileSize) * tileSize; tileStartX <= endX; tileStartX += tileSize)
+      {
+        const long x0 = std::max(startX, tileStartX);
+        const long x1 = std::min(endX, tileStartX + tileSize - 1);
+
+        // The sums from the tile corner are zero above and left of the tile
+        sum += this->GetTileSum(x1, y1);
+        if(x0 > tileStartX)
+        {
+          sum -= this->GetTileSum(x0 - 1, y1);
+        }
+        if(y0 > tileStartY)
+        {
+          sum -= this->GetTileSum(x1, y0 - 1);
+        }
+        if(x0 > tileStartX && y0 > tileStartY)
+        {
+          sum += this->GetTileSum(x0 - 1, y0 - 1);
+        }
+      }
+    }
+
+    return sum;
+  }
+
+private:
+  itk::ImageRegion<2> FullRegion;
+
+  unsigned int TileSize;
+
+  long Width;
+
+  long Height;
+
+  /** The sum from the tile corner to each pixel, in raster order of the full region. */
+  std::vector<double> Sums;
+
+  /** The table value at (x, y), relative to the corner of the full region. */
+  double GetTileSum(const long x, const long y) const
+  {
+    return this->Sums[y * this->Width + x];
+  }
+
+  template <typename TValueFunction>
+  void UpdateTile(const long tileX, const long tileY, TValueFunction& valueFunction)
+  {
+    const long tileSize = static_cast<long>(this->TileSize);
+    const long tileStartX = tileX * tileSize;
+    const long tileStartY = tileY * tileSize;
+    const long tileEndX = std::min(this->Width, tileStartX + tileSize);
+    const long tileEndY = std::min(this->Height, tileStartY + tileSize);
+
+    for(long y = tileStartY; y < tileEndY; ++y)
+    {
+      // The sum of the row of the tile up to x, added to the table value of the row above
+      double rowSum = 0.0;
+      for(long x = tileStartX; x < tileEndX; ++x)
+      {
+        itk::Index<2> pixel = {{this->FullRegion.GetIndex()[0] + x, this->FullRegion.GetIndex()[1] + y}};
+        rowSum += valueFunction(pixel);
+
+        double sum = rowSum;
+        if(y > tileStartY)
+        {
+          sum += this->Sums[(y - 1) * this->Width + x];
+        }
+        this->Sums[y * this->Width + x] = sum;
+      }
+    }
+  }
+};
+
+#endif
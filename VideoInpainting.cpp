@@ -0,0 +1,97 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// ITK
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkCovariantVector.h"
+
+// Submodules
+#include <Helpers/Helpers.h>
+#include <ITKHelpers/ITKHelpers.h>
+#include <Mask/Mask.h>
+
+// STL
+#include <sstream>
+
+#include "Drivers/VideoInpainting.hpp"
+
+// Run with: 15 100 frame0.png frame0.mask frame0_filled.png frame1.png frame1.mask frame1_filled.png ...
+int main(int argc, char *argv[])
+{
+  // Verify arguments
+  if(argc < 6 || (argc - 3) % 3 != 0)
+  {
+    std::cerr << "Required arguments: patchHalfWidth warmStartThreshold "
+              << "frame0.png frame0.mask output0.png [frame1.png frame1.mask output1.png ...]" << std::endl;
+    std::cerr << "Input arguments: ";
+    for(int i = 1; i < argc; ++i)
+    {
+      std::cerr << argv[i] << " ";
+    }
+    return EXIT_FAILURE;
+  }
+
+  // Parse arguments
+  std::stringstream ssPatchHalfWidth;
+  ssPatchHalfWidth << argv[1];
+  unsigned int patchHalfWidth = 0;
+  ssPatchHalfWidth >> patchHalfWidth;
+
+  std::stringstream ssWarmStartThreshold;
+  ssWarmStartThreshold << argv[2];
+  float warmStartThreshold = 0;
+  ssWarmStartThreshold >> warmStartThreshold;
+
+  typedef itk::Image<itk::CovariantVector<int, 3>, 2> OriginalImageType;
+  typedef itk::ImageFileReader<OriginalImageType> ImageReaderType;
+
+  // The frames are inpainted in order, and only the source pixel map is kept from one frame to the next
+  itk::Image<itk::Index<2>, 2>::Pointer previousSourcePixelMap;
+  for(int argumentId = 3; argumentId + 2 < argc; argumentId += 3)
+  {
+    std::cout << "VideoInpainting: inpainting " << argv[argumentId] << std::endl;
+
+    ImageReaderType::Pointer imageReader = ImageReaderType::New();
+    imageReader->SetFileName(argv[argumentId]);
+    imageReader->Update();
+
+    OriginalImageType::Pointer frame = OriginalImageType::New();
+    ITKHelpers::DeepCopy(imageReader->GetOutput(), frame.GetPointer());
+
+    Mask::Pointer mask = Mask::New();
+    mask->Read(argv[argumentId + 1]);
+
+    previousSourcePixelMap = VideoFrameInpainting(frame, mask.GetPointer(), patchHalfWidth,
+                                                  previousSourcePixelMap.GetPointer(), warmStartThreshold);
+
+    // If the output filename is a png file, then use the RGBImage writer so that it is first
+    // casted to unsigned char. Otherwise, write the file directly.
+    std::string outputFileName = argv[argumentId + 2];
+    if(Helpers::GetFileExtension(outputFileName) == "png")
+    {
+      ITKHelpers::WriteRGBImage(frame.GetPointer(), outputFileName);
+    }
+    else
+    {
+      ITKHelpers::WriteImage(frame.GetPointer(), outputFileName);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -23,6 +23,7 @@
 
 // STL
 #include <memory>
+#include <vector>
 
 // Concepts
 #include "Concepts/DescriptorVisitorConcept.hpp"
@@ -30,6 +31,11 @@
 // Accept criteria
 #include "ImageProcessing/BoundaryEnergy.h"
 
+// Custom
+#include "ImageProcessing/FillFront.h"
+#include "Utilities/SourcePatchBank.hpp"
+#include "Utilities/TaskPool.h"
+
 // Boost
 #include <boost/graph/graph_traits.hpp>
 #include <boost/property_map/property_map.hpp>
@@ -97,6 +103,17 @@ class InpaintingVisitor : public InpaintingVisitorParent<TGraph>, public Debug
   typedef itk::Image<itk::Index<2>, 2> SourcePixelMapImageType;
   SourcePixelMapImageType::Pointer SourcePixelMapImage;
 
+  /** The boundary of the hole. It is computed from the mask the first time it is needed (so the mask can still
+    * be changed after the visitor is created), and then updated around each filled patch. */
+  std::shared_ptr<FillFront> Front;
+
+public:
+  typedef SourcePatchBank<VertexDescriptorType> SourcePatchBankType;
+
+private:
+  /** The list of valid source patches. If this is set, it is kept up to date as new patches become valid. */
+  std::shared_ptr<SourcePatchBankType> PatchBank;
+
 public:
 
   CopiedPixelsImageType* GetCopiedPixelsImage()
@@ -114,11 +131,27 @@ public:
     return &this->UsedNodesSet;
   }
 
+  /** The fill front that this visitor keeps up to date, for the priority function and InitializePriority. */
+  std::shared_ptr<FillFront> GetFillFront()
+  {
+    if(!this->Front->IsInitialized())
+    {
+      this->Front->Initialize();
+    }
+    return this->Front;
+  }
+
   void SetAllowNewPatches(const bool allowNewPatches)
   {
     this->AllowNewPatches = allowNewPatches;
   }
 
+  /** Set the source patch bank to add new source patches to (only used if AllowNewPatches is true). */
+  void SetSourcePatchBank(std::shared_ptr<SourcePatchBankType> sourcePatchBank)
+  {
+    this->PatchBank = sourcePatchBank;
+  }
+
   /** Constructor. Everything must be specified in this constructor. (There is no default constructor). */
   InpaintingVisitor(Mask* const mask,
                     std::shared_ptr<TBoundaryNodeQueue> boundaryNodeQueue,
@@ -130,7 +163,7 @@ public:
     InpaintingVisitorParent<TGraph>(visitorName),
     MaskImage(mask), BoundaryNodeQueue(boundaryNodeQueue), PriorityFunction(priorityFunction),
     DescriptorVisitor(descriptorVisitor), AcceptanceVisitor(acceptanceVisitor),
-    PatchHalfWidth(patchHalfWidth)
+    PatchHalfWidth(patchHalfWidth), Front(new FillFront(mask))
   {
     this->FullRegion = this->MaskImage->GetLargestPossibleRegion();
 
@@ -182,7 +215,7 @@ public:
       throw std::runtime_error(ss.str());
     }
 
-    if(!this->MaskImage->HasHoleNeighbor(ITKHelpers::CreateIndex(target)))
+    if(!this->GetFillFront()->IsOnFront(ITKHelpers::CreateIndex(target)))
     {
       std::stringstream ss;
       ss << "InpaintingVisitor::PotentialMatchMade: Potential target pixel " << target[0] << " " << target[1]
@@ -268,6 +301,9 @@ public:
     ITKHelpers::SetRegionToConstant(this->MaskImage, regionToFinish,
                                     this->MaskImage->GetValidValue());
 
+    // Only the pixels around the filled region can join or leave the front
+    this->GetFillFront()->Update(regionToFinish);
+
     // Write an image of where the source and target patch were in this iteration.
 //    if(this->DebugImages && this->Image)
 //    {
@@ -314,6 +350,12 @@ public:
         InitializeVertex(v);
         ++gridIterator;
       }
+
+      // Add the patches that were just initialized as source patches to the list of source patches
+      if(this->PatchBank)
+      {
+        this->PatchBank->AddValidPatchesInRegion(regionToFinish);
+      }
     }
 
     // Add pixels that are on the new boundary to the queue, and mark other pixels as not in the queue.
@@ -349,8 +391,7 @@ public:
     {
       VertexDescriptorType v = Helpers::ConvertFrom<VertexDescriptorType, itk::Index<2> >(imageIterator.GetIndex());
 
-      if(this->MaskImage->GetPixel(imageIterator.GetIndex()) == this->MaskImage->GetValidValue() &&
-         this->MaskImage->HasHoleNeighbor(imageIterator.GetIndex()))
+      if(this->Front->IsOnFront(imageIterator.GetIndex()))
       {
         pixelsToCompute.push_back(imageIterator.GetIndex());
       }
@@ -363,14 +404,19 @@ public:
     }
 
 //    std::cout << "InpaintingVisitor::FinishVertex() update queue" << std::endl;
-    #pragma omp parallel for
-    for(IndexVectorType::const_iterator pixelIterator = pixelsToCompute.begin();
-        pixelIterator < pixelsToCompute.end(); ++pixelIterator)
+    // The queue is not thread safe, so only the priorities are computed in parallel. They are pushed
+    // afterwards in the order of pixelsToCompute, so the queue does not depend on the thread scheduling.
+    std::vector<float> priorities(pixelsToCompute.size());
+    TaskPool::GetGlobalInstance().ParallelFor(0, static_cast<long>(pixelsToCompute.size()),
+                                              [&](const long pixelId)
+    {
+      priorities[pixelId] = this->PriorityFunction->ComputePriority(pixelsToCompute[pixelId]);
+    });
+
+    for(size_t pixelId = 0; pixelId < pixelsToCompute.size(); ++pixelId)
     {
-      VertexDescriptorType v = Helpers::ConvertFrom<VertexDescriptorType, itk::Index<2> >(*pixelIterator);
-      float priority = this->PriorityFunction->ComputePriority(*pixelIterator);
-      #pragma omp critical // There are weird crashes without this guard
-      this->BoundaryNodeQueue->push_or_update(v, priority);
+      VertexDescriptorType v = Helpers::ConvertFrom<VertexDescriptorType, itk::Index<2> >(pixelsToCompute[pixelId]);
+      this->BoundaryNodeQueue->push_or_update(v, priorities[pixelId]);
     }
 
     // std::cout << "FinishVertex after traversing finishing region there are "
@@ -405,25 +451,15 @@ public:
      * V V V V F F F V
      */
 
-    // Expand the region
-//    std::cout << "InpaintingVisitor::FinishVertex() expand" << std::endl;
-    itk::ImageRegion<2> expandedRegion =
-        ITKHelpers::GetRegionInRadiusAroundPixel(indexToFinish, PatchHalfWidth + 1);
-    // Make sure the region is entirely inside the image (to allow for target regions near the image boundary)
-    expandedRegion.Crop(this->FullRegion);
-    std::vector<itk::Index<2> > boundaryPixels =
-        ITKHelpers::GetBoundaryPixels(expandedRegion);
-//    std::cout << "InpaintingVisitor::FinishVertex() boundary pixels" << std::endl;
-    for(unsigned int i = 0; i < boundaryPixels.size(); ++i)
+    // The fill front found these pixels when it was updated (the pixels of the filled region that left the
+    // front were already marked above).
+    const FillFront::PixelContainer& removedPixels = this->Front->GetRemovedPixels();
+    for(size_t i = 0; i < removedPixels.size(); ++i)
     {
-      // the region (the entire image) can be omitted, as this function automatically checks if the pixels are inside the image
-      if(!this->MaskImage->HasHoleNeighbor(boundaryPixels[i]))
-      {
-        VertexDescriptorType v =
-            Helpers::ConvertFrom<VertexDescriptorType, itk::Index<2> >(boundaryPixels[i]);
+      VertexDescriptorType v =
+          Helpers::ConvertFrom<VertexDescriptorType, itk::Index<2> >(removedPixels[i]);
 
-        put(this->BoundaryNodeQueue->BoundaryStatusMap, v, false);
-      }
+      this->BoundaryNodeQueue->mark_as_invalid(v);
     }
 
     // std::cout << "FinishVertex after removing stale nodes outside finishing region there are "